@@ -0,0 +1,175 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Accounting of the lock free fifos between the rt task of the shift
+ *        register gpio backends and sensei.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Every counter has a single writer, either the rt task or a non rt thread, so
+ * they are updated without contention and can be read from any thread.
+ */
+#ifndef SHIFTREG_RT_FIFO_MONITOR_H
+#define SHIFTREG_RT_FIFO_MONITOR_H
+
+#include <atomic>
+#include <cstdint>
+
+/* Size of the packet fifos in each direction, set from cmake */
+#ifndef SHIFTREG_GPIO_PACKET_Q_SIZE
+#define SHIFTREG_GPIO_PACKET_Q_SIZE 150
+#endif
+
+/* Size of the fifo of log messages from the rt task, set from cmake */
+#ifndef SHIFTREG_GPIO_LOG_MSG_Q_SIZE
+#define SHIFTREG_GPIO_LOG_MSG_Q_SIZE 50
+#endif
+
+namespace sensei {
+namespace hw_backend {
+namespace shiftregister_gpio {
+
+/**
+ * @brief What the rt task does with a packet for sensei when the fifo is full
+ */
+enum class RtFifoOverflowPolicy
+{
+    DROP,   /* Discard the packet */
+    DEFER   /* Keep it and stop taking packets from the gpio client until it fits */
+};
+
+struct RtFifoStatistics
+{
+    /* Packets from the gpio client discarded because the fifo to sensei was full */
+    uint64_t tx_packets_dropped{0};
+    /* Times a packet had to wait for the next tick because the fifo to sensei was full */
+    uint64_t tx_packets_deferred{0};
+    /* Ticks that ended with packets from sensei left in the fifo */
+    uint64_t rx_budget_exhausted{0};
+    /* Log messages discarded because the fifo to the logger was full */
+    uint64_t log_msgs_dropped{0};
+    /* Ticks where the max number of log messages was forwarded */
+    uint64_t log_budget_exhausted{0};
+    /* Max number of packets waiting in the fifo to and from sensei */
+    int      tx_fifo_high_water{0};
+    int      rx_fifo_high_water{0};
+};
+
+class RtFifoMonitor
+{
+public:
+    /* =======  Called from the rt task  ======= */
+
+    void tx_packet_pushed()
+    {
+        auto pushed = _tx_pushed.load(std::memory_order_relaxed) + 1;
+        _tx_pushed.store(pushed, std::memory_order_relaxed);
+        _update_high_water(_tx_high_water, pushed - _tx_popped.load(std::memory_order_relaxed));
+    }
+
+    void tx_packet_dropped()
+    {
+        _increment(_tx_dropped);
+    }
+
+    void tx_packet_deferred()
+    {
+        _increment(_tx_deferred);
+    }
+
+    void rx_packet_popped()
+    {
+        _increment(_rx_popped);
+    }
+
+    void rx_budget_exhausted()
+    {
+        _increment(_rx_budget_exhausted);
+    }
+
+    void log_msg_dropped()
+    {
+        _increment(_log_dropped);
+    }
+
+    void log_budget_exhausted()
+    {
+        _increment(_log_budget_exhausted);
+    }
+
+    /* =======  Called from the non rt threads sending and receiving packets  ======= */
+
+    void tx_packet_popped()
+    {
+        _increment(_tx_popped);
+    }
+
+    void rx_packet_pushed()
+    {
+        auto pushed = _rx_pushed.load(std::memory_order_relaxed) + 1;
+        _rx_pushed.store(pushed, std::memory_order_relaxed);
+        _update_high_water(_rx_high_water, pushed - _rx_popped.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Returns a snapshot of the counters, can be called from any thread
+     */
+    RtFifoStatistics statistics() const
+    {
+        RtFifoStatistics stats;
+        stats.tx_packets_dropped = _tx_dropped.load(std::memory_order_relaxed);
+        stats.tx_packets_deferred = _tx_deferred.load(std::memory_order_relaxed);
+        stats.rx_budget_exhausted = _rx_budget_exhausted.load(std::memory_order_relaxed);
+        stats.log_msgs_dropped = _log_dropped.load(std::memory_order_relaxed);
+        stats.log_budget_exhausted = _log_budget_exhausted.load(std::memory_order_relaxed);
+        stats.tx_fifo_high_water = static_cast<int>(_tx_high_water.load(std::memory_order_relaxed));
+        stats.rx_fifo_high_water = static_cast<int>(_rx_high_water.load(std::memory_order_relaxed));
+        return stats;
+    }
+
+private:
+    /* Only safe with a single writer, which every counter has */
+    static void _increment(std::atomic<uint64_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static void _update_high_water(std::atomic<uint64_t>& high_water, uint64_t depth)
+    {
+        /* Pops not yet counted by the other end make this overestimate the depth slightly */
+        if (depth > high_water.load(std::memory_order_relaxed))
+        {
+            high_water.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> _tx_pushed{0};
+    std::atomic<uint64_t> _tx_popped{0};
+    std::atomic<uint64_t> _rx_pushed{0};
+    std::atomic<uint64_t> _rx_popped{0};
+    std::atomic<uint64_t> _tx_high_water{0};
+    std::atomic<uint64_t> _rx_high_water{0};
+    std::atomic<uint64_t> _tx_dropped{0};
+    std::atomic<uint64_t> _tx_deferred{0};
+    std::atomic<uint64_t> _rx_budget_exhausted{0};
+    std::atomic<uint64_t> _log_dropped{0};
+    std::atomic<uint64_t> _log_budget_exhausted{0};
+};
+
+} // namespace shiftregister_gpio
+} // namespace hw_backend
+} // namespace sensei
+
+#endif // SHIFTREG_RT_FIFO_MONITOR_H
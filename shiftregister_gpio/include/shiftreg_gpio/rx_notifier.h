@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Wake up of the non rt receiving thread when the rt task has sent packets.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * The rt task pushes packets to a lock free fifo and then writes a single byte
+ * to a file descriptor, which the non rt side blocks on with poll(). With
+ * Xenomai this is an XDDP socket, which the rt task can write to without
+ * leaving primary mode. Only one notification is outstanding at any time, so
+ * the rt task does at most one write until the non rt side has woken up.
+ */
+#ifndef SHIFTREG_RX_NOTIFIER_H
+#define SHIFTREG_RX_NOTIFIER_H
+
+#include <atomic>
+#include <chrono>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace sensei {
+namespace hw_backend {
+namespace shiftregister_gpio {
+
+class RxNotifier
+{
+public:
+    /**
+     * @brief Called from the rt task after pushing packets to the fifo.
+     * @return true if the rt task has to write a notification, false if one
+     *         is already waiting to be handled.
+     */
+    bool notification_needed()
+    {
+        return !_pending.exchange(true, std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief Called from the rt task if writing the notification failed, so
+     *        that the next push is notified again.
+     */
+    void notification_failed()
+    {
+        _pending.store(false, std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief Block until a notification arrives on fd or the timeout expires.
+     *        The fifo has to be checked after this returns, also on timeout.
+     *
+     * @param fd Non blocking file descriptor written to by the rt task
+     * @param timeout Max time to wait
+     * @return true if a notification was received
+     */
+    bool wait(int fd, std::chrono::milliseconds timeout)
+    {
+        pollfd poll_fd = {fd, POLLIN, 0};
+        if (poll(&poll_fd, 1, static_cast<int>(timeout.count())) <= 0)
+        {
+            return false;
+        }
+        char notification;
+        if (read(fd, &notification, sizeof(notification)) != sizeof(notification))
+        {
+            return false;
+        }
+        /* Packets pushed after this are notified again, packets pushed before
+         * are already visible in the fifo */
+        _pending.store(false, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return true;
+    }
+
+private:
+    std::atomic<bool> _pending{false};
+};
+
+} // namespace shiftregister_gpio
+} // namespace hw_backend
+} // namespace sensei
+
+#endif // SHIFTREG_RX_NOTIFIER_H
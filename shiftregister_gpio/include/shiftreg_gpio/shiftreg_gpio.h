@@ -40,6 +40,8 @@
 #include "gpio_protocol_client/gpio_logger_interface.h"
 #include "logging.h"
 #include "boards/elk_pi_hat_defs.h"
+#include "shiftreg_gpio/rx_notifier.h"
+#include "shiftreg_gpio/rt_fifo_monitor.h"
 
 namespace sensei {
 namespace hw_backend {
@@ -48,10 +50,8 @@ namespace shiftregister_gpio {
 using namespace memory_relaxed_aquire_release;
 
 // Sizes of FIFO which sit between nrt and rt threads
-constexpr int GPIO_PACKET_Q_SIZE = 150;
-constexpr int GPIO_LOG_MSG_Q_SIZE = 50;
-
-constexpr auto RECV_LOOP_SLEEP_PERIOD = std::chrono::milliseconds(5);
+constexpr int GPIO_PACKET_Q_SIZE = SHIFTREG_GPIO_PACKET_Q_SIZE;
+constexpr int GPIO_LOG_MSG_Q_SIZE = SHIFTREG_GPIO_LOG_MSG_Q_SIZE;
 
 /**
  * @brief Enum to denote various stages of initialization of the real task.
@@ -64,6 +64,7 @@ enum class ShiftregTaskState
     DEVICE_OPENED,
     PIN_DATA_MEM_ACQUIRED,
     LOGGER_THREAD_STARTED,
+    RX_NOTIFIER_CREATED,
     RT_TASK_CREATED,
     RUNNING,
 };
@@ -79,15 +80,18 @@ enum class ShiftregTaskState
 class ShiftregGpio : public BaseHwBackend
 {
 public:
-    ShiftregGpio(std::chrono::milliseconds recv_packet_timeout) :
+    ShiftregGpio(std::chrono::milliseconds recv_packet_timeout,
+                 RtFifoOverflowPolicy overflow_policy = RtFifoOverflowPolicy::DROP) :
                 BaseHwBackend(recv_packet_timeout),
                 _is_logger_running(false),
                  _task_state(ShiftregTaskState::NOT_INITIALIZED),
                  _device_handle(0),
+                _xddp_socket(-1),
+                _rx_notifier_fd(-1),
+                _overflow_policy(overflow_policy),
+                _has_deferred_tx_packet(false),
                 _pin_data(nullptr)
-    {
-        _num_recv_retries = recv_packet_timeout/RECV_LOOP_SLEEP_PERIOD;
-    }
+    {}
 
     ~ShiftregGpio()
     {
@@ -136,7 +140,8 @@ public:
      * @brief Interface for sensei to receive a gpio packet from the gpio client
      *        running in real time context. Receives the packet through the
      *        lock free fifo between the rt thread and the calling thread. This
-     *        is a blocking call with a timeout
+     *        is a blocking call with a timeout, the calling thread sleeps until
+     *        the rt thread notifies it that packets were pushed.
      *
      * @param rx_gpio_packet The packet to be received.
      * @return true          A packet was successfully received
@@ -166,10 +171,20 @@ public:
      * @brief The non real time logger task. This receives log msgs from the
      *        real time task and pipes them to the SENSEI log depending on their
      *        log level.  In each iteration, it checks for log msgs from the
-     *        lock free fifo sent by the rt thread.
+     *        lock free fifo sent by the rt thread, and warns about packets and
+     *        log msgs the rt thread dropped since the last iteration.
      */
     void nrt_logger_task();
 
+    /**
+     * @brief Returns the drops, high water marks and exhausted per tick budgets
+     *        of the fifos to and from the rt thread. Can be called from any thread.
+     */
+    RtFifoStatistics rt_fifo_statistics() const
+    {
+        return _fifo_monitor.statistics();
+    }
+
 private:
     /**
      * @brief helper function to destroy objects and join threads. It performs
@@ -189,6 +204,13 @@ private:
      */
     bool _get_pin_data_mem_from_driver();
 
+    /**
+     * @brief Creates the XDDP socket the rt thread uses to notify the non rt
+     *        receiving thread of new packets and opens its non rt end.
+     * @return true if successful, false otherwise.
+     */
+    bool _init_rx_notifier();
+
     /**
      * @brief initialize the rt xenomai thread. It sets a task priority to it
      *        and forces it to run on the last available core of the machine.
@@ -234,7 +256,10 @@ private:
     /**
      * @brief helper function called by the rt thread to take new tx packets
      *        generated by the client during that iteration and send them to
-     *        the hw frontend through the lock free fifo
+     *        the hw frontend through the lock free fifo, then wake up the
+     *        receiving thread. When the fifo is full the packet is dropped or,
+     *        with RtFifoOverflowPolicy::DEFER, kept for the next iteration
+     *        together with the packets still in the client.
      */
     void _handle_tx_packets();
 
@@ -254,9 +279,20 @@ private:
 
     int _device_handle;
 
+    /* Rt and non rt end of the notification of packets from the rt thread */
+    int _xddp_socket;
+    int _rx_notifier_fd;
+    RxNotifier _rx_notifier;
+
     CircularFifo<gpio::GpioPacket, GPIO_PACKET_Q_SIZE> _to_rt_thread_packet_fifo;
     CircularFifo<gpio::GpioPacket, GPIO_PACKET_Q_SIZE> _from_rt_thread_packet_fifo;
     CircularFifo<gpio::GpioLogMsg, GPIO_LOG_MSG_Q_SIZE> _from_rt_thread_log_msg_fifo;
+    RtFifoMonitor _fifo_monitor;
+
+    RtFifoOverflowPolicy _overflow_policy;
+    /* Only accessed from the rt thread */
+    gpio::GpioPacket _deferred_tx_packet;
+    bool _has_deferred_tx_packet;
 
     gpio::GpioClient<NUM_DIGITAL_INPUTS,
             NUM_DIGITAL_OUTPUTS,
@@ -264,8 +300,6 @@ private:
             ADC_RES_IN_BITS> _gpio_client;
 
     uint32_t* _pin_data;
-
-    int _num_recv_retries;
 };
 
 } // namespace shiftregister_gpio
@@ -275,6 +309,8 @@ private:
 // Dummy ShiftregGpio when WITH_GPIO_LOGIC is not defined
 #else
 
+#include "shiftreg_gpio/rt_fifo_monitor.h"
+
 namespace sensei {
 
 SENSEI_GET_LOGGER_WITH_MODULE_NAME("Shiftreg Gpio");
@@ -285,7 +321,8 @@ namespace shiftregister_gpio {
 class ShiftregGpio : public BaseHwBackend
 {
 public:
-    ShiftregGpio(std::chrono::milliseconds recv_packet_timeout) :
+    ShiftregGpio(std::chrono::milliseconds recv_packet_timeout,
+                 [[maybe_unused]] RtFifoOverflowPolicy overflow_policy = RtFifoOverflowPolicy::DROP) :
                                         BaseHwBackend(recv_packet_timeout)
     {}
 
@@ -307,6 +344,11 @@ public:
     {
         return false;
     }
+
+    RtFifoStatistics rt_fifo_statistics() const
+    {
+        return RtFifoStatistics();
+    }
 };
 
 } // namespace shiftregister_gpio
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Simulation of the shift register gpio board, running the gpio client
+ *        in a regular thread.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Runs the same GpioClient as ShiftregGpio, but without Xenomai and the rtdm
+ * driver. The pin memory of the driver is simulated and its ticks come from a
+ * timerfd, so the protocol client and the whole path through sensei can be
+ * exercised and measured on any Linux machine. Test code sets the input pins
+ * and reads the output pins of the simulated board.
+ */
+
+#ifndef SHIFTREG_GPIO_SIM_H_
+#define SHIFTREG_GPIO_SIM_H_
+
+#include <chrono>
+
+#include "hardware_backend/base_hw_backend.h"
+#include "shiftreg_gpio/rt_fifo_monitor.h"
+
+#ifdef WITH_GPIO_SIMULATION
+
+#include <thread>
+#include <atomic>
+#include <array>
+
+#include "fifo/circularfifo_memory_relaxed_aquire_release.h"
+
+#include "gpio_protocol/gpio_protocol.h"
+#include "gpio_protocol_client/gpio_client.h"
+#include "boards/elk_pi_hat_defs.h"
+#include "shiftreg_gpio/rx_notifier.h"
+
+namespace sensei {
+namespace hw_backend {
+namespace shiftregister_gpio {
+
+using namespace memory_relaxed_aquire_release;
+
+// Sizes of FIFO which sit between the simulation thread and sensei
+constexpr int SIM_GPIO_PACKET_Q_SIZE = SHIFTREG_GPIO_PACKET_Q_SIZE;
+
+class ShiftregGpioSim : public BaseHwBackend
+{
+public:
+    ShiftregGpioSim(std::chrono::milliseconds recv_packet_timeout,
+                    RtFifoOverflowPolicy overflow_policy = RtFifoOverflowPolicy::DROP);
+
+    ~ShiftregGpioSim()
+    {
+        deinit();
+    }
+
+    /**
+     * @brief Initializes the gpio client on the simulated pin memory and starts
+     *        the simulation thread, with real time priority if permitted.
+     * @return True if successful, false if not.
+     */
+    bool init() override;
+
+    /**
+     * @brief Stops the simulation thread and releases its resources
+     */
+    void deinit() override;
+
+    /**
+     * @brief Sends the packet through the lock free fifo to the simulation thread
+     */
+    bool send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet) override;
+
+    /**
+     * @brief Receives a packet from the simulation thread, blocking until the thread
+     *        notifies that packets were pushed or the timeout expires.
+     */
+    bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) override;
+
+    /**
+     * @brief Set the state of a digital input pin, sampled at the start of the next tick.
+     *        Can be called from any thread.
+     */
+    void set_digital_input(int pin, bool value);
+
+    /**
+     * @brief Set the value of an analog input pin, sampled at the start of the next tick.
+     *        Can be called from any thread.
+     */
+    void set_analog_input(int pin, uint32_t value);
+
+    /**
+     * @brief Returns the state of a digital output pin as of the end of the last tick
+     */
+    bool digital_output(int pin) const;
+
+    /**
+     * @brief Returns the number of ticks run so far
+     */
+    uint64_t ticks() const;
+
+    /**
+     * @brief Returns the number of ticks that were skipped because the previous
+     *        tick was still running when they were due
+     */
+    uint64_t missed_ticks() const;
+
+    /**
+     * @brief Returns the drops, high water marks and exhausted per tick budgets
+     *        of the fifos to and from the simulation thread
+     */
+    RtFifoStatistics rt_fifo_statistics() const
+    {
+        return _fifo_monitor.statistics();
+    }
+
+    /**
+     * @brief The simulation thread, standing in for the real time task of ShiftregGpio
+     *        and the sampling done by the driver.
+     */
+    void sim_shiftreg_gpio_task();
+
+private:
+    bool _init_rx_notifier();
+    bool _init_tick_timer();
+    void _set_tick_period(int64_t period_ns);
+    void _cleanup();
+
+    /* =======  Functions which run in the simulation thread  ======= */
+    void _sample_input_pins();
+    void _update_output_pins();
+    void _handle_rx_packets();
+    void _handle_tx_packets();
+    void _handle_log_msgs();
+
+    std::atomic<bool> _running;
+    std::thread _processing_task;
+
+    int _tick_timer_fd;
+    /* Pipe in place of the XDDP socket of ShiftregGpio */
+    int _rx_notifier_fds[2];
+    RxNotifier _rx_notifier;
+
+    CircularFifo<gpio::GpioPacket, SIM_GPIO_PACKET_Q_SIZE> _to_sim_thread_packet_fifo;
+    CircularFifo<gpio::GpioPacket, SIM_GPIO_PACKET_Q_SIZE> _from_sim_thread_packet_fifo;
+    RtFifoMonitor _fifo_monitor;
+
+    RtFifoOverflowPolicy _overflow_policy;
+    /* Only accessed from the simulation thread */
+    gpio::GpioPacket _deferred_tx_packet;
+    bool _has_deferred_tx_packet;
+
+    gpio::GpioClient<NUM_DIGITAL_INPUTS,
+            NUM_DIGITAL_OUTPUTS,
+            NUM_ANALOG_INPUTS,
+            ADC_RES_IN_BITS> _gpio_client;
+
+    /* Laid out as the memory shared with the driver: digital inputs, digital outputs, analog inputs */
+    std::array<uint32_t, NUM_DIGITAL_INPUTS + NUM_DIGITAL_OUTPUTS + NUM_ANALOG_INPUTS> _pin_data;
+
+    /* Pin states exchanged with test code, copied to and from the pin data once per tick */
+    std::array<std::atomic<uint32_t>, NUM_DIGITAL_INPUTS> _digital_inputs;
+    std::array<std::atomic<uint32_t>, NUM_ANALOG_INPUTS> _analog_inputs;
+    std::array<std::atomic<uint32_t>, NUM_DIGITAL_OUTPUTS> _digital_outputs;
+
+    std::atomic<uint64_t> _ticks;
+    std::atomic<uint64_t> _missed_ticks;
+};
+
+} // namespace shiftregister_gpio
+} // namespace hw_backend
+} // namespace sensei
+
+// Dummy ShiftregGpioSim when WITH_GPIO_SIMULATION is not defined
+#else
+
+namespace sensei {
+namespace hw_backend {
+namespace shiftregister_gpio {
+
+class ShiftregGpioSim : public BaseHwBackend
+{
+public:
+    ShiftregGpioSim(std::chrono::milliseconds recv_packet_timeout,
+                    [[maybe_unused]] RtFifoOverflowPolicy overflow_policy = RtFifoOverflowPolicy::DROP) :
+                                        BaseHwBackend(recv_packet_timeout)
+    {}
+
+    bool init() override
+    {
+        return false;
+    }
+
+    void deinit() override
+    {}
+
+    bool send_gpio_packet([[maybe_unused]] const gpio::GpioPacket& tx_gpio_packet) override
+    {
+        return false;
+    }
+
+    bool receive_gpio_packet([[maybe_unused]] gpio::GpioPacket& rx_gpio_packet) override
+    {
+        return false;
+    }
+
+    RtFifoStatistics rt_fifo_statistics() const
+    {
+        return RtFifoStatistics();
+    }
+};
+
+} // namespace shiftregister_gpio
+} // namespace hw_backend
+} // namespace sensei
+
+#endif // WITH_GPIO_SIMULATION
+
+#endif // SHIFTREG_GPIO_SIM_H_
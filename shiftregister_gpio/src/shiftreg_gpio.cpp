@@ -23,8 +23,10 @@
 #include <sys/mman.h>
 #include <sys/sysinfo.h>
 #include <sched.h>
+#include <fcntl.h>
 
 #include <string>
+#include <cstring>
 #include <array>
 #include <iostream>
 
@@ -40,6 +42,8 @@
 #include <cobalt/time.h>
 #include <cobalt/sys/ioctl.h>
 #include <cobalt/pthread.h>
+#include <cobalt/sys/socket.h>
+#include <rtdm/ipc.h>
 
 #pragma GCC diagnostic pop
 
@@ -59,6 +63,12 @@ constexpr int MAX_LOG_MSGS_SENT_PER_TICK = 5;
 constexpr int MAX_LOG_MSGS_RX_PER_TICK = 20;
 constexpr int LOGGER_THREAD_TASK_PERIOD_MS = 250;
 
+// Label of the XDDP socket used to wake up the receiving thread
+#define RX_NOTIFIER_XDDP_LABEL "sensei_shiftreg_rx"
+constexpr char RX_NOTIFIER_DEVICE[] = "/proc/xenomai/registry/rtipc/xddp/" RX_NOTIFIER_XDDP_LABEL;
+// Only one notification is outstanding at any time
+constexpr size_t RX_NOTIFIER_POOL_SIZE = 512;
+
 // Compile time version check of gpio protocol
 static_assert(GPIO_PROTOCOL_VERSION_MAJOR == 0,
               "Gpio protocol major version mismatch");
@@ -248,6 +258,14 @@ bool ShiftregGpio::init()
     _logging_task = std::thread(&ShiftregGpio::nrt_logger_task, this);
     _task_state = ShiftregTaskState::LOGGER_THREAD_STARTED;
 
+    if (!_init_rx_notifier())
+    {
+        SENSEI_LOG_ERROR("Failed to create rx notifier");
+        _cleanup();
+        return false;
+    }
+    _task_state = ShiftregTaskState::RX_NOTIFIER_CREATED;
+
     // create the client
     uint32_t* input_pin_data = _pin_data;
     uint32_t* output_pin_data = _pin_data + NUM_DIGITAL_INPUTS;
@@ -285,19 +303,33 @@ void ShiftregGpio::deinit()
 
 bool ShiftregGpio::send_gpio_packet(const gpio::GpioPacket &tx_gpio_packet)
 {
-    return _to_rt_thread_packet_fifo.push(tx_gpio_packet);
+    if (_to_rt_thread_packet_fifo.push(tx_gpio_packet))
+    {
+        _fifo_monitor.rx_packet_pushed();
+        return true;
+    }
+    return false;
 }
 
 bool ShiftregGpio::receive_gpio_packet(gpio::GpioPacket &rx_gpio_packet)
 {
-    for(int i = 0; i < _num_recv_retries; i++)
+    if (_from_rt_thread_packet_fifo.pop(rx_gpio_packet))
+    {
+        _fifo_monitor.tx_packet_popped();
+        return true;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + _recv_packet_timeout;
+    auto timeout = _recv_packet_timeout;
+    while (timeout.count() > 0)
     {
-        if(_from_rt_thread_packet_fifo.pop(rx_gpio_packet))
+        _rx_notifier.wait(_rx_notifier_fd, timeout);
+        if (_from_rt_thread_packet_fifo.pop(rx_gpio_packet))
         {
+            _fifo_monitor.tx_packet_popped();
             return true;
         }
-
-        std::this_thread::sleep_for(RECV_LOOP_SLEEP_PERIOD);
+        timeout = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
     }
 
     return false;
@@ -320,8 +352,22 @@ void ShiftregGpio::nrt_logger_task()
     _is_logger_running = true;
     gpio::GpioLogMsg log_msg;
     int num_log_msgs_per_iter = 0;
+    RtFifoStatistics reported_stats;
     while (_is_logger_running)
     {
+        auto stats = _fifo_monitor.statistics();
+        if (stats.tx_packets_dropped > reported_stats.tx_packets_dropped)
+        {
+            SENSEI_LOG_WARNING("Dropped {} packets to sensei, fifo full",
+                               stats.tx_packets_dropped - reported_stats.tx_packets_dropped);
+        }
+        if (stats.log_msgs_dropped > reported_stats.log_msgs_dropped)
+        {
+            SENSEI_LOG_WARNING("Dropped {} log messages, fifo full",
+                               stats.log_msgs_dropped - reported_stats.log_msgs_dropped);
+        }
+        reported_stats = stats;
+
         while (_from_rt_thread_log_msg_fifo.pop(log_msg) &&
                num_log_msgs_per_iter < MAX_LOG_MSGS_RX_PER_TICK)
         {
@@ -362,6 +408,11 @@ void ShiftregGpio::_cleanup()
         __cobalt_pthread_join(_processing_task, NULL);
         __attribute__((fallthrough));
 
+    case ShiftregTaskState::RX_NOTIFIER_CREATED:
+        close(_rx_notifier_fd);
+        __cobalt_close(_xddp_socket);
+        __attribute__((fallthrough));
+
     case ShiftregTaskState::LOGGER_THREAD_STARTED:
         _is_logger_running = false;
         if (_logging_task.joinable())
@@ -416,6 +467,44 @@ bool ShiftregGpio::_get_pin_data_mem_from_driver()
     return true;
 }
 
+bool ShiftregGpio::_init_rx_notifier()
+{
+    _xddp_socket = __cobalt_socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_XDDP);
+    if (_xddp_socket < 0)
+    {
+        SENSEI_LOG_ERROR("Failed to create XDDP socket, Error {}", _xddp_socket);
+        return false;
+    }
+
+    size_t pool_size = RX_NOTIFIER_POOL_SIZE;
+    rtipc_port_label label;
+    strcpy(label.label, RX_NOTIFIER_XDDP_LABEL);
+    sockaddr_ipc address;
+    address.sipc_family = AF_RTIPC;
+    address.sipc_port = -1;
+
+    if (__cobalt_setsockopt(_xddp_socket, SOL_XDDP, XDDP_POOLSZ, &pool_size, sizeof(pool_size)) != 0 ||
+        __cobalt_setsockopt(_xddp_socket, SOL_XDDP, XDDP_LABEL, &label, sizeof(label)) != 0 ||
+        __cobalt_bind(_xddp_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        SENSEI_LOG_ERROR("Failed to set up XDDP socket");
+        __cobalt_close(_xddp_socket);
+        return false;
+    }
+
+    // The non rt end is a regular file, read from the linux domain
+    _rx_notifier_fd = open(RX_NOTIFIER_DEVICE, O_RDWR | O_NONBLOCK);
+    if (_rx_notifier_fd < 0)
+    {
+        SENSEI_LOG_ERROR("Failed to open {}, Error {}", RX_NOTIFIER_DEVICE, errno);
+        __cobalt_close(_xddp_socket);
+        return false;
+    }
+
+    SENSEI_LOG_INFO("Rx notifier created");
+    return true;
+}
+
 bool ShiftregGpio::_init_rt_task()
 {
     // Create the RT thread
@@ -525,6 +614,7 @@ inline void ShiftregGpio::_handle_rx_packets()
     {
         if (_to_rt_thread_packet_fifo.pop(rx_packet))
         {
+            _fifo_monitor.rx_packet_popped();
             _gpio_client.handle_rx_packet(rx_packet);
             _gpio_client.clear_packet(rx_packet);
             num_rx_packets++;
@@ -533,14 +623,54 @@ inline void ShiftregGpio::_handle_rx_packets()
 
         return;
     }
+
+    if (!_to_rt_thread_packet_fifo.wasEmpty())
+    {
+        _fifo_monitor.rx_budget_exhausted();
+    }
 }
 
 inline void ShiftregGpio::_handle_tx_packets()
 {
+    bool pushed = false;
+    if (_has_deferred_tx_packet)
+    {
+        if (_from_rt_thread_packet_fifo.push(_deferred_tx_packet))
+        {
+            _fifo_monitor.tx_packet_pushed();
+            _has_deferred_tx_packet = false;
+            pushed = true;
+        }
+    }
+
     gpio::GpioPacket* gpio_packet_from_client = nullptr;
-    while (_gpio_client.get_tx_packet(&gpio_packet_from_client))
+    while (!_has_deferred_tx_packet && _gpio_client.get_tx_packet(&gpio_packet_from_client))
+    {
+        if (_from_rt_thread_packet_fifo.push(*gpio_packet_from_client))
+        {
+            _fifo_monitor.tx_packet_pushed();
+            pushed = true;
+        }
+        else if (_overflow_policy == RtFifoOverflowPolicy::DEFER)
+        {
+            /* The rest stay in the client until the fifo has room again */
+            _deferred_tx_packet = *gpio_packet_from_client;
+            _has_deferred_tx_packet = true;
+            _fifo_monitor.tx_packet_deferred();
+        }
+        else
+        {
+            _fifo_monitor.tx_packet_dropped();
+        }
+    }
+
+    if (pushed && _rx_notifier.notification_needed())
     {
-        _from_rt_thread_packet_fifo.push(*gpio_packet_from_client);
+        char notification = 0;
+        if (__cobalt_sendto(_xddp_socket, &notification, sizeof(notification), MSG_DONTWAIT, nullptr, 0) != sizeof(notification))
+        {
+            _rx_notifier.notification_failed();
+        }
     }
 }
 
@@ -548,12 +678,21 @@ void ShiftregGpio::_handle_log_msgs()
 {
     int num_log_msg = 0;
     gpio::GpioLogMsg* log_msg = nullptr;
-    while (_gpio_client.get_log_msg(&log_msg) &&
-           num_log_msg < MAX_LOG_MSGS_SENT_PER_TICK)
+    /* Check the budget first, so that no msg is taken from the client and lost */
+    while (num_log_msg < MAX_LOG_MSGS_SENT_PER_TICK &&
+           _gpio_client.get_log_msg(&log_msg))
     {
-        _from_rt_thread_log_msg_fifo.push(*log_msg);
+        if (!_from_rt_thread_log_msg_fifo.push(*log_msg))
+        {
+            _fifo_monitor.log_msg_dropped();
+        }
         num_log_msg++;
     }
+
+    if (num_log_msg == MAX_LOG_MSGS_SENT_PER_TICK)
+    {
+        _fifo_monitor.log_budget_exhausted();
+    }
 }
 
 } // namespace shiftregister_gpio
@@ -0,0 +1,407 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Simulation of the shift register gpio board, running the gpio client
+ *        in a regular thread.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <sys/timerfd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "shiftreg_gpio/shiftreg_gpio_sim.h"
+#include "gpio_protocol_client/gpio_client.h"
+#include "logging.h"
+#include "thread_scheduling.h"
+
+namespace sensei {
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("Shiftreg Gpio Sim");
+
+namespace hw_backend {
+namespace shiftregister_gpio {
+
+// Same priority as the rt task of ShiftregGpio, used if permitted
+constexpr int SIM_TASK_PRIORITY = 50;
+constexpr int MAX_PACKETS_PER_TICK = 50;
+constexpr int MAX_LOG_MSGS_PER_TICK = 5;
+// Tick period of the driver before the gpio client is configured
+constexpr int64_t DEFAULT_TICK_PERIOD_NS = 1'000'000;
+// The driver samples all analog channels every tick
+constexpr int SIM_ADC_CHANS_PER_TICK = NUM_ANALOG_INPUTS;
+
+// Compile time version check of gpio protocol
+static_assert(GPIO_PROTOCOL_VERSION_MAJOR == 0,
+              "Gpio protocol major version mismatch");
+static_assert(GPIO_PROTOCOL_VERSION_MINOR == 2,
+              "Gpio protocol minor version mismatch");
+
+ShiftregGpioSim::ShiftregGpioSim(std::chrono::milliseconds recv_packet_timeout,
+                                 RtFifoOverflowPolicy overflow_policy) :
+                                        BaseHwBackend(recv_packet_timeout),
+                                        _running(false),
+                                        _tick_timer_fd(-1),
+                                        _rx_notifier_fds{-1, -1},
+                                        _overflow_policy(overflow_policy),
+                                        _has_deferred_tx_packet(false),
+                                        _pin_data{},
+                                        _ticks(0),
+                                        _missed_ticks(0)
+{
+    for (auto& pin : _digital_inputs)
+    {
+        pin = 0;
+    }
+    for (auto& pin : _analog_inputs)
+    {
+        pin = 0;
+    }
+    for (auto& pin : _digital_outputs)
+    {
+        pin = 0;
+    }
+}
+
+bool ShiftregGpioSim::init()
+{
+    if (_running)
+    {
+        return true;
+    }
+
+    if (!_init_rx_notifier())
+    {
+        SENSEI_LOG_ERROR("Failed to create rx notifier");
+        _cleanup();
+        return false;
+    }
+
+    if (!_init_tick_timer())
+    {
+        SENSEI_LOG_ERROR("Failed to create tick timer");
+        _cleanup();
+        return false;
+    }
+
+    uint32_t* input_pin_data = _pin_data.data();
+    uint32_t* output_pin_data = input_pin_data + NUM_DIGITAL_INPUTS;
+    uint32_t* analog_pin_data = output_pin_data + NUM_DIGITAL_OUTPUTS;
+
+    if (!_gpio_client.init(input_pin_data, output_pin_data, analog_pin_data,
+                           SIM_ADC_CHANS_PER_TICK))
+    {
+        SENSEI_LOG_ERROR("Cannot init gpio client.");
+        _cleanup();
+        return false;
+    }
+
+    _running = true;
+    _processing_task = std::thread(&ShiftregGpioSim::sim_shiftreg_gpio_task, this);
+    SENSEI_LOG_INFO("Gpio simulation started");
+    return true;
+}
+
+void ShiftregGpioSim::deinit()
+{
+    _cleanup();
+}
+
+bool ShiftregGpioSim::send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet)
+{
+    if (_to_sim_thread_packet_fifo.push(tx_gpio_packet))
+    {
+        _fifo_monitor.rx_packet_pushed();
+        return true;
+    }
+    return false;
+}
+
+bool ShiftregGpioSim::receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet)
+{
+    if (_from_sim_thread_packet_fifo.pop(rx_gpio_packet))
+    {
+        _fifo_monitor.tx_packet_popped();
+        return true;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + _recv_packet_timeout;
+    auto timeout = _recv_packet_timeout;
+    while (timeout.count() > 0)
+    {
+        _rx_notifier.wait(_rx_notifier_fds[0], timeout);
+        if (_from_sim_thread_packet_fifo.pop(rx_gpio_packet))
+        {
+            _fifo_monitor.tx_packet_popped();
+            return true;
+        }
+        timeout = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    }
+
+    return false;
+}
+
+void ShiftregGpioSim::set_digital_input(int pin, bool value)
+{
+    if (pin >= 0 && pin < NUM_DIGITAL_INPUTS)
+    {
+        _digital_inputs[pin].store(value ? 1 : 0, std::memory_order_release);
+    }
+}
+
+void ShiftregGpioSim::set_analog_input(int pin, uint32_t value)
+{
+    if (pin >= 0 && pin < NUM_ANALOG_INPUTS)
+    {
+        _analog_inputs[pin].store(value, std::memory_order_release);
+    }
+}
+
+bool ShiftregGpioSim::digital_output(int pin) const
+{
+    if (pin >= 0 && pin < NUM_DIGITAL_OUTPUTS)
+    {
+        return _digital_outputs[pin].load(std::memory_order_acquire) != 0;
+    }
+    return false;
+}
+
+uint64_t ShiftregGpioSim::ticks() const
+{
+    return _ticks.load(std::memory_order_acquire);
+}
+
+uint64_t ShiftregGpioSim::missed_ticks() const
+{
+    return _missed_ticks.load(std::memory_order_acquire);
+}
+
+void ShiftregGpioSim::sim_shiftreg_gpio_task()
+{
+    sched_param rt_params = {};
+    rt_params.sched_priority = SIM_TASK_PRIORITY;
+    int res = pthread_setschedparam(pthread_self(), SCHED_FIFO, &rt_params);
+    if (res != 0)
+    {
+        SENSEI_LOG_WARNING("Could not set real time priority of simulation thread, error {}", res);
+    }
+    register_thread(pthread_self(), "gpio simulation");
+
+    bool configured = false;
+    while (_running)
+    {
+        // Blocks until the next tick, as SHIFTREG_DRIVER_WAIT_ON_RT_TASK does
+        uint64_t expirations = 0;
+        if (read(_tick_timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        {
+            continue;
+        }
+        if (expirations > 1)
+        {
+            _missed_ticks.fetch_add(expirations - 1, std::memory_order_release);
+        }
+
+        _sample_input_pins();
+        _handle_rx_packets();
+        if (configured)
+        {
+            _gpio_client.process();
+        }
+        _handle_tx_packets();
+        _handle_log_msgs();
+        _update_output_pins();
+        _ticks.fetch_add(1, std::memory_order_release);
+
+        // set tick period after gpio client has been configured
+        if (!configured && _gpio_client.is_running())
+        {
+            _set_tick_period(_gpio_client.get_tick_period_ns());
+            configured = true;
+        }
+    }
+}
+
+bool ShiftregGpioSim::_init_rx_notifier()
+{
+    if (pipe2(_rx_notifier_fds, O_NONBLOCK) != 0)
+    {
+        SENSEI_LOG_ERROR("Failed to create notifier pipe, Error {}", errno);
+        return false;
+    }
+    return true;
+}
+
+bool ShiftregGpioSim::_init_tick_timer()
+{
+    _tick_timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (_tick_timer_fd < 0)
+    {
+        SENSEI_LOG_ERROR("Failed to create timerfd, Error {}", errno);
+        return false;
+    }
+    _set_tick_period(DEFAULT_TICK_PERIOD_NS);
+    return true;
+}
+
+void ShiftregGpioSim::_set_tick_period(int64_t period_ns)
+{
+    itimerspec period = {};
+    period.it_interval.tv_sec = period_ns / 1'000'000'000;
+    period.it_interval.tv_nsec = period_ns % 1'000'000'000;
+    period.it_value = period.it_interval;
+    if (timerfd_settime(_tick_timer_fd, 0, &period, nullptr) != 0)
+    {
+        SENSEI_LOG_ERROR("Failed to set tick period to {} ns, Error {}", period_ns, errno);
+    }
+}
+
+void ShiftregGpioSim::_cleanup()
+{
+    // The simulation thread wakes up on the next tick and exits
+    _running = false;
+    if (_processing_task.joinable())
+    {
+        _processing_task.join();
+    }
+    if (_tick_timer_fd >= 0)
+    {
+        close(_tick_timer_fd);
+        _tick_timer_fd = -1;
+    }
+    for (auto& fd : _rx_notifier_fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+inline void ShiftregGpioSim::_sample_input_pins()
+{
+    for (int i = 0; i < NUM_DIGITAL_INPUTS; i++)
+    {
+        _pin_data[i] = _digital_inputs[i].load(std::memory_order_acquire);
+    }
+    for (int i = 0; i < NUM_ANALOG_INPUTS; i++)
+    {
+        _pin_data[NUM_DIGITAL_INPUTS + NUM_DIGITAL_OUTPUTS + i] = _analog_inputs[i].load(std::memory_order_acquire);
+    }
+}
+
+inline void ShiftregGpioSim::_update_output_pins()
+{
+    for (int i = 0; i < NUM_DIGITAL_OUTPUTS; i++)
+    {
+        _digital_outputs[i].store(_pin_data[NUM_DIGITAL_INPUTS + i], std::memory_order_release);
+    }
+}
+
+inline void ShiftregGpioSim::_handle_rx_packets()
+{
+    int num_rx_packets = 0;
+    gpio::GpioPacket rx_packet;
+
+    while (num_rx_packets < MAX_PACKETS_PER_TICK &&
+           _to_sim_thread_packet_fifo.pop(rx_packet))
+    {
+        _fifo_monitor.rx_packet_popped();
+        _gpio_client.handle_rx_packet(rx_packet);
+        _gpio_client.clear_packet(rx_packet);
+        num_rx_packets++;
+    }
+
+    if (num_rx_packets == MAX_PACKETS_PER_TICK && !_to_sim_thread_packet_fifo.wasEmpty())
+    {
+        _fifo_monitor.rx_budget_exhausted();
+    }
+}
+
+inline void ShiftregGpioSim::_handle_tx_packets()
+{
+    bool pushed = false;
+    if (_has_deferred_tx_packet && _from_sim_thread_packet_fifo.push(_deferred_tx_packet))
+    {
+        _fifo_monitor.tx_packet_pushed();
+        _has_deferred_tx_packet = false;
+        pushed = true;
+    }
+
+    gpio::GpioPacket* gpio_packet_from_client = nullptr;
+    while (!_has_deferred_tx_packet && _gpio_client.get_tx_packet(&gpio_packet_from_client))
+    {
+        if (_from_sim_thread_packet_fifo.push(*gpio_packet_from_client))
+        {
+            _fifo_monitor.tx_packet_pushed();
+            pushed = true;
+        }
+        else if (_overflow_policy == RtFifoOverflowPolicy::DEFER)
+        {
+            _deferred_tx_packet = *gpio_packet_from_client;
+            _has_deferred_tx_packet = true;
+            _fifo_monitor.tx_packet_deferred();
+        }
+        else
+        {
+            _fifo_monitor.tx_packet_dropped();
+        }
+    }
+
+    if (pushed && _rx_notifier.notification_needed())
+    {
+        char notification = 0;
+        if (write(_rx_notifier_fds[1], &notification, sizeof(notification)) != sizeof(notification))
+        {
+            _rx_notifier.notification_failed();
+        }
+    }
+}
+
+inline void ShiftregGpioSim::_handle_log_msgs()
+{
+    // Not real time, so the messages can be logged directly from here
+    int num_log_msgs = 0;
+    gpio::GpioLogMsg* log_msg = nullptr;
+    while (num_log_msgs < MAX_LOG_MSGS_PER_TICK && _gpio_client.get_log_msg(&log_msg))
+    {
+        switch (log_msg->level)
+        {
+        case gpio::GpioLogLevel::GPIO_LOG_INFO:
+            SENSEI_LOG_INFO("{}", log_msg->msg.data());
+            break;
+
+        case gpio::GpioLogLevel::GPIO_LOG_WARNING:
+            SENSEI_LOG_WARNING("{}", log_msg->msg.data());
+            break;
+
+        case gpio::GpioLogLevel::GPIO_LOG_ERROR:
+            SENSEI_LOG_ERROR("{}", log_msg->msg.data());
+            break;
+        }
+        num_log_msgs++;
+    }
+
+    if (num_log_msgs == MAX_LOG_MSGS_PER_TICK)
+    {
+        _fifo_monitor.log_budget_exhausted();
+    }
+}
+
+} // namespace shiftregister_gpio
+} // namespace hw_backend
+} // namespace sensei
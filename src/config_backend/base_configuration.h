@@ -23,8 +23,15 @@
 #ifndef SENSEI_BASECONFIGURATION_H
 #define SENSEI_BASECONFIGURATION_H
 
+#include <vector>
+#include <string>
+
 #include "message/base_message.h"
 #include "synchronized_queue.h"
+#include "thread_scheduling.h"
+#include "hardware_frontend/base_hw_frontend.h"
+#include "hardware_backend/synthetic_hw_backend.h"
+#include "shiftreg_gpio/rt_fifo_monitor.h"
 
 namespace sensei {
 namespace config {
@@ -36,10 +43,45 @@ enum class ConfigStatus {
     PARAMETER_ERROR,
 };
 
+/**
+ * @brief Configuration of a single board
+ */
 struct HwFrontendConfig
 {
-    HwFrontendType type;
+    HwFrontendType type{HwFrontendType::NONE};
     std::string    port;
+    /* Socket the packets of the gpio client are received on, the default one if empty */
+    std::string    sensei_port;
+    int            ack_window{1};
+    int            min_ack_timeout_ms{5};
+    int            max_ack_timeout_ms{2000};
+    /* Opt-in, as a restart of the gpio client is not detected while shared memory is used */
+    bool           shm_transport{false};
+    bool           inline_mapping{false};
+    hw_backend::shiftregister_gpio::RtFifoOverflowPolicy rt_fifo_overflow{hw_backend::shiftregister_gpio::RtFifoOverflowPolicy::DROP};
+    /* Capture of the packets exchanged with the board, written if set */
+    std::string    record_file;
+    /* Capture played back instead of a board, at replay_speed times the recorded speed or as fast as possible if 0 */
+    std::string    replay_file;
+    float          replay_speed{1.0f};
+    /* Signals generated instead of a board */
+    std::vector<hw_backend::SyntheticSignalConfig> synthetic_signals;
+    /* Global sensor ids handled by the board, mapped to its controller ids from 0.
+     * 0 sensors means all the sensors from first_sensor on */
+    int            first_sensor{0};
+    int            n_sensors{0};
+    hw_frontend::SendQueueLimits send_queue_limits;
+};
+
+/**
+ * @brief Configuration needed before the boards and threads are started
+ */
+struct HwConfig
+{
+    std::vector<HwFrontendConfig> frontends;
+    ThreadsConfig                 threads;
+    /* Local socket where metrics are served as Prometheus text, not served if empty */
+    std::string                   metrics_socket;
 };
 
 class BaseConfiguration
@@ -80,7 +122,7 @@ public:
     /**
      * @brief Read configuration and construct messages from it
      */
-    virtual ConfigStatus read(HwFrontendConfig& /*hw_config*/)
+    virtual ConfigStatus read(HwConfig& /*hw_config*/)
     {
         return ConfigStatus::OK;
     }
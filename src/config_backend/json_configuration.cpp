@@ -44,7 +44,7 @@ Json::Value read_configuration(std::ifstream& file)
 /*
  * Open _source as a file and parse is as a json file
  */
-ConfigStatus JsonConfiguration::read(HwFrontendConfig& hw_config)
+ConfigStatus JsonConfiguration::read(HwConfig& hw_config)
 {
     SENSEI_LOG_INFO("Reading configuration file");
     std::ifstream file(_source);
@@ -64,13 +64,32 @@ ConfigStatus JsonConfiguration::read(HwFrontendConfig& hw_config)
     const Json::Value& hw_frontend = config["hw_frontend"];
     const Json::Value& backends = config["backends"];
     const Json::Value& sensors = config["sensors"];
+    const Json::Value& user_frontend = config["user_frontend"];
+    const Json::Value& threads = config["threads"];
+    const Json::Value& metrics = config["metrics"];
 
     /* Read the hw status, needs to be returned directly and not as an event */
-    ConfigStatus status = handle_hw_config(hw_frontend, hw_config);
+    ConfigStatus status = handle_hw_frontends(hw_frontend, hw_config.frontends);
     if (status != ConfigStatus::OK)
     {
         return status;
     }
+    if (threads.isObject())
+    {
+        status = handle_threads_config(threads, hw_config.threads);
+        if (status != ConfigStatus::OK)
+        {
+            return status;
+        }
+    }
+    if (metrics.isObject())
+    {
+        status = handle_metrics_config(metrics, hw_config.metrics_socket);
+        if (status != ConfigStatus::OK)
+        {
+            return status;
+        }
+    }
     /* Read the rest of the configuration */
     if (backends.isArray())
     {
@@ -83,6 +102,14 @@ ConfigStatus JsonConfiguration::read(HwFrontendConfig& hw_config)
             }
         }
     }
+    if (user_frontend.isObject())
+    {
+        status = handle_user_frontend(user_frontend);
+        if (status != ConfigStatus::OK)
+        {
+            return status;
+        }
+    }
     if (sensors.isArray())
     {
         for(const Json::Value& sensor : sensors)
@@ -100,6 +127,64 @@ ConfigStatus JsonConfiguration::read(HwFrontendConfig& hw_config)
     return ConfigStatus::OK;
 }
 
+/*
+ * Read either a single board or a list of boards, each one handling its own range of sensors
+ */
+ConfigStatus JsonConfiguration::handle_hw_frontends(const Json::Value& frontends, std::vector<HwFrontendConfig>& configs)
+{
+    configs.clear();
+    if (frontends.isObject())
+    {
+        configs.emplace_back();
+        return handle_hw_config(frontends, configs.back());
+    }
+    if (!frontends.isArray())
+    {
+        return ConfigStatus::OK;
+    }
+    for (const Json::Value& frontend : frontends)
+    {
+        configs.emplace_back();
+        ConfigStatus status = handle_hw_config(frontend, configs.back());
+        if (status != ConfigStatus::OK)
+        {
+            return status;
+        }
+    }
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        for (size_t j = i + 1; j < configs.size(); ++j)
+        {
+            const auto& a = configs[i];
+            const auto& b = configs[j];
+            bool a_before_b = a.n_sensors > 0 && a.first_sensor + a.n_sensors <= b.first_sensor;
+            bool b_before_a = b.n_sensors > 0 && b.first_sensor + b.n_sensors <= a.first_sensor;
+            if (!a_before_b && !b_before_a)
+            {
+                SENSEI_LOG_WARNING("Sensor ranges of hw frontends {} and {} overlap", i, j);
+                return ConfigStatus::PARAMETER_ERROR;
+            }
+            if (a.type == HwFrontendType::ELK_PI_GPIO && b.type == HwFrontendType::ELK_PI_GPIO)
+            {
+                SENSEI_LOG_WARNING("Only one elk_pi hw frontend is supported");
+                return ConfigStatus::PARAMETER_ERROR;
+            }
+            if (a.type == HwFrontendType::RASPA_GPIO && b.type == HwFrontendType::RASPA_GPIO && a.port == b.port)
+            {
+                SENSEI_LOG_WARNING("Hw frontends {} and {} use the same port {}", i, j, a.port);
+                return ConfigStatus::PARAMETER_ERROR;
+            }
+            if (a.type == HwFrontendType::RASPA_GPIO && b.type == HwFrontendType::RASPA_GPIO &&
+                a.sensei_port == b.sensei_port)
+            {
+                SENSEI_LOG_WARNING("Hw frontends {} and {} use the same sensei port {}", i, j, a.sensei_port);
+                return ConfigStatus::PARAMETER_ERROR;
+            }
+        }
+    }
+    return ConfigStatus::OK;
+}
+
 ConfigStatus JsonConfiguration::handle_hw_config(const Json::Value& frontend, HwFrontendConfig& config)
 {
     const Json::Value& type = frontend["type"];
@@ -113,12 +198,378 @@ ConfigStatus JsonConfiguration::handle_hw_config(const Json::Value& frontend, Hw
         {
             config.type = HwFrontendType::ELK_PI_GPIO;
         }
+        else if(type == "elk_pi_simulation")
+        {
+            config.type = HwFrontendType::ELK_PI_SIMULATION;
+        }
+        else if(type == "replay")
+        {
+            config.type = HwFrontendType::REPLAY;
+        }
+        else if(type == "synthetic")
+        {
+            config.type = HwFrontendType::SYNTHETIC;
+        }
         else
         {
             SENSEI_LOG_WARNING("\"{}\" is not a recognized hardware frontend type", type.asString());
             return ConfigStatus::PARSING_ERROR;
         }
     }
+    /* Number of packets that can be sent to the board before waiting for their acks */
+    const Json::Value& ack_window = frontend["ack_window"];
+    if (ack_window.isInt())
+    {
+        if (ack_window.asInt() < 1)
+        {
+            SENSEI_LOG_WARNING("Ack window must be at least 1");
+            return ConfigStatus::PARAMETER_ERROR;
+        }
+        config.ack_window = ack_window.asInt();
+    }
+    /* Bounds of the adaptive ack timeout */
+    const Json::Value& min_ack_timeout = frontend["min_ack_timeout_ms"];
+    if (min_ack_timeout.isInt())
+    {
+        config.min_ack_timeout_ms = min_ack_timeout.asInt();
+    }
+    const Json::Value& max_ack_timeout = frontend["max_ack_timeout_ms"];
+    if (max_ack_timeout.isInt())
+    {
+        config.max_ack_timeout_ms = max_ack_timeout.asInt();
+    }
+    if (config.min_ack_timeout_ms < 1 || config.max_ack_timeout_ms < config.min_ack_timeout_ms)
+    {
+        SENSEI_LOG_WARNING("Invalid ack timeout bounds {}, {}", config.min_ack_timeout_ms, config.max_ack_timeout_ms);
+        return ConfigStatus::PARAMETER_ERROR;
+    }
+    /* Offer shared memory to the gpio client instead of exchanging packets over sockets */
+    const Json::Value& shm_transport = frontend["shm_transport"];
+    if (shm_transport.isBool())
+    {
+        config.shm_transport = shm_transport.asBool();
+    }
+    /* Map values directly on the hw frontend read thread instead of in the event loop */
+    const Json::Value& inline_mapping = frontend["inline_mapping"];
+    if (inline_mapping.isBool())
+    {
+        config.inline_mapping = inline_mapping.asBool();
+    }
+    /* What the rt task of an elk_pi board does with packets for sensei when its fifo is full */
+    const Json::Value& rt_fifo_overflow = frontend["rt_fifo_overflow"];
+    if (rt_fifo_overflow.isString())
+    {
+        if (rt_fifo_overflow == "drop")
+        {
+            config.rt_fifo_overflow = hw_backend::shiftregister_gpio::RtFifoOverflowPolicy::DROP;
+        }
+        else if (rt_fifo_overflow == "defer")
+        {
+            config.rt_fifo_overflow = hw_backend::shiftregister_gpio::RtFifoOverflowPolicy::DEFER;
+        }
+        else
+        {
+            SENSEI_LOG_WARNING("\"{}\" is not a recognized rt fifo overflow policy", rt_fifo_overflow.asString());
+            return ConfigStatus::PARAMETER_ERROR;
+        }
+    }
+    /* Socket of the gpio client, for boards connected through raspa */
+    const Json::Value& port = frontend["port"];
+    if (port.isString())
+    {
+        config.port = port.asString();
+    }
+    /* Socket sensei receives the packets of the gpio client on, one per board */
+    const Json::Value& sensei_port = frontend["sensei_port"];
+    if (sensei_port.isString())
+    {
+        config.sensei_port = sensei_port.asString();
+    }
+    /* Recording of the packets exchanged with the board and playback of such a recording */
+    const Json::Value& record_file = frontend["record_file"];
+    if (record_file.isString())
+    {
+        config.record_file = record_file.asString();
+    }
+    const Json::Value& replay_file = frontend["replay_file"];
+    if (replay_file.isString())
+    {
+        config.replay_file = replay_file.asString();
+    }
+    const Json::Value& replay_speed = frontend["replay_speed"];
+    if (replay_speed.isNumeric())
+    {
+        config.replay_speed = replay_speed.asFloat();
+    }
+    if (config.replay_speed < 0)
+    {
+        SENSEI_LOG_WARNING("Invalid replay speed {}", config.replay_speed);
+        return ConfigStatus::PARAMETER_ERROR;
+    }
+    if (config.type == HwFrontendType::REPLAY && config.replay_file.empty())
+    {
+        SENSEI_LOG_WARNING("No capture file to replay");
+        return ConfigStatus::PARAMETER_ERROR;
+    }
+    /* Signals generated by a synthetic board */
+    const Json::Value& synthetic_signals = frontend["synthetic_signals"];
+    if (synthetic_signals.isArray())
+    {
+        config.synthetic_signals.clear();
+        for (const Json::Value& signal : synthetic_signals)
+        {
+            hw_backend::SyntheticSignalConfig signal_config;
+            if (handle_synthetic_signal(signal, signal_config) != ConfigStatus::OK)
+            {
+                SENSEI_LOG_WARNING("Invalid synthetic signal {}", config.synthetic_signals.size());
+                return ConfigStatus::PARAMETER_ERROR;
+            }
+            config.synthetic_signals.push_back(signal_config);
+        }
+    }
+    if (config.type == HwFrontendType::SYNTHETIC && config.synthetic_signals.empty())
+    {
+        SENSEI_LOG_WARNING("No signals to generate for synthetic hw frontend");
+        return ConfigStatus::PARAMETER_ERROR;
+    }
+    /* Range of global sensor ids handled by this board */
+    const Json::Value& first_sensor = frontend["first_sensor"];
+    if (first_sensor.isInt())
+    {
+        config.first_sensor = first_sensor.asInt();
+    }
+    const Json::Value& n_sensors = frontend["n_sensors"];
+    if (n_sensors.isInt())
+    {
+        config.n_sensors = n_sensors.asInt();
+    }
+    if (config.first_sensor < 0 || config.n_sensors < 0)
+    {
+        SENSEI_LOG_WARNING("Invalid sensor range {}, {}", config.first_sensor, config.n_sensors);
+        return ConfigStatus::PARAMETER_ERROR;
+    }
+    /* Capacity and overflow policy of the lanes of packets waiting to be sent */
+    const Json::Value& send_lanes = frontend["send_lanes"];
+    if (send_lanes.isObject())
+    {
+        std::pair<const char*, hw_frontend::SendLaneLimit*> lanes[] = {{"control", &config.send_queue_limits.control},
+                                                                       {"output", &config.send_queue_limits.output},
+                                                                       {"config", &config.send_queue_limits.config}};
+        for (auto& lane : lanes)
+        {
+            const Json::Value& lane_config = send_lanes[lane.first];
+            if (lane_config.isObject() && handle_send_lane_limit(lane_config, *lane.second) != ConfigStatus::OK)
+            {
+                SENSEI_LOG_WARNING("Invalid configuration of send lane \"{}\"", lane.first);
+                return ConfigStatus::PARAMETER_ERROR;
+            }
+        }
+    }
+    return ConfigStatus::OK;
+}
+
+ConfigStatus JsonConfiguration::handle_synthetic_signal(const Json::Value& signal, hw_backend::SyntheticSignalConfig& config)
+{
+    if (signal.isObject() == false)
+    {
+        return ConfigStatus::PARAMETER_ERROR;
+    }
+    const Json::Value& waveform = signal["waveform"];
+    if (waveform.isString())
+    {
+        if (waveform == "ramp")
+        {
+            config.waveform = hw_backend::Waveform::RAMP;
+        }
+        else if (waveform == "noise")
+        {
+            config.waveform = hw_backend::Waveform::NOISE;
+        }
+        else if (waveform == "random_walk")
+        {
+            config.waveform = hw_backend::Waveform::RANDOM_WALK;
+        }
+        else if (waveform == "button_burst")
+        {
+            config.waveform = hw_backend::Waveform::BUTTON_BURST;
+        }
+        else
+        {
+            SENSEI_LOG_WARNING("\"{}\" is not a recognized waveform", waveform.asString());
+            return ConfigStatus::PARAMETER_ERROR;
+        }
+    }
+    const Json::Value& first_controller = signal["first_controller"];
+    if (first_controller.isInt())
+    {
+        config.first_controller = first_controller.asInt();
+    }
+    const Json::Value& n_controllers = signal["n_controllers"];
+    if (n_controllers.isInt())
+    {
+        config.n_controllers = n_controllers.asInt();
+    }
+    const Json::Value& rate = signal["rate_hz"];
+    if (rate.isNumeric())
+    {
+        config.rate_hz = rate.asFloat();
+    }
+    const Json::Value& period = signal["period_ms"];
+    if (period.isInt())
+    {
+        config.period = std::chrono::milliseconds(period.asInt());
+    }
+    const Json::Value& min_value = signal["min"];
+    if (min_value.isUInt())
+    {
+        config.min_value = min_value.asUInt();
+    }
+    const Json::Value& max_value = signal["max"];
+    if (max_value.isUInt())
+    {
+        config.max_value = max_value.asUInt();
+    }
+    const Json::Value& burst_length = signal["burst_length"];
+    if (burst_length.isInt())
+    {
+        config.burst_length = burst_length.asInt();
+    }
+    /* Controller ids are a single byte in the gpio protocol */
+    if (config.first_controller < 0 || config.n_controllers < 1 || config.first_controller + config.n_controllers > 256 ||
+        config.rate_hz <= 0 || config.period.count() < 1 || config.min_value > config.max_value || config.burst_length < 1)
+    {
+        return ConfigStatus::PARAMETER_ERROR;
+    }
+    return ConfigStatus::OK;
+}
+
+ConfigStatus JsonConfiguration::handle_send_lane_limit(const Json::Value& lane, hw_frontend::SendLaneLimit& limit)
+{
+    const Json::Value& capacity = lane["capacity"];
+    if (capacity.isInt())
+    {
+        if (capacity.asInt() < 1)
+        {
+            return ConfigStatus::PARAMETER_ERROR;
+        }
+        limit.capacity = capacity.asInt();
+    }
+    const Json::Value& policy = lane["overflow_policy"];
+    if (policy.isString())
+    {
+        if (policy == "block")
+        {
+            limit.policy = hw_frontend::OverflowPolicy::BLOCK;
+        }
+        else if (policy == "drop_oldest")
+        {
+            limit.policy = hw_frontend::OverflowPolicy::DROP_OLDEST;
+        }
+        else if (policy == "drop_newest")
+        {
+            limit.policy = hw_frontend::OverflowPolicy::DROP_NEWEST;
+        }
+        else if (policy == "coalesce")
+        {
+            limit.policy = hw_frontend::OverflowPolicy::COALESCE;
+        }
+        else
+        {
+            SENSEI_LOG_WARNING("\"{}\" is not a recognized overflow policy", policy.asString());
+            return ConfigStatus::PARAMETER_ERROR;
+        }
+    }
+    return ConfigStatus::OK;
+}
+
+/*
+ * Read the scheduling configuration of the threads, each one is optional
+ */
+ConfigStatus JsonConfiguration::handle_threads_config(const Json::Value& threads, ThreadsConfig& config)
+{
+    std::pair<const char*, ThreadSchedulingConfig*> thread_configs[] = {{"event_loop", &config.event_loop},
+                                                                        {"hw_frontend_read", &config.hw_frontend_read},
+                                                                        {"hw_frontend_write", &config.hw_frontend_write},
+                                                                        {"user_frontend", &config.user_frontend},
+                                                                        {"logger", &config.logger}};
+    for (auto& thread_config : thread_configs)
+    {
+        const Json::Value& thread = threads[thread_config.first];
+        if (thread.isObject())
+        {
+            ConfigStatus status = handle_thread_config(thread, *thread_config.second);
+            if (status != ConfigStatus::OK)
+            {
+                SENSEI_LOG_WARNING("Invalid scheduling configuration for thread \"{}\"", thread_config.first);
+                return status;
+            }
+        }
+    }
+    return ConfigStatus::OK;
+}
+
+ConfigStatus JsonConfiguration::handle_thread_config(const Json::Value& thread, ThreadSchedulingConfig& config)
+{
+    const Json::Value& policy = thread["policy"];
+    if (policy.isString())
+    {
+        if (policy == "other")
+        {
+            config.policy = SchedulingPolicy::OTHER;
+        }
+        else if (policy == "fifo")
+        {
+            config.policy = SchedulingPolicy::FIFO;
+        }
+        else if (policy == "rr")
+        {
+            config.policy = SchedulingPolicy::RR;
+        }
+        else
+        {
+            SENSEI_LOG_WARNING("\"{}\" is not a recognized scheduling policy", policy.asString());
+            return ConfigStatus::PARAMETER_ERROR;
+        }
+    }
+    const Json::Value& priority = thread["priority"];
+    if (priority.isInt())
+    {
+        if (priority.asInt() < 0 || priority.asInt() > 99)
+        {
+            SENSEI_LOG_WARNING("Thread priority {} out of range", priority.asInt());
+            return ConfigStatus::PARAMETER_ERROR;
+        }
+        config.priority = priority.asInt();
+    }
+    const Json::Value& cpus = thread["cpus"];
+    if (cpus.isArray())
+    {
+        config.cpus.clear();
+        for (const Json::Value& cpu : cpus)
+        {
+            if (!cpu.isInt() || cpu.asInt() < 0)
+            {
+                SENSEI_LOG_WARNING("Invalid cpu in thread affinity");
+                return ConfigStatus::PARAMETER_ERROR;
+            }
+            config.cpus.push_back(cpu.asInt());
+        }
+    }
+    return ConfigStatus::OK;
+}
+
+ConfigStatus JsonConfiguration::handle_metrics_config(const Json::Value& metrics, std::string& socket_path)
+{
+    const Json::Value& socket = metrics["socket"];
+    if (socket.isString())
+    {
+        if (socket.asString().empty())
+        {
+            SENSEI_LOG_WARNING("Empty metrics socket path");
+            return ConfigStatus::PARAMETER_ERROR;
+        }
+        socket_path = socket.asString();
+    }
     return ConfigStatus::OK;
 }
 
@@ -235,6 +686,11 @@ ConfigStatus JsonConfiguration::handle_sensor(const Json::Value& sensor)
             auto m = _message_factory.make_set_sending_mode_command(sensor_id, SendingMode::ON_VALUE_CHANGED);
             _queue->push(std::move(m));
         }
+        else if (mode_str == "on_request")
+        {
+            auto m = _message_factory.make_set_sending_mode_command(sensor_id, SendingMode::ON_REQUEST);
+            _queue->push(std::move(m));
+        }
         else
         {
             SENSEI_LOG_WARNING("\"{}\" is not a recognized sending mode", mode_str);
@@ -504,6 +960,41 @@ ConfigStatus JsonConfiguration::handle_osc_backend(const Json::Value& backend, i
         auto m = _message_factory.make_set_osc_output_raw_path_command(id, raw_path.asString());
         _queue->push(std::move(m));
     }
+    /* send only to subscribed clients and mute the sensors nobody subscribed to */
+    const Json::Value& subscription_mode = backend["subscription_mode"];
+    if (subscription_mode.isBool())
+    {
+        auto m = _message_factory.make_set_osc_subscription_mode_command(id, subscription_mode.asBool());
+        _queue->push(std::move(m));
+    }
+    return ConfigStatus::OK;
+}
+
+/*
+ * Handle configuration of the OSC user frontend
+ */
+ConfigStatus JsonConfiguration::handle_user_frontend(const Json::Value& frontend)
+{
+    const Json::Value& port = frontend["osc_input_port"];
+    if (port.isInt())
+    {
+        auto m = _message_factory.make_set_osc_input_port_command(0, port.asInt());
+        _queue->push(std::move(m));
+    }
+    /* optional receiver for high rate output updates, 0 disables it */
+    const Json::Value& fast_port = frontend["fast_input_port"];
+    if (fast_port.isInt())
+    {
+        auto m = _message_factory.make_set_osc_fast_input_port_command(0, fast_port.asInt());
+        _queue->push(std::move(m));
+    }
+    /* shared memory table for output values from co-located processes, empty disables it */
+    const Json::Value& shm_name = frontend["shm_input_name"];
+    if (shm_name.isString())
+    {
+        auto m = _message_factory.make_set_shm_input_name_command(0, shm_name.asString());
+        _queue->push(std::move(m));
+    }
     return ConfigStatus::OK;
 }
 
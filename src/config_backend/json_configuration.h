@@ -39,14 +39,21 @@ public:
     /*
      * Open file, parse json and put commands in queue
      */
-    ConfigStatus read(HwFrontendConfig& hw_config) override;
+    ConfigStatus read(HwConfig& hw_config) override;
 
 private:
+    ConfigStatus handle_hw_frontends(const Json::Value& frontends, std::vector<HwFrontendConfig>& configs);
     ConfigStatus handle_hw_config(const Json::Value& frontend, HwFrontendConfig& config);
+    ConfigStatus handle_send_lane_limit(const Json::Value& lane, hw_frontend::SendLaneLimit& limit);
+    ConfigStatus handle_synthetic_signal(const Json::Value& signal, hw_backend::SyntheticSignalConfig& config);
+    ConfigStatus handle_threads_config(const Json::Value& threads, ThreadsConfig& config);
+    ConfigStatus handle_thread_config(const Json::Value& thread, ThreadSchedulingConfig& config);
+    ConfigStatus handle_metrics_config(const Json::Value& metrics, std::string& socket_path);
     ConfigStatus handle_sensor(const Json::Value& sensor);
     ConfigStatus handle_sensor_hw(const Json::Value& hardware, int sensor_id);
     ConfigStatus handle_backend(const Json::Value& backend);
     ConfigStatus handle_osc_backend(const Json::Value& backend, int id);
+    ConfigStatus handle_user_frontend(const Json::Value& frontend);
     ConfigStatus read_pins(const Json::Value& pins, int sensor_id);
 
     MessageFactory _message_factory;
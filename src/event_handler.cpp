@@ -19,6 +19,7 @@
  */
 #include <iostream>
 #include <chrono>
+#include <algorithm>
 
 #include "event_handler.h"
 #include "output_backend/osc_backend.h"
@@ -26,13 +27,22 @@
 #include "user_frontend/osc_user_frontend.h"
 #include "hardware_frontend/hw_frontend.h"
 #include "hardware_backend/gpio_hw_socket.h"
+#include "hardware_backend/gpio_hw_shm.h"
+#include "hardware_backend/recording_hw_backend.h"
+#include "hardware_backend/replay_hw_backend.h"
+#include "hardware_backend/synthetic_hw_backend.h"
 #include "shiftreg_gpio/shiftreg_gpio.h"
+#include "shiftreg_gpio/shiftreg_gpio_sim.h"
+#include "thread_scheduling.h"
 #include "utils.h"
 #include "logging.h"
 
 using namespace sensei;
 
 constexpr auto HWBACKEND_TIMEOUT = std::chrono::milliseconds(250);
+constexpr char DEFAULT_GPIO_SOCKET[] = "/tmp/raspa";
+constexpr size_t BENCHMARK_LATENCY_SAMPLES = 1 << 16;
+constexpr auto LATENCY_WINDOW = std::chrono::seconds(10);
 
 SENSEI_GET_LOGGER_WITH_MODULE_NAME("eventhandler");
 
@@ -40,7 +50,7 @@ bool EventHandler::init(int max_n_input_pins,
                         int max_n_digital_out_pins,
                         const std::string& config_file)
 {
-    config::HwFrontendConfig hw_config;
+    config::HwConfig hw_config;
     _config_backend.reset(new config::JsonConfiguration(&_event_queue, config_file));
     auto ret = _config_backend->read(hw_config);
     if (ret != config::ConfigStatus::OK)
@@ -63,49 +73,75 @@ bool EventHandler::init(int max_n_input_pins,
         }
     }
 
-    // hw_frontend initialization
-    switch (hw_config.type)
+    // Configure the threads already running, the others are configured when they start
+    apply_current_thread_scheduling(hw_config.threads.event_loop, "event loop");
+    pthread_t logger_thread;
+    if (Logger::worker_thread(logger_thread))
     {
-    case HwFrontendType::RASPA_GPIO:
-        SENSEI_LOG_INFO("Initializing Gpio Hw Frontend with socket hw backend");
-        _hw_backend = std::make_unique<hw_backend::GpioHwSocket>("/tmp/raspa", HWBACKEND_TIMEOUT);
-        _hw_frontend = std::make_unique<hw_frontend::HwFrontend>(&_to_frontend_queue, &_event_queue, _hw_backend.get());
-        break;
-
-    case HwFrontendType::ELK_PI_GPIO:
-        SENSEI_LOG_INFO("Initializing Gpio Frontend with Elk Pi hw backend");
-        _hw_backend = std::make_unique<hw_backend::shiftregister_gpio::ShiftregGpio>(HWBACKEND_TIMEOUT);
-        _hw_frontend = std::make_unique<hw_frontend::HwFrontend>(&_to_frontend_queue, &_event_queue, _hw_backend.get());
-        break;
+        register_thread(logger_thread, "logger");
+        if (hw_config.threads.logger.is_set())
+        {
+            apply_thread_scheduling(logger_thread, hw_config.threads.logger, "logger");
+        }
+    }
 
-    default:
-        _hw_backend = std::make_unique<hw_backend::NoOpHwBackend>(HWBACKEND_TIMEOUT);
-        _hw_frontend = std::make_unique<hw_frontend::NoOpFrontend>(&_to_frontend_queue, &_event_queue);
-        SENSEI_LOG_ERROR("No HW Frontend configured");
-        break;
+    auto& metrics_registry = metrics::registry();
+    _event_queue.set_depth_metrics(metrics_registry.gauge("sensei_event_queue_depth", "Messages waiting in the event queue"),
+                                   metrics_registry.gauge("sensei_event_queue_high_water",
+                                                          "Most messages ever waiting in the event queue"));
+    if (hw_config.metrics_socket.empty() == false)
+    {
+        _metrics_exporter = std::make_unique<metrics::PrometheusExporter>(metrics_registry, hw_config.metrics_socket);
+        _metrics_exporter->start();
     }
 
-    if(!_hw_backend->init())
+    // hw_frontends initialization, one per board
+    if (hw_config.frontends.empty())
     {
-        SENSEI_LOG_ERROR("Failed to initialize hw backend");
-        return false;
+        hw_config.frontends.emplace_back();
+    }
+    for (const auto& frontend_config : hw_config.frontends)
+    {
+        auto board = _create_hw_board(frontend_config, max_n_input_pins);
+        if (board == nullptr)
+        {
+            return false;
+        }
+        _hw_boards.push_back(std::move(board));
     }
 
     _processor = std::make_unique<mapping::MappingProcessor>(max_n_input_pins);
     _output_backend = std::make_unique<output_backend::OSCBackend>(max_n_input_pins);
-    _user_frontend = std::make_unique<user_frontend::OSCUserFrontend>(&_event_queue, max_n_input_pins, max_n_digital_out_pins);
+    _latency_monitor = std::make_unique<LatencyMonitor>(max_n_input_pins, LATENCY_WINDOW);
+    _output_backend->set_latency_monitor(_latency_monitor.get());
+    _user_frontend = std::make_unique<user_frontend::OSCUserFrontend>(&_event_queue, max_n_input_pins, max_n_digital_out_pins,
+                                                                      hw_config.threads.user_frontend);
 
-    _hw_frontend->verify_acks(true);
-    _hw_frontend->run();
+    for (size_t i = 0; i < _hw_boards.size(); ++i)
+    {
+        auto& frontend = _hw_boards[i]->frontend;
+        if (hw_config.frontends[i].inline_mapping)
+        {
+            SENSEI_LOG_INFO("Mapping values of hw frontend {} on its read thread", i);
+            frontend->set_inline_value_handler(this);
+        }
+        frontend->set_thread_scheduling(hw_config.threads.hw_frontend_read, hw_config.threads.hw_frontend_write);
+        frontend->verify_acks(true);
+        frontend->run();
+    }
     return true;
 }
 
 void EventHandler::deinit()
 {
-    _hw_frontend->stop();
-    _hw_frontend.reset(nullptr);
-    _hw_backend->deinit();
-    _hw_backend.reset(nullptr);
+    for (auto& board : _hw_boards)
+    {
+        board->frontend->stop();
+        board->frontend.reset(nullptr);
+        board->backend->deinit();
+    }
+    _hw_boards.clear();
+    _metrics_exporter.reset(nullptr);
     _processor.reset(nullptr);
     _output_backend.reset(nullptr);
     _config_backend.reset(nullptr);
@@ -117,12 +153,16 @@ void EventHandler::handle_events(std::chrono::milliseconds wait_period)
     while (! _event_queue.empty())
     {
         std::unique_ptr<BaseMessage> event = _event_queue.pop();
+        std::lock_guard<std::mutex> lock(_processing_mutex);
         switch(event->base_type())
         {
         case MessageType::VALUE:
             {
+                auto start = std::chrono::steady_clock::now();
                 auto value = static_unique_ptr_cast<Value, BaseMessage>(std::move(event));
+                value->set_dequeue_time(start);
                 _handle_value(std::move(value));
+                _record_value_latency(start);
             }
             break;
 
@@ -130,6 +170,10 @@ void EventHandler::handle_events(std::chrono::milliseconds wait_period)
             {
                 auto cmd = static_unique_ptr_cast<Command, BaseMessage>(std::move(event));
                 _handle_command(std::move(cmd));
+                if (_benchmark_enabled)
+                {
+                    _benchmark_stats.commands++;
+                }
             }
             break;
 
@@ -141,6 +185,88 @@ void EventHandler::handle_events(std::chrono::milliseconds wait_period)
             break;
         }
     }
+    std::lock_guard<std::mutex> lock(_processing_mutex);
+    _update_subscriptions();
+    if (_latency_monitor != nullptr && _latency_monitor->rotate_if_due(std::chrono::steady_clock::now()))
+    {
+        _log_latency_summary();
+    }
+}
+
+void EventHandler::handle_inline_value(Value* value)
+{
+    // Only output values come from the hw frontend, set values always go through the event loop
+    auto start = std::chrono::steady_clock::now();
+    value->set_dequeue_time(start);
+    std::lock_guard<std::mutex> lock(_processing_mutex);
+    _processor->process(value, _output_backend.get());
+    _record_value_latency(start);
+}
+
+void EventHandler::enable_benchmark(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(_processing_mutex);
+    _benchmark_enabled = enabled;
+    _benchmark_stats = BenchmarkStatistics();
+    _event_queue.reset_max_size();
+    for (auto& board : _hw_boards)
+    {
+        board->to_frontend_queue.reset_max_size();
+    }
+    _value_latencies.clear();
+    _next_value_latency = 0;
+    if (enabled)
+    {
+        _value_latencies.reserve(BENCHMARK_LATENCY_SAMPLES);
+    }
+}
+
+BenchmarkStatistics EventHandler::benchmark_statistics()
+{
+    std::lock_guard<std::mutex> lock(_processing_mutex);
+    BenchmarkStatistics stats = _benchmark_stats;
+    stats.max_event_queue_depth = _event_queue.max_size();
+    for (auto& board : _hw_boards)
+    {
+        stats.max_hw_queue_depth = std::max(stats.max_hw_queue_depth, board->to_frontend_queue.max_size());
+    }
+    if (_value_latencies.empty() == false)
+    {
+        auto latencies = _value_latencies;
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](size_t p) {return latencies[(latencies.size() - 1) * p / 100];};
+        stats.latency_p50 = percentile(50);
+        stats.latency_p90 = percentile(90);
+        stats.latency_p99 = percentile(99);
+        stats.latency_max = latencies.back();
+    }
+    return stats;
+}
+
+hw_backend::BaseHwBackend* EventHandler::board_backend(int sensor_index)
+{
+    HwBoard* board = _hw_board_for_sensor(sensor_index);
+    return board != nullptr ? board->backend.get() : nullptr;
+}
+
+void EventHandler::_record_value_latency(std::chrono::steady_clock::time_point start)
+{
+    if (_benchmark_enabled == false)
+    {
+        return;
+    }
+    _benchmark_stats.values++;
+    auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    // Only the latest latencies are kept, so that memory use doesn't depend on the length of the run
+    if (_value_latencies.size() < BENCHMARK_LATENCY_SAMPLES)
+    {
+        _value_latencies.push_back(latency);
+    }
+    else
+    {
+        _value_latencies[_next_value_latency] = latency;
+        _next_value_latency = (_next_value_latency + 1) % BENCHMARK_LATENCY_SAMPLES;
+    }
 }
 
 void EventHandler::_handle_value(std::unique_ptr<Value> value)
@@ -151,16 +277,39 @@ void EventHandler::_handle_value(std::unique_ptr<Value> value)
     }
     else if (is_set_value(value.get()))
     {
-        auto cmd = _processor->process_set(value.get());
-        if (cmd != nullptr)
+        // A batch of values is mapped as a unit and handed over with a single queue operation
+        std::vector<std::unique_ptr<Command>> set_commands;
+        _processor->process_set(value.get(), set_commands);
+        if (set_commands.empty() == false)
         {
-            _to_frontend_queue.push(std::move(cmd));
+            _send_to_hw_frontends(set_commands);
         }
     }
 }
 
 void EventHandler::_handle_command(std::unique_ptr<Command> cmd)
 {
+    if (cmd->type() == CommandType::QUERY_VALUES)
+    {
+        _handle_query(static_cast<const QueryValuesCommand*>(cmd.get()));
+        return;
+    }
+    if (cmd->type() == CommandType::QUERY_CONFIG)
+    {
+        _handle_config_query(static_cast<const QueryConfigCommand*>(cmd.get()));
+        return;
+    }
+    if (cmd->type() == CommandType::QUERY_LATENCY)
+    {
+        _handle_latency_query(static_cast<const QueryLatencyCommand*>(cmd.get()));
+        return;
+    }
+    if (cmd->type() == CommandType::QUERY_METRICS)
+    {
+        _handle_metrics_query(static_cast<const QueryMetricsCommand*>(cmd.get()));
+        return;
+    }
+
     CommandDestination address = cmd->destination();
 
     // Process first non-sink destinations
@@ -253,12 +402,273 @@ void EventHandler::_handle_command(std::unique_ptr<Command> cmd)
     // which is a owning sink
     if (address & CommandDestination::HARDWARE_FRONTEND)
     {
-        _to_frontend_queue.push(std::move(cmd));
+        _send_to_hw_frontend(std::move(cmd));
+    }
+
+}
+
+void EventHandler::_handle_query(const QueryValuesCommand* query)
+{
+    // Queries are served from the mapping processor cache, the board is not involved
+    auto query_data = query->data();
+    CommandContainer values;
+    _processor->put_cached_values_into(query_data.sensors, std::back_inserter(values));
+    _output_backend->send_query_reply(values, query_data);
+}
+
+void EventHandler::_handle_config_query(const QueryConfigCommand* query)
+{
+    auto query_data = query->data();
+    CommandContainer commands;
+    _processor->put_config_commands_into(query_data.sensors, std::back_inserter(commands));
+    _output_backend->send_config_reply(commands, query_data);
+}
+
+void EventHandler::_handle_latency_query(const QueryLatencyCommand* query)
+{
+    if (_latency_monitor != nullptr)
+    {
+        _output_backend->send_latency_reply(*_latency_monitor, query->data());
+    }
+}
+
+void EventHandler::_handle_metrics_query(const QueryMetricsCommand* query)
+{
+    _output_backend->send_metrics_reply(metrics::registry(), query->data());
+}
+
+void EventHandler::_log_latency_summary()
+{
+    for (int stage = 0; stage < N_LATENCY_STAGES; ++stage)
+    {
+        auto summary = _latency_monitor->summary(static_cast<LatencyStage>(stage));
+        if (summary.samples == 0)
+        {
+            continue;
+        }
+        SENSEI_LOG_INFO("Latency {}: {} values, p50 {} us, p99 {} us, p99.9 {} us, max {} us",
+                        latency_stage_name(static_cast<LatencyStage>(stage)), summary.samples,
+                        summary.p50.count(), summary.p99.count(), summary.p999.count(), summary.max.count());
+    }
+}
+
+void EventHandler::_update_subscriptions()
+{
+    // Mute commands for sensors without subscribers go straight to the board,
+    // the mapping processor configuration is left untouched
+    CommandContainer mute_commands;
+    _output_backend->update_subscriptions(std::back_inserter(mute_commands));
+    for (auto& msg : mute_commands)
+    {
+        _send_to_hw_frontend(static_unique_ptr_cast<Command, BaseMessage>(std::move(msg)));
+    }
+}
+
+std::unique_ptr<EventHandler::HwBoard> EventHandler::_create_hw_board(const config::HwFrontendConfig& config,
+                                                                      int max_n_input_pins)
+{
+    if (config.first_sensor >= max_n_input_pins || config.first_sensor + config.n_sensors > max_n_input_pins)
+    {
+        SENSEI_LOG_ERROR("Sensor range {}, {} of hw frontend exceeds the {} sensors", config.first_sensor,
+                         config.n_sensors, max_n_input_pins);
+        return nullptr;
+    }
+    auto board = std::make_unique<HwBoard>();
+    board->first_sensor = config.first_sensor;
+    board->end_sensor = config.n_sensors > 0 ? config.first_sensor + config.n_sensors : max_n_input_pins;
+    // Boards are told apart in the metrics by their first sensor, as their ranges never overlap
+    auto metrics_labels = metrics::label("board", config.first_sensor);
+    auto& metrics_registry = metrics::registry();
+    board->to_frontend_queue.set_depth_metrics(
+            metrics_registry.gauge("sensei_hw_queue_depth", "Commands waiting in the queue of a board", metrics_labels),
+            metrics_registry.gauge("sensei_hw_queue_high_water", "Most commands ever waiting in the queue of a board",
+                                   metrics_labels));
+    std::string socket_name = config.port.empty() ? DEFAULT_GPIO_SOCKET : config.port;
+    std::string sensei_socket_name = config.sensei_port.empty() ? hw_backend::DEFAULT_SENSEI_SOCKET : config.sensei_port;
+
+    switch (config.type)
+    {
+    case HwFrontendType::RASPA_GPIO:
+        if (config.shm_transport)
+        {
+            SENSEI_LOG_INFO("Initializing Gpio Hw Frontend with shared memory hw backend on {} and {}", socket_name,
+                            sensei_socket_name);
+            board->backend = std::make_unique<hw_backend::GpioHwShm>(socket_name, HWBACKEND_TIMEOUT, sensei_socket_name);
+        }
+        else
+        {
+            SENSEI_LOG_INFO("Initializing Gpio Hw Frontend with socket hw backend on {} and {}", socket_name,
+                            sensei_socket_name);
+            board->backend = std::make_unique<hw_backend::GpioHwSocket>(socket_name, HWBACKEND_TIMEOUT,
+                                                                        sensei_socket_name);
+        }
+        break;
+
+    case HwFrontendType::ELK_PI_GPIO:
+        SENSEI_LOG_INFO("Initializing Gpio Frontend with Elk Pi hw backend");
+        board->backend = std::make_unique<hw_backend::shiftregister_gpio::ShiftregGpio>(HWBACKEND_TIMEOUT,
+                                                                                        config.rt_fifo_overflow);
+        break;
+
+    case HwFrontendType::ELK_PI_SIMULATION:
+        SENSEI_LOG_INFO("Initializing Gpio Frontend with simulated Elk Pi hw backend");
+        board->backend = std::make_unique<hw_backend::shiftregister_gpio::ShiftregGpioSim>(HWBACKEND_TIMEOUT,
+                                                                                           config.rt_fifo_overflow);
+        break;
+
+    case HwFrontendType::SYNTHETIC:
+        SENSEI_LOG_INFO("Initializing Gpio Frontend with synthetic hw backend");
+        board->backend = std::make_unique<hw_backend::SyntheticHwBackend>(config.synthetic_signals, HWBACKEND_TIMEOUT);
+        break;
+
+    case HwFrontendType::REPLAY:
+        SENSEI_LOG_INFO("Initializing Gpio Frontend with playback of {} at speed {}", config.replay_file, config.replay_speed);
+        board->backend = std::make_unique<hw_backend::ReplayHwBackend>(config.replay_file, config.replay_speed, HWBACKEND_TIMEOUT);
+        break;
+
+    default:
+        board->backend = std::make_unique<hw_backend::NoOpHwBackend>(HWBACKEND_TIMEOUT);
+        board->frontend = std::make_unique<hw_frontend::NoOpFrontend>(&board->to_frontend_queue, &_event_queue);
+        SENSEI_LOG_ERROR("No HW Frontend configured");
+        break;
+    }
+
+    if (board->frontend == nullptr)
+    {
+        if (config.record_file.empty() == false)
+        {
+            board->backend = std::make_unique<hw_backend::RecordingHwBackend>(std::move(board->backend),
+                                                                              config.record_file, HWBACKEND_TIMEOUT);
+        }
+        board->frontend = std::make_unique<hw_frontend::HwFrontend>(&board->to_frontend_queue, &_event_queue, board->backend.get(),
+                                                                    config.ack_window,
+                                                                    std::chrono::milliseconds(config.min_ack_timeout_ms),
+                                                                    std::chrono::milliseconds(config.max_ack_timeout_ms),
+                                                                    metrics_labels);
     }
 
+    if(!board->backend->init())
+    {
+        SENSEI_LOG_ERROR("Failed to initialize hw backend");
+        return nullptr;
+    }
+    // Values from controllers past the end of the range would be mapped to sensors that don't exist
+    board->frontend->set_sensor_range(board->first_sensor, board->end_sensor - board->first_sensor);
+    board->frontend->set_send_queue_limits(config.send_queue_limits);
+    return board;
+}
+
+EventHandler::HwBoard* EventHandler::_hw_board_for_sensor(int sensor_index)
+{
+    for (auto& board : _hw_boards)
+    {
+        if (sensor_index >= board->first_sensor && sensor_index < board->end_sensor)
+        {
+            return board.get();
+        }
+    }
+    return nullptr;
+}
+
+void EventHandler::_send_to_hw_frontend(std::unique_ptr<Command> cmd)
+{
+    if (cmd->type() == CommandType::ENABLE_SENDING_PACKETS)
+    {
+        // Applies to whole boards, every board gets its own copy
+        bool enabled = static_cast<const EnableSendingPacketsCommand*>(cmd.get())->data();
+        for (auto& board : _hw_boards)
+        {
+            board->to_frontend_queue.push(static_unique_ptr_cast<Command, BaseMessage>(
+                    _message_factory.make_enable_sending_packets_command(0, enabled)));
+        }
+        return;
+    }
+    HwBoard* board = _hw_board_for_sensor(cmd->index());
+    if (board == nullptr)
+    {
+        SENSEI_LOG_WARNING("No hw frontend handles sensor {}, dropping command {}", cmd->index(), cmd->representation());
+        return;
+    }
+    board->to_frontend_queue.push(std::move(cmd));
+}
+
+void EventHandler::_send_to_hw_frontends(std::vector<std::unique_ptr<Command>>& commands)
+{
+    // Each board gets its share of the commands with a single queue operation
+    if (_hw_boards.size() == 1)
+    {
+        _hw_boards.front()->to_frontend_queue.push_all(commands);
+        return;
+    }
+    std::vector<std::unique_ptr<Command>> board_commands;
+    for (auto& board : _hw_boards)
+    {
+        for (auto& cmd : commands)
+        {
+            if (cmd && cmd->index() >= board->first_sensor && cmd->index() < board->end_sensor)
+            {
+                board_commands.push_back(std::move(cmd));
+            }
+        }
+        if (board_commands.empty() == false)
+        {
+            board->to_frontend_queue.push_all(board_commands);
+        }
+    }
+    for (const auto& cmd : commands)
+    {
+        if (cmd)
+        {
+            SENSEI_LOG_WARNING("No hw frontend handles sensor {}, dropping command {}", cmd->index(), cmd->representation());
+        }
+    }
+    commands.clear();
 }
 
 void EventHandler::_handle_error(std::unique_ptr<Error> error)
 {
+    if (error->type() == ErrorType::HW_BACKEND_RESTARTED)
+    {
+        SENSEI_LOG_WARNING("Hardware board of sensor {} restarted, resending its configuration", error->index());
+        _resync_hw_board(error->index());
+        return;
+    }
     SENSEI_LOG_ERROR("Hardware Error: {}", error->representation());
+}
+
+void EventHandler::_resync_hw_board(int sensor_index)
+{
+    HwBoard* board = _hw_board_for_sensor(sensor_index);
+    if (board == nullptr)
+    {
+        return;
+    }
+    // Rebuild the board side configuration from the mapping processor, between a reset and a start of
+    // the board as when reading the configuration. The frontend restores the latest output values after.
+    std::vector<int> sensors;
+    for (int i = board->first_sensor; i < board->end_sensor; ++i)
+    {
+        sensors.push_back(i);
+    }
+    CommandContainer config_commands;
+    _processor->put_config_commands_into(sensors, std::back_inserter(config_commands));
+
+    std::vector<std::unique_ptr<Command>> commands;
+    commands.push_back(static_unique_ptr_cast<Command, BaseMessage>(
+            _message_factory.make_enable_sending_packets_command(0, false)));
+    for (auto& msg : config_commands)
+    {
+        auto cmd = static_unique_ptr_cast<Command, BaseMessage>(std::move(msg));
+        if (cmd->destination() & CommandDestination::HARDWARE_FRONTEND)
+        {
+            commands.push_back(std::move(cmd));
+        }
+    }
+    commands.push_back(static_unique_ptr_cast<Command, BaseMessage>(
+            _message_factory.make_enable_sending_packets_command(0, true)));
+    board->to_frontend_queue.push_all(commands);
+
+    // The configuration enables all sensors, mute the ones without subscribers again
+    _output_backend->sensors_reconfigured(board->first_sensor, board->end_sensor);
+    _update_subscriptions();
 }
\ No newline at end of file
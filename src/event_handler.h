@@ -23,6 +23,8 @@
 #include <memory>
 #include <string>
 #include <chrono>
+#include <mutex>
+#include <vector>
 
 #include "synchronized_queue.h"
 #include "mapping/mapping_processor.h"
@@ -32,10 +34,28 @@
 #include "output_backend/output_backend.h"
 #include "config_backend/base_configuration.h"
 #include "user_frontend/user_frontend.h"
+#include "latency_monitor.h"
+#include "metrics.h"
 
 namespace sensei {
 
-class EventHandler
+/**
+ * @brief Load figures collected by the event handler while benchmarking
+ */
+struct BenchmarkStatistics
+{
+    uint64_t values;                /* Values from the hardware that were mapped */
+    uint64_t commands;
+    size_t   max_event_queue_depth;
+    size_t   max_hw_queue_depth;    /* Deepest command queue of any board */
+    /* Time to map and output a single value, over the latest values */
+    std::chrono::nanoseconds latency_p50;
+    std::chrono::nanoseconds latency_p90;
+    std::chrono::nanoseconds latency_p99;
+    std::chrono::nanoseconds latency_max;
+};
+
+class EventHandler : public hw_frontend::InlineValueHandler
 {
 public:
     EventHandler() = default;
@@ -48,9 +68,30 @@ public:
 
     void deinit();
 
+    /**
+     * @brief Map and send a value directly from the hw frontend read thread.
+     *        Only used when inline mapping is enabled in the configuration.
+     * @param [in] value The value received from the hardware
+     */
+    void handle_inline_value(Value* value) override;
+
+    /**
+     * @brief Start or stop collecting the figures returned by benchmark_statistics(),
+     *        starting clears what was collected before.
+     */
+    void enable_benchmark(bool enabled);
+
+    BenchmarkStatistics benchmark_statistics();
+
+    /**
+     * @brief Returns the hw backend of the board handling the given sensor, or nullptr if no
+     *        board does. I.e. for test code to set the pins of a simulated Elk Pi board.
+     */
+    hw_backend::BaseHwBackend* board_backend(int sensor_index);
+
     void reload_config()
     {
-        config::HwFrontendConfig hwc;
+        config::HwConfig hwc;
         _config_backend->read(hwc);
     }
 
@@ -58,18 +99,57 @@ private:
     void _handle_value(std::unique_ptr<Value> value);
     void _handle_command(std::unique_ptr<Command> cmd);
     void _handle_error(std::unique_ptr<Error> error);
+    void _resync_hw_board(int sensor_index);
+    void _handle_query(const QueryValuesCommand* query);
+    void _handle_config_query(const QueryConfigCommand* query);
+    void _handle_latency_query(const QueryLatencyCommand* query);
+    void _handle_metrics_query(const QueryMetricsCommand* query);
+    void _log_latency_summary();
+    void _update_subscriptions();
+    void _record_value_latency(std::chrono::steady_clock::time_point start);
+
+    /**
+     * @brief A board, with its own hw backend, hw frontend and command queue.
+     *        Handles the sensor ids from first_sensor up to, not including, end_sensor.
+     */
+    struct HwBoard
+    {
+        int first_sensor;
+        int end_sensor;
+        SynchronizedQueue<std::unique_ptr<Command>> to_frontend_queue;
+        std::unique_ptr<hw_backend::BaseHwBackend> backend;
+        std::unique_ptr<hw_frontend::BaseHwFrontend> frontend;
+    };
+
+    std::unique_ptr<HwBoard> _create_hw_board(const config::HwFrontendConfig& config, int max_n_input_pins);
+    HwBoard* _hw_board_for_sensor(int sensor_index);
+    void _send_to_hw_frontend(std::unique_ptr<Command> cmd);
+    void _send_to_hw_frontends(std::vector<std::unique_ptr<Command>>& commands);
 
-    // Inter-modules communication queues
-    SynchronizedQueue<std::unique_ptr<Command>> _to_frontend_queue;
+    // Inter-modules communication queue, each board also has its own command queue
     SynchronizedQueue<std::unique_ptr<BaseMessage>> _event_queue;
 
+    // Latencies of values from the boards to the output backend, must outlive the output backend
+    std::unique_ptr<LatencyMonitor> _latency_monitor;
+
     // Sub-components instances
-    std::unique_ptr<hw_frontend::BaseHwFrontend> _hw_frontend;
-    std::unique_ptr<hw_backend::BaseHwBackend> _hw_backend;
+    std::vector<std::unique_ptr<HwBoard>> _hw_boards;
     std::unique_ptr<mapping::MappingProcessor> _processor;
     std::unique_ptr<output_backend::OutputBackend> _output_backend;
     std::unique_ptr<config::BaseConfiguration> _config_backend;
     std::unique_ptr<user_frontend::UserFrontend> _user_frontend;
+    std::unique_ptr<metrics::PrometheusExporter> _metrics_exporter;
+
+    // Benchmarking, protected by _processing_mutex
+    bool     _benchmark_enabled{false};
+    BenchmarkStatistics _benchmark_stats{};
+    std::vector<std::chrono::nanoseconds> _value_latencies;
+    size_t   _next_value_latency{0};
+    MessageFactory _message_factory;
+
+    // Serializes access to the mapping processor and output backend
+    // between the event loop and the hw frontend read thread
+    std::mutex _processing_mutex;
 };
 
 } // namespace sensei
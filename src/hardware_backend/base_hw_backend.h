@@ -78,6 +78,44 @@ public:
      */
     virtual bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) = 0;
 
+    /**
+     * @brief Send several GPIO Packets to the gpio hardware device, in order.
+     *        Backends that can send a batch with fewer system calls should
+     *        override this, the default sends one packet at a time.
+     *
+     * @param tx_gpio_packets The gpio packets to be sent
+     * @param count The number of packets in tx_gpio_packets
+     * @return The number of packets sent, the first packets of the batch
+     */
+    virtual int send_gpio_packets(const gpio::GpioPacket* tx_gpio_packets, int count)
+    {
+        int sent = 0;
+        while (sent < count && send_gpio_packet(tx_gpio_packets[sent]))
+        {
+            sent++;
+        }
+        return sent;
+    }
+
+    /**
+     * @brief Receive up to max_count GPIO Packets from the gpio hardware device.
+     *        Blocks with a timeout of _recv_packet_timeout until the first
+     *        packet arrives, then returns the packets that are available
+     *        without blocking. The default receives one packet at a time.
+     *
+     * @param rx_gpio_packets Destination of the received packets
+     * @param max_count The max number of packets to receive
+     * @return The number of packets received, 0 on timeout
+     */
+    virtual int receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count)
+    {
+        if (max_count > 0 && receive_gpio_packet(rx_gpio_packets[0]))
+        {
+            return 1;
+        }
+        return 0;
+    }
+
 protected:
     std::chrono::milliseconds _recv_packet_timeout;
 };
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Binary format of the captures of gpio packets exchanged with a hw backend,
+ *        written by RecordingHwBackend and played back by ReplayHwBackend.
+ *
+ *        A capture starts with a CaptureHeader, followed by one record per packet:
+ *        the time in nanoseconds since the start of the recording (int64_t), the
+ *        direction (uint8_t) and the raw packet, all in host byte order.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#ifndef SENSEI_GPIO_CAPTURE_H
+#define SENSEI_GPIO_CAPTURE_H
+
+#include <cstdint>
+#include <chrono>
+
+#include "gpio_protocol/gpio_protocol.h"
+
+namespace sensei {
+namespace hw_backend {
+
+constexpr char     CAPTURE_MAGIC[8] = {'S', 'N', 'S', 'I', 'G', 'C', 'A', 'P'};
+constexpr uint32_t CAPTURE_VERSION = 1;
+
+enum class CaptureDirection : uint8_t
+{
+    RX = 0,     /* Received from the board */
+    TX = 1,     /* Sent to the board */
+};
+
+struct CaptureHeader
+{
+    char     magic[8];
+    uint32_t version;
+    /* Captures can only be played back by builds with the same packet layout */
+    uint32_t packet_size;
+};
+
+struct CaptureRecord
+{
+    std::chrono::nanoseconds time;
+    CaptureDirection         direction;
+    gpio::GpioPacket         packet;
+};
+
+constexpr size_t CAPTURE_RECORD_SIZE = sizeof(int64_t) + sizeof(uint8_t) + sizeof(gpio::GpioPacket);
+
+} // namespace hw_backend
+} // namespace sensei
+
+#endif // SENSEI_GPIO_CAPTURE_H
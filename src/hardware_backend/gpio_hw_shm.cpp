@@ -0,0 +1,201 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Hw backend exchanging packets with a gpio protocol client through
+ *        shared memory rings, with the unix sockets as fallback.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <cstring>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include "gpio_hw_shm.h"
+#include "logging.h"
+
+namespace sensei {
+namespace hw_backend {
+
+constexpr int SHM_NEGOTIATION_ATTEMPTS = 5;
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("gpio_hw_shm");
+
+bool GpioHwShm::init()
+{
+    if (!GpioHwSocket::init())
+    {
+        return false;
+    }
+    if (_negotiate_shm_transport())
+    {
+        SENSEI_LOG_INFO("Using shared memory transport with gpio client");
+    }
+    else
+    {
+        SENSEI_LOG_INFO("Gpio client does not support shared memory, using sockets");
+    }
+    return true;
+}
+
+void GpioHwShm::deinit()
+{
+    _release_shm_transport();
+    GpioHwSocket::deinit();
+}
+
+bool GpioHwShm::send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet)
+{
+    return send_gpio_packets(&tx_gpio_packet, 1) == 1;
+}
+
+bool GpioHwShm::receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet)
+{
+    return receive_gpio_packets(&rx_gpio_packet, 1) == 1;
+}
+
+int GpioHwShm::send_gpio_packets(const gpio::GpioPacket* tx_gpio_packets, int count)
+{
+    if (!shm_active())
+    {
+        return GpioHwSocket::send_gpio_packets(tx_gpio_packets, count);
+    }
+    bool wake_client;
+    int sent = gpio_shm_push(_segment->to_client, tx_gpio_packets, count, wake_client);
+    if (wake_client)
+    {
+        uint64_t doorbell = 1;
+        [[maybe_unused]] auto res = write(_to_client_doorbell, &doorbell, sizeof(doorbell));
+    }
+    return sent;
+}
+
+int GpioHwShm::receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count)
+{
+    if (!shm_active())
+    {
+        return GpioHwSocket::receive_gpio_packets(rx_gpio_packets, max_count);
+    }
+    int received = gpio_shm_pop(_segment->from_client, rx_gpio_packets, max_count);
+    if (received > 0)
+    {
+        return received;
+    }
+    pollfd doorbell_fd = {_from_client_doorbell, POLLIN, 0};
+    if (poll(&doorbell_fd, 1, static_cast<int>(_recv_packet_timeout.count())) > 0)
+    {
+        uint64_t doorbell;
+        [[maybe_unused]] auto res = read(_from_client_doorbell, &doorbell, sizeof(doorbell));
+    }
+    return gpio_shm_pop(_segment->from_client, rx_gpio_packets, max_count);
+}
+
+bool GpioHwShm::_negotiate_shm_transport()
+{
+    int segment_fd = memfd_create("sensei_gpio_shm", MFD_CLOEXEC);
+    if (segment_fd < 0)
+    {
+        SENSEI_LOG_ERROR("Failed to create shared memory: {}", strerror(errno));
+        return false;
+    }
+    void* mem = MAP_FAILED;
+    if (ftruncate(segment_fd, sizeof(GpioShmSegment)) == 0)
+    {
+        mem = mmap(nullptr, sizeof(GpioShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+    }
+    _to_client_doorbell = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _from_client_doorbell = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mem == MAP_FAILED || _to_client_doorbell < 0 || _from_client_doorbell < 0)
+    {
+        SENSEI_LOG_ERROR("Failed to set up shared memory transport: {}", strerror(errno));
+        if (mem != MAP_FAILED)
+        {
+            munmap(mem, sizeof(GpioShmSegment));
+        }
+        close(segment_fd);
+        _release_shm_transport();
+        return false;
+    }
+    auto segment = static_cast<GpioShmSegment*>(mem);
+    std::memset(mem, 0, sizeof(GpioShmSegment));
+    segment->magic = GPIO_SHM_MAGIC;
+    segment->version = GPIO_SHM_VERSION;
+
+    /* Send the offer with the file descriptors attached */
+    GpioShmOffer offer = {GPIO_SHM_MAGIC, GPIO_SHM_VERSION, sizeof(GpioShmSegment)};
+    int fds[GPIO_SHM_N_FDS];
+    fds[GPIO_SHM_SEGMENT_FD] = segment_fd;
+    fds[GPIO_SHM_TO_CLIENT_DOORBELL_FD] = _to_client_doorbell;
+    fds[GPIO_SHM_FROM_CLIENT_DOORBELL_FD] = _from_client_doorbell;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+    std::memset(control, 0, sizeof(control));
+    iovec buffer = {&offer, sizeof(offer)};
+    msghdr message = {};
+    message.msg_iov = &buffer;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* fd_message = CMSG_FIRSTHDR(&message);
+    fd_message->cmsg_level = SOL_SOCKET;
+    fd_message->cmsg_type = SCM_RIGHTS;
+    fd_message->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(fd_message), fds, sizeof(fds));
+
+    bool accepted = false;
+    if (sendmsg(_out_socket, &message, 0) == sizeof(offer))
+    {
+        /* Packets sent by the client before it has seen the offer are dropped */
+        for (int i = 0; i < SHM_NEGOTIATION_ATTEMPTS && !accepted; ++i)
+        {
+            GpioShmReply reply;
+            auto bytes = recv(_in_socket, &reply, sizeof(reply), 0);
+            accepted = bytes == sizeof(reply) && reply.magic == GPIO_SHM_MAGIC &&
+                       reply.version == GPIO_SHM_VERSION && reply.accepted != 0;
+        }
+    }
+    /* The client has its own copy of the segment descriptor, the mapping stays valid */
+    close(segment_fd);
+    _segment = segment;
+    if (!accepted)
+    {
+        _release_shm_transport();
+    }
+    return accepted;
+}
+
+void GpioHwShm::_release_shm_transport()
+{
+    if (_segment != nullptr)
+    {
+        munmap(_segment, sizeof(GpioShmSegment));
+        _segment = nullptr;
+    }
+    if (_to_client_doorbell >= 0)
+    {
+        close(_to_client_doorbell);
+        _to_client_doorbell = -1;
+    }
+    if (_from_client_doorbell >= 0)
+    {
+        close(_from_client_doorbell);
+        _from_client_doorbell = -1;
+    }
+}
+
+} // namespace hw_backend
+} // namespace sensei
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Hw backend exchanging packets with a gpio protocol client through
+ *        shared memory rings, with the unix sockets as fallback.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#ifndef SENSEI_GPIO_HW_SHM_H
+#define SENSEI_GPIO_HW_SHM_H
+
+#include <string>
+#include <chrono>
+
+#include "gpio_hw_socket.h"
+#include "gpio_shm_ring.h"
+
+namespace sensei {
+namespace hw_backend {
+
+/**
+ * @brief Connects to the gpio hw socket like GpioHwSocket and then offers the
+ *        client a shared memory segment with a ring of packets in each direction
+ *        (see gpio_shm_ring.h). If the client accepts, packets are exchanged
+ *        through the rings, otherwise through the sockets. The transport is
+ *        only negotiated in init() and the client going away is not noticed
+ *        while the rings are used, so the client has to be started first and
+ *        not be restarted on its own.
+ */
+class GpioHwShm : public GpioHwSocket
+{
+public:
+    GpioHwShm(std::string gpio_hw_socket_name,
+              std::chrono::milliseconds recv_packet_timeout,
+              std::string sensei_socket_name = DEFAULT_SENSEI_SOCKET) :
+                                    GpioHwSocket(gpio_hw_socket_name, recv_packet_timeout, sensei_socket_name),
+                                    _segment(nullptr),
+                                    _to_client_doorbell(-1),
+                                    _from_client_doorbell(-1)
+    {}
+
+    ~GpioHwShm()
+    {
+        deinit();
+    }
+
+    /**
+     * @brief Initialize the sockets and negotiate the shared memory transport
+     *        with the gpio client.
+     * @return True if successful, false if not. Falling back to the sockets
+     *         is not an error.
+     */
+    bool init() override;
+
+    /**
+     * @brief Release the shared memory and close the sockets.
+     */
+    void deinit() override;
+
+    bool send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet) override;
+
+    bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) override;
+
+    int send_gpio_packets(const gpio::GpioPacket* tx_gpio_packets, int count) override;
+
+    int receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count) override;
+
+    /**
+     * @brief Returns true if packets go through shared memory
+     */
+    bool shm_active() const
+    {
+        return _segment != nullptr;
+    }
+
+private:
+    /**
+     * @brief Create the segment and doorbells and offer them to the client.
+     * @return True if the client accepted the offer
+     */
+    bool _negotiate_shm_transport();
+
+    void _release_shm_transport();
+
+    GpioShmSegment* _segment;
+    int _to_client_doorbell;
+    int _from_client_doorbell;
+};
+
+} // namespace hw_backend
+} // namespace sensei
+
+#endif // SENSEI_GPIO_HW_SHM_H
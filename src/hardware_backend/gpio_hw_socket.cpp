@@ -21,9 +21,12 @@
 #include <chrono>
 #include <iostream>
 #include <cstring>
+#include <array>
+#include <algorithm>
 
 #include <sys/un.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include "gpio_hw_socket.h"
 #include "logging.h"
@@ -31,7 +34,6 @@
 namespace sensei {
 namespace hw_backend {
 
-constexpr char SENSEI_SOCKET[] = "/tmp/sensei";
 constexpr size_t GPIO_PACKET_SIZE = sizeof(gpio::GpioPacket);
 
 SENSEI_GET_LOGGER_WITH_MODULE_NAME("gpio_hw_socket");
@@ -43,19 +45,24 @@ bool GpioHwSocket::init()
 
     if (_in_socket >= 0 && _out_socket >= 0)
     {
-        /* Sensei binds one socket to SENSEI_SOCKET, then tries to connect
+        /* Sensei binds one socket to sensei_socket_name, then tries to connect
          * the other one to gpio_hw_socket_name, if this fails, Sensei will retry
          * the connection to gpio_hw_socket_name when it receives something on
-         * SENSEI_SOCKET.
+         * sensei_socket_name.
          * gpio_hw_socket_name should do the opposite when it starts up, binds to
          * its own port and waits for a message. This way the processes can be
          * started in any order and synchronise  */
 
         sockaddr_un address;
         address.sun_family = AF_UNIX;
-        strcpy(address.sun_path, SENSEI_SOCKET);
+        if (_sensei_socket_name.size() >= sizeof(address.sun_path))
+        {
+            SENSEI_LOG_ERROR("Socket name {} is too long", _sensei_socket_name);
+            return false;
+        }
+        strcpy(address.sun_path, _sensei_socket_name.c_str());
         // In case sensei didn't quit gracefully, clear the socket handle
-        unlink(SENSEI_SOCKET);
+        unlink(_sensei_socket_name.c_str());
         auto res = bind(_in_socket, reinterpret_cast<sockaddr*>(&address), sizeof(sockaddr_un));
         if (res != 0)
         {
@@ -85,7 +92,7 @@ bool GpioHwSocket::init()
 
 void GpioHwSocket::deinit()
 {
-    unlink(SENSEI_SOCKET);
+    unlink(_sensei_socket_name.c_str());
 }
 
 bool GpioHwSocket::send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet)
@@ -105,7 +112,6 @@ bool GpioHwSocket::send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet)
 
 bool GpioHwSocket::receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet)
 {
-    memset(&rx_gpio_packet, 0, GPIO_PACKET_SIZE);
     auto bytes = recv(_in_socket, &rx_gpio_packet, GPIO_PACKET_SIZE, 0);
     if(bytes < static_cast<ssize_t>(GPIO_PACKET_SIZE))
     {
@@ -115,7 +121,82 @@ bool GpioHwSocket::receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet)
     return true;
 }
 
-inline void GpioHwSocket::_connect_to_gpio_hw_socket()
+#ifdef __linux__
+int GpioHwSocket::send_gpio_packets(const gpio::GpioPacket* tx_gpio_packets, int count)
+{
+    std::array<mmsghdr, GPIO_SOCKET_BATCH_SIZE> messages;
+    std::array<iovec, GPIO_SOCKET_BATCH_SIZE> buffers;
+    int sent = 0;
+    while (sent < count)
+    {
+        int batch_size = std::min(count - sent, GPIO_SOCKET_BATCH_SIZE);
+        for (int i = 0; i < batch_size; ++i)
+        {
+            buffers[i].iov_base = const_cast<gpio::GpioPacket*>(&tx_gpio_packets[sent + i]);
+            buffers[i].iov_len = GPIO_PACKET_SIZE;
+            memset(&messages[i], 0, sizeof(mmsghdr));
+            messages[i].msg_hdr.msg_iov = &buffers[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        auto res = sendmmsg(_out_socket, messages.data(), batch_size, 0);
+        if (res > 0)
+        {
+            sent += res;
+        }
+        if (res < batch_size)
+        {
+            SENSEI_LOG_WARNING("Sending packets on socket failed, {} of {} sent. Attempting"
+                               " to reconnect to socket..,", sent, count);
+            _connect_to_gpio_hw_socket();
+            break;
+        }
+    }
+    return sent;
+}
+
+int GpioHwSocket::receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count)
+{
+    std::array<mmsghdr, GPIO_SOCKET_BATCH_SIZE> messages;
+    std::array<iovec, GPIO_SOCKET_BATCH_SIZE> buffers;
+    int batch_size = std::min(max_count, GPIO_SOCKET_BATCH_SIZE);
+    for (int i = 0; i < batch_size; ++i)
+    {
+        buffers[i].iov_base = &rx_gpio_packets[i];
+        buffers[i].iov_len = GPIO_PACKET_SIZE;
+        memset(&messages[i], 0, sizeof(mmsghdr));
+        messages[i].msg_hdr.msg_iov = &buffers[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    /* The socket receive timeout applies until the first packet, the rest is taken if already queued */
+    auto res = recvmmsg(_in_socket, messages.data(), batch_size, MSG_WAITFORONE, nullptr);
+    int received = 0;
+    for (int i = 0; i < res; ++i)
+    {
+        if (messages[i].msg_len < GPIO_PACKET_SIZE)
+        {
+            continue;
+        }
+        if (received != i)
+        {
+            rx_gpio_packets[received] = rx_gpio_packets[i];
+        }
+        received++;
+    }
+    return received;
+}
+#else
+int GpioHwSocket::send_gpio_packets(const gpio::GpioPacket* tx_gpio_packets, int count)
+{
+    return BaseHwBackend::send_gpio_packets(tx_gpio_packets, count);
+}
+
+int GpioHwSocket::receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count)
+{
+    return BaseHwBackend::receive_gpio_packets(rx_gpio_packets, max_count);
+}
+#endif
+
+void GpioHwSocket::_connect_to_gpio_hw_socket()
 {
     sockaddr_un address;
     address.sun_family = AF_UNIX;
@@ -30,6 +30,12 @@
 namespace sensei {
 namespace hw_backend {
 
+/* Max number of packets sent or received with one system call */
+constexpr int GPIO_SOCKET_BATCH_SIZE = 32;
+
+/* Socket sensei receives packets on, unless configured otherwise */
+constexpr char DEFAULT_SENSEI_SOCKET[] = "/tmp/sensei";
+
 /**
  * @brief Class to provide an abstract interface to transfer gpio packets over unix sockets.
  *        This class creates a sensei socket and connects to the socket of the gpio hw process.
@@ -43,14 +49,18 @@ public:
      * @brief Construct a new Gpio Hw Socket backend.
      *
      * @param gpio_hw_socket_name The socket name to which it should connect to
+     * @param sensei_socket_name The socket name it binds to and receives packets on,
+     *                           must be different for every board
      */
     GpioHwSocket(std::string gpio_hw_socket_name,
-                 std::chrono::milliseconds recv_packet_timeout) :
+                 std::chrono::milliseconds recv_packet_timeout,
+                 std::string sensei_socket_name = DEFAULT_SENSEI_SOCKET) :
                                                 BaseHwBackend(recv_packet_timeout),
                                                 _in_socket(-1),
                                                 _out_socket(-1),
                                                 _connected(false),
-                                                _gpio_hw_socket_name(gpio_hw_socket_name)
+                                                _gpio_hw_socket_name(gpio_hw_socket_name),
+                                                _sensei_socket_name(sensei_socket_name)
     {}
 
     ~GpioHwSocket()
@@ -90,7 +100,27 @@ public:
      */
     bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) override;
 
-private:
+    /**
+     * @brief Send a batch of gpio packets with a single system call per
+     *        GPIO_SOCKET_BATCH_SIZE packets, using sendmmsg.
+     *
+     * @param tx_gpio_packets The gpio packets to be sent.
+     * @param count The number of packets to send.
+     * @return The number of packets sent.
+     */
+    int send_gpio_packets(const gpio::GpioPacket* tx_gpio_packets, int count) override;
+
+    /**
+     * @brief Receive all queued gpio packets, up to max_count, with a single
+     *        system call using recvmmsg. Blocks only until the first packet.
+     *
+     * @param rx_gpio_packets The destination to store the incoming packets
+     * @param max_count The max number of packets to receive
+     * @return The number of packets received
+     */
+    int receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count) override;
+
+protected:
     /**
      * @brief Helper member to connect to the gpio hw socket.
      */
@@ -102,6 +132,7 @@ private:
     bool _connected;
 
     std::string _gpio_hw_socket_name;
+    std::string _sensei_socket_name;
 };
 
 } // namespace hw_backend
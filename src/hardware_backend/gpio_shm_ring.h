@@ -0,0 +1,152 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Shared memory rings of gpio packets between Sensei and a gpio client process
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Sensei creates a memory segment with one single producer, single consumer
+ * ring in each direction and an eventfd doorbell per ring. It offers them
+ * to the gpio client over the datagram socket, passing the file descriptors
+ * with SCM_RIGHTS, and uses them instead of the socket if the client accepts.
+ *
+ * A producer only rings the doorbell when the consumer might be waiting on it,
+ * that is when the consumer had emptied the ring before the packets were pushed.
+ * So under load, packets are exchanged without any system calls.
+ *
+ * This header only depends on the gpio protocol so that clients can include it.
+ */
+#ifndef SENSEI_GPIO_SHM_RING_H
+#define SENSEI_GPIO_SHM_RING_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "gpio_protocol/gpio_protocol.h"
+
+namespace sensei {
+namespace hw_backend {
+
+constexpr uint32_t GPIO_SHM_MAGIC = 0x47504953; // "GPIS"
+constexpr uint32_t GPIO_SHM_VERSION = 1;
+constexpr uint32_t GPIO_SHM_RING_SIZE = 256;
+
+static_assert((GPIO_SHM_RING_SIZE & (GPIO_SHM_RING_SIZE - 1)) == 0, "Ring size must be a power of 2");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory rings need lock free atomics");
+
+/* Order of the file descriptors passed with the offer */
+enum GpioShmFd
+{
+    GPIO_SHM_SEGMENT_FD = 0,
+    GPIO_SHM_TO_CLIENT_DOORBELL_FD,
+    GPIO_SHM_FROM_CLIENT_DOORBELL_FD,
+    GPIO_SHM_N_FDS
+};
+
+/* Sent by Sensei together with the file descriptors. It is shorter than a
+ * gpio packet, so clients without shared memory support drop it. */
+struct GpioShmOffer
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t segment_size;
+};
+
+/* Reply from the client over the socket */
+struct GpioShmReply
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t accepted;
+};
+
+static_assert(sizeof(GpioShmOffer) < sizeof(gpio::GpioPacket), "Offer must not be mistaken for a packet");
+static_assert(sizeof(GpioShmReply) < sizeof(gpio::GpioPacket), "Reply must not be mistaken for a packet");
+
+struct GpioShmRing
+{
+    alignas(64) std::atomic<uint32_t> head; // Written by the consumer
+    alignas(64) std::atomic<uint32_t> tail; // Written by the producer
+    gpio::GpioPacket packets[GPIO_SHM_RING_SIZE];
+};
+
+struct GpioShmSegment
+{
+    uint32_t magic;
+    uint32_t version;
+    GpioShmRing to_client;
+    GpioShmRing from_client;
+};
+
+/**
+ * @brief Push packets to a ring, only call this from the producing side.
+ *
+ * @param [in] ring The ring to push to
+ * @param [in] packets Packets to push
+ * @param [in] count Number of packets
+ * @param [out] wake_consumer Set to true if the doorbell of the ring must be rung
+ *
+ * @return The number of packets pushed, fewer than count if the ring is full
+ */
+inline int gpio_shm_push(GpioShmRing& ring, const gpio::GpioPacket* packets, int count, bool& wake_consumer)
+{
+    const uint32_t start = ring.tail.load(std::memory_order_relaxed);
+    const uint32_t head = ring.head.load(std::memory_order_acquire);
+    uint32_t tail = start;
+    int pushed = 0;
+    while (pushed < count && tail - head < GPIO_SHM_RING_SIZE)
+    {
+        ring.packets[tail % GPIO_SHM_RING_SIZE] = packets[pushed++];
+        tail++;
+    }
+    ring.tail.store(tail, std::memory_order_seq_cst);
+    /* If the consumer had taken all packets before these, it may have seen the
+     * ring empty and be waiting. Otherwise it sees these when it comes back for
+     * the earlier packets. Pairs with the seq_cst store and load in gpio_shm_pop() */
+    wake_consumer = pushed > 0 && ring.head.load(std::memory_order_seq_cst) == start;
+    return pushed;
+}
+
+/**
+ * @brief Pop packets from a ring, only call this from the consuming side.
+ *        If it returns 0, the consumer can wait for the doorbell of the ring.
+ *
+ * @param [in] ring The ring to pop from
+ * @param [out] packets Destination of the packets
+ * @param [in] max_count Max number of packets to pop
+ *
+ * @return The number of packets popped
+ */
+inline int gpio_shm_pop(GpioShmRing& ring, gpio::GpioPacket* packets, int max_count)
+{
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    const uint32_t tail = ring.tail.load(std::memory_order_seq_cst);
+    int popped = 0;
+    while (popped < max_count && head != tail)
+    {
+        packets[popped++] = ring.packets[head % GPIO_SHM_RING_SIZE];
+        head++;
+    }
+    if (popped > 0)
+    {
+        ring.head.store(head, std::memory_order_seq_cst);
+    }
+    return popped;
+}
+
+} // namespace hw_backend
+} // namespace sensei
+
+#endif //SENSEI_GPIO_SHM_RING_H
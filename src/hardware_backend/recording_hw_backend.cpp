@@ -0,0 +1,131 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Hw backend tap recording every packet exchanged with another hw backend
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <cstring>
+#include <cerrno>
+
+#include "recording_hw_backend.h"
+#include "logging.h"
+
+namespace sensei {
+namespace hw_backend {
+
+/* Large enough that the disk is rarely touched from the read and write threads */
+constexpr size_t CAPTURE_FILE_BUFFER_SIZE = 1 << 16;
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("recording_hw_backend");
+
+bool RecordingHwBackend::init()
+{
+    {
+        std::lock_guard<std::mutex> lock(_file_mutex);
+        _file = std::fopen(_file_name.c_str(), "wb");
+        if (_file == nullptr)
+        {
+            SENSEI_LOG_ERROR("Failed to open capture file {}: {}", _file_name, std::strerror(errno));
+            return false;
+        }
+        std::setvbuf(_file, nullptr, _IOFBF, CAPTURE_FILE_BUFFER_SIZE);
+        CaptureHeader header;
+        std::memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+        header.version = CAPTURE_VERSION;
+        header.packet_size = sizeof(gpio::GpioPacket);
+        std::fwrite(&header, sizeof(header), 1, _file);
+        _start_time = std::chrono::steady_clock::now();
+        _recorded_packets = 0;
+    }
+    SENSEI_LOG_INFO("Recording hw backend packets to {}", _file_name);
+    return _backend->init();
+}
+
+void RecordingHwBackend::deinit()
+{
+    _backend->deinit();
+    std::lock_guard<std::mutex> lock(_file_mutex);
+    if (_file != nullptr)
+    {
+        std::fclose(_file);
+        _file = nullptr;
+        SENSEI_LOG_INFO("Recorded {} packets to {}", _recorded_packets, _file_name);
+    }
+}
+
+bool RecordingHwBackend::send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet)
+{
+    bool sent = _backend->send_gpio_packet(tx_gpio_packet);
+    if (sent)
+    {
+        _record(&tx_gpio_packet, 1, CaptureDirection::TX);
+    }
+    return sent;
+}
+
+bool RecordingHwBackend::receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet)
+{
+    bool received = _backend->receive_gpio_packet(rx_gpio_packet);
+    if (received)
+    {
+        _record(&rx_gpio_packet, 1, CaptureDirection::RX);
+    }
+    return received;
+}
+
+int RecordingHwBackend::send_gpio_packets(const gpio::GpioPacket* tx_gpio_packets, int count)
+{
+    int sent = _backend->send_gpio_packets(tx_gpio_packets, count);
+    _record(tx_gpio_packets, sent, CaptureDirection::TX);
+    return sent;
+}
+
+int RecordingHwBackend::receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count)
+{
+    int received = _backend->receive_gpio_packets(rx_gpio_packets, max_count);
+    _record(rx_gpio_packets, received, CaptureDirection::RX);
+    return received;
+}
+
+uint64_t RecordingHwBackend::recorded_packets()
+{
+    std::lock_guard<std::mutex> lock(_file_mutex);
+    return _recorded_packets;
+}
+
+void RecordingHwBackend::_record(const gpio::GpioPacket* packets, int count, CaptureDirection direction)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start_time).count();
+    std::lock_guard<std::mutex> lock(_file_mutex);
+    if (_file == nullptr)
+    {
+        return;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        std::fwrite(&time, sizeof(time), 1, _file);
+        std::fwrite(&direction, sizeof(direction), 1, _file);
+        std::fwrite(&packets[i], sizeof(gpio::GpioPacket), 1, _file);
+    }
+    _recorded_packets += count;
+}
+
+} // namespace hw_backend
+} // namespace sensei
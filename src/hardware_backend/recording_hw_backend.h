@@ -0,0 +1,101 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Hw backend tap recording every packet exchanged with another hw backend
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#ifndef SENSEI_RECORDING_HW_BACKEND_H
+#define SENSEI_RECORDING_HW_BACKEND_H
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <chrono>
+
+#include "base_hw_backend.h"
+#include "gpio_capture.h"
+
+namespace sensei {
+namespace hw_backend {
+
+/**
+ * @brief Wraps a hw backend and writes the packets sent and received through it to a
+ *        capture file, with the time they passed through. See gpio_capture.h for the format.
+ */
+class RecordingHwBackend : public BaseHwBackend
+{
+public:
+    /**
+     * @brief Construct a recording tap on a hw backend
+     *
+     * @param backend The backend that is recorded, owned by the tap
+     * @param file_name Path of the capture, overwritten if it exists
+     */
+    RecordingHwBackend(std::unique_ptr<BaseHwBackend> backend,
+                       const std::string& file_name,
+                       std::chrono::milliseconds recv_packet_timeout) :
+                                                BaseHwBackend(recv_packet_timeout),
+                                                _backend(std::move(backend)),
+                                                _file_name(file_name)
+    {}
+
+    ~RecordingHwBackend()
+    {
+        deinit();
+    }
+
+    /**
+     * @brief Open the capture file and initialize the recorded backend
+     * @return True if both were successful, false if not
+     */
+    bool init() override;
+
+    /**
+     * @brief Deinitialize the recorded backend and close the capture file
+     */
+    void deinit() override;
+
+    bool send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet) override;
+
+    bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) override;
+
+    int send_gpio_packets(const gpio::GpioPacket* tx_gpio_packets, int count) override;
+
+    int receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count) override;
+
+    /**
+     * @brief Returns the number of packets written to the capture
+     */
+    uint64_t recorded_packets();
+
+private:
+    void _record(const gpio::GpioPacket* packets, int count, CaptureDirection direction);
+
+    std::unique_ptr<BaseHwBackend> _backend;
+    std::string _file_name;
+
+    /* Packets are recorded from both the read and the write thread of the hw frontend */
+    std::mutex  _file_mutex;
+    FILE*       _file{nullptr};
+    std::chrono::steady_clock::time_point _start_time;
+    uint64_t    _recorded_packets{0};
+};
+
+} // namespace hw_backend
+} // namespace sensei
+
+#endif // SENSEI_RECORDING_HW_BACKEND_H
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Hw backend playing back a capture of a recorded session instead of
+ *        talking to a board
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include "replay_hw_backend.h"
+#include "logging.h"
+
+namespace sensei {
+namespace hw_backend {
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("replay_hw_backend");
+
+bool ReplayHwBackend::init()
+{
+    FILE* file = std::fopen(_file_name.c_str(), "rb");
+    if (file == nullptr)
+    {
+        SENSEI_LOG_ERROR("Failed to open capture file {}: {}", _file_name, std::strerror(errno));
+        return false;
+    }
+    CaptureHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CAPTURE_VERSION ||
+        header.packet_size != sizeof(gpio::GpioPacket))
+    {
+        SENSEI_LOG_ERROR("{} is not a capture of gpio packets that can be played back", _file_name);
+        std::fclose(file);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _records.clear();
+    _board_info.reset();
+    CaptureRecord record;
+    int64_t time;
+    while (std::fread(&time, sizeof(time), 1, file) == 1 &&
+           std::fread(&record.direction, sizeof(record.direction), 1, file) == 1 &&
+           std::fread(&record.packet, sizeof(record.packet), 1, file) == 1)
+    {
+        if (record.direction != CaptureDirection::RX || record.packet.command == gpio::GPIO_ACK)
+        {
+            continue;
+        }
+        if (record.packet.command == gpio::GPIO_CMD_SYSTEM_CONTROL &&
+            record.packet.sub_command == gpio::GPIO_SUB_CMD_GET_BOARD_INFO)
+        {
+            _board_info = record.packet;
+            continue;
+        }
+        record.time = std::chrono::nanoseconds(time);
+        _records.push_back(record);
+    }
+    std::fclose(file);
+    _next_record = 0;
+    _started = false;
+    _replies.clear();
+
+    [[maybe_unused]] auto duration = _records.empty() ? std::chrono::nanoseconds(0) : _records.back().time - _records.front().time;
+    SENSEI_LOG_INFO("Loaded {} packets, {} ms of recorded traffic, from {}", _records.size(),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), _file_name);
+    return true;
+}
+
+void ReplayHwBackend::deinit()
+{
+    /* Wake up a receiving thread so that it sees the frontend stopping */
+    _reply_notifier.notify_all();
+}
+
+bool ReplayHwBackend::send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (tx_gpio_packet.command == gpio::GPIO_CMD_SYSTEM_CONTROL &&
+            tx_gpio_packet.sub_command == gpio::GPIO_SUB_CMD_GET_BOARD_INFO && _board_info.has_value())
+        {
+            _replies.push_back(_board_info.value());
+        }
+        gpio::GpioPacket ack = {};
+        ack.command = gpio::GPIO_ACK;
+        ack.payload.gpio_ack_data.returned_seq_no = tx_gpio_packet.sequence_no;
+        ack.payload.gpio_ack_data.gpio_return_status = gpio::GPIO_OK;
+        _replies.push_back(ack);
+    }
+    _reply_notifier.notify_one();
+    return true;
+}
+
+bool ReplayHwBackend::receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet)
+{
+    return receive_gpio_packets(&rx_gpio_packet, 1) == 1;
+}
+
+int ReplayHwBackend::receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto now = std::chrono::steady_clock::now();
+    auto timeout = now + _recv_packet_timeout;
+    if (!_started)
+    {
+        _start_time = now;
+        _started = true;
+    }
+    while (true)
+    {
+        int count = 0;
+        while (count < max_count && !_replies.empty())
+        {
+            rx_gpio_packets[count++] = _replies.front();
+            _replies.pop_front();
+        }
+        while (count < max_count && _next_record < _records.size() && _due_time(_next_record) <= now)
+        {
+            rx_gpio_packets[count++] = _records[_next_record++].packet;
+        }
+        if (count > 0 || now >= timeout)
+        {
+            return count;
+        }
+        auto wake_up = timeout;
+        if (_next_record < _records.size())
+        {
+            wake_up = std::min(wake_up, _due_time(_next_record));
+        }
+        _reply_notifier.wait_until(lock, wake_up);
+        now = std::chrono::steady_clock::now();
+    }
+}
+
+bool ReplayHwBackend::finished()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _next_record == _records.size();
+}
+
+uint64_t ReplayHwBackend::replayed_packets()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _next_record;
+}
+
+std::chrono::steady_clock::time_point ReplayHwBackend::_due_time(size_t record) const
+{
+    if (_speed <= 0)
+    {
+        return _start_time;
+    }
+    auto recorded_time = _records[record].time - _records.front().time;
+    return _start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(recorded_time / _speed);
+}
+
+} // namespace hw_backend
+} // namespace sensei
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Hw backend playing back a capture of a recorded session instead of
+ *        talking to a board
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#ifndef SENSEI_REPLAY_HW_BACKEND_H
+#define SENSEI_REPLAY_HW_BACKEND_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <chrono>
+
+#include "base_hw_backend.h"
+#include "gpio_capture.h"
+
+namespace sensei {
+namespace hw_backend {
+
+/**
+ * @brief Returns the packets received from the board in a capture written by
+ *        RecordingHwBackend, with the timing they were recorded with. Packets sent
+ *        to it are acked right away and never reach a board, so the hw frontend
+ *        and everything after it can run on recorded traffic without any hardware.
+ */
+class ReplayHwBackend : public BaseHwBackend
+{
+public:
+    /**
+     * @brief Construct a replay backend
+     *
+     * @param file_name Path of the capture to play back
+     * @param speed Playback speed relative to the recording, 2 plays back twice as fast.
+     *              0 plays back as fast as possible.
+     */
+    ReplayHwBackend(const std::string& file_name,
+                    float speed,
+                    std::chrono::milliseconds recv_packet_timeout) :
+                                                BaseHwBackend(recv_packet_timeout),
+                                                _file_name(file_name),
+                                                _speed(speed)
+    {}
+
+    /**
+     * @brief Load the capture
+     * @return True if the capture could be read, false if not
+     */
+    bool init() override;
+
+    void deinit() override;
+
+    /**
+     * @brief Acks the packet, and answers a request for board info with the board
+     *        info of the capture if there is one.
+     */
+    bool send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet) override;
+
+    bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) override;
+
+    /**
+     * @brief Returns the acks and replies to the packets sent, then the recorded
+     *        packets that are due. Playback starts with the first call.
+     */
+    int receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count) override;
+
+    /**
+     * @brief Returns true when all recorded packets have been played back
+     */
+    bool finished();
+
+    /**
+     * @brief Returns the number of recorded packets played back so far
+     */
+    uint64_t replayed_packets();
+
+private:
+    std::chrono::steady_clock::time_point _due_time(size_t record) const;
+
+    std::string _file_name;
+    float       _speed;
+
+    /* Only the packets received from the board are played back, acks and replies
+     * belong to the recorded session and are generated for the packets sent instead */
+    std::vector<CaptureRecord>      _records;
+    std::optional<gpio::GpioPacket> _board_info;
+    size_t      _next_record{0};
+    bool        _started{false};
+    std::chrono::steady_clock::time_point _start_time;
+
+    std::mutex  _mutex;
+    std::condition_variable _reply_notifier;
+    std::deque<gpio::GpioPacket> _replies;
+};
+
+} // namespace hw_backend
+} // namespace sensei
+
+#endif // SENSEI_REPLAY_HW_BACKEND_H
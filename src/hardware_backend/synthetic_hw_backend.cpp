@@ -0,0 +1,240 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Hw backend generating the traffic of a board with synthetic signals,
+ *        for load testing without hardware
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <algorithm>
+
+#include "synthetic_hw_backend.h"
+#include "hardware_frontend/gpio_command_creator.h"
+#include "logging.h"
+
+namespace sensei {
+namespace hw_backend {
+
+/* Values later than this are skipped instead of sent in a burst to catch up */
+constexpr auto MAX_GENERATION_LAG = std::chrono::milliseconds(100);
+/* Fixed, so that runs with the same configuration generate the same values */
+constexpr unsigned int RANDOM_SEED = 1;
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("synthetic_hw_backend");
+
+SyntheticHwBackend::SyntheticHwBackend(const std::vector<SyntheticSignalConfig>& signals,
+                                       std::chrono::milliseconds recv_packet_timeout) :
+                                                BaseHwBackend(recv_packet_timeout),
+                                                _random_generator(RANDOM_SEED)
+{
+    for (const auto& config : signals)
+    {
+        Signal signal;
+        signal.config = config;
+        signal.interval = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / std::max(config.rate_hz, 0.001f)));
+        signal.tick = 0;
+        signal.next_controller = 0;
+        signal.walk_values.resize(config.n_controllers, config.min_value + (config.max_value - config.min_value) / 2);
+        _signals.push_back(signal);
+    }
+}
+
+bool SyntheticHwBackend::init()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _started = false;
+    _replies.clear();
+    [[maybe_unused]] float packet_rate = 0;
+    for (auto& signal : _signals)
+    {
+        signal.tick = 0;
+        signal.next_controller = 0;
+        packet_rate += signal.config.rate_hz * signal.config.n_controllers;
+    }
+    SENSEI_LOG_INFO("Generating {} synthetic signals, up to {} packets per second", _signals.size(), packet_rate);
+    return true;
+}
+
+void SyntheticHwBackend::deinit()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        SENSEI_LOG_INFO("Generated {} packets, skipped {} late ticks", _generated_packets, _skipped_ticks);
+    }
+    _reply_notifier.notify_all();
+}
+
+bool SyntheticHwBackend::send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (tx_gpio_packet.command == gpio::GPIO_CMD_SYSTEM_CONTROL &&
+            tx_gpio_packet.sub_command == gpio::GPIO_SUB_CMD_GET_BOARD_INFO)
+        {
+            gpio::GpioPacket board_info = tx_gpio_packet;
+            int n_controllers = 0;
+            for (const auto& signal : _signals)
+            {
+                n_controllers = std::max(n_controllers, signal.config.first_controller + signal.config.n_controllers);
+            }
+            board_info.payload.gpio_board_info_data.num_analog_input_pins = static_cast<uint8_t>(std::min(n_controllers, 255));
+            _replies.push_back(board_info);
+        }
+        gpio::GpioPacket ack = {};
+        ack.command = gpio::GPIO_ACK;
+        ack.payload.gpio_ack_data.returned_seq_no = tx_gpio_packet.sequence_no;
+        ack.payload.gpio_ack_data.gpio_return_status = gpio::GPIO_OK;
+        _replies.push_back(ack);
+    }
+    _reply_notifier.notify_one();
+    return true;
+}
+
+bool SyntheticHwBackend::receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet)
+{
+    return receive_gpio_packets(&rx_gpio_packet, 1) == 1;
+}
+
+int SyntheticHwBackend::receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto now = std::chrono::steady_clock::now();
+    auto timeout = now + _recv_packet_timeout;
+    if (!_started)
+    {
+        _start_time = now;
+        _started = true;
+    }
+    while (true)
+    {
+        int count = 0;
+        while (count < max_count && !_replies.empty())
+        {
+            rx_gpio_packets[count++] = _replies.front();
+            _replies.pop_front();
+        }
+        for (auto& signal : _signals)
+        {
+            count += _generate(signal, rx_gpio_packets + count, max_count - count, now);
+        }
+        if (count > 0 || now >= timeout)
+        {
+            return count;
+        }
+        auto wake_up = timeout;
+        for (const auto& signal : _signals)
+        {
+            wake_up = std::min(wake_up, _due_time(signal));
+        }
+        _reply_notifier.wait_until(lock, wake_up);
+        now = std::chrono::steady_clock::now();
+    }
+}
+
+uint64_t SyntheticHwBackend::generated_packets()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _generated_packets;
+}
+
+uint64_t SyntheticHwBackend::skipped_ticks()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _skipped_ticks;
+}
+
+int SyntheticHwBackend::_generate(Signal& signal, gpio::GpioPacket* packets, int max_count,
+                                  std::chrono::steady_clock::time_point now)
+{
+    if (now - _due_time(signal) > MAX_GENERATION_LAG)
+    {
+        uint64_t current_tick = (now - _start_time) / signal.interval;
+        _skipped_ticks += current_tick - signal.tick;
+        signal.tick = current_tick;
+        signal.next_controller = 0;
+    }
+    int count = 0;
+    while (count < max_count && _due_time(signal) <= now)
+    {
+        uint32_t value;
+        int controller = signal.next_controller;
+        if (_sample(signal, controller, value))
+        {
+            gpio::GpioPacket& packet = packets[count++];
+            packet = {};
+            packet.command = gpio::GPIO_CMD_GET_VALUE;
+            packet.timestamp = static_cast<uint32_t>(signal.tick);
+            packet.payload.gpio_value_data.controller_id = static_cast<uint8_t>(signal.config.first_controller + controller);
+            packet.payload.gpio_value_data.controller_val = hw_frontend::to_gpio_protocol_byteord(value);
+            _generated_packets++;
+        }
+        if (++signal.next_controller >= signal.config.n_controllers)
+        {
+            signal.next_controller = 0;
+            signal.tick++;
+        }
+    }
+    return count;
+}
+
+bool SyntheticHwBackend::_sample(Signal& signal, int controller, uint32_t& value)
+{
+    const auto& config = signal.config;
+    uint32_t range = config.max_value - config.min_value;
+    int64_t ticks_per_period = std::max<int64_t>(1, std::chrono::nanoseconds(config.period) / signal.interval);
+    switch (config.waveform)
+    {
+        case Waveform::RAMP:
+        {
+            int64_t offset = ticks_per_period * controller / std::max(1, config.n_controllers);
+            auto position = static_cast<double>((signal.tick + offset) % ticks_per_period) / ticks_per_period;
+            value = config.min_value + static_cast<uint32_t>(position * range);
+            return true;
+        }
+        case Waveform::NOISE:
+        {
+            value = std::uniform_int_distribution<uint32_t>(config.min_value, config.max_value)(_random_generator);
+            return true;
+        }
+        case Waveform::RANDOM_WALK:
+        {
+            int64_t max_step = std::max<int64_t>(1, range / 32);
+            int64_t walk = signal.walk_values[controller] + std::uniform_int_distribution<int64_t>(-max_step, max_step)(_random_generator);
+            signal.walk_values[controller] = static_cast<uint32_t>(std::clamp<int64_t>(walk, config.min_value, config.max_value));
+            value = signal.walk_values[controller];
+            return true;
+        }
+        case Waveform::BUTTON_BURST:
+        {
+            /* Alternate pressed and released for burst_length presses, then nothing changes until the next period */
+            int64_t position = signal.tick % ticks_per_period;
+            if (position >= 2 * config.burst_length)
+            {
+                return false;
+            }
+            value = position % 2 == 0 ? config.max_value : config.min_value;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::chrono::steady_clock::time_point SyntheticHwBackend::_due_time(const Signal& signal) const
+{
+    return _start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(signal.interval * signal.tick);
+}
+
+} // namespace hw_backend
+} // namespace sensei
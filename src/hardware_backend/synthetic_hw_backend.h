@@ -0,0 +1,129 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Hw backend generating the traffic of a board with synthetic signals,
+ *        for load testing without hardware
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#ifndef SENSEI_SYNTHETIC_HW_BACKEND_H
+#define SENSEI_SYNTHETIC_HW_BACKEND_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <chrono>
+
+#include "base_hw_backend.h"
+
+namespace sensei {
+namespace hw_backend {
+
+enum class Waveform
+{
+    RAMP,           /* Rises from min to max over every period, shifted in phase between controllers */
+    NOISE,          /* Uniformly distributed between min and max */
+    RANDOM_WALK,    /* Random steps of up to 1/32 of the range */
+    BUTTON_BURST,   /* A burst of presses at the start of every period, silent after */
+};
+
+/**
+ * @brief A signal generated for a group of consecutive controllers
+ */
+struct SyntheticSignalConfig
+{
+    Waveform waveform{Waveform::RAMP};
+    int      first_controller{0};
+    int      n_controllers{1};
+    /* Values per second of every controller */
+    float    rate_hz{1000.0f};
+    std::chrono::milliseconds period{1000};
+    uint32_t min_value{0};
+    uint32_t max_value{1023};
+    /* Presses per burst for BUTTON_BURST */
+    int      burst_length{8};
+};
+
+/**
+ * @brief Sends values of the configured signals at their rate, and acks every packet
+ *        sent to it right away. When the receiving side can't keep up, the values
+ *        that are more than a while late are skipped and counted.
+ */
+class SyntheticHwBackend : public BaseHwBackend
+{
+public:
+    SyntheticHwBackend(const std::vector<SyntheticSignalConfig>& signals,
+                       std::chrono::milliseconds recv_packet_timeout);
+
+    bool init() override;
+
+    void deinit() override;
+
+    /**
+     * @brief Acks the packet, and answers a request for board info with the
+     *        number of controllers generated as analog inputs
+     */
+    bool send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet) override;
+
+    bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) override;
+
+    /**
+     * @brief Returns the acks and replies to the packets sent, then the values that
+     *        are due. Generation starts with the first call.
+     */
+    int receive_gpio_packets(gpio::GpioPacket* rx_gpio_packets, int max_count) override;
+
+    /**
+     * @brief Returns the number of value packets generated
+     */
+    uint64_t generated_packets();
+
+    /**
+     * @brief Returns the number of signal ticks skipped because they were too late
+     */
+    uint64_t skipped_ticks();
+
+private:
+    struct Signal
+    {
+        SyntheticSignalConfig config;
+        std::chrono::nanoseconds interval;
+        uint64_t tick;
+        int      next_controller;
+        std::vector<uint32_t> walk_values;
+    };
+
+    int _generate(Signal& signal, gpio::GpioPacket* packets, int max_count, std::chrono::steady_clock::time_point now);
+    bool _sample(Signal& signal, int controller, uint32_t& value);
+    std::chrono::steady_clock::time_point _due_time(const Signal& signal) const;
+
+    std::vector<Signal> _signals;
+    std::minstd_rand    _random_generator;
+    bool        _started{false};
+    std::chrono::steady_clock::time_point _start_time;
+    uint64_t    _generated_packets{0};
+    uint64_t    _skipped_ticks{0};
+
+    std::mutex  _mutex;
+    std::condition_variable _reply_notifier;
+    std::deque<gpio::GpioPacket> _replies;
+};
+
+} // namespace hw_backend
+} // namespace sensei
+
+#endif // SENSEI_SYNTHETIC_HW_BACKEND_H
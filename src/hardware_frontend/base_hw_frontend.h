@@ -26,10 +26,56 @@
 #include "synchronized_queue.h"
 #include "message/base_message.h"
 #include "message/base_command.h"
+#include "message/base_value.h"
+#include "thread_scheduling.h"
 
 namespace sensei {
 namespace hw_frontend {
 
+/**
+ * @brief What to do with a packet to be sent when its send lane is full
+ */
+enum class OverflowPolicy
+{
+    BLOCK,          /* Stop taking commands until packets of the lane are sent, never drops a packet */
+    DROP_OLDEST,    /* Discard the oldest packet waiting in the lane */
+    DROP_NEWEST,    /* Discard the packet being queued */
+    COALESCE        /* Merge output values for the same controller, drop the oldest if still full */
+};
+
+struct SendLaneLimit
+{
+    int            capacity;    /* 0 to size it from the number of sensors of the board */
+    OverflowPolicy policy;
+};
+
+/**
+ * @brief Max number of packets waiting to be sent in each lane, and what to do when it's reached
+ */
+struct SendQueueLimits
+{
+    SendLaneLimit control{64, OverflowPolicy::BLOCK};
+    SendLaneLimit output{256, OverflowPolicy::COALESCE};
+    SendLaneLimit config{0, OverflowPolicy::BLOCK};
+};
+
+/**
+ * @brief Interface for receivers of values which are handled directly on
+ *        the read thread of a frontend, bypassing the event queue.
+ */
+class InlineValueHandler
+{
+public:
+    virtual ~InlineValueHandler() = default;
+
+    /**
+     * @brief Called from the frontend read thread for every value received.
+     *        Implementations must be thread safe with respect to the event loop.
+     * @param [in] value The value received from the hardware
+     */
+    virtual void handle_inline_value(Value* value) = 0;
+};
+
 /**
  * @brief Base class for frontends connecting to HW
  */
@@ -73,9 +119,60 @@ public:
      */
     virtual void verify_acks(bool enabled) = 0;
 
+    /**
+     * @brief Hand values directly to the given handler from the read thread
+     *        instead of pushing them to the out queue. Must be called before run().
+     * @param [in] handler The handler to use, or nullptr to use the out queue
+     */
+    void set_inline_value_handler(InlineValueHandler* handler)
+    {
+        _inline_value_handler = handler;
+    }
+
+    /**
+     * @brief Set the range of global sensor ids handled by this frontend.
+     *        Controller ids on the board start from 0 at first_sensor.
+     *        Must be called before run().
+     * @param [in] first_sensor Sensor id of controller 0 of the board
+     * @param [in] n_sensors Number of sensors of the board, 0 for no limit
+     */
+    void set_sensor_range(int first_sensor, int n_sensors)
+    {
+        _first_sensor = first_sensor;
+        _n_sensors = n_sensors;
+    }
+
+    /**
+     * @brief Set the capacity and overflow policy of the lanes of packets
+     *        waiting to be sent. Must be called before run().
+     * @param [in] limits The limits of each lane
+     */
+    void set_send_queue_limits(const SendQueueLimits& limits)
+    {
+        _send_queue_limits = limits;
+    }
+
+    /**
+     * @brief Set the scheduling of the read and write threads, applied when
+     *        the threads are started. Must be called before run().
+     * @param [in] read_thread Scheduling configuration of the read thread
+     * @param [in] write_thread Scheduling configuration of the write thread
+     */
+    void set_thread_scheduling(const ThreadSchedulingConfig& read_thread, const ThreadSchedulingConfig& write_thread)
+    {
+        _read_thread_scheduling = read_thread;
+        _write_thread_scheduling = write_thread;
+    }
+
 protected:
     SynchronizedQueue<std::unique_ptr<Command>>*_in_queue;
     SynchronizedQueue<std::unique_ptr<BaseMessage>>*_out_queue;
+    InlineValueHandler* _inline_value_handler{nullptr};
+    SendQueueLimits _send_queue_limits;
+    int _first_sensor{0};
+    int _n_sensors{0};
+    ThreadSchedulingConfig _read_thread_scheduling;
+    ThreadSchedulingConfig _write_thread_scheduling;
 };
 
 
@@ -50,6 +50,12 @@ inline uint32_t from_gpio_protocol_byteord(uint32_t word)
 #endif
 }
 
+/* Sequence numbers wrap around, so they are ordered by their difference and not by value */
+inline bool sequence_before(uint32_t seq_no, uint32_t other_seq_no)
+{
+    return static_cast<int32_t>(seq_no - other_seq_no) < 0;
+}
+
 std::string gpio_status_to_string(uint8_t);
 
 std::string gpio_packet_to_string(const gpio::GpioPacket& packet);
@@ -86,7 +92,15 @@ public:
 private:
     gpio::GpioPacket _prepare_packet();
 
-    uint32_t _sequence_number() {return _sequence_count++;}
+    uint32_t _sequence_number()
+    {
+        /* 0 is skipped when wrapping around, as it marks empty slots in the message tracker */
+        if (_sequence_count == 0)
+        {
+            _sequence_count = 1;
+        }
+        return _sequence_count++;
+    }
 
     uint32_t _sequence_count{1};
 };
@@ -20,6 +20,7 @@
  */
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 #include "hw_frontend.h"
 #include "gpio_protocol/gpio_protocol.h"
@@ -33,26 +34,57 @@ using namespace gpio;
 constexpr uint8_t   DEFAULT_TICK_RATE = GPIO_SYSTEM_TICK_1000_HZ;
 constexpr auto      READ_WRITE_TIMEOUT = std::chrono::milliseconds(20);
 constexpr auto      HW_BACKEND_CON_TIMEOUT = std::chrono::milliseconds(250);
+constexpr auto      WAIT_FOR_ACK_INTERVAL = std::chrono::milliseconds(1);
+constexpr int       RECEIVE_BATCH_SIZE = 32;
+constexpr int       SEND_BATCH_SIZE = 32;
+/* Initial ack timeout, adapted to the round trip time once acks are received */
 constexpr auto      ACK_TIMEOUT = std::chrono::milliseconds(1000);
 constexpr int       MAX_RESEND_ATTEMPTS = 3;
+/* Lanes sized from the number of sensors have room for this many packets per sensor */
+constexpr int       PACKETS_PER_SENSOR = 16;
+/* Number of sensors assumed for boards without a sensor range */
+constexpr int       DEFAULT_N_SENSORS = 64;
+/* Output values remembered to match their acks, older ones are forgotten */
+constexpr size_t    MAX_UNACKED_OUTPUT_VALUES = 256;
 
 SENSEI_GET_LOGGER_WITH_MODULE_NAME("gpio_hw_frontend");
 
+/* All packets addressing a single controller have the controller id first in their payload */
+inline int packet_controller_id(const GpioPacket& packet)
+{
+    return packet.payload.reset_controller_data.controller_id;
+}
+
 HwFrontend::HwFrontend(SynchronizedQueue <std::unique_ptr<sensei::Command>>*in_queue,
                        SynchronizedQueue <std::unique_ptr<sensei::BaseMessage>>*out_queue,
-                       hw_backend::BaseHwBackend* hw_backend)
+                       hw_backend::BaseHwBackend* hw_backend,
+                       int ack_window,
+                       std::chrono::milliseconds min_ack_timeout,
+                       std::chrono::milliseconds max_ack_timeout,
+                       const std::string& metrics_labels)
                 : BaseHwFrontend(in_queue, out_queue),
-                _message_tracker(ACK_TIMEOUT, MAX_RESEND_ATTEMPTS),
+                _message_tracker(ACK_TIMEOUT, MAX_RESEND_ATTEMPTS, ack_window, min_ack_timeout, max_ack_timeout, metrics_labels),
                 _hw_backend(hw_backend),
                 _state(ThreadState::STOPPED),
-                _ready_to_send{true},
                 _muted(false),
                 _verify_acks(true)
 {
+    _send_batch.reserve(SEND_BATCH_SIZE);
+    auto& registry = metrics::registry();
+    _packets_received_metric = registry.counter("sensei_packets_received_total", "Packets received from the board",
+                                                metrics_labels);
+    _packets_sent_metric = registry.counter("sensei_packets_sent_total", "Packets sent to the board", metrics_labels);
+    _dropped_packets_metric = registry.counter("sensei_send_queue_dropped_total",
+                                               "Packets dropped from or not queued in a full send lane", metrics_labels);
+    _send_queue_depth_metric = registry.gauge("sensei_send_queue_depth", "Packets waiting to be sent to the board",
+                                              metrics_labels);
+    _send_queue_high_water_metric = registry.gauge("sensei_send_queue_high_water",
+                                                   "Most packets ever waiting to be sent to the board", metrics_labels);
+
     /* Prepare the setup and query hw commands to be the first to send */
-    _send_list.push_back(_packet_factory.make_reset_system_command());
-    _send_list.push_back(_packet_factory.make_get_board_info_command());
-    _send_list.push_back(_packet_factory.make_set_tick_rate_command(DEFAULT_TICK_RATE));
+    _queue_packet(_packet_factory.make_reset_system_command());
+    _queue_packet(_packet_factory.make_get_board_info_command());
+    _queue_packet(_packet_factory.make_set_tick_rate_command(DEFAULT_TICK_RATE));
 }
 
 void HwFrontend::run()
@@ -88,6 +120,13 @@ void HwFrontend::stop()
     }
     _state.store(ThreadState::STOPPED);
     SENSEI_LOG_INFO("Threads stopped");
+    [[maybe_unused]] auto rtt = _message_tracker.rtt_statistics();
+    SENSEI_LOG_INFO("Ack round trip time: smoothed {} us, variance {} us, min {} us, max {} us, {} samples, {} retries. "
+                    "Timeout {} us", rtt.smoothed_rtt.count(), rtt.rtt_variance.count(), rtt.min_rtt.count(),
+                    rtt.max_rtt.count(), rtt.samples, rtt.retries, rtt.timeout.count());
+    [[maybe_unused]] auto latency = output_latency_statistics();
+    SENSEI_LOG_INFO("Output latency from queuing to ack: mean {} us, max {} us, {} samples", latency.mean.count(),
+                    latency.max.count(), latency.samples);
 }
 
 void HwFrontend::mute(bool enabled)
@@ -102,18 +141,18 @@ void HwFrontend::verify_acks(bool enabled)
 
 void HwFrontend::read_loop()
 {
-    GpioPacket buffer;
+    apply_current_thread_scheduling(_read_thread_scheduling, "hw frontend read");
+    std::array<GpioPacket, RECEIVE_BATCH_SIZE> buffer;
     while (_state.load() == ThreadState::RUNNING)
     {
-        const auto recv_msg = _hw_backend->receive_gpio_packet(buffer);
-        if(!_muted && recv_msg)
+        const int received = _hw_backend->receive_gpio_packets(buffer.data(), RECEIVE_BATCH_SIZE);
+        if (received > 0)
         {
-            _handle_gpio_packet(buffer);
+            _packets_received_metric->increment(received);
         }
-
-        if (!_ready_to_send)
+        for (int i = 0; i < received && !_muted; ++i)
         {
-            _handle_timeouts(); /* It's more efficient to not check this every time */
+            _handle_gpio_packet(buffer[i]);
         }
     }
     /* Notify the write thread in case it is waiting since no more notifications will follow */
@@ -122,86 +161,692 @@ void HwFrontend::read_loop()
 
 void HwFrontend::write_loop()
 {
+    apply_current_thread_scheduling(_write_thread_scheduling, "hw frontend write");
     while (_state.load() == ThreadState::RUNNING)
     {
-        _in_queue->wait_for_data(std::chrono::milliseconds(READ_WRITE_TIMEOUT));
+        /* Wake up in time to resend the packets whose ack is late, the read thread might be blocked receiving */
+        bool blocked;
+        {
+            std::unique_lock<std::mutex> lock(_send_mutex);
+            auto wait_time = _time_to_next_timeout(READ_WRITE_TIMEOUT);
+            blocked = _send_lanes_blocked();
+            if (blocked)
+            {
+                /* Leave the commands in the in queue until there is room for their packets */
+                _ready_to_send_notifier.wait_for(lock, wait_time);
+            }
+            else
+            {
+                lock.unlock();
+                _in_queue->wait_for_data(wait_time);
+            }
+        }
         while(!_in_queue->empty())
         {
+            std::lock_guard<std::mutex> lock(_send_mutex);
+            if (_send_lanes_blocked())
+            {
+                break;
+            }
             std::unique_ptr<Command> message = _in_queue->pop();
             _process_sensei_command(message.get());
         }
 
-        while(!_send_list.empty() && _state.load() == ThreadState::RUNNING)
+        while (_state.load() == ThreadState::RUNNING)
         {
             std::unique_lock<std::mutex> lock(_send_mutex);
-
-            SENSEI_LOG_DEBUG("Going through sendlist: {} packets", _send_list.size());
-            if (_verify_acks && !_ready_to_send )
+            _handle_timeouts();
+            if (!_backend_connected && std::chrono::steady_clock::now() < _next_send_attempt)
             {
-                SENSEI_LOG_DEBUG("Waiting for ack");
-                _ready_to_send_notifier.wait(lock);
-                continue;
+                /* Keep taking commands into the bounded lanes until it's time for the next probe */
+                break;
             }
-
-            auto& packet = _send_list.front();
-
-            // attempt to send packets.
-            if(!_hw_backend->send_gpio_packet(packet))
+            std::array<GpioPacket, SEND_BATCH_SIZE> packets;
+            int batch_size = _prepare_send_batch(packets.data(), SEND_BATCH_SIZE);
+            if (batch_size == 0)
             {
-                SENSEI_LOG_WARNING("Failed sending packet to hw backend");
-                std::this_thread::sleep_for(std::chrono::milliseconds(HW_BACKEND_CON_TIMEOUT));
+                if (_send_lanes_empty())
+                {
+                    _check_resync_finished();
+                    break;
+                }
+                /* Wait for acks, but keep taking new commands as they could be sent before the queued packets */
+                SENSEI_LOG_DEBUG("Waiting for ack");
+                _ready_to_send_notifier.wait_for(lock, _time_to_next_timeout(WAIT_FOR_ACK_INTERVAL));
+                if (!_in_queue->empty() && !_send_lanes_blocked())
+                {
+                    break;
+                }
                 continue;
             }
 
-            if (_verify_acks)
+            // attempt to send packets.
+            int sent = _hw_backend->send_gpio_packets(packets.data(), batch_size);
+            _finish_send_batch(std::max(sent, 0));
+            _packets_sent_metric->increment(std::max(sent, 0));
+            if (sent < batch_size)
             {
-                SENSEI_LOG_DEBUG("Sent Gpio packet: {}, id: {}", gpio_packet_to_string(packet),
-                                                                 static_cast<int>(from_gpio_protocol_byteord(packet.sequence_no)));
-                _message_tracker.store(nullptr, from_gpio_protocol_byteord(packet.sequence_no));
-                _ready_to_send = false;
+                _backend_send_failed(sent);
+                if (!_backend_connected)
+                {
+                    break;
+                }
             }
-            else
+            else if (!_backend_connected)
             {
-                _send_list.pop_front();
+                SENSEI_LOG_INFO("Hw backend reconnected");
+                _backend_connected = true;
+                /* Whatever is behind the backend might have restarted in the meantime */
+                _start_resync("backend reconnected");
             }
         }
     }
 }
 
-void HwFrontend::_handle_timeouts()
+int HwFrontend::_prepare_send_batch(GpioPacket* packets, int max_count)
+{
+    _send_batch.clear();
+    while (static_cast<int>(_send_batch.size()) < max_count)
+    {
+        QueuedPacket* queued = _next_packet_to_send();
+        if (queued == nullptr)
+        {
+            break;
+        }
+        /* Tracked as sent already, so that the following packets see it in flight */
+        if (_needs_ack(*queued))
+        {
+            _message_tracker.store(nullptr, from_gpio_protocol_byteord(queued->packet.sequence_no));
+            _in_flight_packets.push_back(*queued);
+        }
+        packets[_send_batch.size()] = queued->packet;
+        _send_batch.push_back(*queued);
+        _pop_send_lane(queued->lane);
+    }
+    return static_cast<int>(_send_batch.size());
+}
+
+void HwFrontend::_finish_send_batch(int sent)
+{
+    for (int i = 0; i < sent; ++i)
+    {
+        SENSEI_LOG_DEBUG("Sent Gpio packet: {}, id: {}", gpio_packet_to_string(_send_batch[i].packet),
+                         from_gpio_protocol_byteord(_send_batch[i].packet.sequence_no));
+        if (!_needs_ack(_send_batch[i]))
+        {
+            _output_value_sent(_send_batch[i]);
+            _packet_completed(_send_batch[i]);
+        }
+    }
+    /* Put back the packets that were not sent, last first so that they keep their order */
+    for (int i = static_cast<int>(_send_batch.size()) - 1; i >= sent; --i)
+    {
+        if (_needs_ack(_send_batch[i]))
+        {
+            uint32_t seq_no = from_gpio_protocol_byteord(_send_batch[i].packet.sequence_no);
+            _message_tracker.remove(seq_no);
+            _take_in_flight_packet(seq_no);
+        }
+        _requeue_packet(_send_batch[i]);
+    }
+    _send_batch.clear();
+}
+
+OutputLatencyStatistics HwFrontend::output_latency_statistics()
+{
+    std::lock_guard<std::mutex> lock(_send_mutex);
+    OutputLatencyStatistics stats;
+    stats.samples = _output_latency_samples;
+    stats.max = _output_latency_max;
+    stats.mean = std::chrono::microseconds(0);
+    if (_output_latency_samples > 0)
+    {
+        stats.mean = _output_latency_sum / static_cast<int64_t>(_output_latency_samples);
+    }
+    return stats;
+}
+
+SendQueueStatistics HwFrontend::send_queue_statistics()
+{
+    std::lock_guard<std::mutex> lock(_send_mutex);
+    SendQueueStatistics stats = _send_queue_stats;
+    stats.backend_connected = _backend_connected;
+    return stats;
+}
+
+ResyncStatistics HwFrontend::resync_statistics()
 {
     std::lock_guard<std::mutex> lock(_send_mutex);
-    switch (_message_tracker.timed_out())
+    return _resync_stats;
+}
+
+void HwFrontend::_handle_timeouts()
+{
+    _handle_output_value_timeouts();
+    if (_message_tracker.in_flight() == 0)
+    {
+        return;
+    }
+    /* Several packets of the window can time out at once, handle all of them */
+    std::vector<uint64_t> retries;
+    uint64_t seq_no;
+    for (auto status = _message_tracker.timed_out(seq_no);
+         status == timeout::TIMED_OUT || status == timeout::TIMED_OUT_PERMANENTLY;
+         status = _message_tracker.timed_out(seq_no))
     {
-        case timeout::TIMED_OUT_PERMANENTLY:
+        if (status == timeout::TIMED_OUT_PERMANENTLY)
         {
-            /* Resending timed out too many times, push an error message to main loop.
-             * NOTE: Intentional fall through as we want to signal ready to send to the
-             * write thread too. */
+            /* Resending timed out too many times, drop the packet and free its slot in the window */
             SENSEI_LOG_WARNING("Message timed out too many times, sending next message.");
-            if (_send_list.size() > 0)
+            _message_tracker.remove(seq_no);
+            auto packet = _take_in_flight_packet(seq_no);
+            if (packet.has_value())
             {
-                _send_list.pop_front();
+                _packet_completed(packet.value());
             }
-            [[fallthrough]];
         }
-        case timeout::TIMED_OUT:
+        else
         {
             SENSEI_LOG_WARNING("Message timed out, retrying.");
-            _ready_to_send = true;
-            _ready_to_send_notifier.notify_one();
+            retries.push_back(seq_no);
+        }
+    }
+    /* Resend them before any new packet in their lanes, last sent first so that they keep their order */
+    for (int i = static_cast<int>(_in_flight_packets.size()) - 1; i >= 0 && !retries.empty(); --i)
+    {
+        auto retry = std::find(retries.begin(), retries.end(),
+                               from_gpio_protocol_byteord(_in_flight_packets[i].packet.sequence_no));
+        if (retry != retries.end())
+        {
+            retries.erase(retry);
+            _requeue_packet(_in_flight_packets[i]);
+            _in_flight_packets.erase(_in_flight_packets.begin() + i);
+        }
+    }
+}
+
+std::chrono::milliseconds HwFrontend::_time_to_next_timeout(std::chrono::milliseconds max_wait)
+{
+    auto deadline = _message_tracker.next_deadline();
+    for (const auto& output : _unacked_output_values)
+    {
+        deadline = std::min(deadline, output.deadline);
+    }
+    auto remaining = deadline - std::chrono::steady_clock::now();
+    if (remaining >= max_wait)
+    {
+        return max_wait;
+    }
+    return std::chrono::ceil<std::chrono::milliseconds>(std::max(remaining, std::chrono::steady_clock::duration::zero()));
+}
+
+void HwFrontend::_backend_send_failed(int sent)
+{
+    _send_queue_stats.failed_sends++;
+    if (sent > 0)
+    {
+        /* The backend is there but could not take the whole batch, try the rest right away */
+        return;
+    }
+    if (_backend_connected)
+    {
+        SENSEI_LOG_WARNING("Failed sending packet to hw backend, backend disconnected");
+        _backend_connected = false;
+        _send_queue_stats.disconnects++;
+    }
+    _next_send_attempt = std::chrono::steady_clock::now() + HW_BACKEND_CON_TIMEOUT;
+}
+
+std::optional<HwFrontend::QueuedPacket> HwFrontend::_take_in_flight_packet(uint64_t seq_no)
+{
+    auto packet = std::find_if(_in_flight_packets.begin(), _in_flight_packets.end(), [&](const QueuedPacket& p)
+    {
+        return from_gpio_protocol_byteord(p.packet.sequence_no) == seq_no;
+    });
+    if (packet == _in_flight_packets.end())
+    {
+        return std::nullopt;
+    }
+    QueuedPacket taken = *packet;
+    _in_flight_packets.erase(packet);
+    return taken;
+}
+
+void HwFrontend::_queue_packet(const GpioPacket& packet, Delivery delivery)
+{
+    SendLane lane = _packet_lane(packet);
+    const SendLaneLimit& limit = _lane_limit(lane);
+    bool coalesce = lane == OUTPUT_LANE && packet.command == GPIO_CMD_SET_VALUE && limit.policy == OverflowPolicy::COALESCE;
+    if (coalesce)
+    {
+        /* Overwrite the value of a packet for the same controller that is still waiting to be sent,
+         * so there is never more than one value per controller queued */
+        auto slot = _pending_set_values.find(packet.payload.gpio_value_data.controller_id);
+        if (slot != _pending_set_values.end())
+        {
+            auto& pending_packet = _send_lanes[OUTPUT_LANE][slot->second - _output_lane_start].packet;
+            pending_packet.payload.gpio_value_data.controller_val = packet.payload.gpio_value_data.controller_val;
+            _send_queue_stats.coalesced++;
+            return;
+        }
+    }
+    if (limit.policy != OverflowPolicy::BLOCK && static_cast<int>(_send_lanes[lane].size()) >= _lane_capacity(lane))
+    {
+        if (limit.policy == OverflowPolicy::DROP_NEWEST)
+        {
+            if (delivery == Delivery::RELIABLE)
+            {
+                SENSEI_LOG_WARNING("Send lane {} full, dropping packet: {}", lane, gpio_packet_to_string(packet));
+            }
+            else
+            {
+                SENSEI_LOG_DEBUG("Send lane {} full, dropping packet: {}", lane, gpio_packet_to_string(packet));
+            }
+            _send_queue_stats.dropped_newest++;
+            _dropped_packets_metric->increment();
+            return;
+        }
+        _drop_oldest_packet(lane);
+    }
+    switch (lane)
+    {
+        case OUTPUT_LANE:
+        {
+            if (coalesce)
+            {
+                _pending_set_values[packet.payload.gpio_value_data.controller_id] = _output_lane_start +
+                                                                                    static_cast<int64_t>(_send_lanes[OUTPUT_LANE].size());
+            }
             break;
         }
-        case timeout::NO_MESSAGE:
-        case timeout::WAITING:
-            /* Keep waiting */
+        case CONFIG_LANE:
+        {
+            /* Values queued before a configuration packet must be sent before it */
+            int controller_id = packet_controller_id(packet);
+            _pending_set_values.erase(controller_id);
+            _unfinished_config[controller_id].push_back(from_gpio_protocol_byteord(packet.sequence_no));
             break;
+        }
+        default:
+            _pending_set_values.clear();
+            break;
+    }
+    _send_lanes[lane].push_back({packet, lane, std::chrono::steady_clock::now(), delivery});
+    _update_send_queue_metrics();
+}
+
+void HwFrontend::_requeue_packet(const QueuedPacket& packet)
+{
+    _send_lanes[packet.lane].push_front(packet);
+    _update_send_queue_metrics();
+    if (packet.lane == OUTPUT_LANE)
+    {
+        _output_lane_start--;
+    }
+}
+
+HwFrontend::QueuedPacket* HwFrontend::_next_packet_to_send()
+{
+    auto oldest_control = _oldest_unfinished(CONTROL_LANE);
+    for (auto& lane : _send_lanes)
+    {
+        if (lane.empty())
+        {
+            continue;
+        }
+        auto& queued = lane.front();
+        uint32_t seq_no = from_gpio_protocol_byteord(queued.packet.sequence_no);
+        bool ready;
+        switch (queued.lane)
+        {
+            case CONTROL_LANE:
+                /* System control packets act as barriers, everything queued before must be done */
+                ready = _unfinished_after(_oldest_unfinished(OUTPUT_LANE), seq_no) &&
+                        _unfinished_after(_oldest_unfinished(CONFIG_LANE), seq_no);
+                break;
+
+            case OUTPUT_LANE:
+            {
+                /* A value can't be sent before the controller it is sent to is configured */
+                ready = _unfinished_after(oldest_control, seq_no);
+                auto config = _unfinished_config.find(packet_controller_id(queued.packet));
+                if (ready && config != _unfinished_config.end())
+                {
+                    ready = sequence_before(seq_no, *std::min_element(config->second.begin(), config->second.end(),
+                                                                      sequence_before));
+                }
+                break;
+            }
+            default:
+                ready = _unfinished_after(oldest_control, seq_no);
+        }
+        /* Retries of packets in flight can always be sent, new packets only if there is room in the window */
+        if (ready && (!_needs_ack(queued) || _message_tracker.can_store(seq_no)))
+        {
+            return &queued;
+        }
+    }
+    return nullptr;
+}
+
+void HwFrontend::_pop_send_lane(SendLane lane)
+{
+    const auto& packet = _send_lanes[lane].front().packet;
+    if (lane == OUTPUT_LANE)
+    {
+        if (packet.command == GPIO_CMD_SET_VALUE)
+        {
+            auto slot = _pending_set_values.find(packet.payload.gpio_value_data.controller_id);
+            if (slot != _pending_set_values.end() && slot->second == _output_lane_start)
+            {
+                _pending_set_values.erase(slot);
+            }
+        }
+        _output_lane_start++;
+    }
+    _send_lanes[lane].pop_front();
+    _update_send_queue_metrics();
+}
+
+void HwFrontend::_drop_oldest_packet(SendLane lane)
+{
+    QueuedPacket dropped = _send_lanes[lane].front();
+    if (dropped.delivery == Delivery::RELIABLE)
+    {
+        SENSEI_LOG_WARNING("Send lane {} full, dropping packet: {}", lane, gpio_packet_to_string(dropped.packet));
+    }
+    else
+    {
+        SENSEI_LOG_DEBUG("Send lane {} full, dropping packet: {}", lane, gpio_packet_to_string(dropped.packet));
+    }
+    _pop_send_lane(lane);
+    if (_needs_ack(dropped))
+    {
+        /* It might be a retry of a packet that timed out */
+        _message_tracker.remove(from_gpio_protocol_byteord(dropped.packet.sequence_no));
+    }
+    /* Packets waiting for it to be acked should not wait anymore */
+    _packet_completed(dropped);
+    _send_queue_stats.dropped_oldest++;
+    _dropped_packets_metric->increment();
+}
+
+const SendLaneLimit& HwFrontend::_lane_limit(SendLane lane) const
+{
+    switch (lane)
+    {
+        case CONTROL_LANE:
+            return _send_queue_limits.control;
+
+        case OUTPUT_LANE:
+            return _send_queue_limits.output;
+
+        default:
+            return _send_queue_limits.config;
+    }
+}
+
+int HwFrontend::_lane_capacity(SendLane lane) const
+{
+    int capacity = _lane_limit(lane).capacity;
+    if (capacity > 0)
+    {
+        return capacity;
+    }
+    /* Room for the whole configuration of the board */
+    return (_n_sensors > 0 ? _n_sensors : DEFAULT_N_SENSORS) * PACKETS_PER_SENSOR;
+}
+
+bool HwFrontend::_send_lanes_blocked() const
+{
+    for (int lane = 0; lane < static_cast<int>(_send_lanes.size()); ++lane)
+    {
+        auto send_lane = static_cast<SendLane>(lane);
+        if (_lane_limit(send_lane).policy == OverflowPolicy::BLOCK &&
+            static_cast<int>(_send_lanes[lane].size()) >= _lane_capacity(send_lane))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+HwFrontend::SendLane HwFrontend::_packet_lane(const GpioPacket& packet)
+{
+    switch (packet.command)
+    {
+        case GPIO_CMD_SET_VALUE:
+        case GPIO_CMD_GET_VALUE:
+            return OUTPUT_LANE;
+
+        case GPIO_CMD_CONFIG_CONTROLLER:
+            return packet.sub_command == GPIO_SUB_CMD_RESET_ALL_CONTROLLERS ? CONTROL_LANE : CONFIG_LANE;
+
+        default:
+            return CONTROL_LANE;
+    }
+}
+
+bool HwFrontend::_send_lanes_empty() const
+{
+    return std::all_of(_send_lanes.begin(), _send_lanes.end(), [](const auto& lane) {return lane.empty();});
+}
+
+void HwFrontend::_packet_completed(const QueuedPacket& packet)
+{
+    if (packet.lane != CONFIG_LANE)
+    {
+        return;
+    }
+    auto config = _unfinished_config.find(packet_controller_id(packet.packet));
+    if (config != _unfinished_config.end())
+    {
+        auto& seq_numbers = config->second;
+        seq_numbers.erase(std::remove(seq_numbers.begin(), seq_numbers.end(),
+                                      from_gpio_protocol_byteord(packet.packet.sequence_no)), seq_numbers.end());
+        if (seq_numbers.empty())
+        {
+            _unfinished_config.erase(config);
+        }
+    }
+}
+
+std::optional<uint32_t> HwFrontend::_oldest_unfinished(SendLane lane) const
+{
+    /* Packets are queued in order of sequence number within a lane */
+    std::optional<uint32_t> oldest;
+    if (!_send_lanes[lane].empty())
+    {
+        oldest = from_gpio_protocol_byteord(_send_lanes[lane].front().packet.sequence_no);
+    }
+    for (const auto& packet : _in_flight_packets)
+    {
+        uint32_t seq_no = from_gpio_protocol_byteord(packet.packet.sequence_no);
+        if (packet.lane == lane && (!oldest || sequence_before(seq_no, *oldest)))
+        {
+            oldest = seq_no;
+        }
+    }
+    return oldest;
+}
+
+bool HwFrontend::_unfinished_after(std::optional<uint32_t> oldest_unfinished, uint32_t seq_no)
+{
+    return !oldest_unfinished || sequence_before(seq_no, *oldest_unfinished);
+}
+
+void HwFrontend::_queue_output_value(int controller_id, uint32_t value)
+{
+    _output_values[controller_id] = value;
+    _queue_packet(_packet_factory.make_set_value_command(controller_id, value), Delivery::LATEST_WINS);
+}
+
+bool HwFrontend::_needs_ack(const QueuedPacket& packet) const
+{
+    return _verify_acks && packet.delivery == Delivery::RELIABLE;
+}
+
+void HwFrontend::_output_value_sent(const QueuedPacket& packet)
+{
+    if (!_verify_acks || packet.delivery != Delivery::LATEST_WINS)
+    {
+        return;
+    }
+    const auto& value_data = packet.packet.payload.gpio_value_data;
+    auto deadline = std::chrono::steady_clock::now() + _message_tracker.rtt_statistics().timeout;
+    _unacked_output_values.push_back({from_gpio_protocol_byteord(packet.packet.sequence_no), value_data.controller_id,
+                                      from_gpio_protocol_byteord(value_data.controller_val), packet.queue_time,
+                                      deadline});
+    if (_unacked_output_values.size() > MAX_UNACKED_OUTPUT_VALUES)
+    {
+        /* Forgotten before its ack could come, treat it as lost so that a latest value is not left unverified */
+        auto oldest = _unacked_output_values.front();
+        _unacked_output_values.pop_front();
+        _output_value_lost(oldest);
+    }
+}
+
+void HwFrontend::_output_value_lost(const SentOutputValue& output)
+{
+    _send_queue_stats.lost_output_values++;
+    if (_is_latest_output_value(output))
+    {
+        SENSEI_LOG_DEBUG("Output value to controller {} lost, sending it again", output.controller_id);
+        _queue_output_value(output.controller_id, output.value);
+    }
+}
+
+void HwFrontend::_handle_output_value_timeouts()
+{
+    if (_unacked_output_values.empty())
+    {
+        return;
+    }
+    /* Catches the last value of a controller, no later ack would reveal that it was lost */
+    auto now = std::chrono::steady_clock::now();
+    std::vector<SentOutputValue> lost;
+    auto expired = std::remove_if(_unacked_output_values.begin(), _unacked_output_values.end(),
+                                  [&](const SentOutputValue& output)
+    {
+        if (output.deadline > now)
+        {
+            return false;
+        }
+        lost.push_back(output);
+        return true;
+    });
+    _unacked_output_values.erase(expired, _unacked_output_values.end());
+    for (const auto& output : lost)
+    {
+        _output_value_lost(output);
+    }
+}
+
+bool HwFrontend::_output_value_acked(uint32_t seq_no)
+{
+    auto acked = std::find_if(_unacked_output_values.begin(), _unacked_output_values.end(), [&](const SentOutputValue& v)
+    {
+        return v.seq_no == seq_no;
+    });
+    if (acked == _unacked_output_values.end())
+    {
+        return false;
+    }
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - acked->queue_time);
+    _output_latency_samples++;
+    _output_latency_sum += latency;
+    _output_latency_max = std::max(_output_latency_max, latency);
+
+    /* Acks come in the order the packets were sent, values sent before without an ack were lost */
+    std::vector<SentOutputValue> lost(_unacked_output_values.begin(), acked);
+    _unacked_output_values.erase(_unacked_output_values.begin(), acked);
+    for (const auto& output : lost)
+    {
+        _output_value_lost(output);
+    }
+    _unacked_output_values.pop_front();
+    _check_resync_finished();
+    return true;
+}
+
+bool HwFrontend::_is_latest_output_value(const SentOutputValue& output) const
+{
+    auto latest = _output_values.find(output.controller_id);
+    if (latest == _output_values.end() || latest->second != output.value)
+    {
+        return false;
+    }
+    /* A value sent or queued after it makes it obsolete */
+    auto same_controller = [&](const auto& v) {return v.controller_id == output.controller_id;};
+    if (std::any_of(_unacked_output_values.begin(), _unacked_output_values.end(), same_controller))
+    {
+        return false;
     }
+    return std::none_of(_send_lanes[OUTPUT_LANE].begin(), _send_lanes[OUTPUT_LANE].end(), [&](const QueuedPacket& p)
+    {
+        return p.packet.command == GPIO_CMD_SET_VALUE && packet_controller_id(p.packet) == output.controller_id;
+    });
+}
+
+void HwFrontend::_clear_send_lanes()
+{
+    for (auto& lane : _send_lanes)
+    {
+        lane.clear();
+    }
+    for (const auto& packet : _in_flight_packets)
+    {
+        _message_tracker.remove(from_gpio_protocol_byteord(packet.packet.sequence_no));
+    }
+    _in_flight_packets.clear();
+    _unacked_output_values.clear();
+    _pending_set_values.clear();
+    _unfinished_config.clear();
+    _output_lane_start = 0;
+    _update_send_queue_metrics();
+}
+
+void HwFrontend::_update_send_queue_metrics()
+{
+    int64_t depth = 0;
+    for (const auto& lane : _send_lanes)
+    {
+        depth += static_cast<int64_t>(lane.size());
+    }
+    _send_queue_depth_metric->set(depth);
+    _send_queue_high_water_metric->update_max(depth);
+}
+
+void HwFrontend::_start_resync([[maybe_unused]] const char* reason)
+{
+    SENSEI_LOG_WARNING("Board restart detected ({}), resynchronizing", reason);
+    /* Packets still queued were meant for the board as it was before, they are replaced by its full configuration */
+    _clear_send_lanes();
+    _queue_packet(_packet_factory.make_get_board_info_command());
+    _resync_state = ResyncState::WAITING_FOR_CONFIG;
+    _resync_start = std::chrono::steady_clock::now();
+    _resync_stats.resyncs++;
+    _out_queue->push(_message_factory.make_hw_backend_restarted_error(_first_sensor));
+}
+
+void HwFrontend::_check_resync_finished()
+{
+    if (_resync_state != ResyncState::SENDING || !_send_lanes_empty() || !_in_flight_packets.empty())
+    {
+        return;
+    }
+    auto time_to_recover = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _resync_start);
+    _resync_stats.last_time_to_recover = time_to_recover;
+    _resync_stats.max_time_to_recover = std::max(_resync_stats.max_time_to_recover, time_to_recover);
+    _resync_state = ResyncState::IDLE;
+    SENSEI_LOG_INFO("Board resynchronized in {} us", time_to_recover.count());
 }
 
 void HwFrontend::_process_sensei_command(const Command*message)
 {
     SENSEI_LOG_DEBUG("HwFrontend: got command: {}", message->representation());
+    /* Controller ids of the board start from 0 at the first sensor of its range */
+    const int controller_id = message->index() - _first_sensor;
     switch (message->type())
     {
         case CommandType::SET_SENSOR_HW_TYPE:
@@ -210,7 +855,7 @@ void HwFrontend::_process_sensei_command(const Command*message)
             auto hw_type = to_gpio_hw_type(cmd->data());
             if (hw_type.has_value())
             {
-                _send_list.push_back(_packet_factory.make_add_controller_command(cmd->index(), hw_type.value()));
+                _queue_packet(_packet_factory.make_add_controller_command(controller_id, hw_type.value()));
             }
             break;
         }
@@ -228,7 +873,7 @@ void HwFrontend::_process_sensei_command(const Command*message)
                 if (i_mod >= sizeof(list.pins) || i >= setpins.size())
                 {
                     list.pincount = static_cast<uint8_t>(i_mod);
-                    _send_list.push_back(_packet_factory.make_add_pins_to_controller_command(cmd->index(), list));
+                    _queue_packet(_packet_factory.make_add_pins_to_controller_command(controller_id, list));
                     i_mod = 0;
                 }
             }
@@ -238,7 +883,7 @@ void HwFrontend::_process_sensei_command(const Command*message)
         {
             auto cmd = static_cast<const SetEnabledCommand*>(message);
             uint8_t muted = cmd->data()? GPIO_CONTROLLER_UNMUTED : GPIO_CONTROLLER_MUTED;
-            _send_list.push_back(_packet_factory.make_mute_controller_command(cmd->index(), muted));
+            _queue_packet(_packet_factory.make_mute_controller_command(controller_id, muted));
             break;
         }
         case CommandType::SET_SENDING_MODE:
@@ -247,33 +892,33 @@ void HwFrontend::_process_sensei_command(const Command*message)
             auto mode = to_gpio_sending_mode(cmd->data());
             if (mode.has_value())
             {
-                _send_list.push_back(_packet_factory.make_set_notification_mode(cmd->index(), mode.value()));
+                _queue_packet(_packet_factory.make_set_notification_mode(controller_id, mode.value()));
             }
             break;
         }
         case CommandType::SET_SENDING_DELTA_TICKS:
         {
             auto cmd = static_cast<const SetSendingDeltaTicksCommand*>(message);
-            _send_list.push_back(_packet_factory.make_set_controller_tick_rate_command(cmd->index(), cmd->data()));
+            _queue_packet(_packet_factory.make_set_controller_tick_rate_command(controller_id, cmd->data()));
             break;
         }
         case CommandType::SET_ADC_BIT_RESOLUTION:
         {
             auto cmd = static_cast<const SetADCBitResolutionCommand*>(message);
-            _send_list.push_back(_packet_factory.make_set_analog_resolution_command(cmd->index(), cmd->data()));
+            _queue_packet(_packet_factory.make_set_analog_resolution_command(controller_id, cmd->data()));
             break;
         }
         case CommandType::SET_ADC_FILTER_TIME_CONSTANT:
         {
             auto cmd = static_cast<const SetADCFitlerTimeConstantCommand*>(message);
-            _send_list.push_back(_packet_factory.make_set_analog_time_constant_command(cmd->index(), cmd->data()));
+            _queue_packet(_packet_factory.make_set_analog_time_constant_command(controller_id, cmd->data()));
             break;
         }
         case CommandType::SET_MULTIPLEXED:
         {
             auto cmd = static_cast<const SetMultiplexedSensorCommand*>(message);
-            _send_list.push_back(_packet_factory.make_add_controller_to_mux_command(cmd->index(),
-                                                                                    cmd->data().id,
+            _queue_packet(_packet_factory.make_add_controller_to_mux_command(controller_id,
+                                                                                    cmd->data().id - _first_sensor,
                                                                                     cmd->data().pin));
             break;
         }
@@ -290,13 +935,13 @@ void HwFrontend::_process_sensei_command(const Command*message)
                     polarity = GPIO_ACTIVE_LOW;
                     break;
             }
-            _send_list.push_back(_packet_factory.make_set_polarity_command(cmd->index(), polarity));
+            _queue_packet(_packet_factory.make_set_polarity_command(controller_id, polarity));
             break;
         }
         case CommandType::SET_FAST_MODE:
         {
             auto cmd = static_cast<const SetFastModeCommand*>(message);
-            _send_list.push_back(_packet_factory.make_set_debounce_mode_command(cmd->index(),
+            _queue_packet(_packet_factory.make_set_debounce_mode_command(controller_id,
                                                                                 cmd->data()? GPIO_CONTROLLER_DEBOUNCE_ENABLED :
                                                                                              GPIO_CONTROLLER_DEBOUNCE_DISABLED));
             break;
@@ -305,20 +950,19 @@ void HwFrontend::_process_sensei_command(const Command*message)
         case CommandType::SET_DIGITAL_OUTPUT_VALUE:
         {
             auto cmd = static_cast<const SetDigitalOutputValueCommand*>(message);
-            _send_list.push_back(_packet_factory.make_set_value_command(cmd->index(), cmd->data()? 1 : 0));
+            _queue_output_value(controller_id, cmd->data()? 1 : 0);
             break;
         }
         case CommandType::SET_CONTINUOUS_OUTPUT_VALUE:
         {
             auto cmd = static_cast<const SetContinuousOutputValueCommand*>(message);
-            _send_list.push_back(_packet_factory.make_set_value_command(cmd->index(),
-                                                                        std::round(cmd->data())));
+            _queue_output_value(controller_id, std::round(cmd->data()));
             break;
         }
         case CommandType::SET_ANALOG_OUTPUT_VALUE:
         {
             auto cmd = static_cast<const SetRangeOutputValueCommand*>(message);
-            _send_list.push_back(_packet_factory.make_set_value_command(cmd->index(), cmd->data()));
+            _queue_output_value(controller_id, cmd->data());
             break;
         }
         case CommandType::ENABLE_SENDING_PACKETS:
@@ -326,11 +970,20 @@ void HwFrontend::_process_sensei_command(const Command*message)
             auto cmd = static_cast<const EnableSendingPacketsCommand*>(message);
             if (cmd->data() == true)
             {
-                _send_list.push_back(_packet_factory.make_start_system_command());
+                _queue_packet(_packet_factory.make_start_system_command());
+                if (_resync_state == ResyncState::WAITING_FOR_CONFIG)
+                {
+                    /* The configuration of a restarted board is complete, restore its outputs */
+                    for (const auto& [output_id, value] : _output_values)
+                    {
+                        _queue_packet(_packet_factory.make_set_value_command(output_id, value), Delivery::LATEST_WINS);
+                    }
+                    _resync_state = ResyncState::SENDING;
+                }
             }
             else
             {
-                _send_list.push_back(_packet_factory.make_reset_system_command());
+                _queue_packet(_packet_factory.make_reset_system_command());
             }
             break;
         }
@@ -339,7 +992,7 @@ void HwFrontend::_process_sensei_command(const Command*message)
             // TODO - maybe this should be reserved for encoders and led rings
             auto cmd = static_cast<const SetInputRangeCommand*>(message);
             auto range = cmd->data();
-            _send_list.push_back(_packet_factory.make_set_range_command(cmd->index(),
+            _queue_packet(_packet_factory.make_set_range_command(controller_id,
                                                                         static_cast<uint32_t>(std::round(range.min)),
                                                                         static_cast<uint32_t>(std::round(range.max))));
             break;
@@ -385,14 +1038,15 @@ void HwFrontend::_handle_ack(const GpioPacket& ack)
         std::unique_lock<std::mutex> lock(_send_mutex);
         if (_message_tracker.ack(seq_no))
         {
-            if (_send_list.size() > 0)
+            auto packet = _take_in_flight_packet(seq_no);
+            if (packet.has_value())
             {
-                _send_list.pop_front();
+                _packet_completed(packet.value());
             }
-            _ready_to_send = true;
+            _check_resync_finished();
             _ready_to_send_notifier.notify_one();
         }
-        else
+        else if (!_output_value_acked(seq_no))
         {
             SENSEI_LOG_WARNING("Got unrecognised ack for packet: {}", seq_no);
         }
@@ -408,15 +1062,36 @@ void HwFrontend::_handle_ack(const GpioPacket& ack)
 void HwFrontend::_handle_value(const GpioPacket& packet)
 {
     auto& m = packet.payload.gpio_value_data;
-   _out_queue->push(_message_factory.make_analog_value(m.controller_id,
-                                                       from_gpio_protocol_byteord(m.controller_val),
-                                                       packet.timestamp));
+    if (_n_sensors > 0 && m.controller_id >= _n_sensors)
+    {
+        SENSEI_LOG_WARNING("Got a value from controller {} outside of the sensor range", m.controller_id);
+        return;
+    }
+    auto value = _message_factory.make_analog_value(m.controller_id + _first_sensor,
+                                                    from_gpio_protocol_byteord(m.controller_val),
+                                                    packet.timestamp);
+    static_cast<Value*>(value.get())->set_receive_time(std::chrono::steady_clock::now());
+    if (_inline_value_handler != nullptr)
+    {
+        _inline_value_handler->handle_inline_value(static_cast<Value*>(value.get()));
+    }
+    else
+    {
+        _out_queue->push(std::move(value));
+    }
     SENSEI_LOG_DEBUG("Got a value packet!");
 }
 
 void HwFrontend::_handle_board_info(const gpio::GpioPacket& packet)
 {
-    _board_info = packet.payload.gpio_board_info_data;
+    const auto& board_info = packet.payload.gpio_board_info_data;
+    if (_has_board_info && std::memcmp(&_board_info, &board_info, sizeof(board_info)) != 0)
+    {
+        std::lock_guard<std::mutex> lock(_send_mutex);
+        _start_resync("board info changed");
+    }
+    _board_info = board_info;
+    _has_board_info = true;
     SENSEI_LOG_INFO("Received board info: No of digital input pins: {}",_board_info.num_digital_input_pins);
     SENSEI_LOG_INFO("No of digital output pins: {}",_board_info.num_digital_output_pins);
     SENSEI_LOG_INFO("No of analog input pins: {}", _board_info.num_analog_input_pins);
@@ -484,6 +1159,11 @@ std::optional<uint8_t> to_gpio_sending_mode(SendingMode mode)
             gpio_mode = GPIO_ON_VALUE_CHANGE;
             break;
 
+        case SendingMode::ON_REQUEST:
+            // The board keeps sending changes so that the mapper cache is always current
+            gpio_mode = GPIO_ON_VALUE_CHANGE;
+            break;
+
         case SendingMode::ON_PRESS:
         case SendingMode::ON_RELEASE:
             // TODO - currently handling these in the mapper
@@ -28,6 +28,11 @@
 #include <cassert>
 #include <utility>
 #include <optional>
+#include <unordered_map>
+#include <array>
+#include <deque>
+#include <vector>
+#include <chrono>
 
 #include "base_hw_frontend.h"
 #include "hardware_backend/base_hw_backend.h"
@@ -40,6 +45,43 @@
 namespace sensei {
 namespace hw_frontend {
 
+/**
+ * @brief Time from queuing a value packet for an output controller until it was acked.
+ *        Output values are not held back waiting for acks, so this includes the ack
+ *        round trip but not the time spent waiting for the acks of other packets.
+ */
+struct OutputLatencyStatistics
+{
+    std::chrono::microseconds mean;
+    std::chrono::microseconds max;
+    uint64_t samples;
+};
+
+/**
+ * @brief Counters of the packets that could not be sent as queued
+ */
+struct SendQueueStatistics
+{
+    uint64_t coalesced;         /* Output values merged into a value already queued */
+    uint64_t dropped_oldest;    /* Packets dropped from a full lane to make room */
+    uint64_t dropped_newest;    /* Packets not queued because their lane was full */
+    uint64_t failed_sends;      /* Calls to the backend that did not send all packets */
+    uint64_t disconnects;       /* Times the backend went from connected to disconnected */
+    uint64_t lost_output_values; /* Output values whose ack never came, sent again if still the latest */
+    bool     backend_connected;
+};
+
+/**
+ * @brief Board restarts detected and the time it took to bring each restarted board
+ *        back to its configured state
+ */
+struct ResyncStatistics
+{
+    uint64_t resyncs;
+    std::chrono::microseconds last_time_to_recover;
+    std::chrono::microseconds max_time_to_recover;
+};
+
 class HwFrontend : public BaseHwFrontend
 {
 public:
@@ -48,10 +90,19 @@ public:
     *
     * @param [in] in_queue Output queue where decoded messages go
     * @param [in] out_queue Queue for messages to be sent to the board
+    * @param [in] ack_window Max number of packets sent without being acked,
+    *                        1 waits for the ack of every packet before sending the next
+    * @param [in] min_ack_timeout Lower bound of the adaptive ack timeout
+    * @param [in] max_ack_timeout Upper bound of the adaptive ack timeout
+    * @param [in] metrics_labels Labels of the metrics of this board
     */
     HwFrontend(SynchronizedQueue<std::unique_ptr<Command>>*in_queue,
                SynchronizedQueue<std::unique_ptr<BaseMessage>>*out_queue,
-               hw_backend::BaseHwBackend* hw_backend);
+               hw_backend::BaseHwBackend* hw_backend,
+               int ack_window,
+               std::chrono::milliseconds min_ack_timeout,
+               std::chrono::milliseconds max_ack_timeout,
+               const std::string& metrics_labels = "");
 
     ~HwFrontend()
     {}
@@ -74,12 +125,30 @@ public:
     void mute(bool enabled) override;
 
     /**
-     * @brief Enables tracking and verification of packets ent
+     * @brief Enables tracking and verification of packets sent. Configuration and
+     *        system packets are then resent until acked and limited by the ack window.
+     *        Output values are always sent right away, their acks are only used for
+     *        statistics and to resend the latest value of a controller if it was lost.
      *
      * @param [in] enabled Sets ack verification enabled/disabled
      */
     void verify_acks(bool enabled) override;
 
+    /**
+     * @brief Returns the latency statistics of the acked output value packets
+     */
+    OutputLatencyStatistics output_latency_statistics();
+
+    /**
+     * @brief Returns the counters of dropped and merged packets and the backend state
+     */
+    SendQueueStatistics send_queue_statistics();
+
+    /**
+     * @brief Returns the number of board resynchronizations and their time to recover
+     */
+    ResyncStatistics resync_statistics();
+
 private:
     enum class ThreadState : int
     {
@@ -88,20 +157,122 @@ private:
         STOPPED,
     };
 
+    /* Packets are queued in separate lanes, a lower lane has priority when sending */
+    enum SendLane : int
+    {
+        CONTROL_LANE = 0,   /* System control packets and the reset of all controllers */
+        OUTPUT_LANE,        /* Output values and value requests */
+        CONFIG_LANE,        /* Configuration of single controllers */
+        N_SEND_LANES
+    };
+
+    enum class ResyncState
+    {
+        IDLE,
+        WAITING_FOR_CONFIG, /* The board restarted, its configuration is requested from the event handler */
+        SENDING,            /* Configuration and cached output values are queued and not all acked yet */
+    };
+
+    /* How a packet is delivered when acks are verified */
+    enum class Delivery
+    {
+        RELIABLE,       /* Resent until acked, counts towards the ack window */
+        LATEST_WINS,    /* Sent once without waiting for the ack, a newer value replaces it */
+    };
+
+    struct QueuedPacket
+    {
+        gpio::GpioPacket packet;
+        SendLane lane;
+        std::chrono::steady_clock::time_point queue_time;
+        Delivery delivery;
+    };
+
+    /* An output value sent while acks are verified and not acked yet */
+    struct SentOutputValue
+    {
+        uint32_t seq_no;
+        int      controller_id;
+        uint32_t value;
+        std::chrono::steady_clock::time_point queue_time;
+        /* Considered lost if not acked by then */
+        std::chrono::steady_clock::time_point deadline;
+    };
+
     void read_loop();
     void write_loop();
 
+    /* Resend or drop all packets and output values whose ack timed out, call with _send_mutex held */
     void _handle_timeouts();
+    /* Call with _send_mutex held */
+    std::chrono::milliseconds _time_to_next_timeout(std::chrono::milliseconds max_wait);
+    std::optional<QueuedPacket> _take_in_flight_packet(uint64_t seq_no);
     void _handle_gpio_packet(const gpio::GpioPacket& packet);
     void _handle_ack(const gpio::GpioPacket& ack);
     void _handle_value(const gpio::GpioPacket& packet);
     void _handle_board_info(const gpio::GpioPacket& packet);
     void _process_sensei_command(const Command*message);
+    void _queue_packet(const gpio::GpioPacket& packet, Delivery delivery = Delivery::RELIABLE);
+    void _requeue_packet(const QueuedPacket& packet);
+    QueuedPacket* _next_packet_to_send();
+    int _prepare_send_batch(gpio::GpioPacket* packets, int max_count);
+    void _finish_send_batch(int sent);
+    bool _send_lanes_empty() const;
+    static SendLane _packet_lane(const gpio::GpioPacket& packet);
+    void _pop_send_lane(SendLane lane);
+    void _drop_oldest_packet(SendLane lane);
+    const SendLaneLimit& _lane_limit(SendLane lane) const;
+    int _lane_capacity(SendLane lane) const;
+    bool _send_lanes_blocked() const;
+    void _backend_send_failed(int sent);
+    void _packet_completed(const QueuedPacket& packet);
+    std::optional<uint32_t> _oldest_unfinished(SendLane lane) const;
+    static bool _unfinished_after(std::optional<uint32_t> oldest_unfinished, uint32_t seq_no);
+    void _queue_output_value(int controller_id, uint32_t value);
+    bool _needs_ack(const QueuedPacket& packet) const;
+    void _output_value_sent(const QueuedPacket& packet);
+    bool _output_value_acked(uint32_t seq_no);
+    bool _is_latest_output_value(const SentOutputValue& output) const;
+    void _output_value_lost(const SentOutputValue& output);
+    void _handle_output_value_timeouts();
+    void _clear_send_lanes();
+    void _update_send_queue_metrics();
+    void _start_resync(const char* reason);
+    void _check_resync_finished();
 
     MessageFactory   _message_factory;
     GpioCommandCreator _packet_factory;
     MessageTracker     _message_tracker;
-    std::deque<gpio::GpioPacket>  _send_list;
+    std::array<std::deque<QueuedPacket>, N_SEND_LANES> _send_lanes;
+    /* Position of the first packet in the output lane, counted from the first packet ever queued there */
+    int64_t                       _output_lane_start{0};
+    /* Position in the output lane of the unsent value packet of each controller */
+    std::unordered_map<int, int64_t> _pending_set_values;
+    /* Sequence numbers of the configuration packets of each controller that are not yet acked */
+    std::unordered_map<int, std::vector<uint32_t>> _unfinished_config;
+    std::deque<QueuedPacket>      _in_flight_packets;
+    /* Output values sent and not acked yet, oldest first */
+    std::deque<SentOutputValue>   _unacked_output_values;
+    /* Packets taken from the lanes to be sent with one call to the backend */
+    std::vector<QueuedPacket>     _send_batch;
+
+    uint64_t        _output_latency_samples{0};
+    std::chrono::microseconds _output_latency_sum{0};
+    std::chrono::microseconds _output_latency_max{0};
+    SendQueueStatistics _send_queue_stats{};
+    /* While the backend is down, sends are only attempted as reconnection probes */
+    bool            _backend_connected{true};
+    std::chrono::steady_clock::time_point _next_send_attempt;
+    /* Latest value sent to each output controller, to restore the outputs after a board restart */
+    std::unordered_map<int, uint32_t> _output_values;
+    ResyncState     _resync_state{ResyncState::IDLE};
+    std::chrono::steady_clock::time_point _resync_start;
+    ResyncStatistics _resync_stats{};
+    metrics::Counter* _packets_received_metric;
+    metrics::Counter* _packets_sent_metric;
+    metrics::Counter* _dropped_packets_metric;
+    metrics::Gauge*   _send_queue_depth_metric;
+    metrics::Gauge*   _send_queue_high_water_metric;
     hw_backend::BaseHwBackend* _hw_backend;
 
     std::atomic<ThreadState> _state;
@@ -111,10 +282,10 @@ private:
     std::mutex      _send_mutex;
     std::condition_variable _ready_to_send_notifier;
 
-    bool            _ready_to_send;
     bool            _muted;
     bool            _verify_acks;
     gpio::GpioBoardInfoData _board_info;
+    bool            _has_board_info{false};
 };
 
 std::optional<uint8_t> to_gpio_hw_type(SensorHwType type);
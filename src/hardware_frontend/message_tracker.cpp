@@ -20,17 +20,39 @@
  * A helper class to keep track of sent messages and acknowledgements to identify
  * message timeouts.
  */
+#include <algorithm>
+
 #include "message_tracker.h"
 
 namespace sensei {
 namespace hw_frontend {
 
-MessageTracker::MessageTracker(std::chrono::milliseconds timeout, int max_retries) :
+/* Timer granularity term of the timeout calculation */
+constexpr auto CLOCK_GRANULARITY = std::chrono::microseconds(100);
+
+MessageTracker::MessageTracker(std::chrono::milliseconds timeout,
+                               int max_retries,
+                               int window_size,
+                               std::chrono::milliseconds min_timeout,
+                               std::chrono::milliseconds max_timeout,
+                               const std::string& metrics_labels) :
         _timeout(timeout),
+        _min_timeout(min_timeout.count() > 0 ? min_timeout : timeout),
+        _max_timeout(max_timeout.count() > 0 ? max_timeout : timeout),
+        _smoothed_rtt(0),
+        _rtt_variance(0),
+        _min_rtt(0),
+        _max_rtt(0),
+        _rtt_samples(0),
+        _total_retries(0),
         _max_retries(max_retries),
-        _retries(0),
-        _identifier(0)
+        _entries(std::max(window_size, 1)),
+        _in_flight(0)
 {
+    auto& registry = metrics::registry();
+    _acks_metric = registry.counter("sensei_acks_total", "Packets acked by the board", metrics_labels);
+    _timeouts_metric = registry.counter("sensei_ack_timeouts_total", "Packets whose ack timed out", metrics_labels);
+    _retries_metric = registry.counter("sensei_retries_total", "Packets sent again after an ack timeout", metrics_labels);
 }
 
 MessageTracker::~MessageTracker()
@@ -38,75 +60,175 @@ MessageTracker::~MessageTracker()
 
 }
 
-void MessageTracker::store(std::unique_ptr<Command>&& message, uint64_t uuid)
+bool MessageTracker::store(std::unique_ptr<Command>&& message, uint64_t uuid)
 {
     std::lock_guard<std::mutex> lock(_mutex);
-    update_time();
-    _message_in_transit = std::move(message);
-    _send_time = _current_time;
-    if (uuid == _identifier)
+    auto& entry = _entry(uuid);
+    auto timeout = _timeout;
+    if (entry.identifier == uuid)
     {
-        _retries--;
+        entry.retries--;
+        _total_retries++;
+        _retries_metric->increment();
+        /* Exponential backoff */
+        int sent_count = _max_retries - entry.retries;
+        timeout = std::min(_timeout * (1 << std::min(sent_count - 1, 16)), _max_timeout);
+    }
+    else if (entry.identifier == 0)
+    {
+        entry.identifier = uuid;
+        entry.retries = _max_retries - 1;
+        _in_flight++;
     }
     else
     {
-        _identifier = uuid;
-        _retries = _max_retries - 1;
+        return false;
     }
+    update_time();
+    entry.message = std::move(message);
+    entry.send_time = _current_time;
+    entry.deadline = _current_time + timeout;
+    entry.reported = false;
+    return true;
+}
+
+bool MessageTracker::can_store(uint64_t uuid)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& entry = _entry(uuid);
+    return entry.identifier == 0 || entry.identifier == uuid;
 }
 
 bool MessageTracker::ack(uint64_t identifier)
 {
     std::lock_guard<std::mutex> lock(_mutex);
-    if (identifier != _identifier)
+    auto& entry = _entry(identifier);
+    if (identifier == 0 || entry.identifier != identifier)
     {
         return false;
     }
-    _message_in_transit = nullptr;
-    _identifier = 0;
+    /* Karn's algorithm, the ack of a retried message can't be matched to one send */
+    if (entry.retries == _max_retries - 1)
+    {
+        update_time();
+        _add_rtt_sample(_current_time - entry.send_time);
+    }
+    entry.message = nullptr;
+    entry.identifier = 0;
+    _in_flight--;
+    _acks_metric->increment();
     return true;
 }
 
-timeout MessageTracker::timed_out()
+void MessageTracker::remove(uint64_t identifier)
 {
     std::lock_guard<std::mutex> lock(_mutex);
-    if (_identifier == 0 &&  _message_in_transit == nullptr)
+    auto& entry = _entry(identifier);
+    if (identifier != 0 && entry.identifier == identifier)
     {
-        return timeout::NO_MESSAGE;
+        entry.message = nullptr;
+        entry.identifier = 0;
+        _in_flight--;
     }
-    update_time();
-    if (_send_time + _timeout > _current_time)
+}
+
+timeout MessageTracker::timed_out(uint64_t& identifier)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_in_flight == 0)
     {
-        return timeout::WAITING;
+        return timeout::NO_MESSAGE;
     }
-    else
+    update_time();
+    for (auto& entry : _entries)
     {
-        if (_retries > 0)
+        if (entry.identifier == 0 || entry.reported || entry.deadline > _current_time)
         {
-            return timeout::TIMED_OUT;
+            continue;
         }
-        else
+        entry.reported = true;
+        identifier = entry.identifier;
+        _timeouts_metric->increment();
+        return entry.retries > 0 ? timeout::TIMED_OUT : timeout::TIMED_OUT_PERMANENTLY;
+    }
+    return timeout::WAITING;
+}
+
+timeout MessageTracker::timed_out()
+{
+    uint64_t identifier;
+    return timed_out(identifier);
+}
+
+std::chrono::steady_clock::time_point MessageTracker::next_deadline()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if (_in_flight == 0)
+    {
+        return deadline;
+    }
+    for (const auto& entry : _entries)
+    {
+        if (entry.identifier != 0 && !entry.reported)
         {
-            return timeout::TIMED_OUT_PERMANENTLY;
+            deadline = std::min(deadline, entry.deadline);
         }
     }
+    return deadline;
 }
 
-std::unique_ptr<Command> MessageTracker::get_cached_message()
+std::unique_ptr<Command> MessageTracker::get_cached_message(uint64_t identifier)
 {
     std::lock_guard<std::mutex> lock(_mutex);
-    update_time();
-    if (_message_in_transit)
+    auto& entry = _entry(identifier);
+    if (entry.identifier == identifier && entry.message)
     {
-        return std::move(_message_in_transit);
+        return std::move(entry.message);
     }
     return nullptr;
 }
 
+RttStatistics MessageTracker::rtt_statistics()
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    std::lock_guard<std::mutex> lock(_mutex);
+    return RttStatistics{duration_cast<microseconds>(_smoothed_rtt),
+                         duration_cast<microseconds>(_rtt_variance),
+                         duration_cast<microseconds>(_timeout),
+                         duration_cast<microseconds>(_min_rtt),
+                         duration_cast<microseconds>(_max_rtt),
+                         _rtt_samples,
+                         _total_retries};
+}
+
+void MessageTracker::_add_rtt_sample(std::chrono::steady_clock::duration rtt)
+{
+    if (_rtt_samples == 0)
+    {
+        _smoothed_rtt = rtt;
+        _rtt_variance = rtt / 2;
+        _min_rtt = rtt;
+        _max_rtt = rtt;
+    }
+    else
+    {
+        auto error = _smoothed_rtt > rtt ? _smoothed_rtt - rtt : rtt - _smoothed_rtt;
+        _rtt_variance = (3 * _rtt_variance + error) / 4;
+        _smoothed_rtt = (7 * _smoothed_rtt + rtt) / 8;
+        _min_rtt = std::min(_min_rtt, rtt);
+        _max_rtt = std::max(_max_rtt, rtt);
+    }
+    _rtt_samples++;
+    auto variance_term = std::max<std::chrono::steady_clock::duration>(CLOCK_GRANULARITY, 4 * _rtt_variance);
+    _timeout = std::clamp<std::chrono::steady_clock::duration>(_smoothed_rtt + variance_term, _min_timeout, _max_timeout);
+}
+
 void MessageTracker::update_time()
 {
     _current_time = std::chrono::steady_clock::now();
 };
 
 }; // namespace hw_frontend
-}; // namespace sensei
\ No newline at end of file
+}; // namespace sensei
@@ -18,7 +18,15 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  *
  * A helper class to keep track of sent messages and acknowledgements to identify
- * message timeouts.
+ * message timeouts. Up to window_size messages can be waiting for an ack at the
+ * same time. Messages are kept in a ring indexed by their identifier (i.e. the
+ * packet sequence number), each with its own deadline and retry count. With a
+ * window of 1 only one message at a time can be tracked.
+ *
+ * The timeout adapts to the measured round trip time as in TCP (RFC 6298):
+ * a smoothed RTT and RTT variance are updated on every ack and the timeout is
+ * set to srtt + 4 * rttvar, within the given bounds. Retried messages are not
+ * sampled and their timeout is doubled on every retry.
  */
 #ifndef SENSEI_MESSAGE_TRACKER_H
 #define SENSEI_MESSAGE_TRACKER_H
@@ -26,15 +34,26 @@
 #include <cstdint>
 #include <chrono>
 #include <mutex>
-#include <map>
-
-#include <iostream>
+#include <atomic>
+#include <vector>
 
 #include "message/base_command.h"
+#include "metrics.h"
 
 namespace sensei {
 namespace hw_frontend {
 
+struct RttStatistics
+{
+    std::chrono::microseconds smoothed_rtt;
+    std::chrono::microseconds rtt_variance;
+    std::chrono::microseconds timeout;
+    std::chrono::microseconds min_rtt;
+    std::chrono::microseconds max_rtt;
+    uint64_t samples;
+    uint64_t retries;
+};
+
 enum class timeout
 {
     NO_MESSAGE,
@@ -47,14 +66,37 @@ enum class timeout
 class MessageTracker
 {
 public:
-    MessageTracker(std::chrono::milliseconds timeout, int max_retries);
+    /**
+     * @brief Class constructor, by default the timeout is fixed
+     *
+     * @param [in] timeout     Initial timeout, used until the first RTT is measured
+     * @param [in] max_retries Number of times a message is sent before giving up
+     * @param [in] window_size Max number of messages waiting for an ack
+     * @param [in] min_timeout Lower bound for the adaptive timeout
+     * @param [in] max_timeout Upper bound for the adaptive timeout, including backoff
+     * @param [in] metrics_labels Labels of the metrics of this tracker, e.g. its board
+     */
+    MessageTracker(std::chrono::milliseconds timeout,
+                   int max_retries,
+                   int window_size = 1,
+                   std::chrono::milliseconds min_timeout = std::chrono::milliseconds(0),
+                   std::chrono::milliseconds max_timeout = std::chrono::milliseconds(0),
+                   const std::string& metrics_labels = "");
 
     ~MessageTracker();
 
     /**
-     * @brief Log a new entry, i.e. call this when sending a packet and waiting for a response
+     * @brief Log a new entry, i.e. call this when sending a packet and waiting for a response.
+     *        Storing an identifier that is already tracked counts as a retry.
+     *
+     * @return false if the slot for this identifier is taken by another message
      */
-    void store(std::unique_ptr<Command>&& message, uint64_t uuid);
+    bool store(std::unique_ptr<Command>&& message, uint64_t uuid);
+
+    /**
+     * @brief Check if there is a free slot for a new message with the given identifier.
+     */
+    bool can_store(uint64_t uuid);
 
     /**
      * @brief Check the status of a received packet against un-acknowledged packets.
@@ -63,28 +105,86 @@ public:
     bool ack(uint64_t identifier);
 
     /**
-     * @brief Returns timeout status
+     * @brief Stop tracking a message, i.e. after it timed out permanently or
+     *        could not be sent. Unlike ack(), no round trip time is sampled.
      */
+    void remove(uint64_t identifier);
+
+    /**
+     * @brief Returns timeout status. A timed out message is only reported once,
+     *        until it is stored again.
+     *
+     * @param [out] identifier Identifier of the timed out message, if any
+     */
+    timeout timed_out(uint64_t& identifier);
+
     timeout timed_out();
 
+    /**
+     * @brief Returns when the next message waiting for an ack times out,
+     *        or time_point::max() if there is none
+     */
+    std::chrono::steady_clock::time_point next_deadline();
+
     /**
     * @brief Returns the message_in_transit for resend or for destruction
      * Returns nullptr if there is no cached message.
     */
-    std::unique_ptr<Command> get_cached_message();
+    std::unique_ptr<Command> get_cached_message(uint64_t identifier);
+
+    /**
+     * @brief Returns the round trip time statistics and the current timeout
+     */
+    RttStatistics rtt_statistics();
+
+    /**
+     * @brief Number of messages waiting for an ack
+     */
+    int in_flight() const
+    {
+        return _in_flight;
+    }
 
 private:
+    struct Entry
+    {
+        uint64_t                               identifier{0};
+        std::chrono::steady_clock::time_point  send_time;
+        std::chrono::steady_clock::time_point  deadline;
+        int                                    retries{0};
+        bool                                   reported{false};
+        std::unique_ptr<Command>               message;
+    };
+
+    Entry& _entry(uint64_t identifier)
+    {
+        return _entries[identifier % _entries.size()];
+    }
+
     void update_time();
 
+    void _add_rtt_sample(std::chrono::steady_clock::duration rtt);
+
     std::chrono::steady_clock::duration    _timeout;
+    std::chrono::steady_clock::duration    _min_timeout;
+    std::chrono::steady_clock::duration    _max_timeout;
     std::chrono::steady_clock::time_point  _current_time;
-    std::chrono::steady_clock::time_point  _send_time;
+
+    std::chrono::steady_clock::duration    _smoothed_rtt;
+    std::chrono::steady_clock::duration    _rtt_variance;
+    std::chrono::steady_clock::duration    _min_rtt;
+    std::chrono::steady_clock::duration    _max_rtt;
+    uint64_t                               _rtt_samples;
+    uint64_t                               _total_retries;
 
     int                                    _max_retries;
-    int                                    _retries;
-    std::unique_ptr<Command>               _message_in_transit;
+    std::vector<Entry>                     _entries;
+    std::atomic<int>                       _in_flight;
+
+    metrics::Counter*                      _acks_metric;
+    metrics::Counter*                      _timeouts_metric;
+    metrics::Counter*                      _retries_metric;
 
-    uint64_t    _identifier;
     std::mutex  _mutex;
 
 };
@@ -93,4 +193,4 @@ private:
 } // namespace sensei
 
 
-#endif //SENSEI_MESSAGE_TRACKER_H
\ No newline at end of file
+#endif //SENSEI_MESSAGE_TRACKER_H
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Latency of values from the board to the output backend, in
+ *        histograms per sensor and for all sensors
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <algorithm>
+#include <limits>
+
+#include "latency_monitor.h"
+
+namespace sensei {
+
+constexpr int N_WINDOWS = 2;
+
+const char* latency_stage_name(LatencyStage stage)
+{
+    switch (stage)
+    {
+        case LatencyStage::QUEUE:
+            return "queue";
+
+        case LatencyStage::MAPPING:
+            return "mapping";
+
+        case LatencyStage::OUTPUT:
+            return "output";
+
+        case LatencyStage::TOTAL:
+            return "total";
+
+        default:
+            return "";
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+void LatencyHistogram::record(uint32_t latency_us)
+{
+    _counts[bucket(latency_us)].fetch_add(1, std::memory_order_relaxed);
+    uint32_t max_us = _max_us.load(std::memory_order_relaxed);
+    while (latency_us > max_us && !_max_us.compare_exchange_weak(max_us, latency_us, std::memory_order_relaxed))
+    {}
+}
+
+void LatencyHistogram::clear()
+{
+    for (auto& count : _counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+    _max_us.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::add_to(Counts& counts, uint32_t& max_us) const
+{
+    for (int i = 0; i < N_BUCKETS; ++i)
+    {
+        counts[i] += _counts[i].load(std::memory_order_relaxed);
+    }
+    max_us = std::max(max_us, _max_us.load(std::memory_order_relaxed));
+}
+
+int LatencyHistogram::bucket(uint32_t latency_us)
+{
+    if (latency_us < LINEAR_BUCKETS)
+    {
+        return static_cast<int>(latency_us);
+    }
+    int exponent = 31 - __builtin_clz(latency_us);
+    if (exponent > MAX_EXPONENT)
+    {
+        return N_BUCKETS - 1;
+    }
+    int sub_bucket = (latency_us >> (exponent - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+    return LINEAR_BUCKETS + ((exponent - 4) << SUB_BUCKET_BITS) + sub_bucket;
+}
+
+uint32_t LatencyHistogram::bucket_upper_bound(int bucket)
+{
+    if (bucket < LINEAR_BUCKETS)
+    {
+        return static_cast<uint32_t>(bucket);
+    }
+    int exponent = ((bucket - LINEAR_BUCKETS) >> SUB_BUCKET_BITS) + 4;
+    uint32_t sub_bucket = (bucket - LINEAR_BUCKETS) & ((1 << SUB_BUCKET_BITS) - 1);
+    return (((1u << SUB_BUCKET_BITS) + sub_bucket + 1) << (exponent - SUB_BUCKET_BITS)) - 1;
+}
+
+uint32_t LatencyHistogram::percentile(const Counts& counts, uint64_t samples, int per_mille)
+{
+    if (samples == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = (samples * per_mille + 999) / 1000;
+    uint64_t seen = 0;
+    for (int i = 0; i < N_BUCKETS; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            return bucket_upper_bound(i);
+        }
+    }
+    return bucket_upper_bound(N_BUCKETS - 1);
+}
+
+LatencyMonitor::LatencyMonitor(int n_sensors, std::chrono::milliseconds window) :
+        _n_sensors(n_sensors),
+        _window(window),
+        _window_start(std::chrono::steady_clock::now()),
+        _histograms(new LatencyHistogram[N_WINDOWS * (n_sensors + 1) * N_LATENCY_STAGES])
+{}
+
+void LatencyMonitor::record(int sensor,
+                            std::chrono::steady_clock::time_point received,
+                            std::chrono::steady_clock::time_point dequeued,
+                            std::chrono::steady_clock::time_point mapped,
+                            std::chrono::steady_clock::time_point sent)
+{
+    if (sensor < 0 || sensor >= _n_sensors)
+    {
+        return;
+    }
+    constexpr std::chrono::steady_clock::time_point NOT_SET;
+    if (dequeued == NOT_SET)
+    {
+        dequeued = mapped;
+    }
+    if (received == NOT_SET)
+    {
+        received = dequeued;
+    }
+    auto to_us = [](std::chrono::steady_clock::duration d)
+    {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        return static_cast<uint32_t>(std::clamp<int64_t>(us, 0, std::numeric_limits<uint32_t>::max()));
+    };
+    const std::array<uint32_t, N_LATENCY_STAGES> latencies = {to_us(dequeued - received),
+                                                               to_us(mapped - dequeued),
+                                                               to_us(sent - mapped),
+                                                               to_us(sent - received)};
+    int window = _current_window.load(std::memory_order_relaxed);
+    for (int stage = 0; stage < N_LATENCY_STAGES; ++stage)
+    {
+        _histogram(window, ALL_SENSORS, static_cast<LatencyStage>(stage)).record(latencies[stage]);
+        _histogram(window, sensor, static_cast<LatencyStage>(stage)).record(latencies[stage]);
+    }
+}
+
+LatencySummary LatencyMonitor::summary(LatencyStage stage, int sensor) const
+{
+    LatencySummary summary{};
+    if (sensor < ALL_SENSORS || sensor >= _n_sensors)
+    {
+        return summary;
+    }
+    LatencyHistogram::Counts counts{};
+    uint32_t max_us = 0;
+    for (int window = 0; window < N_WINDOWS; ++window)
+    {
+        _histogram(window, sensor, stage).add_to(counts, max_us);
+    }
+    for (auto count : counts)
+    {
+        summary.samples += count;
+    }
+    /* The bucket bounds can be above the highest latency actually recorded */
+    auto percentile = [&](int per_mille)
+    {
+        return std::chrono::microseconds(std::min(LatencyHistogram::percentile(counts, summary.samples, per_mille), max_us));
+    };
+    summary.p50 = percentile(500);
+    summary.p99 = percentile(990);
+    summary.p999 = percentile(999);
+    summary.max = std::chrono::microseconds(max_us);
+    return summary;
+}
+
+bool LatencyMonitor::rotate_if_due(std::chrono::steady_clock::time_point now)
+{
+    if (now - _window_start < _window)
+    {
+        return false;
+    }
+    int next_window = (_current_window.load(std::memory_order_relaxed) + 1) % N_WINDOWS;
+    for (int sensor = ALL_SENSORS; sensor < _n_sensors; ++sensor)
+    {
+        for (int stage = 0; stage < N_LATENCY_STAGES; ++stage)
+        {
+            _histogram(next_window, sensor, static_cast<LatencyStage>(stage)).clear();
+        }
+    }
+    _current_window.store(next_window, std::memory_order_relaxed);
+    _window_start = now;
+    return true;
+}
+
+LatencyHistogram& LatencyMonitor::_histogram(int window, int sensor, LatencyStage stage) const
+{
+    int index = (window * (_n_sensors + 1) + sensor + 1) * N_LATENCY_STAGES + static_cast<int>(stage);
+    return _histograms[index];
+}
+
+} // namespace sensei
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Latency of values from the board to the output backend, in
+ *        histograms per sensor and for all sensors
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Values are timestamped when their packet is received from the board, when
+ * the event loop takes them from its queue, when they are handed to the output
+ * backend after mapping and when the output backend has sent them. The time
+ * between these points is recorded in log linear histograms with relaxed
+ * atomic counters, so recording never blocks. The histograms are kept for two
+ * consecutive windows, summaries cover the current and the previous window.
+ */
+#ifndef SENSEI_LATENCY_MONITOR_H
+#define SENSEI_LATENCY_MONITOR_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace sensei {
+
+enum class LatencyStage : int
+{
+    QUEUE = 0,  /* From receiving the packet until the event loop takes the value */
+    MAPPING,    /* From there until the mapped value is handed to the output backend */
+    OUTPUT,     /* Sending the value from the output backend */
+    TOTAL,      /* From receiving the packet until the value is sent */
+    N_STAGES
+};
+
+constexpr int N_LATENCY_STAGES = static_cast<int>(LatencyStage::N_STAGES);
+
+const char* latency_stage_name(LatencyStage stage);
+
+struct LatencySummary
+{
+    uint64_t samples;
+    std::chrono::microseconds p50;
+    std::chrono::microseconds p99;
+    std::chrono::microseconds p999;
+    std::chrono::microseconds max;
+};
+
+/**
+ * @brief Histogram of latencies in microseconds. Exact below 16 us, above that
+ *        every power of 2 is split into 8 buckets, so values are reported at most
+ *        12.5% too high. Latencies above ~2 minutes all go in the last bucket.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int LINEAR_BUCKETS = 16;
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int MAX_EXPONENT = 26;
+    static constexpr int N_BUCKETS = LINEAR_BUCKETS + (MAX_EXPONENT - 3) * (1 << SUB_BUCKET_BITS);
+
+    using Counts = std::array<uint64_t, N_BUCKETS>;
+
+    LatencyHistogram();
+
+    /**
+     * @brief Record a latency, safe to call from several threads
+     */
+    void record(uint32_t latency_us);
+
+    /**
+     * @brief Reset all counters. Latencies recorded meanwhile may be lost
+     */
+    void clear();
+
+    /**
+     * @brief Add the counts and max of this histogram to those given
+     */
+    void add_to(Counts& counts, uint32_t& max_us) const;
+
+    static int bucket(uint32_t latency_us);
+
+    /**
+     * @brief Highest latency that goes in the given bucket
+     */
+    static uint32_t bucket_upper_bound(int bucket);
+
+    /**
+     * @brief Latency under which the given fraction in per mille of the samples are
+     */
+    static uint32_t percentile(const Counts& counts, uint64_t samples, int per_mille);
+
+private:
+    std::array<std::atomic<uint32_t>, N_BUCKETS> _counts;
+    std::atomic<uint32_t> _max_us;
+};
+
+class LatencyMonitor
+{
+public:
+    static constexpr int ALL_SENSORS = -1;
+
+    /**
+     * @brief Create a monitor for sensor indexes from 0 to n_sensors - 1
+     *
+     * @param [in] n_sensors Number of sensors with their own histograms
+     * @param [in] window Length of a window, summaries cover between 1 and 2 windows
+     */
+    LatencyMonitor(int n_sensors, std::chrono::milliseconds window);
+
+    /**
+     * @brief Record the latencies of a value sent by the output backend, safe to
+     *        call from several threads. Time points that were never set are taken
+     *        to be equal to the next one.
+     *
+     * @param [in] sensor Index of the sensor of the value
+     * @param [in] received When its packet was received from the board
+     * @param [in] dequeued When the event loop took it from its queue
+     * @param [in] mapped When the mapped value was handed to the output backend
+     * @param [in] sent When the output backend had sent it
+     */
+    void record(int sensor,
+                std::chrono::steady_clock::time_point received,
+                std::chrono::steady_clock::time_point dequeued,
+                std::chrono::steady_clock::time_point mapped,
+                std::chrono::steady_clock::time_point sent);
+
+    /**
+     * @brief Summarize the latencies of the current and previous window
+     *
+     * @param [in] stage The stage to summarize
+     * @param [in] sensor Index of the sensor, or ALL_SENSORS
+     */
+    LatencySummary summary(LatencyStage stage, int sensor = ALL_SENSORS) const;
+
+    /**
+     * @brief Start a new window if the current one is over, dropping the
+     *        oldest. Only to be called from one thread.
+     * @return true if a new window was started
+     */
+    bool rotate_if_due(std::chrono::steady_clock::time_point now);
+
+    int n_sensors() const
+    {
+        return _n_sensors;
+    }
+
+private:
+    LatencyHistogram& _histogram(int window, int sensor, LatencyStage stage) const;
+
+    int _n_sensors;
+    std::chrono::milliseconds _window;
+    std::chrono::steady_clock::time_point _window_start;
+    std::atomic<int> _current_window{0};
+    /* For each of the 2 windows, the histograms of all sensors then of each sensor, one per stage */
+    std::unique_ptr<LatencyHistogram[]> _histograms;
+};
+
+} // namespace sensei
+
+#endif //SENSEI_LATENCY_MONITOR_H
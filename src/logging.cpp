@@ -34,8 +34,15 @@
 #include "logging.h"
 #ifndef DISABLE_LOGGING
 
+#include <atomic>
+
 namespace sensei {
 
+namespace {
+std::atomic<bool> worker_thread_started{false};
+pthread_t worker_thread_handle;
+}
+
 std::shared_ptr<spdlog::logger> Logger::get_logger()
 {
     /*
@@ -50,6 +57,16 @@ std::shared_ptr<spdlog::logger> Logger::get_logger()
     return spdlog_instance;
 }
 
+bool Logger::worker_thread(pthread_t& thread)
+{
+    if (worker_thread_started.load() == false)
+    {
+        return false;
+    }
+    thread = worker_thread_handle;
+    return true;
+}
+
 std::shared_ptr<spdlog::logger> setup_logging()
 {
     /*
@@ -65,7 +82,12 @@ std::shared_ptr<spdlog::logger> setup_logging()
 
     spdlog::set_level(MIN_LOG_LEVEL);
     spdlog::set_pattern("[%Y-%m-%d %T.%e] [%l] %v");
-    spdlog::set_async_mode(LOGGER_QUEUE_SIZE);
+    /* Remember the worker thread so its scheduling can be configured later */
+    spdlog::set_async_mode(LOGGER_QUEUE_SIZE, spdlog::async_overflow_policy::block_retry, []()
+    {
+        worker_thread_handle = pthread_self();
+        worker_thread_started.store(true);
+    });
     auto async_file_logger = spdlog::rotating_logger_mt(LOGGER_NAME,
                                                         LOGGER_FILE,
                                                         MAX_LOG_FILE_SIZE,
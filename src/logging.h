@@ -35,6 +35,7 @@
 #define SENSEI_LOGGING_H
 
 #include <iostream>
+#include <pthread.h>
 
 /* Sensei log macros */
 #ifndef DISABLE_LOGGING
@@ -83,6 +84,13 @@ class Logger
 {
 public:
     static std::shared_ptr<spdlog::logger> get_logger();
+
+    /**
+     * @brief Get the handle of the async logging thread
+     * @param [out] thread The handle of the thread, if started
+     * @return true if the logging thread has started
+     */
+    static bool worker_thread(pthread_t& thread);
 };
 
 std::shared_ptr<spdlog::logger> setup_logging();
@@ -103,6 +111,19 @@ std::shared_ptr<spdlog::logger> setup_logging();
 #define SENSEI_LOG_WARNING_IF(...)
 #define SENSEI_LOG_ERROR_IF(...)
 #define SENSEI_LOG_CRITICAL_IF(...)
+
+namespace sensei {
+
+class Logger
+{
+public:
+    static bool worker_thread(pthread_t& /*thread*/)
+    {
+        return false;
+    }
+};
+
+} // end namespace sensei
 #endif
 
 #endif //SENSEI_LOGGING_H
\ No newline at end of file
@@ -21,10 +21,12 @@
 #include <fstream>
 #include <csignal>
 #include <cassert>
+#include <iomanip>
 
 #include "optionparser.h"
 
 #include "event_handler.h"
+#include "thread_scheduling.h"
 #include "logging.h"
 #include "generated/version.h"
 
@@ -66,6 +68,28 @@ void print_version_and_build_info()
     std::cout << "Built on: " << SENSEI_BUILD_TIMESTAMP << std::endl;
 }
 
+void print_benchmark_report(const sensei::BenchmarkStatistics& stats, std::chrono::steady_clock::duration run_time)
+{
+    double seconds = std::chrono::duration<double>(run_time).count();
+    auto to_us = [](std::chrono::nanoseconds time) {return time.count() / 1000.0;};
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "\nBenchmark report, " << seconds << " s" << std::endl;
+    std::cout << "Throughput: " << stats.values / seconds << " values/s, "
+              << stats.commands / seconds << " commands/s (" << stats.values << " values, "
+              << stats.commands << " commands)" << std::endl;
+    std::cout << "Max queue depth: events " << stats.max_event_queue_depth
+              << ", hw commands " << stats.max_hw_queue_depth << std::endl;
+    std::cout << "Value latency (us): p50 " << to_us(stats.latency_p50) << ", p90 " << to_us(stats.latency_p90)
+              << ", p99 " << to_us(stats.latency_p99) << ", max " << to_us(stats.latency_max) << std::endl;
+    std::cout << "Cpu time per thread since it started:" << std::endl;
+    for (const auto& thread : sensei::thread_cpu_times())
+    {
+        double cpu_seconds = std::chrono::duration<double>(thread.cpu_time).count();
+        std::cout << "  " << std::left << std::setw(20) << thread.name << std::right << std::setprecision(3)
+                  << cpu_seconds << " s (" << std::setprecision(1) << 100.0 * cpu_seconds / seconds << " %)" << std::endl;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Signal handlers
 ////////////////////////////////////////////////////////////////////////////////
@@ -153,7 +177,8 @@ enum OptionIndex
     N_INPUT_PINS,
     N_OUTPUT_PINS,
     SLEEP_PERIOD,
-    CONFIG_FILENAME
+    CONFIG_FILENAME,
+    BENCHMARK
 };
 
 const option::Descriptor usage[] =
@@ -214,6 +239,15 @@ const option::Descriptor usage[] =
         SenseiArg::NonEmpty,
         "\t\t-f <file>, --file=<file> \tSpecify JSON configuration file [default=" SENSEI_DEFAULT_CONFIG_FILENAME "]."
     },
+    {
+        BENCHMARK,
+        0,
+        "b",
+        "benchmark",
+        SenseiArg::Numeric,
+        "\t\t-b <seconds>, --benchmark=<seconds> \tRun for the given time, then print throughput, queue depths, "
+        "latency percentiles and cpu time per thread and exit."
+    },
     { 0, 0, 0, 0, 0, 0}
 };
 
@@ -262,6 +296,7 @@ int main(int argc, char* argv[])
     int n_output_pins = SENSEI_DEFAULT_N_OUTPUT_PINS;
     std::chrono::milliseconds wait_period_ms{SENSEI_DEFAULT_WAIT_PERIOD_MS};
     std::string config_filename = std::string(SENSEI_DEFAULT_CONFIG_FILENAME);
+    std::chrono::seconds benchmark_time{0};
     for (int i=0; i<cl_parser.optionsCount(); i++)
     {
         option::Option& opt = cl_buffer[i];
@@ -317,6 +352,18 @@ int main(int argc, char* argv[])
             config_filename.assign(opt.arg);
             break;
 
+        case BENCHMARK:
+            {
+                int parsed_int = atoi(opt.arg);
+                if (parsed_int <= 0)
+                {
+                    SenseiArg::print_error("Option '", opt, "' invalid number\n");
+                    return 1;
+                }
+                benchmark_time = std::chrono::seconds(parsed_int);
+            }
+            break;
+
         default:
             SenseiArg::print_error("Unhandled option '", opt, "' \n");
             break;
@@ -353,6 +400,9 @@ int main(int argc, char* argv[])
     ////////////////////////////////////////////////////////////////////////////////
 
     SENSEI_LOG_INFO("Starting  main loop");
+    bool benchmark = benchmark_time.count() > 0;
+    event_handler.enable_benchmark(benchmark);
+    auto start_time = std::chrono::steady_clock::now();
     while (main_loop_running)
     {
         event_handler.handle_events(wait_period_ms);
@@ -361,6 +411,15 @@ int main(int argc, char* argv[])
             event_handler.reload_config();
             config_reload_pending = 0;
         }
+        if (benchmark && std::chrono::steady_clock::now() - start_time >= benchmark_time)
+        {
+            break;
+        }
+    }
+    if (benchmark)
+    {
+        // Before deinit, while all the threads are still running
+        print_benchmark_report(event_handler.benchmark_statistics(), std::chrono::steady_clock::now() - start_time);
     }
 
     ////////////////////////////////////////////////////////////////////////////////
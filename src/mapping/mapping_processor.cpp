@@ -33,6 +33,14 @@ MappingProcessor::MappingProcessor(int max_no_sensors) :
 {
     _mappers.resize(_max_no_sensors);
     std::fill(_mappers.begin(), _mappers.end(), nullptr);
+    _dropped_values_metric = metrics::registry().counter("sensei_mapper_dropped_values_total",
+                                                         "Values from the board that the mapping dropped");
+    for (int i = 0; i < _max_no_sensors; ++i)
+    {
+        _value_metrics.push_back(metrics::registry().counter("sensei_sensor_values_total",
+                                                             "Values received from the board per sensor",
+                                                             metrics::label("sensor", i)));
+    }
 }
 
 CommandErrorCode MappingProcessor::apply_command(const Command *cmd)
@@ -104,9 +112,37 @@ void MappingProcessor::put_config_commands_into(CommandIterator out_iterator)
     }
 }
 
+void MappingProcessor::put_config_commands_into(const std::vector<int>& sensor_indexes, CommandIterator out_iterator)
+{
+    if (sensor_indexes.empty())
+    {
+        put_config_commands_into(out_iterator);
+        return;
+    }
+    for (auto sensor_index : sensor_indexes)
+    {
+        if ((sensor_index < 0) || (sensor_index > (_max_no_sensors-1)))
+        {
+            SENSEI_LOG_WARNING("Got config query for invalid sensor {}", sensor_index);
+            continue;
+        }
+        if (_mappers[sensor_index] != nullptr)
+        {
+            _mappers[sensor_index]->put_config_commands_into(out_iterator);
+        }
+    }
+}
+
 void MappingProcessor::process(Value *value, output_backend::OutputBackend *backend)
 {
     int sensor_index = value->index();
+    if (sensor_index < 0 || static_cast<unsigned int>(sensor_index) >= _mappers.size())
+    {
+        SENSEI_LOG_ERROR("Got value message for invalid sensor {}", sensor_index);
+        _dropped_values_metric->increment();
+        return;
+    }
+    _value_metrics[sensor_index]->increment();
     if (_mappers[sensor_index] != nullptr)
     {
         _mappers[sensor_index]->process(value, backend);
@@ -114,19 +150,76 @@ void MappingProcessor::process(Value *value, output_backend::OutputBackend *back
     else
     {
         SENSEI_LOG_ERROR("Got value message for uninitialized sensor {}", value->index());
+        _dropped_values_metric->increment();
     }
 }
 
-std::unique_ptr<Command> MappingProcessor::process_set(Value* value)
+void MappingProcessor::process_set(Value* value, std::vector<std::unique_ptr<Command>>& out_commands)
 {
+    if (value->type() == ValueType::FLOAT_SET_BATCH)
+    {
+        for (const auto& update : static_cast<FloatSetBatchValue*>(value)->values())
+        {
+            if (static_cast<unsigned int>(update.index) < _mappers.size() && _mappers[update.index] != nullptr)
+            {
+                auto cmd = _mappers[update.index]->process_float_set_value(update.value);
+                if (cmd != nullptr)
+                {
+                    out_commands.push_back(std::move(cmd));
+                }
+            }
+            else
+            {
+                SENSEI_LOG_ERROR("Got set value for uninitialized sensor {} in batch", update.index);
+            }
+        }
+        return;
+    }
+
     int sensor_index = value->index();
     if (static_cast<unsigned int>(sensor_index) < _mappers.size() && _mappers[sensor_index] != nullptr)
     {
-        return _mappers[sensor_index]->process_set_value(value);
+        auto cmd = _mappers[sensor_index]->process_set_value(value);
+        if (cmd != nullptr)
+        {
+            out_commands.push_back(std::move(cmd));
+        }
     }
     else
     {
         SENSEI_LOG_ERROR("Got set value message for uninitialized sensor {}", value->index());
-        return nullptr;
     }
-}
\ No newline at end of file
+}
+
+void MappingProcessor::put_cached_values_into(const std::vector<int>& sensor_indexes, CommandIterator out_iterator)
+{
+    MessageFactory factory;
+    auto put_value = [&](int sensor_index)
+    {
+        float value;
+        uint32_t timestamp;
+        auto& mapper = _mappers[sensor_index];
+        if (mapper != nullptr && mapper->cached_value(value, timestamp))
+        {
+            *out_iterator = factory.make_output_value(sensor_index, value, timestamp);
+        }
+    };
+
+    if (sensor_indexes.empty())
+    {
+        for (int i = 0; i < _max_no_sensors; ++i)
+        {
+            put_value(i);
+        }
+        return;
+    }
+    for (auto sensor_index : sensor_indexes)
+    {
+        if ((sensor_index < 0) || (sensor_index > (_max_no_sensors-1)))
+        {
+            SENSEI_LOG_WARNING("Got value query for invalid sensor {}", sensor_index);
+            continue;
+        }
+        put_value(sensor_index);
+    }
+}
@@ -39,13 +39,40 @@ public:
 
     void put_config_commands_into(CommandIterator out_iterator);
 
+    /**
+     * @brief Fill the given container with the configuration commands of a set of sensors.
+     *
+     * @param [in] sensor_indexes Sensors to include, all sensors if empty
+     * @param [out] out_iterator back_inserter operator to output container to be filled
+     */
+    void put_config_commands_into(const std::vector<int>& sensor_indexes, CommandIterator out_iterator);
+
     void process(Value* value, output_backend::OutputBackend* backend);
 
-    std::unique_ptr<Command> process_set(Value* value);
+    /**
+     * @brief Map a set value from a user frontend to output commands for the hw frontend.
+     *        All the values of a FloatSetBatchValue are mapped in a single call.
+     *
+     * @param [in] value Set value, or batch of set values
+     * @param [out] out_commands Container to which the resulting commands are appended
+     */
+    void process_set(Value* value, std::vector<std::unique_ptr<Command>>& out_commands);
+
+    /**
+     * @brief Fill the given container with the latest mapped value of each sensor as OutputValues.
+     *        Sensors that haven't produced a value yet are skipped.
+     *
+     * @param [in] sensor_indexes Sensors to include, all sensors if empty
+     * @param [out] out_iterator back_inserter operator to output container to be filled
+     */
+    void put_cached_values_into(const std::vector<int>& sensor_indexes, CommandIterator out_iterator);
 
 private:
     int _max_no_sensors;
     std::vector<std::unique_ptr<BaseSensorMapper>> _mappers;
+    /* Values received per sensor, for their rates */
+    std::vector<metrics::Counter*> _value_metrics;
+    metrics::Counter* _dropped_values_metric;
 };
 
 } // namespace mapping
@@ -57,7 +57,12 @@ BaseSensorMapper::BaseSensorMapper(SensorType type, int index) :
     _delta_ticks_sending(1),
     _previous_value(0.0f),
     _invert_value(false),
-    _send_timestamp(false)
+    _send_timestamp(false),
+    _cached_value(0.0f),
+    _cached_timestamp(0),
+    _has_cached_value(false),
+    _dropped_values_metric(metrics::registry().counter("sensei_mapper_dropped_values_total",
+                                                       "Values from the board that the mapping dropped"))
 {}
 
 CommandErrorCode BaseSensorMapper::apply_command(const Command *cmd)
@@ -171,6 +176,31 @@ void BaseSensorMapper::put_config_commands_into(CommandIterator out_iterator)
     }
 }
 
+bool BaseSensorMapper::cached_value(float& value, uint32_t& timestamp) const
+{
+    value = _cached_value;
+    timestamp = _cached_timestamp;
+    return _has_cached_value;
+}
+
+void BaseSensorMapper::_output_value(float out_val, Value* raw_value, output_backend::OutputBackend* backend)
+{
+    _cached_value = out_val;
+    _cached_timestamp = _send_timestamp? raw_value->timestamp() : 0;
+    _has_cached_value = true;
+    if (_sending_mode == SendingMode::ON_REQUEST)
+    {
+        return;
+    }
+
+    MessageFactory factory;
+    // Use temporary variable here, since if the factory method is created inside the temporary rvalue expression
+    // it gets optimized away by the compiler in release mode
+    auto temp_msg = factory.make_output_value(_sensor_index, out_val, _cached_timestamp);
+    auto transformed_value = static_cast<OutputValue*>(temp_msg.get());
+    backend->send(transformed_value, raw_value);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // DigitalSensorMapper
 ////////////////////////////////////////////////////////////////////////////////
@@ -219,6 +249,7 @@ void DigitalSensorMapper::process(Value *value, output_backend::OutputBackend *b
 {
     if (! _enabled)
     {
+        _dropped_values_metric->increment();
         return;
     }
     bool digital_val;
@@ -232,6 +263,7 @@ void DigitalSensorMapper::process(Value *value, output_backend::OutputBackend *b
     }
     else
     {
+        _dropped_values_metric->increment();
         return;
     }
     float out_val = digital_val? 1.0f : 0.0f;
@@ -241,42 +273,39 @@ void DigitalSensorMapper::process(Value *value, output_backend::OutputBackend *b
     }
 
     // Don't check for previous value changed on digital pins
-
-    MessageFactory factory;
-    // Use temporary variable here, since if the factory method is created inside the temporary rvalue expression
-    // it gets optimized away by the compiler in release mode
-    auto temp_msg = factory.make_output_value(_sensor_index,
-                                              out_val,
-                                              _send_timestamp? value->timestamp() : 0);
-    auto transformed_value = static_cast<OutputValue*>(temp_msg.get());
-    backend->send(transformed_value, value);
+    _output_value(out_val, value, backend);
 }
 
 std::unique_ptr<Command> DigitalSensorMapper::process_set_value(Value*value)
 {
-    bool out_val;
-    if (!_enabled)
+    if (value->type() == ValueType::FLOAT_SET)
+    {
+        return process_float_set_value(static_cast<FloatSetValue*>(value)->value());
+    }
+    if (!_enabled || value->type() != ValueType::INT_SET)
     {
         return nullptr;
     }
-    switch (value->type())
+    bool out_val = static_cast<IntegerSetValue*>(value)->value() > 0;
+    if (_invert_value)
     {
-        case ValueType::INT_SET:
-            out_val = static_cast<IntegerSetValue*>(value)->value() > 0;
-            break;
-
-        case ValueType::FLOAT_SET:
-            out_val = static_cast<FloatSetValue*>(value)->value() > 0.5f;
-            break;
+        out_val = !out_val;
+    }
+    return static_unique_ptr_cast<Command, BaseMessage>(_factory.make_set_digital_output_command(_sensor_index, out_val));
+}
 
-        default:
-            return nullptr;
+std::unique_ptr<Command> DigitalSensorMapper::process_float_set_value(float value)
+{
+    if (!_enabled)
+    {
+        return nullptr;
     }
+    bool out_val = value > 0.5f;
     if (_invert_value)
     {
         out_val = !out_val;
     }
-    return static_unique_ptr_cast<Command, BaseMessage>(_factory.make_set_digital_output_command(value->index(), out_val));
+    return static_unique_ptr_cast<Command, BaseMessage>(_factory.make_set_digital_output_command(_sensor_index, out_val));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -383,6 +412,7 @@ void AnalogSensorMapper::process(Value* value, output_backend::OutputBackend* ba
 {
     if (! _enabled)
     {
+        _dropped_values_metric->increment();
         return;
     }
     assert(value->type() == ValueType::ANALOG);
@@ -395,43 +425,36 @@ void AnalogSensorMapper::process(Value* value, output_backend::OutputBackend* ba
     {
         out_val = 1.0f - out_val;
     }
-    if ((_sending_mode == SendingMode::ON_VALUE_CHANGED) && (fabsf(out_val - _previous_value) > PREVIOUS_VALUE_THRESHOLD))
+    bool send_on_change = (_sending_mode == SendingMode::ON_VALUE_CHANGED) || (_sending_mode == SendingMode::ON_REQUEST);
+    if (send_on_change && (fabsf(out_val - _previous_value) > PREVIOUS_VALUE_THRESHOLD))
     {
-        MessageFactory factory;
-        // Use temporary variable here, since if the factory method is created inside the temporary rvalue expression
-        // it gets optimized away by the compiler in release mode
-        auto temp_msg = factory.make_output_value(_sensor_index,
-                                                  out_val,
-                                                  _send_timestamp? value->timestamp() : 0);
-        auto transformed_value = static_cast<OutputValue*>(temp_msg.get());
-        backend->send(transformed_value, value);
+        _output_value(out_val, value, backend);
         _previous_value = out_val;
     }
 }
 
 std::unique_ptr<Command> AnalogSensorMapper::process_set_value(Value*value)
 {
-    if (!_enabled)
+    if (value->type() != ValueType::FLOAT_SET)
     {
         return nullptr;
     }
-    float out_val;
-    switch (value->type())
-    {
-        case ValueType::FLOAT_SET:
-            out_val = static_cast<FloatSetValue*>(value)->value();
-            break;
+    return process_float_set_value(static_cast<FloatSetValue*>(value)->value());
+}
 
-        default:
-            return nullptr;
+std::unique_ptr<Command> AnalogSensorMapper::process_float_set_value(float value)
+{
+    if (!_enabled)
+    {
+        return nullptr;
     }
-    out_val = clip<float>(out_val, 0.0f, 1.0f);
+    float out_val = clip<float>(value, 0.0f, 1.0f);
     if (_invert_value)
     {
         out_val = 1.0f - out_val;
     }
     out_val = out_val * (_input_scale_range_high - _input_scale_range_low) + _input_scale_range_low;
-    return static_unique_ptr_cast<Command, BaseMessage>(_factory.make_set_range_output_command(value->index(), out_val));
+    return static_unique_ptr_cast<Command, BaseMessage>(_factory.make_set_range_output_command(_sensor_index, out_val));
 }
 
 CommandErrorCode AnalogSensorMapper::_set_sensor_hw_type(SensorHwType hw_type)
@@ -567,6 +590,7 @@ void RangeSensorMapper::process(Value*value, output_backend::OutputBackend*backe
 {
     if (! _enabled)
     {
+        _dropped_values_metric->increment();
         return;
     }
     assert(value->type() == ValueType::ANALOG);
@@ -580,45 +604,42 @@ void RangeSensorMapper::process(Value*value, output_backend::OutputBackend*backe
     }
     if (out_val != _previous_int_value)
     {
-        MessageFactory factory;
-        // Use temporary variable here, since if the factory method is created inside the temporary rvalue expression
-        // it gets optimized away by the compiler in release mode
-        auto temp_msg = factory.make_output_value(_sensor_index,
-                                                  out_val,
-                                                  _send_timestamp? value->timestamp() : 0);
-        auto transformed_value = static_cast<OutputValue*>(temp_msg.get());
-        backend->send(transformed_value, value);
+        _output_value(out_val, value, backend);
         _previous_int_value = out_val;
     }
 }
 
 std::unique_ptr<Command> RangeSensorMapper::process_set_value(Value*value)
 {
-    if (!_enabled)
+    if (value->type() == ValueType::FLOAT_SET)
     {
-        return nullptr;
+        return process_float_set_value(static_cast<FloatSetValue*>(value)->value());
     }
-    int out_val;
-    switch (value->type())
+    if (!_enabled || value->type() != ValueType::INT_SET)
     {
-        case ValueType::INT_SET:
-            out_val = static_cast<IntegerSetValue*>(value)->value();
-            break;
-
-        case ValueType::FLOAT_SET:
-            out_val = static_cast<int>(std::round(static_cast<FloatSetValue*>(value)->value()));
-            break;
+        return nullptr;
+    }
+    return _make_set_command(static_cast<IntegerSetValue*>(value)->value());
+}
 
-        default:
-            return nullptr;
+std::unique_ptr<Command> RangeSensorMapper::process_float_set_value(float value)
+{
+    if (!_enabled)
+    {
+        return nullptr;
     }
-    out_val = clip<int>(out_val, _input_scale_range_low, _input_scale_range_high);
+    return _make_set_command(static_cast<int>(std::round(value)));
+}
+
+std::unique_ptr<Command> RangeSensorMapper::_make_set_command(int value)
+{
+    int out_val = clip<int>(value, _input_scale_range_low, _input_scale_range_high);
     if (_invert_value)
     {
         out_val = _input_scale_range_high - out_val;
     }
     return static_unique_ptr_cast<Command, BaseMessage>(
-            _factory.make_set_range_output_command(value->index(), out_val));
+            _factory.make_set_range_output_command(_sensor_index, out_val));
 }
 
 CommandErrorCode RangeSensorMapper::_set_sensor_hw_type(SensorHwType hw_type)
@@ -701,6 +722,7 @@ void ContinuousSensorMapper::process(Value *value, output_backend::OutputBackend
 {
     if (! _enabled)
     {
+        _dropped_values_metric->increment();
         return;
     }
     assert(value->type() == ValueType::CONTINUOUS);
@@ -715,41 +737,33 @@ void ContinuousSensorMapper::process(Value *value, output_backend::OutputBackend
     }
     if (fabsf(out_val - _previous_value) > PREVIOUS_VALUE_THRESHOLD)
     {
-        MessageFactory factory;
-        // Use temporary variable here, since if the factory method is created inside the temporary rvalue expression
-        // it gets optimized away by the compiler in release mode
-        auto temp_msg = factory.make_output_value(_sensor_index,
-                                                  out_val,
-                                                  _send_timestamp? value->timestamp() : 0);
-        auto transformed_value = static_cast<OutputValue*>(temp_msg.get());
-        backend->send(transformed_value, value);
+        _output_value(out_val, value, backend);
         _previous_value = out_val;
     }
 }
 
 std::unique_ptr<Command> ContinuousSensorMapper::process_set_value(Value*value)
 {
-    if (!_enabled)
+    if (value->type() != ValueType::FLOAT_SET)
     {
         return nullptr;
     }
-    float out_val;
-    switch (value->type())
-    {
-        case ValueType::FLOAT_SET:
-            out_val = static_cast<FloatSetValue*>(value)->value();
-            break;
+    return process_float_set_value(static_cast<FloatSetValue*>(value)->value());
+}
 
-        default:
-            return nullptr;
+std::unique_ptr<Command> ContinuousSensorMapper::process_float_set_value(float value)
+{
+    if (!_enabled)
+    {
+        return nullptr;
     }
-    out_val = clip<float>(out_val, 0.0f, 1.0f);
+    float out_val = clip<float>(value, 0.0f, 1.0f);
     if (_invert_value)
     {
         out_val = 1.0f - out_val;
     }
     out_val = out_val * (_input_scale_range_high - _input_scale_range_low) + _input_scale_range_low;
-    return static_unique_ptr_cast<Command, BaseMessage>(_factory.make_set_continuous_output_command(value->index(), out_val));
+    return static_unique_ptr_cast<Command, BaseMessage>(_factory.make_set_continuous_output_command(_sensor_index, out_val));
 
 }
 
@@ -28,6 +28,7 @@
 #include "output_backend/output_backend.h"
 #include "message/command_defs.h"
 #include "message/message_factory.h"
+#include "metrics.h"
 
 namespace sensei {
 namespace mapping {
@@ -86,7 +87,32 @@ public:
      */
     virtual std::unique_ptr<Command> process_set_value(Value *value) = 0;
 
+    /**
+     * @brief Same as process_set_value() for a float value, used for values
+     *        that are part of a batch
+     * @param [in] value Output value, normalised to a [0, 1] range
+     * @return A set value command to be sent to a hw frontend
+     */
+    virtual std::unique_ptr<Command> process_float_set_value(float value) = 0;
+
+    /**
+     * @brief Get the latest mapped value of the sensor. This is kept up to date
+     *        also when the sensor doesn't send its values (i.e. ON_REQUEST mode)
+     *
+     * @param [out] value     Latest mapped value
+     * @param [out] timestamp Timestamp of the value, 0 if timestamps are not enabled
+     *
+     * @return true if the sensor has produced a value since it was configured
+     */
+    bool cached_value(float& value, uint32_t& timestamp) const;
+
 protected:
+    /**
+     * @brief Store a new mapped value and send it to the backend,
+     *        unless the sensor only sends values on request
+     */
+    void _output_value(float out_val, Value* raw_value, output_backend::OutputBackend* backend);
+
     MessageFactory      _factory;
     SensorType          _sensor_type;
     SensorHwType        _hw_type;
@@ -102,6 +128,13 @@ protected:
     bool                _invert_value;
     bool                _send_timestamp;
     bool                _fast_mode;
+
+    float               _cached_value;
+    uint32_t            _cached_timestamp;
+    bool                _has_cached_value;
+
+    /* Values dropped because the sensor is disabled or they are of the wrong type */
+    metrics::Counter*   _dropped_values_metric;
 };
 
 /**
@@ -124,6 +157,8 @@ public:
 
     virtual std::unique_ptr<Command> process_set_value(Value *value) override;
 
+    virtual std::unique_ptr<Command> process_float_set_value(float value) override;
+
 private:
 
 };
@@ -149,6 +184,8 @@ public:
 
     virtual std::unique_ptr<Command> process_set_value(Value *value) override;
 
+    virtual std::unique_ptr<Command> process_float_set_value(float value) override;
+
 private:
     CommandErrorCode _set_sensor_hw_type(SensorHwType hw_type);
     CommandErrorCode _set_adc_bit_resolution(int resolution);
@@ -192,9 +229,12 @@ public:
 
     virtual std::unique_ptr<Command> process_set_value(Value *value) override;
 
+    virtual std::unique_ptr<Command> process_float_set_value(float value) override;
+
 private:
     CommandErrorCode _set_sensor_hw_type(SensorHwType hw_type);
     CommandErrorCode _set_input_scale_range(int low, int high);
+    std::unique_ptr<Command> _make_set_command(int value);
 
     // Mapping parameters
     int _input_scale_range_low;
@@ -224,6 +264,8 @@ public:
 
     virtual std::unique_ptr<Command> process_set_value(Value *value) override;
 
+    virtual std::unique_ptr<Command> process_float_set_value(float value) override;
+
 private:
     CommandErrorCode _set_input_scale_range(float low, float high);
 
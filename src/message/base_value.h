@@ -25,6 +25,8 @@
 #ifndef SENSEI_BASE_VALUE_H
 #define SENSEI_BASE_VALUE_H
 
+#include <chrono>
+
 #include "message/base_message.h"
 
 namespace sensei {
@@ -54,6 +56,31 @@ public:
         return _type;
     }
 
+    /**
+     * @brief Local times when the value was received from the board and when
+     *        the event loop took it from its queue, for latency monitoring.
+     *        Left at the clock's epoch when not set.
+     */
+    std::chrono::steady_clock::time_point receive_time() const
+    {
+        return _receive_time;
+    }
+
+    void set_receive_time(std::chrono::steady_clock::time_point time)
+    {
+        _receive_time = time;
+    }
+
+    std::chrono::steady_clock::time_point dequeue_time() const
+    {
+        return _dequeue_time;
+    }
+
+    void set_dequeue_time(std::chrono::steady_clock::time_point time)
+    {
+        _dequeue_time = time;
+    }
+
 protected:
     Value(const int sensor_index,
           const ValueType type,
@@ -64,6 +91,8 @@ protected:
     }
 
     ValueType _type;
+    std::chrono::steady_clock::time_point _receive_time;
+    std::chrono::steady_clock::time_point _dequeue_time;
 };
 
 #define SENSEI_DECLARE_VALUE(ClassName, value_type, InternalType, representation_prefix) \
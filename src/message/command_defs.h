@@ -28,7 +28,9 @@
 #ifndef SENSEI_COMMAND_DEFS_H
 #define SENSEI_COMMAND_DEFS_H
 
+#include <array>
 #include <vector>
+#include <string>
 
 #include "base_command.h"
 
@@ -70,6 +72,15 @@ enum class CommandType
     SET_OSC_OUTPUT_HOST,
     SET_OSC_OUTPUT_PORT,
     SET_OSC_INPUT_PORT,
+    SET_OSC_FAST_INPUT_PORT,
+    SET_SHM_INPUT_NAME,
+    SET_OSC_SUBSCRIPTION_MODE,
+    ADD_OSC_SUBSCRIPTION,
+    REMOVE_OSC_SUBSCRIPTION,
+    QUERY_VALUES,
+    QUERY_CONFIG,
+    QUERY_LATENCY,
+    QUERY_METRICS,
     N_COMMAND_TAGS
 };
 
@@ -122,7 +133,10 @@ enum class HwFrontendType
 {
     NONE,
     RASPA_GPIO,
-    ELK_PI_GPIO
+    ELK_PI_GPIO,
+    ELK_PI_SIMULATION,
+    REPLAY,
+    SYNTHETIC
 };
 
 /**
@@ -139,6 +153,19 @@ enum class SendingMode
     N_SENDING_MODES
 };
 
+/**
+ * @brief Sending mode names used by the runtime configuration interface
+ */
+constexpr std::array<const char*, static_cast<int>(SendingMode::N_SENDING_MODES)> SENDING_MODE_NAMES =
+{
+    "off",
+    "continuous",
+    "on_value_changed",
+    "on_request",
+    "on_press",
+    "on_release"
+};
+
 /**
  * @brief For customising certain hw
  */
@@ -166,6 +193,28 @@ struct MultiplexerData
     int  pin;
 };
 
+/**
+ * @brief Subscription of an OSC client to the sensors matching a path pattern
+ */
+struct OSCSubscription
+{
+    std::string pattern;
+    std::string host;
+    int port;
+    int lease_s;
+};
+
+/**
+ * @brief Request for the latest values of a set of sensors, the reply
+ *        is sent by the output backend to the given host and port
+ */
+struct ValueQuery
+{
+    std::vector<int> sensors;
+    std::string host;
+    int port;
+};
+
 enum class CommandErrorCode
 {
     OK,
@@ -190,7 +239,8 @@ SENSEI_DECLARE_COMMAND(SetEnabledCommand,
                        CommandType::SET_ENABLED,
                        bool,
                        "Set Enabled",
-                       CommandDestination::HARDWARE_FRONTEND | CommandDestination::MAPPING_PROCESSOR);
+                       CommandDestination::HARDWARE_FRONTEND | CommandDestination::MAPPING_PROCESSOR |
+                       CommandDestination::OUTPUT_BACKEND);
 
 SENSEI_DECLARE_COMMAND(SetSensorTypeCommand,
                        CommandType::SET_SENSOR_TYPE,
@@ -358,6 +408,60 @@ SENSEI_DECLARE_COMMAND(SetOSCInputPortCommand,
                        "Set OSC input port",
                        CommandDestination::USER_FRONTEND);
 
+SENSEI_DECLARE_COMMAND(SetOSCFastInputPortCommand,
+                       CommandType::SET_OSC_FAST_INPUT_PORT,
+                       int,
+                       "Set OSC fast receiver input port",
+                       CommandDestination::USER_FRONTEND);
+
+SENSEI_DECLARE_COMMAND(SetShmInputNameCommand,
+                       CommandType::SET_SHM_INPUT_NAME,
+                       std::string,
+                       "Set shared memory input name",
+                       CommandDestination::USER_FRONTEND);
+
+SENSEI_DECLARE_COMMAND(SetOSCSubscriptionModeCommand,
+                       CommandType::SET_OSC_SUBSCRIPTION_MODE,
+                       bool,
+                       "Set OSC subscription mode",
+                       CommandDestination::OUTPUT_BACKEND);
+
+SENSEI_DECLARE_COMMAND(AddOSCSubscriptionCommand,
+                       CommandType::ADD_OSC_SUBSCRIPTION,
+                       OSCSubscription,
+                       "Add OSC subscription",
+                       CommandDestination::OUTPUT_BACKEND);
+
+SENSEI_DECLARE_COMMAND(RemoveOSCSubscriptionCommand,
+                       CommandType::REMOVE_OSC_SUBSCRIPTION,
+                       OSCSubscription,
+                       "Remove OSC subscription",
+                       CommandDestination::OUTPUT_BACKEND);
+
+SENSEI_DECLARE_COMMAND(QueryValuesCommand,
+                       CommandType::QUERY_VALUES,
+                       ValueQuery,
+                       "Query latest values",
+                       CommandDestination::MAPPING_PROCESSOR | CommandDestination::OUTPUT_BACKEND);
+
+SENSEI_DECLARE_COMMAND(QueryConfigCommand,
+                       CommandType::QUERY_CONFIG,
+                       ValueQuery,
+                       "Query sensor configuration",
+                       CommandDestination::MAPPING_PROCESSOR | CommandDestination::OUTPUT_BACKEND);
+
+SENSEI_DECLARE_COMMAND(QueryLatencyCommand,
+                       CommandType::QUERY_LATENCY,
+                       ValueQuery,
+                       "Query value latencies",
+                       CommandDestination::OUTPUT_BACKEND);
+
+SENSEI_DECLARE_COMMAND(QueryMetricsCommand,
+                       CommandType::QUERY_METRICS,
+                       ValueQuery,
+                       "Query runtime metrics",
+                       CommandDestination::OUTPUT_BACKEND);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Container specifications
 ////////////////////////////////////////////////////////////////////////////////
@@ -40,6 +40,7 @@ enum class ErrorType
 {
     BAD_CRC,
     TOO_MANY_TIMEOUTS,
+    HW_BACKEND_RESTARTED,
     N_ERROR_TYPES
 };
 
@@ -51,6 +52,10 @@ SENSEI_DECLARE_VOID_ERROR(TooManyTimeoutsError,
                           ErrorType::TOO_MANY_TIMEOUTS,
                           "Too many timeouts while trying to send external messages");
 
+SENSEI_DECLARE_VOID_ERROR(HwBackendRestartedError,
+                          ErrorType::HW_BACKEND_RESTARTED,
+                          "Hw backend restarted and lost its configuration");
+
 } // namespace sensei
 
 #endif //SENSEI_ERROR_DEFS_H
\ No newline at end of file
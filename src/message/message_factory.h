@@ -108,6 +108,14 @@ public:
         return std::unique_ptr<FloatSetValue>(msg);
     }
 
+    std::unique_ptr<BaseMessage> make_float_set_batch_value(std::vector<OutputUpdate> values,
+                                                            const uint32_t timestamp = 0)
+    {
+        int index = values.empty()? 0 : values.front().index;
+        auto msg = new FloatSetBatchValue(index, std::move(values), timestamp);
+        return std::unique_ptr<FloatSetBatchValue>(msg);
+    }
+
     ////////////////////////////////////////////////////////////////////////////////
     // Commands
     ////////////////////////////////////////////////////////////////////////////////
@@ -342,6 +350,90 @@ public:
         return std::unique_ptr<SetOSCInputPortCommand>(msg);
     }
 
+    std::unique_ptr<BaseMessage> make_set_osc_fast_input_port_command(const int index,
+                                                                      const int port,
+                                                                      const uint32_t timestamp = 0)
+    {
+        auto msg = new SetOSCFastInputPortCommand(index, port, timestamp);
+        return std::unique_ptr<SetOSCFastInputPortCommand>(msg);
+    }
+
+    std::unique_ptr<BaseMessage> make_set_shm_input_name_command(const int index,
+                                                                 const std::string& name,
+                                                                 const uint32_t timestamp = 0)
+    {
+        auto msg = new SetShmInputNameCommand(index, name, timestamp);
+        return std::unique_ptr<SetShmInputNameCommand>(msg);
+    }
+
+    std::unique_ptr<BaseMessage> make_set_osc_subscription_mode_command(const int index,
+                                                                        const bool enabled,
+                                                                        const uint32_t timestamp = 0)
+    {
+        auto msg = new SetOSCSubscriptionModeCommand(index, enabled, timestamp);
+        return std::unique_ptr<SetOSCSubscriptionModeCommand>(msg);
+    }
+
+    std::unique_ptr<BaseMessage> make_add_osc_subscription_command(const int index,
+                                                                   const std::string& pattern,
+                                                                   const std::string& host,
+                                                                   const int port,
+                                                                   const int lease_s,
+                                                                   const uint32_t timestamp = 0)
+    {
+        auto msg = new AddOSCSubscriptionCommand(index, {pattern, host, port, lease_s}, timestamp);
+        return std::unique_ptr<AddOSCSubscriptionCommand>(msg);
+    }
+
+    std::unique_ptr<BaseMessage> make_remove_osc_subscription_command(const int index,
+                                                                      const std::string& pattern,
+                                                                      const std::string& host,
+                                                                      const int port,
+                                                                      const uint32_t timestamp = 0)
+    {
+        auto msg = new RemoveOSCSubscriptionCommand(index, {pattern, host, port, 0}, timestamp);
+        return std::unique_ptr<RemoveOSCSubscriptionCommand>(msg);
+    }
+
+    std::unique_ptr<BaseMessage> make_query_values_command(const int index,
+                                                           const std::vector<int>& sensors,
+                                                           const std::string& host,
+                                                           const int port,
+                                                           const uint32_t timestamp = 0)
+    {
+        auto msg = new QueryValuesCommand(index, {sensors, host, port}, timestamp);
+        return std::unique_ptr<QueryValuesCommand>(msg);
+    }
+
+    std::unique_ptr<BaseMessage> make_query_config_command(const int index,
+                                                           const std::vector<int>& sensors,
+                                                           const std::string& host,
+                                                           const int port,
+                                                           const uint32_t timestamp = 0)
+    {
+        auto msg = new QueryConfigCommand(index, {sensors, host, port}, timestamp);
+        return std::unique_ptr<QueryConfigCommand>(msg);
+    }
+
+    std::unique_ptr<BaseMessage> make_query_latency_command(const int index,
+                                                            const std::vector<int>& sensors,
+                                                            const std::string& host,
+                                                            const int port,
+                                                            const uint32_t timestamp = 0)
+    {
+        auto msg = new QueryLatencyCommand(index, {sensors, host, port}, timestamp);
+        return std::unique_ptr<QueryLatencyCommand>(msg);
+    }
+
+    std::unique_ptr<BaseMessage> make_query_metrics_command(const int index,
+                                                            const std::string& host,
+                                                            const int port,
+                                                            const uint32_t timestamp = 0)
+    {
+        auto msg = new QueryMetricsCommand(index, {{}, host, port}, timestamp);
+        return std::unique_ptr<QueryMetricsCommand>(msg);
+    }
+
     ////////////////////////////////////////////////////////////////////////////////
     // Errors
     ////////////////////////////////////////////////////////////////////////////////
@@ -360,6 +452,13 @@ public:
         return std::unique_ptr<TooManyTimeoutsError>(msg);
     }
 
+    std::unique_ptr<BaseMessage> make_hw_backend_restarted_error(const int index,
+                                                                 const uint32_t timestamp = 0)
+    {
+        auto msg = new HwBackendRestartedError(index, timestamp);
+        return std::unique_ptr<HwBackendRestartedError>(msg);
+    }
+
 };
 
 } // namespace sensei
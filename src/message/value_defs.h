@@ -44,7 +44,8 @@ enum class ValueType
     CONTINUOUS,
     OUTPUT,
     INT_SET,
-    FLOAT_SET
+    FLOAT_SET,
+    FLOAT_SET_BATCH
 };
 
 inline bool is_output_value(const Value* value)
@@ -54,7 +55,7 @@ inline bool is_output_value(const Value* value)
 
 inline bool is_set_value(const Value* value)
 {
-    return (value->type() >= ValueType::INT_SET && value->type() <= ValueType::FLOAT_SET);
+    return (value->type() >= ValueType::INT_SET && value->type() <= ValueType::FLOAT_SET_BATCH);
 }
 
 SENSEI_DECLARE_VALUE(AnalogValue, ValueType::ANALOG, int, "Analog Value");
@@ -69,6 +70,47 @@ SENSEI_DECLARE_VALUE(IntegerSetValue, ValueType::INT_SET, int, "Analog SetValue"
 
 SENSEI_DECLARE_VALUE(FloatSetValue, ValueType::FLOAT_SET, float, "Continuous SetValue");
 
+/**
+ * @brief Value of a single output in a batch
+ */
+struct OutputUpdate
+{
+    int   index;
+    float value;
+};
+
+/**
+ * @brief Several output values set with a single user frontend message, which are
+ *        handled as a unit. Declared explicitly instead of with SENSEI_DECLARE_VALUE
+ *        to give access to the values without copying them.
+ */
+class FloatSetBatchValue : public Value
+{
+public:
+    SENSEI_MESSAGE_CONCRETE_CLASS_PREAMBLE(FloatSetBatchValue)
+
+    std::string representation() const override
+    {
+        return std::string("Continuous SetValue Batch");
+    }
+
+    const std::vector<OutputUpdate>& values() const
+    {
+        return _values;
+    }
+
+private:
+    FloatSetBatchValue(const int index,
+                       std::vector<OutputUpdate> values,
+                       const uint32_t timestamp=0) :
+        Value(index, ValueType::FLOAT_SET_BATCH, timestamp),
+        _values(std::move(values))
+    {
+    }
+
+    std::vector<OutputUpdate> _values;
+};
+
 
 } // namespace sensei
 
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Registry of runtime metrics and their export as Prometheus text
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "metrics.h"
+#include "thread_scheduling.h"
+#include "logging.h"
+
+namespace sensei {
+namespace metrics {
+
+constexpr int ACCEPT_TIMEOUT_MS = 250;
+constexpr auto CLIENT_TIMEOUT = std::chrono::milliseconds(100);
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("metrics");
+
+Counter* MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels)
+{
+    return &_entry(name, help, labels, MetricType::COUNTER).counter;
+}
+
+Gauge* MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels)
+{
+    return &_entry(name, help, labels, MetricType::GAUGE).gauge;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::_entry(const std::string& name,
+                                                const std::string& help,
+                                                const std::string& labels,
+                                                MetricType type)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto [entry, inserted] = _entries.try_emplace({name, labels});
+    if (inserted)
+    {
+        entry->second.type = type;
+        _help.emplace(name, help);
+    }
+    else if (entry->second.type != type)
+    {
+        SENSEI_LOG_ERROR("Metric {} registered with different types", name);
+    }
+    return entry->second;
+}
+
+std::vector<MetricSample> MetricsRegistry::collect() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<MetricSample> samples;
+    samples.reserve(_entries.size());
+    for (const auto& [key, entry] : _entries)
+    {
+        int64_t value = entry.type == MetricType::COUNTER ? static_cast<int64_t>(entry.counter.value())
+                                                          : entry.gauge.value();
+        samples.push_back({key.first, key.second, entry.type, value});
+    }
+    return samples;
+}
+
+std::string MetricsRegistry::prometheus_text() const
+{
+    auto samples = collect();
+    std::ostringstream text;
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        const auto& sample = samples[i];
+        if (i == 0 || samples[i - 1].name != sample.name)
+        {
+            text << "# HELP " << sample.name << " " << _help.at(sample.name) << "\n";
+            text << "# TYPE " << sample.name << (sample.type == MetricType::COUNTER ? " counter\n" : " gauge\n");
+        }
+        text << sample.name;
+        if (sample.labels.empty() == false)
+        {
+            text << "{" << sample.labels << "}";
+        }
+        text << " " << sample.value << "\n";
+    }
+    return text.str();
+}
+
+MetricsRegistry& registry()
+{
+    static MetricsRegistry process_registry;
+    return process_registry;
+}
+
+std::string label(const char* name, int value)
+{
+    return std::string(name) + "=\"" + std::to_string(value) + "\"";
+}
+
+PrometheusExporter::PrometheusExporter(const MetricsRegistry& registry, const std::string& socket_path) :
+        _registry(registry),
+        _socket_path(socket_path)
+{}
+
+PrometheusExporter::~PrometheusExporter()
+{
+    stop();
+}
+
+bool PrometheusExporter::start()
+{
+    sockaddr_un address;
+    if (_socket_path.size() >= sizeof(address.sun_path))
+    {
+        SENSEI_LOG_ERROR("Metrics socket path too long: {}", _socket_path);
+        return false;
+    }
+    _socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_socket < 0)
+    {
+        SENSEI_LOG_ERROR("Failed to create metrics socket: {}", strerror(errno));
+        return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, _socket_path.c_str());
+    // In case sensei didn't quit gracefully, clear the socket handle
+    unlink(_socket_path.c_str());
+    if (bind(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(_socket, 4) != 0)
+    {
+        SENSEI_LOG_ERROR("Failed to bind metrics socket {}: {}", _socket_path, strerror(errno));
+        close(_socket);
+        _socket = -1;
+        return false;
+    }
+    _running = true;
+    _thread = std::thread(&PrometheusExporter::_serve_loop, this);
+    register_thread(_thread.native_handle(), "metrics exporter");
+    SENSEI_LOG_INFO("Serving metrics on {}", _socket_path);
+    return true;
+}
+
+void PrometheusExporter::stop()
+{
+    _running = false;
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+    if (_socket >= 0)
+    {
+        close(_socket);
+        _socket = -1;
+        unlink(_socket_path.c_str());
+    }
+}
+
+void PrometheusExporter::_serve_loop()
+{
+    while (_running)
+    {
+        pollfd fd = {_socket, POLLIN, 0};
+        if (poll(&fd, 1, ACCEPT_TIMEOUT_MS) <= 0)
+        {
+            continue;
+        }
+        int client = accept(_socket, nullptr, nullptr);
+        if (client < 0)
+        {
+            continue;
+        }
+        // The request is not parsed, every client gets the metrics. Read what
+        // it sent so that closing the socket doesn't reset the connection.
+        timeval timeout = {0, static_cast<suseconds_t>(std::chrono::microseconds(CLIENT_TIMEOUT).count())};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        char request[1024];
+        [[maybe_unused]] auto request_size = recv(client, request, sizeof(request), 0);
+
+        std::string body = _registry.prometheus_text();
+        std::string response = "HTTP/1.0 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size())
+        {
+            auto res = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (res <= 0)
+            {
+                SENSEI_LOG_WARNING("Failed to send metrics: {}", strerror(errno));
+                break;
+            }
+            sent += res;
+        }
+        close(client);
+    }
+}
+
+} // namespace metrics
+} // namespace sensei
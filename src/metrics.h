@@ -0,0 +1,194 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Registry of runtime metrics and their export as Prometheus text
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Modules register their counters and gauges once, when they are created, and
+ * keep pointers to them. Updating a metric is a single relaxed atomic operation,
+ * so it can be done on any thread without taking locks. Registering and
+ * collecting take the registry lock, they are never done on the hot paths.
+ *
+ * Metrics are identified by their name and labels, registering the same metric
+ * twice returns the one already registered, e.g. when a module is re-created.
+ */
+#ifndef SENSEI_METRICS_H
+#define SENSEI_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sensei {
+namespace metrics {
+
+enum class MetricType
+{
+    COUNTER,
+    GAUGE
+};
+
+/**
+ * @brief Monotonically increasing count of events
+ */
+class Counter
+{
+public:
+    void increment(uint64_t count = 1)
+    {
+        _value.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const
+    {
+        return _value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> _value{0};
+};
+
+/**
+ * @brief Value that can go up and down, e.g. the depth of a queue
+ */
+class Gauge
+{
+public:
+    void set(int64_t value)
+    {
+        _value.store(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Set the gauge to value if it is higher, for high-water marks
+     */
+    void update_max(int64_t value)
+    {
+        int64_t current = _value.load(std::memory_order_relaxed);
+        while (value > current && !_value.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {}
+    }
+
+    int64_t value() const
+    {
+        return _value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> _value{0};
+};
+
+struct MetricSample
+{
+    std::string name;
+    std::string labels;     /* Comma separated name="value" pairs, may be empty */
+    MetricType  type;
+    int64_t     value;
+};
+
+class MetricsRegistry
+{
+public:
+    /**
+     * @brief Get a counter, registering it if needed. A metric name can't be used
+     *        for both counters and gauges.
+     *
+     * @param [in] name Name of the metric, e.g. "sensei_packets_received_total"
+     * @param [in] help One line description of the metric
+     * @param [in] labels Labels of this instance of the metric, e.g. label("board", 0)
+     * @return The counter, valid as long as the registry
+     */
+    Counter* counter(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    /**
+     * @brief Get a gauge, registering it if needed, see counter()
+     */
+    Gauge* gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    /**
+     * @brief Read the current value of all metrics, ordered by name and labels
+     */
+    std::vector<MetricSample> collect() const;
+
+    /**
+     * @brief Format all metrics in the Prometheus text exposition format
+     */
+    std::string prometheus_text() const;
+
+private:
+    struct Entry
+    {
+        MetricType type;
+        Counter    counter;
+        Gauge      gauge;
+    };
+
+    Entry& _entry(const std::string& name, const std::string& help, const std::string& labels, MetricType type);
+
+    /* Entries never move once inserted, so pointers to their metrics stay valid */
+    std::map<std::pair<std::string, std::string>, Entry> _entries;
+    std::map<std::string, std::string> _help;
+    mutable std::mutex _mutex;
+};
+
+/**
+ * @brief The registry of the whole process
+ */
+MetricsRegistry& registry();
+
+/**
+ * @brief Format a label for the registry, i.e. name="value"
+ */
+std::string label(const char* name, int value);
+
+/**
+ * @brief Serves the metrics of a registry as Prometheus text to every client
+ *        connecting to a local stream socket, as a minimal HTTP response so it
+ *        can be read with e.g. curl --unix-socket or a scraping proxy.
+ */
+class PrometheusExporter
+{
+public:
+    PrometheusExporter(const MetricsRegistry& registry, const std::string& socket_path);
+
+    ~PrometheusExporter();
+
+    /**
+     * @brief Bind the socket and start serving on a separate thread
+     * @return false if the socket could not be bound
+     */
+    bool start();
+
+    void stop();
+
+private:
+    void _serve_loop();
+
+    const MetricsRegistry& _registry;
+    std::string       _socket_path;
+    int               _socket{-1};
+    std::atomic<bool> _running{false};
+    std::thread       _thread;
+};
+
+} // namespace metrics
+} // namespace sensei
+
+#endif //SENSEI_METRICS_H
@@ -24,6 +24,7 @@
 #include <lo/lo_types.h>
 
 #include "osc_backend.h"
+#include "message/message_factory.h"
 
 #include "logging.h"
 
@@ -36,6 +37,8 @@ SENSEI_GET_LOGGER_WITH_MODULE_NAME("osc_backend");
 
 constexpr uint32_t US_TO_S = 1'000'000;
 constexpr uint32_t OSC_TIME_FRAC = UINT32_MAX / US_TO_S;
+constexpr int DEFAULT_LEASE_S = 60;
+constexpr int MAX_LEASE_S = 24 * 3600;
 
 void trim_osc_path_components(std::string& s)
 {
@@ -59,6 +62,78 @@ lo_timetag to_osc_timestamp(uint32_t value_time)
     return lo_time;
 }
 
+/*
+ * Build the OSC message for a configuration command. The path is the one of the
+ * matching user frontend endpoint so that clients can send the reply back unchanged.
+ * Returns nullptr for commands that can't be changed at runtime.
+ */
+lo_message config_message(const Command* cmd, const char*& path)
+{
+    lo_message message = lo_message_new();
+    lo_message_add_int32(message, cmd->index());
+    switch (cmd->type())
+    {
+    case CommandType::SET_ENABLED:
+        path = "/set_enabled";
+        lo_message_add_int32(message, static_cast<const SetEnabledCommand*>(cmd)->data());
+        break;
+
+    case CommandType::SET_SENDING_MODE:
+        path = "/set_sending_mode";
+        lo_message_add_string(message, SENDING_MODE_NAMES[static_cast<int>(static_cast<const SetSendingModeCommand*>(cmd)->data())]);
+        break;
+
+    case CommandType::SET_SENDING_DELTA_TICKS:
+        path = "/set_delta_ticks";
+        lo_message_add_int32(message, static_cast<const SetSendingDeltaTicksCommand*>(cmd)->data());
+        break;
+
+    case CommandType::SET_ADC_FILTER_TIME_CONSTANT:
+        path = "/set_filter_time_constant";
+        lo_message_add_float(message, static_cast<const SetADCFitlerTimeConstantCommand*>(cmd)->data());
+        break;
+
+    case CommandType::SET_SLIDER_THRESHOLD:
+        path = "/set_slider_threshold";
+        lo_message_add_int32(message, static_cast<const SetSliderThresholdCommand*>(cmd)->data());
+        break;
+
+    case CommandType::SET_INPUT_RANGE:
+        {
+            path = "/set_input_range";
+            auto range = static_cast<const SetInputRangeCommand*>(cmd)->data();
+            lo_message_add_float(message, range.min);
+            lo_message_add_float(message, range.max);
+        };
+        break;
+
+    case CommandType::SET_INVERT_ENABLED:
+        path = "/set_invert";
+        lo_message_add_int32(message, static_cast<const SetInvertEnabledCommand*>(cmd)->data());
+        break;
+
+    default:
+        lo_message_free(message);
+        return nullptr;
+    }
+    return message;
+}
+
+bool is_input_sensor(SensorType type)
+{
+    switch (type)
+    {
+    case SensorType::DIGITAL_INPUT:
+    case SensorType::ANALOG_INPUT:
+    case SensorType::CONTINUOUS_INPUT:
+    case SensorType::RANGE_INPUT:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
 std::string concatenate_osc_paths(std::string a, std::string b)
 {
     std::stringstream stream;
@@ -75,28 +150,49 @@ OSCBackend::OSCBackend(const int max_n_input_pins) :
     _base_path("sensors"),
     _base_raw_path("raw_input"),
     _host("localhost"),
-    _port(23023)
-
+    _port(23023),
+    _address(nullptr),
+    _subscription_mode(false),
+    _subscribers_changed(false),
+    _send_errors_metric(metrics::registry().counter("sensei_osc_send_errors_total", "OSC messages that failed to send"))
 {
     _full_out_paths.resize(static_cast<size_t>(max_n_input_pins));
     _full_raw_paths.resize(static_cast<size_t>(max_n_input_pins));
+    _sensor_subscribers.resize(static_cast<size_t>(max_n_input_pins));
+    _sensor_muted.resize(static_cast<size_t>(max_n_input_pins), false);
     _compute_full_paths();
     _compute_address();
 }
 
+OSCBackend::~OSCBackend()
+{
+    for (auto& subscriber : _subscribers)
+    {
+        lo_address_free(subscriber.address);
+    }
+    if (_address != nullptr)
+    {
+        lo_address_free(_address);
+    }
+}
+
 void OSCBackend::send(const OutputValue* transformed_value, const Value* raw_input_value)
 {
     // TODO: see if it's worth checking errors in lo_send calls
+    auto mapped_time = std::chrono::steady_clock::now();
     int sensor_index = transformed_value->index();
 
     SENSEI_LOG_INFO("OSC backend, got value to send");
     if (_send_output_active)
     {
-        if (transformed_value->timestamp() == 0)
-            lo_send(_address, _full_out_paths[sensor_index].c_str(), "f", transformed_value->value());
-        else
-            lo_send(_address, _full_out_paths[sensor_index].c_str(), "ft",
-                    transformed_value->value(), to_osc_timestamp(transformed_value->timestamp()));
+        lo_message message = lo_message_new();
+        lo_message_add_float(message, transformed_value->value());
+        if (transformed_value->timestamp() != 0)
+        {
+            lo_message_add_timetag(message, to_osc_timestamp(transformed_value->timestamp()));
+        }
+        _send_message(sensor_index, _full_out_paths[sensor_index], message);
+        lo_message_free(message);
     }
 
     if (_send_raw_input_active)
@@ -129,12 +225,189 @@ void OSCBackend::send(const OutputValue* transformed_value, const Value* raw_inp
         default:
             break;
         }
-        if (transformed_value->timestamp() == 0)
-            lo_send(_address, _full_raw_paths[sensor_index].c_str(), "i", input_val);
-        else
-            lo_send(_address, _full_raw_paths[sensor_index].c_str(), "i", input_val, to_osc_timestamp(transformed_value->timestamp()));
+        lo_message message = lo_message_new();
+        lo_message_add_int32(message, input_val);
+        if (transformed_value->timestamp() != 0)
+        {
+            lo_message_add_timetag(message, to_osc_timestamp(transformed_value->timestamp()));
+        }
+        _send_message(sensor_index, _full_raw_paths[sensor_index], message);
+        lo_message_free(message);
+    }
+    _record_latency(transformed_value, raw_input_value, mapped_time);
+}
+
+void OSCBackend::update_subscriptions(CommandIterator out_iterator)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto expired = std::remove_if(_subscribers.begin(), _subscribers.end(), [&](const Subscriber& s)
+    {
+        if (s.expiry > now)
+        {
+            return false;
+        }
+        SENSEI_LOG_INFO("Subscription of {}:{} to {} expired", s.host, s.port, s.pattern);
+        lo_address_free(s.address);
+        return true;
+    });
+    if (expired != _subscribers.end())
+    {
+        _subscribers.erase(expired, _subscribers.end());
+        _subscribers_changed = true;
+    }
+
+    if (_subscribers_changed == false)
+    {
+        return;
+    }
+    _compute_sensor_subscribers();
+    _subscribers_changed = false;
+
+    MessageFactory factory;
+    for (size_t i = 0; i < _sensor_subscribers.size(); i++)
+    {
+        if (is_input_sensor(_pin_types[i]) == false)
+        {
+            continue;
+        }
+        bool muted = _subscription_mode && _sensor_subscribers[i].empty();
+        if (muted != _sensor_muted[i])
+        {
+            _sensor_muted[i] = muted;
+            // A sensor disabled by the configuration or the user stays disabled on the board
+            if (_sensor_enabled[i])
+            {
+                SENSEI_LOG_INFO("{} sensor {}, subscribers: {}", muted? "Muting" : "Unmuting", i, _sensor_subscribers[i].size());
+                out_iterator = factory.make_set_enabled_command(static_cast<int>(i), !muted);
+            }
+        }
+    }
+}
+
+void OSCBackend::sensors_reconfigured(int first_sensor, int end_sensor)
+{
+    int end = std::min(end_sensor, static_cast<int>(_sensor_muted.size()));
+    for (int i = std::max(first_sensor, 0); i < end; ++i)
+    {
+        _sensor_muted[i] = false;
+    }
+    _subscribers_changed = true;
+}
+
+void OSCBackend::send_query_reply(const CommandContainer& values, const ValueQuery& query)
+{
+    auto port_str = std::to_string(query.port);
+    lo_address address = lo_address_new(query.host.c_str(), port_str.c_str());
+    if (address == nullptr)
+    {
+        SENSEI_LOG_WARNING("Invalid address {}:{} for query reply", query.host, query.port);
+        return;
+    }
+
+    // All values go in a single bundle so the client gets a consistent snapshot
+    lo_bundle bundle = lo_bundle_new(LO_TT_IMMEDIATE);
+    for (const auto& msg : values)
+    {
+        auto value = static_cast<const OutputValue*>(msg.get());
+        lo_message message = lo_message_new();
+        lo_message_add_float(message, value->value());
+        if (value->timestamp() != 0)
+        {
+            lo_message_add_timetag(message, to_osc_timestamp(value->timestamp()));
+        }
+        lo_bundle_add_message(bundle, _full_out_paths[value->index()].c_str(), message);
+    }
+    lo_send_bundle(address, bundle);
+    lo_bundle_free_recursive(bundle);
+    lo_address_free(address);
+}
+
+void OSCBackend::send_config_reply(const CommandContainer& commands, const ValueQuery& query)
+{
+    auto port_str = std::to_string(query.port);
+    lo_address address = lo_address_new(query.host.c_str(), port_str.c_str());
+    if (address == nullptr)
+    {
+        SENSEI_LOG_WARNING("Invalid address {}:{} for config reply", query.host, query.port);
+        return;
+    }
+
+    lo_bundle bundle = lo_bundle_new(LO_TT_IMMEDIATE);
+    for (const auto& msg : commands)
+    {
+        const char* path = nullptr;
+        lo_message message = config_message(static_cast<const Command*>(msg.get()), path);
+        if (message != nullptr)
+        {
+            lo_bundle_add_message(bundle, path, message);
+        }
+    }
+    lo_send_bundle(address, bundle);
+    lo_bundle_free_recursive(bundle);
+    lo_address_free(address);
+}
+
+void OSCBackend::send_latency_reply(const LatencyMonitor& monitor, const ValueQuery& query)
+{
+    auto port_str = std::to_string(query.port);
+    lo_address address = lo_address_new(query.host.c_str(), port_str.c_str());
+    if (address == nullptr)
+    {
+        SENSEI_LOG_WARNING("Invalid address {}:{} for latency reply", query.host, query.port);
+        return;
+    }
+
+    // One message per sensor and stage: sensor, stage, samples, p50, p99, p999, max, all times in us
+    std::vector<int> sensors = query.sensors;
+    if (sensors.empty())
+    {
+        sensors.push_back(LatencyMonitor::ALL_SENSORS);
+    }
+    lo_bundle bundle = lo_bundle_new(LO_TT_IMMEDIATE);
+    for (int sensor : sensors)
+    {
+        for (int stage = 0; stage < N_LATENCY_STAGES; ++stage)
+        {
+            auto summary = monitor.summary(static_cast<LatencyStage>(stage), sensor);
+            lo_message message = lo_message_new();
+            lo_message_add_int32(message, sensor);
+            lo_message_add_string(message, latency_stage_name(static_cast<LatencyStage>(stage)));
+            lo_message_add_int64(message, static_cast<int64_t>(summary.samples));
+            lo_message_add_int32(message, static_cast<int32_t>(summary.p50.count()));
+            lo_message_add_int32(message, static_cast<int32_t>(summary.p99.count()));
+            lo_message_add_int32(message, static_cast<int32_t>(summary.p999.count()));
+            lo_message_add_int32(message, static_cast<int32_t>(summary.max.count()));
+            lo_bundle_add_message(bundle, "/latency", message);
+        }
+    }
+    lo_send_bundle(address, bundle);
+    lo_bundle_free_recursive(bundle);
+    lo_address_free(address);
+}
+
+void OSCBackend::send_metrics_reply(const metrics::MetricsRegistry& registry, const ValueQuery& query)
+{
+    auto port_str = std::to_string(query.port);
+    lo_address address = lo_address_new(query.host.c_str(), port_str.c_str());
+    if (address == nullptr)
+    {
+        SENSEI_LOG_WARNING("Invalid address {}:{} for metrics reply", query.host, query.port);
+        return;
     }
 
+    // One message per metric: name, labels and value
+    lo_bundle bundle = lo_bundle_new(LO_TT_IMMEDIATE);
+    for (const auto& sample : registry.collect())
+    {
+        lo_message message = lo_message_new();
+        lo_message_add_string(message, sample.name.c_str());
+        lo_message_add_string(message, sample.labels.c_str());
+        lo_message_add_int64(message, sample.value);
+        lo_bundle_add_message(bundle, "/metric", message);
+    }
+    lo_send_bundle(address, bundle);
+    lo_bundle_free_recursive(bundle);
+    lo_address_free(address);
 }
 
 CommandErrorCode OSCBackend::apply_command(const Command *cmd)
@@ -158,6 +431,21 @@ CommandErrorCode OSCBackend::apply_command(const Command *cmd)
             const auto typed_cmd = static_cast<const SetSensorTypeCommand*>(cmd);
             _pin_types[pin_idx] = typed_cmd->data();
             _compute_full_paths();
+            // A (re)configured sensor is enabled on the board, mute it again if needed
+            _sensor_muted[pin_idx] = false;
+        };
+        break;
+
+    case CommandType::SET_ENABLED:
+        {
+            const auto typed_cmd = static_cast<const SetEnabledCommand*>(cmd);
+            _sensor_enabled[pin_idx] = typed_cmd->data();
+            // Enabling a muted sensor enables it on the board too, mute it again if needed
+            if (typed_cmd->data() && _sensor_muted[pin_idx])
+            {
+                _sensor_muted[pin_idx] = false;
+                _subscribers_changed = true;
+            }
         };
         break;
 
@@ -200,6 +488,28 @@ CommandErrorCode OSCBackend::apply_command(const Command *cmd)
         };
         break;
 
+    case CommandType::SET_OSC_SUBSCRIPTION_MODE:
+        {
+            const auto typed_cmd = static_cast<const SetOSCSubscriptionModeCommand*>(cmd);
+            _subscription_mode = typed_cmd->data();
+            _subscribers_changed = true;
+        };
+        break;
+
+    case CommandType::ADD_OSC_SUBSCRIPTION:
+        {
+            const auto typed_cmd = static_cast<const AddOSCSubscriptionCommand*>(cmd);
+            status = _add_subscription(typed_cmd->data());
+        };
+        break;
+
+    case CommandType::REMOVE_OSC_SUBSCRIPTION:
+        {
+            const auto typed_cmd = static_cast<const RemoveOSCSubscriptionCommand*>(cmd);
+            status = _remove_subscription(typed_cmd->data());
+        };
+        break;
+
     default:
         status = CommandErrorCode::UNHANDLED_COMMAND_FOR_SENSOR_TYPE;
         break;
@@ -252,7 +562,7 @@ void OSCBackend::_compute_full_paths()
         _full_raw_paths[i] = concatenate_osc_paths(cur_raw_path,
                                                    concatenate_osc_paths(cur_sensor_type, _sensor_names[i]) );
     }
-
+    _subscribers_changed = true;
 
 }
 
@@ -261,6 +571,10 @@ CommandErrorCode OSCBackend::_compute_address()
     std::stringstream port_stream;
     port_stream << _port;
     auto port_str = port_stream.str();
+    if (_address != nullptr)
+    {
+        lo_address_free(_address);
+    }
     _address = lo_address_new(_host.c_str(), port_str.c_str());
 
     if (_address == nullptr)
@@ -269,4 +583,108 @@ CommandErrorCode OSCBackend::_compute_address()
     }
 
     return CommandErrorCode::OK;
+}
+
+CommandErrorCode OSCBackend::_add_subscription(const OSCSubscription& subscription)
+{
+    if ((subscription.port < 1000) || (subscription.port > 65535))
+    {
+        return CommandErrorCode::INVALID_PORT_NUMBER;
+    }
+    int lease_s = subscription.lease_s > 0 ? std::min(subscription.lease_s, MAX_LEASE_S) : DEFAULT_LEASE_S;
+    auto expiry = std::chrono::steady_clock::now() + std::chrono::seconds(lease_s);
+
+    // Renewing an existing subscription only extends its lease
+    for (auto& subscriber : _subscribers)
+    {
+        if (subscriber.pattern == subscription.pattern &&
+            subscriber.host == subscription.host &&
+            subscriber.port == subscription.port)
+        {
+            subscriber.expiry = expiry;
+            return CommandErrorCode::OK;
+        }
+    }
+
+    auto port_str = std::to_string(subscription.port);
+    lo_address address = lo_address_new(subscription.host.c_str(), port_str.c_str());
+    if (address == nullptr)
+    {
+        return CommandErrorCode::INVALID_URL;
+    }
+    SENSEI_LOG_INFO("New subscription of {}:{} to {}, lease {} s", subscription.host, subscription.port,
+                    subscription.pattern, lease_s);
+    _subscribers.push_back({subscription.pattern, subscription.host, subscription.port, address, expiry});
+    _subscribers_changed = true;
+    return CommandErrorCode::OK;
+}
+
+CommandErrorCode OSCBackend::_remove_subscription(const OSCSubscription& subscription)
+{
+    // An empty pattern removes all subscriptions of the client
+    std::vector<lo_address> removed_addresses;
+    auto removed = std::remove_if(_subscribers.begin(), _subscribers.end(), [&](const Subscriber& s)
+    {
+        if (s.host != subscription.host || s.port != subscription.port ||
+            (subscription.pattern.empty() == false && s.pattern != subscription.pattern))
+        {
+            return false;
+        }
+        removed_addresses.push_back(s.address);
+        return true;
+    });
+    if (removed != _subscribers.end())
+    {
+        _subscribers.erase(removed, _subscribers.end());
+        // Values sent before the next update_subscriptions() must not go to the freed addresses
+        _compute_sensor_subscribers();
+        _subscribers_changed = true;
+    }
+    for (auto address : removed_addresses)
+    {
+        lo_address_free(address);
+    }
+    return CommandErrorCode::OK;
+}
+
+void OSCBackend::_compute_sensor_subscribers()
+{
+    for (size_t i = 0; i < _sensor_subscribers.size(); i++)
+    {
+        auto& addresses = _sensor_subscribers[i];
+        addresses.clear();
+        if (is_input_sensor(_pin_types[i]) == false)
+        {
+            continue;
+        }
+        for (const auto& subscriber : _subscribers)
+        {
+            // Patterns can match either the full output path or the sensor name
+            const char* pattern = subscriber.pattern.c_str();
+            if (lo_pattern_match(_full_out_paths[i].c_str(), pattern) ||
+                lo_pattern_match(_sensor_names[i].c_str(), pattern))
+            {
+                addresses.push_back(subscriber.address);
+            }
+        }
+    }
+}
+
+void OSCBackend::_send_message(int sensor_index, const std::string& path, lo_message message)
+{
+    if (_subscription_mode == false)
+    {
+        if (lo_send_message(_address, path.c_str(), message) < 0)
+        {
+            _send_errors_metric->increment();
+        }
+        return;
+    }
+    for (auto address : _sensor_subscribers[sensor_index])
+    {
+        if (lo_send_message(address, path.c_str(), message) < 0)
+        {
+            _send_errors_metric->increment();
+        }
+    }
 }
\ No newline at end of file
@@ -20,6 +20,8 @@
 #ifndef SENSEI_OSC_BACKEND_H
 #define SENSEI_OSC_BACKEND_H
 
+#include <chrono>
+
 #include <lo/lo.h>
 #include "output_backend.h"
 
@@ -31,18 +33,46 @@ class OSCBackend : public OutputBackend
 public:
     OSCBackend(const int max_n_input_pins=64);
 
-    ~OSCBackend()
-    {}
+    ~OSCBackend();
 
     CommandErrorCode apply_command(const Command *cmd) override;
 
     void send(const OutputValue* transformed_value, const Value* raw_input_value) override;
 
+    void update_subscriptions(CommandIterator out_iterator) override;
+
+    void sensors_reconfigured(int first_sensor, int end_sensor) override;
+
+    void send_query_reply(const CommandContainer& values, const ValueQuery& query) override;
+
+    void send_config_reply(const CommandContainer& commands, const ValueQuery& query) override;
+
+    void send_latency_reply(const LatencyMonitor& monitor, const ValueQuery& query) override;
+
+    void send_metrics_reply(const metrics::MetricsRegistry& registry, const ValueQuery& query) override;
+
 private:
+    struct Subscriber
+    {
+        std::string pattern;
+        std::string host;
+        int port;
+        lo_address address;
+        std::chrono::steady_clock::time_point expiry;
+    };
+
     void _compute_full_paths();
 
     CommandErrorCode _compute_address();
 
+    CommandErrorCode _add_subscription(const OSCSubscription& subscription);
+
+    CommandErrorCode _remove_subscription(const OSCSubscription& subscription);
+
+    void _compute_sensor_subscribers();
+
+    void _send_message(int sensor_index, const std::string& path, lo_message message);
+
     std::string _base_path;
     std::string _base_raw_path;
     std::string _host;
@@ -51,6 +81,16 @@ private:
 
     std::vector<std::string> _full_out_paths;
     std::vector<std::string> _full_raw_paths;
+
+    // When subscription mode is on, values are sent only to subscribers
+    // instead of the configured host and port
+    bool _subscription_mode;
+    bool _subscribers_changed;
+    std::vector<Subscriber> _subscribers;
+    std::vector<std::vector<lo_address>> _sensor_subscribers;
+    std::vector<bool> _sensor_muted;
+
+    metrics::Counter* _send_errors_metric;
 };
 
 } // namespace output_backend
@@ -22,6 +22,8 @@
 
 #include "message/value_defs.h"
 #include "message/command_defs.h"
+#include "latency_monitor.h"
+#include "metrics.h"
 
 namespace sensei {
 
@@ -38,6 +40,7 @@ public:
         _sensor_names.resize(static_cast<size_t>(_max_n_pins));
         _pin_types.resize(static_cast<size_t>(_max_n_pins));
         std::fill(_pin_types.begin(), _pin_types.end(), SensorType::UNDEFINED);
+        _sensor_enabled.resize(static_cast<size_t>(_max_n_pins), false);
     }
 
     virtual ~OutputBackend()
@@ -64,6 +67,13 @@ public:
             };
             break;
 
+        case CommandType::SET_ENABLED:
+            {
+                const auto typed_cmd = static_cast<const SetEnabledCommand*>(cmd);
+                _sensor_enabled[pin_idx] = typed_cmd->data();
+            };
+            break;
+
         case CommandType::SET_SEND_OUTPUT_ENABLED:
             {
                 const auto typed_cmd = static_cast<const SetSendOutputEnabledCommand*>(cmd);
@@ -88,12 +98,95 @@ public:
 
     virtual void send(const OutputValue* transformed_value, const Value* raw_input_value) = 0;
 
+    /**
+     * @brief Expire old subscriptions and put into the given iterator the commands needed
+     *        to mute sensors that lost all their subscribers or to unmute the ones which
+     *        gained one. Backends without subscription support never produce commands.
+     *
+     * @param [out] out_iterator Iterator where to put SetEnabled commands for the hw frontend
+     */
+    virtual void update_subscriptions(CommandIterator /*out_iterator*/)
+    {}
+
+    /**
+     * @brief Tell the backend that the sensors in [first_sensor, end_sensor) were
+     *        configured again on their board, i.e. are enabled there again, so that
+     *        the next update_subscriptions() mutes them again if needed.
+     */
+    virtual void sensors_reconfigured(int /*first_sensor*/, int /*end_sensor*/)
+    {}
+
+    /**
+     * @brief Send a set of values as a single reply to a client query.
+     *
+     * @param [in] values OutputValue messages with the latest values of the queried sensors
+     * @param [in] query  The query, containing the address of the client
+     */
+    virtual void send_query_reply(const CommandContainer& /*values*/, const ValueQuery& /*query*/)
+    {}
+
+    /**
+     * @brief Send the configuration of a set of sensors as a single reply to a client query.
+     *
+     * @param [in] commands Configuration commands of the queried sensors
+     * @param [in] query    The query, containing the address of the client
+     */
+    virtual void send_config_reply(const CommandContainer& /*commands*/, const ValueQuery& /*query*/)
+    {}
+
+    /**
+     * @brief Send the latency summaries of a set of sensors as a single reply to a client query.
+     *
+     * @param [in] monitor The latency monitor to summarize
+     * @param [in] query   The query, containing the sensors and the address of the client.
+     *                     No sensors means the summary of all sensors.
+     */
+    virtual void send_latency_reply(const LatencyMonitor& /*monitor*/, const ValueQuery& /*query*/)
+    {}
+
+    /**
+     * @brief Send the current value of all metrics as a single reply to a client query.
+     *
+     * @param [in] registry The registry with the metrics
+     * @param [in] query    The query, containing the address of the client
+     */
+    virtual void send_metrics_reply(const metrics::MetricsRegistry& /*registry*/, const ValueQuery& /*query*/)
+    {}
+
+    /**
+     * @brief Set a monitor to record the latency of every value sent, or nullptr to stop
+     */
+    void set_latency_monitor(LatencyMonitor* monitor)
+    {
+        _latency_monitor = monitor;
+    }
+
 protected:
     int _max_n_pins;
     bool _send_output_active;
     bool _send_raw_input_active;
     std::vector<std::string> _sensor_names;
     std::vector<SensorType> _pin_types;
+    // Enabled state set by the configuration or the user, regardless of muting
+    std::vector<bool> _sensor_enabled;
+    LatencyMonitor* _latency_monitor{nullptr};
+
+    /**
+     * @brief To be called by send() when done, with the time it was called
+     */
+    void _record_latency(const OutputValue* transformed_value,
+                         const Value* raw_input_value,
+                         std::chrono::steady_clock::time_point mapped_time)
+    {
+        if (_latency_monitor != nullptr && raw_input_value != nullptr)
+        {
+            _latency_monitor->record(transformed_value->index(),
+                                     raw_input_value->receive_time(),
+                                     raw_input_value->dequeue_time(),
+                                     mapped_time,
+                                     std::chrono::steady_clock::now());
+        }
+    }
 };
 
 } // namespace output_backend
@@ -32,6 +32,7 @@ StandardStreamBackend::StandardStreamBackend(const int max_n_input_pins) :
 
 void StandardStreamBackend::send(const OutputValue* transformed_value, const Value* raw_input_value)
 {
+    auto mapped_time = std::chrono::steady_clock::now();
     int sensor_index = transformed_value->index();
 
     if (_send_output_active)
@@ -77,7 +78,7 @@ void StandardStreamBackend::send(const OutputValue* transformed_value, const Val
             break;
         }
     }
-
+    _record_latency(transformed_value, raw_input_value, mapped_time);
 }
 
 CommandErrorCode StandardStreamBackend::apply_command(const Command *cmd)
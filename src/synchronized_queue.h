@@ -20,9 +20,12 @@
 #ifndef SENSEI_SYNCHRONIZED_QUEUE_H
 #define SENSEI_SYNCHRONIZED_QUEUE_H
 
+#include <algorithm>
 #include <condition_variable>
 #include <chrono>
+#include <vector>
 #include "locked_queue.h"
+#include "metrics.h"
 
 template <class T> class SynchronizedQueue
 {
@@ -31,6 +34,7 @@ public:
     {
         std::lock_guard<std::mutex> lock(_queue_mutex);
         _queue.push_front(message);
+        _update_depth_metrics();
         _notifier.notify_one();
     }
 
@@ -38,6 +42,23 @@ public:
     {
         std::lock_guard<std::mutex> lock(_queue_mutex);
         _queue.push_front(std::move(message));
+        _update_depth_metrics();
+        _notifier.notify_one();
+    }
+
+    /**
+     * @brief Push all the elements of messages with a single lock and notification,
+     *        messages is left empty but keeps its capacity
+     */
+    void push_all(std::vector<T>& messages)
+    {
+        std::lock_guard<std::mutex> lock(_queue_mutex);
+        for (auto& message : messages)
+        {
+            _queue.push_front(std::move(message));
+        }
+        messages.clear();
+        _update_depth_metrics();
         _notifier.notify_one();
     }
 
@@ -46,6 +67,7 @@ public:
         std::lock_guard<std::mutex> lock(_queue_mutex);
         T message = std::move(_queue.back());
         _queue.pop_back();
+        _update_depth_metrics();
         return std::move(message);
     }
 
@@ -62,11 +84,62 @@ public:
     {
         return _queue.empty();
     }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(_queue_mutex);
+        return _queue.size();
+    }
+
+    /**
+     * @brief The deepest the queue has been since the last call to reset_max_size()
+     */
+    size_t max_size()
+    {
+        std::lock_guard<std::mutex> lock(_queue_mutex);
+        return _max_size;
+    }
+
+    void reset_max_size()
+    {
+        std::lock_guard<std::mutex> lock(_queue_mutex);
+        _max_size = _queue.size();
+    }
+
+    /**
+     * @brief Keep the given gauges updated with the depth of the queue and the
+     *        deepest it has been. Either can be nullptr to not update it
+     */
+    void set_depth_metrics(sensei::metrics::Gauge* depth, sensei::metrics::Gauge* high_water)
+    {
+        std::lock_guard<std::mutex> lock(_queue_mutex);
+        _depth_gauge = depth;
+        _high_water_gauge = high_water;
+        _update_depth_metrics();
+    }
+
 private:
+    void _update_depth_metrics()
+    {
+        _max_size = std::max(_max_size, _queue.size());
+        auto depth = static_cast<int64_t>(_queue.size());
+        if (_depth_gauge != nullptr)
+        {
+            _depth_gauge->set(depth);
+        }
+        if (_high_water_gauge != nullptr)
+        {
+            _high_water_gauge->update_max(depth);
+        }
+    }
+
     std::deque<T>           _queue;
     std::mutex              _queue_mutex;
     std::mutex              _wait_mutex;
     std::condition_variable _notifier;
+    size_t                  _max_size{0};
+    sensei::metrics::Gauge* _depth_gauge{nullptr};
+    sensei::metrics::Gauge* _high_water_gauge{nullptr};
 };
 
 #endif //SENSEI_SYNCHRONIZED_QUEUE_H
\ No newline at end of file
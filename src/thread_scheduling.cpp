@@ -0,0 +1,181 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Scheduling policy, priority and cpu affinity of sensei threads
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <ctime>
+#include <sched.h>
+
+#include "thread_scheduling.h"
+#include "logging.h"
+
+namespace sensei {
+
+constexpr int LATENCY_MEASUREMENT_ITERATIONS = 50;
+constexpr auto LATENCY_MEASUREMENT_PERIOD = std::chrono::microseconds(200);
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("scheduling");
+
+namespace {
+
+struct RegisteredThread
+{
+    std::string name;
+    clockid_t   cpu_clock;
+};
+
+std::mutex registered_threads_mutex;
+std::vector<RegisteredThread> registered_threads;
+
+bool read_cpu_clock(clockid_t clock, std::chrono::nanoseconds& time)
+{
+    timespec ts;
+    if (clock_gettime(clock, &ts) != 0)
+    {
+        return false;
+    }
+    time = std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+    return true;
+}
+
+int to_posix_policy(SchedulingPolicy policy)
+{
+    switch (policy)
+    {
+        case SchedulingPolicy::FIFO:
+            return SCHED_FIFO;
+
+        case SchedulingPolicy::RR:
+            return SCHED_RR;
+
+        default:
+            return SCHED_OTHER;
+    }
+}
+
+} // anonymous namespace
+
+bool apply_thread_scheduling(pthread_t thread, const ThreadSchedulingConfig& config, [[maybe_unused]] const char* name)
+{
+    bool success = true;
+    if (config.policy != SchedulingPolicy::INHERIT)
+    {
+        int policy = to_posix_policy(config.policy);
+        sched_param param = {};
+        param.sched_priority = policy == SCHED_OTHER ? 0 : config.priority;
+        int res = pthread_setschedparam(thread, policy, &param);
+        if (res != 0)
+        {
+            SENSEI_LOG_ERROR("Failed to set scheduling policy {} with priority {} for {} thread: {}",
+                             policy, param.sched_priority, name, strerror(res));
+            success = false;
+        }
+    }
+    if (config.cpus.empty() == false)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (int cpu : config.cpus)
+        {
+            if (cpu < 0 || cpu >= CPU_SETSIZE)
+            {
+                SENSEI_LOG_ERROR("Invalid cpu {} in affinity of {} thread", cpu, name);
+                return false;
+            }
+            CPU_SET(cpu, &cpuset);
+        }
+        int res = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+        if (res != 0)
+        {
+            SENSEI_LOG_ERROR("Failed to set cpu affinity of {} thread: {}", name, strerror(res));
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool apply_current_thread_scheduling(const ThreadSchedulingConfig& config, const char* name)
+{
+    register_thread(pthread_self(), name);
+    if (config.is_set() == false)
+    {
+        return true;
+    }
+    bool success = apply_thread_scheduling(pthread_self(), config, name);
+    [[maybe_unused]] auto stats = measure_scheduling_latency(LATENCY_MEASUREMENT_ITERATIONS, LATENCY_MEASUREMENT_PERIOD);
+    SENSEI_LOG_INFO("{} thread wakeup latency: mean {} us, max {} us over {} sleeps", name,
+                    stats.mean.count(), stats.max.count(), stats.samples);
+    return success;
+}
+
+SchedulingLatencyStatistics measure_scheduling_latency(int iterations, std::chrono::microseconds period)
+{
+    SchedulingLatencyStatistics stats;
+    std::chrono::microseconds sum{0};
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto wakeup_time = std::chrono::steady_clock::now() + period;
+        std::this_thread::sleep_until(wakeup_time);
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wakeup_time);
+        sum += latency;
+        stats.max = std::max(stats.max, latency);
+        stats.samples++;
+    }
+    if (stats.samples > 0)
+    {
+        stats.mean = sum / stats.samples;
+    }
+    return stats;
+}
+
+void register_thread(pthread_t thread, const char* name)
+{
+    clockid_t cpu_clock;
+    if (pthread_getcpuclockid(thread, &cpu_clock) != 0)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(registered_threads_mutex);
+    /* Forget the threads that have exited, and the thread itself if it's registered again */
+    std::chrono::nanoseconds time;
+    registered_threads.erase(std::remove_if(registered_threads.begin(), registered_threads.end(), [&](const auto& t)
+    {
+        return t.cpu_clock == cpu_clock || read_cpu_clock(t.cpu_clock, time) == false;
+    }), registered_threads.end());
+    registered_threads.push_back({name, cpu_clock});
+}
+
+std::vector<ThreadCpuTime> thread_cpu_times()
+{
+    std::vector<ThreadCpuTime> times;
+    std::lock_guard<std::mutex> lock(registered_threads_mutex);
+    for (const auto& thread : registered_threads)
+    {
+        std::chrono::nanoseconds time;
+        if (read_cpu_clock(thread.cpu_clock, time))
+        {
+            times.push_back({thread.name, time});
+        }
+    }
+    return times;
+}
+
+} // namespace sensei
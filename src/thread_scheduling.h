@@ -0,0 +1,123 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Scheduling policy, priority and cpu affinity of sensei threads
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#ifndef SENSEI_THREAD_SCHEDULING_H
+#define SENSEI_THREAD_SCHEDULING_H
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <pthread.h>
+
+namespace sensei {
+
+enum class SchedulingPolicy
+{
+    INHERIT,
+    OTHER,
+    FIFO,
+    RR
+};
+
+/**
+ * @brief Scheduling configuration of a single thread. Threads with the
+ *        default configuration are left untouched.
+ */
+struct ThreadSchedulingConfig
+{
+    SchedulingPolicy policy{SchedulingPolicy::INHERIT};
+    int              priority{0};
+    std::vector<int> cpus;
+
+    bool is_set() const
+    {
+        return policy != SchedulingPolicy::INHERIT || cpus.empty() == false;
+    }
+};
+
+/**
+ * @brief Scheduling configuration of all the threads started by sensei
+ */
+struct ThreadsConfig
+{
+    ThreadSchedulingConfig event_loop;
+    ThreadSchedulingConfig hw_frontend_read;
+    ThreadSchedulingConfig hw_frontend_write;
+    ThreadSchedulingConfig user_frontend;
+    ThreadSchedulingConfig logger;
+};
+
+struct ThreadCpuTime
+{
+    std::string name;
+    std::chrono::nanoseconds cpu_time;
+};
+
+struct SchedulingLatencyStatistics
+{
+    std::chrono::microseconds mean{0};
+    std::chrono::microseconds max{0};
+    int samples{0};
+};
+
+/**
+ * @brief Set the scheduling policy, priority and cpu affinity of a thread.
+ *        Failures are logged with the name of the thread.
+ * @param [in] thread The thread to configure
+ * @param [in] config The configuration to apply
+ * @param [in] name Name of the thread, for logging
+ * @return true if the whole configuration could be applied
+ */
+bool apply_thread_scheduling(pthread_t thread, const ThreadSchedulingConfig& config, const char* name);
+
+/**
+ * @brief Configure the calling thread and register it for cpu time accounting.
+ *        If a configuration is set, also measure and log how late the thread
+ *        wakes up from short sleeps. Meant to be called first thing in the
+ *        entry function of a thread.
+ * @param [in] config The configuration to apply
+ * @param [in] name Name of the thread, for logging
+ * @return true if the whole configuration could be applied
+ */
+bool apply_current_thread_scheduling(const ThreadSchedulingConfig& config, const char* name);
+
+/**
+ * @brief Measure the scheduling latency of the calling thread, i.e. how
+ *        much later than requested it wakes up from a sleep.
+ * @param [in] iterations The number of sleeps to measure
+ * @param [in] period The requested length of each sleep
+ * @return The wakeup latency statistics
+ */
+SchedulingLatencyStatistics measure_scheduling_latency(int iterations, std::chrono::microseconds period);
+
+/**
+ * @brief Register a thread so that its cpu time is included in thread_cpu_times()
+ * @param [in] thread The thread to register
+ * @param [in] name Name of the thread in the report
+ */
+void register_thread(pthread_t thread, const char* name);
+
+/**
+ * @brief Returns the cpu time used so far by each registered thread that is still running
+ */
+std::vector<ThreadCpuTime> thread_cpu_times();
+
+} // namespace sensei
+
+#endif //SENSEI_THREAD_SCHEDULING_H
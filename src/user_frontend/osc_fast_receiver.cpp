@@ -0,0 +1,245 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Optional lightweight OSC receiver for high rate output updates
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <cstring>
+
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "osc_fast_receiver.h"
+#include "logging.h"
+
+using namespace sensei;
+using namespace sensei::user_frontend;
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("osc_fast_receiver");
+
+namespace {
+
+constexpr int POLL_TIMEOUT_MS = 100;
+constexpr size_t MAX_OUTPUT_VALUES = 256;
+
+}; // anonymous namespace
+
+OSCFastReceiver::OSCFastReceiver(SynchronizedQueue<std::unique_ptr<BaseMessage>>* queue,
+                                 const ThreadSchedulingConfig& thread_scheduling) :
+        _queue(queue),
+        _socket(-1),
+        _running(false),
+        _thread_scheduling(thread_scheduling)
+{
+    _pending_messages.reserve(FAST_RECEIVER_BATCH_SIZE);
+    _output_values.reserve(MAX_OUTPUT_VALUES);
+#ifdef __linux__
+    for (int i = 0; i < FAST_RECEIVER_BATCH_SIZE; ++i)
+    {
+        _iovecs[i].iov_base = _buffers[i].data();
+        _iovecs[i].iov_len = _buffers[i].size();
+        std::memset(&_headers[i], 0, sizeof(mmsghdr));
+        _headers[i].msg_hdr.msg_iov = &_iovecs[i];
+        _headers[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+}
+
+OSCFastReceiver::~OSCFastReceiver()
+{
+    stop();
+}
+
+bool OSCFastReceiver::start(int port)
+{
+    stop();
+    _socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_socket < 0 || fcntl(_socket, F_SETFL, O_NONBLOCK) != 0)
+    {
+        SENSEI_LOG_ERROR("Failed to create socket: {}", strerror(errno));
+        return false;
+    }
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        SENSEI_LOG_ERROR("Failed to bind to port {}: {}", port, strerror(errno));
+        close(_socket);
+        _socket = -1;
+        return false;
+    }
+    SENSEI_LOG_INFO("Fast OSC receiver listening on port {}", port);
+    _running = true;
+    _receive_thread = std::thread(&OSCFastReceiver::_receive_loop, this);
+    return true;
+}
+
+void OSCFastReceiver::stop()
+{
+    _running = false;
+    if (_receive_thread.joinable())
+    {
+        _receive_thread.join();
+    }
+    if (_socket >= 0)
+    {
+        close(_socket);
+        _socket = -1;
+    }
+}
+
+void OSCFastReceiver::_receive_loop()
+{
+    apply_current_thread_scheduling(_thread_scheduling, "osc fast receiver");
+    pollfd poll_fd{_socket, POLLIN, 0};
+    while (_running)
+    {
+        int ret = poll(&poll_fd, 1, POLL_TIMEOUT_MS);
+        if (ret <= 0)
+        {
+            continue;
+        }
+        // Drain the socket completely before going back to sleep
+        while (_receive_batch() == FAST_RECEIVER_BATCH_SIZE)
+        {}
+    }
+}
+
+int OSCFastReceiver::_receive_batch()
+{
+    int received = 0;
+#ifdef __linux__
+    received = recvmmsg(_socket, _headers.data(), FAST_RECEIVER_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+    for (int i = 0; i < received; ++i)
+    {
+        _handle_packet(_buffers[i].data(), _headers[i].msg_len);
+    }
+#else
+    while (received < FAST_RECEIVER_BATCH_SIZE)
+    {
+        auto bytes = recv(_socket, _buffers[0].data(), _buffers[0].size(), MSG_DONTWAIT);
+        if (bytes <= 0)
+        {
+            break;
+        }
+        _handle_packet(_buffers[0].data(), static_cast<size_t>(bytes));
+        ++received;
+    }
+#endif
+    if (_pending_messages.empty() == false)
+    {
+        _queue->push_all(_pending_messages);
+    }
+    return received;
+}
+
+void OSCFastReceiver::_handle_packet(const char* data, size_t size)
+{
+    auto handler = [this](const osc_parser::OscMessageView& message)
+    {
+        _handle_message(message);
+    };
+    osc_parser::parse_packet(data, size, _parsed_message, handler);
+
+    // All output values from a packet, i.e. a whole bundle, are queued as one batch
+    if (_output_values.size() == 1)
+    {
+        _pending_messages.push_back(_factory.make_float_set_value(_output_values[0].index, _output_values[0].value));
+    }
+    else if (_output_values.size() > 1)
+    {
+        _pending_messages.push_back(_factory.make_float_set_batch_value(_output_values));
+    }
+    _output_values.clear();
+}
+
+void OSCFastReceiver::_handle_message(const osc_parser::OscMessageView& message)
+{
+    if (message.argc < 2 || message.types[0] != 'i')
+    {
+        return;
+    }
+    int index = message.argv[0].i;
+    switch (message.address)
+    {
+        case osc_parser::OscAddress::SET_ENABLED:
+            if (message.types[1] == 'i')
+            {
+                _pending_messages.push_back(_factory.make_set_enabled_command(index, message.argv[1].i != 0));
+            }
+            break;
+
+        case osc_parser::OscAddress::SET_OUTPUT:
+            if (message.types[1] == 'f')
+            {
+                _output_values.push_back({index, message.argv[1].f});
+            }
+            break;
+
+        case osc_parser::OscAddress::SET_OUTPUTS:
+            _add_output_values(message);
+            break;
+
+        case osc_parser::OscAddress::SET_DIGITAL_OUTPUT:
+            if (message.types[1] == 'i')
+            {
+                _pending_messages.push_back(_factory.make_integer_set_value(index, message.argv[1].i != 0 ? 1 : 0));
+            }
+            break;
+
+        case osc_parser::OscAddress::SET_RANGE_OUTPUT:
+            if (message.types[1] == 'i')
+            {
+                _pending_messages.push_back(_factory.make_integer_set_value(index, message.argv[1].i));
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void OSCFastReceiver::_add_output_values(const osc_parser::OscMessageView& message)
+{
+    // Either a first index followed by a blob of consecutive float32 values
+    if (message.argc == 2 && message.types[1] == 'b')
+    {
+        int first_index = message.argv[0].i;
+        int n_values = message.argv[1].b.size / 4;
+        for (int i = 0; i < n_values; ++i)
+        {
+            int32_t raw = osc_parser::read_int32(message.argv[1].b.data + 4 * i);
+            float value;
+            std::memcpy(&value, &raw, sizeof(value));
+            _output_values.push_back({first_index + i, value});
+        }
+        return;
+    }
+    // Or index and value pairs
+    for (int i = 0; i + 1 < message.argc; i += 2)
+    {
+        if (message.types[i] != 'i' || message.types[i + 1] != 'f')
+        {
+            return;
+        }
+        _output_values.push_back({message.argv[i].i, message.argv[i + 1].f});
+    }
+}
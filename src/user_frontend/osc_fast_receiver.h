@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Optional lightweight OSC receiver for high rate output updates
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Listens on its own UDP port, drains the socket in batches and parses the
+ * messages with osc_parser, bypassing liblo. All the messages received in
+ * one batch are put in the event queue with a single queue operation, and
+ * all the output values in a packet or bundle are queued as a single batch.
+ *
+ * Handled OSC paths and arguments:
+ *
+ *  /set_enabled        ii
+ *  /set_output         if
+ *  /set_outputs        ifif.. or ib (see OSCUserFrontend)
+ *  /set_digital_output ii
+ *  /set_range_output   ii
+ */
+#ifndef SENSEI_OSC_FAST_RECEIVER_H
+#define SENSEI_OSC_FAST_RECEIVER_H
+
+#include <array>
+#include <atomic>
+#include <thread>
+
+#include <sys/socket.h>
+
+#include "synchronized_queue.h"
+#include "message/message_factory.h"
+#include "user_frontend/osc_parser.h"
+#include "thread_scheduling.h"
+
+namespace sensei {
+namespace user_frontend {
+
+constexpr int FAST_RECEIVER_BATCH_SIZE = 32;
+constexpr size_t FAST_RECEIVER_MAX_PACKET_SIZE = 1536;
+
+class OSCFastReceiver
+{
+public:
+    OSCFastReceiver(SynchronizedQueue<std::unique_ptr<BaseMessage>>* queue,
+                    const ThreadSchedulingConfig& thread_scheduling = ThreadSchedulingConfig());
+
+    ~OSCFastReceiver();
+
+    /**
+     * @brief Open the socket and start the receiving thread
+     *
+     * @param [in] port UDP port to listen to
+     *
+     * @return true if the socket could be opened
+     */
+    bool start(int port);
+
+    void stop();
+
+    bool running() const
+    {
+        return _running;
+    }
+
+private:
+    void _receive_loop();
+
+    int _receive_batch();
+
+    void _handle_packet(const char* data, size_t size);
+
+    void _handle_message(const osc_parser::OscMessageView& message);
+
+    void _add_output_values(const osc_parser::OscMessageView& message);
+
+    SynchronizedQueue<std::unique_ptr<BaseMessage>>* _queue;
+    MessageFactory _factory;
+    CommandContainer _pending_messages;
+    std::vector<OutputUpdate> _output_values;
+    int _socket;
+    std::atomic<bool> _running;
+    std::thread _receive_thread;
+    ThreadSchedulingConfig _thread_scheduling;
+
+    osc_parser::OscMessageView _parsed_message;
+    std::array<std::array<char, FAST_RECEIVER_MAX_PACKET_SIZE>, FAST_RECEIVER_BATCH_SIZE> _buffers;
+#ifdef __linux__
+    std::array<mmsghdr, FAST_RECEIVER_BATCH_SIZE> _headers;
+    std::array<iovec, FAST_RECEIVER_BATCH_SIZE> _iovecs;
+#endif
+};
+
+} // namespace user_frontend
+} // namespace sensei
+
+#endif //SENSEI_OSC_FAST_RECEIVER_H
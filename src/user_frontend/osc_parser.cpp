@@ -0,0 +1,220 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Allocation free parser for the OSC packets handled by the fast receiver
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <array>
+#include <cstring>
+#include <arpa/inet.h>
+
+#include "osc_parser.h"
+
+namespace sensei {
+namespace user_frontend {
+namespace osc_parser {
+
+namespace {
+
+struct AddressEntry
+{
+    const char* path;
+    OscAddress  address;
+};
+
+constexpr AddressEntry ADDRESSES[] = {{"/set_enabled",        OscAddress::SET_ENABLED},
+                                      {"/set_output",         OscAddress::SET_OUTPUT},
+                                      {"/set_outputs",        OscAddress::SET_OUTPUTS},
+                                      {"/set_digital_output", OscAddress::SET_DIGITAL_OUTPUT},
+                                      {"/set_range_output",   OscAddress::SET_RANGE_OUTPUT}};
+
+constexpr int N_ADDRESSES = sizeof(ADDRESSES) / sizeof(AddressEntry);
+constexpr uint32_t HASH_TABLE_SIZE = 16;
+
+constexpr size_t const_strlen(const char* str)
+{
+    size_t length = 0;
+    while (str[length] != '\0')
+    {
+        ++length;
+    }
+    return length;
+}
+
+// FNV-1a, reduced to the table size
+constexpr uint32_t hash(const char* str, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash = (hash ^ static_cast<uint8_t>(str[i])) * 16777619u;
+    }
+    return hash % HASH_TABLE_SIZE;
+}
+
+constexpr bool hash_is_perfect()
+{
+    for (int i = 0; i < N_ADDRESSES; ++i)
+    {
+        for (int j = i + 1; j < N_ADDRESSES; ++j)
+        {
+            if (hash(ADDRESSES[i].path, const_strlen(ADDRESSES[i].path)) ==
+                hash(ADDRESSES[j].path, const_strlen(ADDRESSES[j].path)))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(hash_is_perfect(), "OSC address hash has collisions, change HASH_TABLE_SIZE");
+
+constexpr std::array<int, HASH_TABLE_SIZE> make_hash_table()
+{
+    std::array<int, HASH_TABLE_SIZE> table{};
+    for (auto& slot : table)
+    {
+        slot = -1;
+    }
+    for (int i = 0; i < N_ADDRESSES; ++i)
+    {
+        table[hash(ADDRESSES[i].path, const_strlen(ADDRESSES[i].path))] = i;
+    }
+    return table;
+}
+
+constexpr auto HASH_TABLE = make_hash_table();
+
+/* OSC strings are null terminated and padded to a multiple of 4 bytes,
+ * returns the padded size or 0 if the string is not terminated in the buffer */
+size_t padded_string_size(const char* data, size_t size)
+{
+    auto end = static_cast<const char*>(std::memchr(data, '\0', size));
+    if (end == nullptr)
+    {
+        return 0;
+    }
+    size_t padded = ((end - data) / 4 + 1) * 4;
+    return padded <= size ? padded : 0;
+}
+
+} // anonymous namespace
+
+int32_t read_int32(const char* data)
+{
+    uint32_t raw;
+    std::memcpy(&raw, data, sizeof(raw));
+    return static_cast<int32_t>(ntohl(raw));
+}
+
+bool is_bundle(const char* data, size_t size)
+{
+    return size >= BUNDLE_HEADER_SIZE && std::memcmp(data, "#bundle", 8) == 0;
+}
+
+OscAddress lookup_address(const char* address, size_t length)
+{
+    int index = HASH_TABLE[hash(address, length)];
+    if (index < 0)
+    {
+        return OscAddress::UNKNOWN;
+    }
+    const char* path = ADDRESSES[index].path;
+    if (const_strlen(path) != length || std::memcmp(path, address, length) != 0)
+    {
+        return OscAddress::UNKNOWN;
+    }
+    return ADDRESSES[index].address;
+}
+
+bool parse_message(const char* data, size_t size, OscMessageView& message)
+{
+    if (size < 8 || size % 4 != 0 || data[0] != '/')
+    {
+        return false;
+    }
+    size_t address_size = padded_string_size(data, size);
+    if (address_size == 0)
+    {
+        return false;
+    }
+    message.address = lookup_address(data, std::strlen(data));
+    if (message.address == OscAddress::UNKNOWN)
+    {
+        return false;
+    }
+
+    const char* types = data + address_size;
+    size_t remaining = size - address_size;
+    size_t types_size = padded_string_size(types, remaining);
+    if (types_size == 0 || types[0] != ',')
+    {
+        return false;
+    }
+    const char* args = types + types_size;
+    remaining -= types_size;
+
+    int argc = 0;
+    for (const char* type = types + 1; *type != '\0'; ++type)
+    {
+        if (argc >= MAX_ARGUMENTS || remaining < 4)
+        {
+            return false;
+        }
+        switch (*type)
+        {
+            case 'i':
+                message.argv[argc].i = read_int32(args);
+                break;
+
+            case 'f':
+            {
+                int32_t raw = read_int32(args);
+                std::memcpy(&message.argv[argc].f, &raw, sizeof(float));
+                break;
+            }
+
+            case 'b':
+            {
+                int32_t blob_size = read_int32(args);
+                size_t padded_size = (static_cast<size_t>(blob_size) + 3) / 4 * 4;
+                if (blob_size < 0 || padded_size > remaining - 4)
+                {
+                    return false;
+                }
+                message.argv[argc].b.data = args + 4;
+                message.argv[argc].b.size = blob_size;
+                args += padded_size;
+                remaining -= padded_size;
+                break;
+            }
+
+            default:
+                return false;
+        }
+        message.types[argc] = *type;
+        args += 4;
+        remaining -= 4;
+        ++argc;
+    }
+    message.argc = argc;
+    return true;
+}
+
+} // namespace osc_parser
+} // namespace user_frontend
+} // namespace sensei
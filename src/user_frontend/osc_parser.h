@@ -0,0 +1,147 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Allocation free parser for the OSC messages handled by the fast receiver
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Only the fixed set of addresses in OscAddress is recognised, addresses are
+ * looked up with a perfect hash computed at compile time. Only int32, float and
+ * blob arguments are supported, which covers all the messages of the user frontend.
+ * Bundles are unpacked recursively, their time tags are ignored.
+ */
+#ifndef SENSEI_OSC_PARSER_H
+#define SENSEI_OSC_PARSER_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace sensei {
+namespace user_frontend {
+namespace osc_parser {
+
+constexpr int MAX_ARGUMENTS = 128;
+constexpr int MAX_BUNDLE_DEPTH = 4;
+constexpr size_t BUNDLE_HEADER_SIZE = 16;
+
+enum class OscAddress
+{
+    SET_ENABLED,
+    SET_OUTPUT,
+    SET_OUTPUTS,
+    SET_DIGITAL_OUTPUT,
+    SET_RANGE_OUTPUT,
+    UNKNOWN
+};
+
+union OscArgument
+{
+    int32_t i;
+    float   f;
+    struct
+    {
+        const char* data;
+        int32_t     size;
+    } b;
+};
+
+/**
+ * @brief A parsed message, arguments are copied out of the packet except
+ *        for blobs, which point into the packet buffer
+ */
+struct OscMessageView
+{
+    OscAddress  address;
+    int         argc;
+    char        types[MAX_ARGUMENTS];
+    OscArgument argv[MAX_ARGUMENTS];
+};
+
+/**
+ * @brief Look up an OSC address among the ones known by the parser
+ *
+ * @param [in] address OSC address, not necessarily null terminated
+ * @param [in] length  Length of address
+ *
+ * @return The matching address or OscAddress::UNKNOWN
+ */
+OscAddress lookup_address(const char* address, size_t length);
+
+/**
+ * @brief Parse a single OSC message
+ *
+ * @param [in] data     Start of the message
+ * @param [in] size     Size of the message in bytes
+ * @param [out] message Parsed message
+ *
+ * @return true if the message is well formed, has a known address and
+ *         only int32 and float arguments
+ */
+bool parse_message(const char* data, size_t size, OscMessageView& message);
+
+/**
+ * @brief Read a big endian int32 from an unaligned buffer
+ */
+int32_t read_int32(const char* data);
+
+/**
+ * @brief Check if an OSC packet is a bundle
+ */
+bool is_bundle(const char* data, size_t size);
+
+/**
+ * @brief Parse an OSC packet, either a single message or a bundle,
+ *        calling callback(const OscMessageView&) for every valid message.
+ *
+ * @param [in] data     Start of the packet
+ * @param [in] size     Size of the packet in bytes
+ * @param [out] message Storage for the message passed to the callback
+ * @param [in] callback Called with every parsed message
+ * @param [in] depth    Bundle nesting depth, used internally
+ */
+template <typename Callback>
+void parse_packet(const char* data, size_t size, OscMessageView& message, Callback& callback, int depth = 0)
+{
+    if (is_bundle(data, size) == false)
+    {
+        if (parse_message(data, size, message))
+        {
+            callback(message);
+        }
+        return;
+    }
+    if (depth >= MAX_BUNDLE_DEPTH)
+    {
+        return;
+    }
+    size_t offset = BUNDLE_HEADER_SIZE;
+    while (offset + 4 <= size)
+    {
+        int32_t element_size = read_int32(data + offset);
+        offset += 4;
+        if (element_size < 0 || static_cast<size_t>(element_size) > size - offset)
+        {
+            return;
+        }
+        parse_packet(data + offset, element_size, message, callback, depth + 1);
+        offset += element_size;
+    }
+}
+
+} // namespace osc_parser
+} // namespace user_frontend
+} // namespace sensei
+
+#endif //SENSEI_OSC_PARSER_H
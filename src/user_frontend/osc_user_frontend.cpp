@@ -21,6 +21,11 @@
 #include "logging.h"
 
 #include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <arpa/inet.h>
 
 using namespace sensei;
 using namespace sensei::user_frontend;
@@ -30,6 +35,7 @@ SENSEI_GET_LOGGER_WITH_MODULE_NAME("osc_frontend");
 namespace
 {
 static const int DEFAULT_SERVER_PORT = 23024;
+static const int MAX_OUTPUTS_PER_MESSAGE = 256;
 
 static void osc_error(int num, const char *msg, const char *path)
 {
@@ -62,14 +68,63 @@ static int osc_set_digital_output(const char* /*path*/, const char* /*types*/, l
 static int osc_set_continuous_output(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int /*argc*/, void* /*data*/, void *user_data)
 {
     OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
-    int id = argv[0]->i;
-    float value = argv[1]->f;
-    self->set_continuous_output(id, value);
-    SENSEI_LOG_DEBUG("Sending value {} to output {}", value, id);
+    OutputUpdate update{argv[0]->i, argv[1]->f};
+    self->add_output_values(&update, 1);
+    SENSEI_LOG_DEBUG("Sending value {} to output {}", update.value, update.index);
 
     return 0;
 }
 
+static int osc_set_continuous_outputs(const char* /*path*/, const char* types, lo_arg ** argv, int argc, void* /*data*/, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    std::array<OutputUpdate, MAX_OUTPUTS_PER_MESSAGE> updates;
+    int count = 0;
+
+    if (argc == 2 && types[0] == 'i' && types[1] == 'b')
+    {
+        int first_index = argv[0]->i;
+        auto blob_data = static_cast<const char*>(lo_blob_dataptr(argv[1]));
+        int n_values = std::min(static_cast<int>(lo_blob_datasize(argv[1]) / 4), MAX_OUTPUTS_PER_MESSAGE);
+        for (; count < n_values; ++count)
+        {
+            uint32_t raw;
+            std::memcpy(&raw, blob_data + 4 * count, sizeof(raw));
+            raw = ntohl(raw);
+            updates[count].index = first_index + count;
+            std::memcpy(&updates[count].value, &raw, sizeof(float));
+        }
+    }
+    else
+    {
+        for (int i = 0; i + 1 < argc && count < MAX_OUTPUTS_PER_MESSAGE; i += 2)
+        {
+            if (types[i] != 'i' || types[i + 1] != 'f')
+            {
+                SENSEI_LOG_WARNING("Malformed /set_outputs message with types {}", types);
+                return 0;
+            }
+            updates[count++] = {argv[i]->i, argv[i + 1]->f};
+        }
+    }
+    self->add_output_values(updates.data(), count);
+    SENSEI_LOG_DEBUG("Sending {} output values", count);
+
+    return 0;
+}
+
+static int osc_bundle_start(lo_timetag /*time*/, void *user_data)
+{
+    static_cast<OSCUserFrontend*>(user_data)->begin_bundle();
+    return 0;
+}
+
+static int osc_bundle_end(void *user_data)
+{
+    static_cast<OSCUserFrontend*>(user_data)->end_bundle();
+    return 0;
+}
+
 static int osc_set_range_output(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int /*argc*/, void* /*data*/, void *user_data)
 {
     OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
@@ -81,14 +136,185 @@ static int osc_set_range_output(const char* /*path*/, const char* /*types*/, lo_
     return 0;
 }
 
+static int osc_subscribe(const char* /*path*/, const char* types, lo_arg ** argv, int argc, void* data, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    lo_address source = lo_message_get_source(static_cast<lo_message>(data));
+    std::string pattern(&argv[0]->s);
+    std::string host(lo_address_get_hostname(source));
+    int port = (argc == 3 && types[1] == 'i')? argv[1]->i : std::atoi(lo_address_get_port(source));
+    int lease_s = argv[argc - 1]->i;
+    self->subscribe(pattern, host, port, lease_s);
+    SENSEI_LOG_DEBUG("Subscribing {}:{} to {}", host, port, pattern);
+
+    return 0;
+}
+
+static int osc_unsubscribe(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int argc, void* data, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    lo_address source = lo_message_get_source(static_cast<lo_message>(data));
+    std::string pattern(&argv[0]->s);
+    std::string host(lo_address_get_hostname(source));
+    int port = (argc == 2)? argv[1]->i : std::atoi(lo_address_get_port(source));
+    self->unsubscribe(pattern, host, port);
+    SENSEI_LOG_DEBUG("Unsubscribing {}:{} from {}", host, port, pattern);
+
+    return 0;
+}
+
+static bool read_sensor_list(const char* types, lo_arg ** argv, int argc, std::vector<int>& sensors)
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        if (types[i] != 'i')
+        {
+            return false;
+        }
+        sensors.push_back(argv[i]->i);
+    }
+    return true;
+}
+
+static int osc_get_values(const char* /*path*/, const char* types, lo_arg ** argv, int argc, void* data, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    std::vector<int> sensors;
+    if (read_sensor_list(types, argv, argc, sensors) == false)
+    {
+        SENSEI_LOG_WARNING("Value query with non integer argument, ignoring");
+        return 0;
+    }
+    lo_address source = lo_message_get_source(static_cast<lo_message>(data));
+    self->query_values(sensors, lo_address_get_hostname(source), std::atoi(lo_address_get_port(source)));
+    SENSEI_LOG_DEBUG("Querying values of {} sensors", sensors.size());
+
+    return 0;
+}
+
+static int osc_get_config(const char* /*path*/, const char* types, lo_arg ** argv, int argc, void* data, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    std::vector<int> sensors;
+    if (read_sensor_list(types, argv, argc, sensors) == false)
+    {
+        SENSEI_LOG_WARNING("Config query with non integer argument, ignoring");
+        return 0;
+    }
+    lo_address source = lo_message_get_source(static_cast<lo_message>(data));
+    self->query_config(sensors, lo_address_get_hostname(source), std::atoi(lo_address_get_port(source)));
+    SENSEI_LOG_DEBUG("Querying config of {} sensors", sensors.size());
+
+    return 0;
+}
+
+static int osc_get_latency(const char* /*path*/, const char* types, lo_arg ** argv, int argc, void* data, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    std::vector<int> sensors;
+    if (read_sensor_list(types, argv, argc, sensors) == false)
+    {
+        SENSEI_LOG_WARNING("Latency query with non integer argument, ignoring");
+        return 0;
+    }
+    lo_address source = lo_message_get_source(static_cast<lo_message>(data));
+    self->query_latency(sensors, lo_address_get_hostname(source), std::atoi(lo_address_get_port(source)));
+    SENSEI_LOG_DEBUG("Querying latency of {} sensors", sensors.size());
+
+    return 0;
+}
+
+static int osc_get_metrics(const char* /*path*/, const char* /*types*/, lo_arg ** /*argv*/, int /*argc*/, void* data, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    lo_address source = lo_message_get_source(static_cast<lo_message>(data));
+    self->query_metrics(lo_address_get_hostname(source), std::atoi(lo_address_get_port(source)));
+    SENSEI_LOG_DEBUG("Querying metrics");
+
+    return 0;
+}
+
+static int osc_set_sending_mode(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int /*argc*/, void* /*data*/, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    int id = argv[0]->i;
+    const char* mode_str = &argv[1]->s;
+    auto mode = std::find_if(SENDING_MODE_NAMES.begin(), SENDING_MODE_NAMES.end(),
+                             [&](const char* name) { return std::strcmp(name, mode_str) == 0; });
+    if (mode == SENDING_MODE_NAMES.end())
+    {
+        SENSEI_LOG_WARNING("Unknown sending mode {} for sensor {}", mode_str, id);
+        return 0;
+    }
+    self->set_sending_mode(id, static_cast<SendingMode>(mode - SENDING_MODE_NAMES.begin()));
+    SENSEI_LOG_DEBUG("Setting sending mode of sensor {} to {}", id, mode_str);
+
+    return 0;
+}
+
+static int osc_set_delta_ticks(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int /*argc*/, void* /*data*/, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    self->set_delta_ticks(argv[0]->i, argv[1]->i);
+    SENSEI_LOG_DEBUG("Setting delta ticks of sensor {} to {}", argv[0]->i, argv[1]->i);
+
+    return 0;
+}
+
+static int osc_set_input_range(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int /*argc*/, void* /*data*/, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    self->set_input_range(argv[0]->i, argv[1]->f, argv[2]->f);
+    SENSEI_LOG_DEBUG("Setting input range of sensor {} to [{}, {}]", argv[0]->i, argv[1]->f, argv[2]->f);
+
+    return 0;
+}
+
+static int osc_set_filter_time_constant(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int /*argc*/, void* /*data*/, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    self->set_filter_time_constant(argv[0]->i, argv[1]->f);
+    SENSEI_LOG_DEBUG("Setting filter time constant of sensor {} to {}", argv[0]->i, argv[1]->f);
+
+    return 0;
+}
+
+static int osc_set_slider_threshold(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int /*argc*/, void* /*data*/, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    self->set_slider_threshold(argv[0]->i, argv[1]->i);
+    SENSEI_LOG_DEBUG("Setting slider threshold of sensor {} to {}", argv[0]->i, argv[1]->i);
+
+    return 0;
+}
+
+static int osc_set_invert(const char* /*path*/, const char* /*types*/, lo_arg ** argv, int /*argc*/, void* /*data*/, void *user_data)
+{
+    OSCUserFrontend *self = static_cast<OSCUserFrontend*>(user_data);
+    self->set_invert(argv[0]->i, static_cast<bool>(argv[1]->i));
+    SENSEI_LOG_DEBUG("Setting inverted status of sensor {} to {}", argv[0]->i, argv[1]->i);
+
+    return 0;
+}
+
+int osc_server_thread_init(lo_server_thread /*thread*/, void* user_data)
+{
+    auto frontend = static_cast<OSCUserFrontend*>(user_data);
+    frontend->apply_server_thread_scheduling();
+    return 0;
+}
+
 }; // anonymous namespace
 
 OSCUserFrontend::OSCUserFrontend(SynchronizedQueue<std::unique_ptr<BaseMessage>> *queue,
                                  const int max_n_input_pins,
-                                 const int max_n_digital_out_pins) :
-        UserFrontend(queue, max_n_input_pins, max_n_digital_out_pins),
+                                 const int max_n_digital_out_pins,
+                                 const ThreadSchedulingConfig& thread_scheduling) :
+        UserFrontend(queue, max_n_input_pins, max_n_digital_out_pins, thread_scheduling),
             _osc_server(nullptr),
-            _server_port(DEFAULT_SERVER_PORT)
+            _server_port(DEFAULT_SERVER_PORT),
+            _fast_receiver(std::make_unique<OSCFastReceiver>(queue, thread_scheduling)),
+            _bundle_depth(0)
 {
     _start_server();
 }
@@ -117,6 +343,25 @@ CommandErrorCode OSCUserFrontend::apply_command(const Command* cmd)
         };
         break;
 
+    case CommandType::SET_OSC_FAST_INPUT_PORT:
+        {
+            const auto typed_cmd = static_cast<const SetOSCFastInputPortCommand*>(cmd);
+            auto port = typed_cmd->data();
+            if (port == 0)
+            {
+                _fast_receiver->stop();
+            }
+            else if ((port < 1000) || (port > 65535) || (port == _server_port))
+            {
+                status = CommandErrorCode::INVALID_PORT_NUMBER;
+            }
+            else if (_fast_receiver->start(port) == false)
+            {
+                status = CommandErrorCode::INVALID_PORT_NUMBER;
+            }
+        };
+        break;
+
     default:
         status = CommandErrorCode::UNHANDLED_COMMAND_FOR_SENSOR_TYPE;
         break;
@@ -133,6 +378,38 @@ CommandErrorCode OSCUserFrontend::apply_command(const Command* cmd)
     }
 }
 
+void OSCUserFrontend::add_output_values(const OutputUpdate* values, int count)
+{
+    if (_bundle_depth > 0)
+    {
+        _bundle_values.insert(_bundle_values.end(), values, values + count);
+    }
+    else if (count == 1)
+    {
+        set_continuous_output(values[0].index, values[0].value);
+    }
+    else if (count > 1)
+    {
+        set_continuous_outputs(std::vector<OutputUpdate>(values, values + count));
+    }
+}
+
+void OSCUserFrontend::begin_bundle()
+{
+    _bundle_depth++;
+}
+
+void OSCUserFrontend::end_bundle()
+{
+    // Nested bundles are flattened into the outermost one
+    if (--_bundle_depth > 0 || _bundle_values.empty())
+    {
+        return;
+    }
+    set_continuous_outputs(std::move(_bundle_values));
+    _bundle_values.clear();
+}
+
 void OSCUserFrontend::_start_server()
 {
     std::stringstream port_stream;
@@ -141,6 +418,25 @@ void OSCUserFrontend::_start_server()
     _osc_server = lo_server_thread_new(port_stream.str().c_str(), osc_error);
     lo_server_thread_add_method(_osc_server, "/set_enabled", "ii", osc_set_sensor_enabled, this);
     lo_server_thread_add_method(_osc_server, "/set_output", "if", osc_set_continuous_output, this);
+    lo_server_thread_add_method(_osc_server, "/set_outputs", nullptr, osc_set_continuous_outputs, this);
+    lo_server_add_bundle_handlers(lo_server_thread_get_server(_osc_server), osc_bundle_start, osc_bundle_end, this);
+    lo_server_thread_add_method(_osc_server, "/subscribe", "si", osc_subscribe, this);
+    lo_server_thread_add_method(_osc_server, "/subscribe", "sii", osc_subscribe, this);
+    lo_server_thread_add_method(_osc_server, "/unsubscribe", "s", osc_unsubscribe, this);
+    lo_server_thread_add_method(_osc_server, "/unsubscribe", "si", osc_unsubscribe, this);
+    lo_server_thread_add_method(_osc_server, "/get_value", "i", osc_get_values, this);
+    lo_server_thread_add_method(_osc_server, "/get_values", nullptr, osc_get_values, this);
+    lo_server_thread_add_method(_osc_server, "/get_snapshot", "", osc_get_values, this);
+    lo_server_thread_add_method(_osc_server, "/set_sending_mode", "is", osc_set_sending_mode, this);
+    lo_server_thread_add_method(_osc_server, "/set_delta_ticks", "ii", osc_set_delta_ticks, this);
+    lo_server_thread_add_method(_osc_server, "/set_input_range", "iff", osc_set_input_range, this);
+    lo_server_thread_add_method(_osc_server, "/set_filter_time_constant", "if", osc_set_filter_time_constant, this);
+    lo_server_thread_add_method(_osc_server, "/set_slider_threshold", "ii", osc_set_slider_threshold, this);
+    lo_server_thread_add_method(_osc_server, "/set_invert", "ii", osc_set_invert, this);
+    lo_server_thread_add_method(_osc_server, "/get_config", nullptr, osc_get_config, this);
+    lo_server_thread_add_method(_osc_server, "/get_latency", nullptr, osc_get_latency, this);
+    lo_server_thread_add_method(_osc_server, "/get_metrics", "", osc_get_metrics, this);
+    lo_server_thread_set_callbacks(_osc_server, osc_server_thread_init, nullptr, this);
     int ret = lo_server_thread_start(_osc_server);
     if (ret < 0)
     {
@@ -22,13 +22,56 @@
  *
  * OSC paths and arguments:
  *
- *  /set_pin_enabled    ii
- *  /set_digital_output ii
+ *  /set_enabled        ii     sensor index, enabled
+ *  /set_output         if     output index, value
+ *  /set_outputs        ifif.. output index and value pairs
+ *  /set_outputs        ib     first output index, blob of big endian float32
+ *                             values for consecutive outputs
+ *  /subscribe          si     pattern, lease in seconds (values sent to sender address)
+ *  /subscribe          sii    pattern, port, lease in seconds (values sent to sender host)
+ *  /unsubscribe        s      pattern, empty string removes all subscriptions of the sender
+ *  /unsubscribe        si     pattern, port
+ *  /get_value          i      sensor index
+ *  /get_values         i...   list of sensor indexes
+ *  /get_snapshot              all sensors
+ *
+ * Runtime configuration of a single sensor:
+ *
+ *  /set_sending_mode         is   sensor index, mode name (e.g. "on_value_changed")
+ *  /set_delta_ticks          ii   sensor index, ticks
+ *  /set_input_range          iff  sensor index, min, max
+ *  /set_filter_time_constant if   sensor index, time constant
+ *  /set_slider_threshold     ii   sensor index, threshold
+ *  /set_invert               ii   sensor index, inverted
+ *  /get_config               i... list of sensor indexes, all sensors if empty
+ *
+ * Monitoring:
+ *
+ *  /get_latency        i...   list of sensor indexes, all sensors together if empty
+ *  /get_metrics               all runtime metrics
+ *
+ * All /set_output and /set_outputs messages in an OSC bundle are queued
+ * as a single batch.
+ *
+ * Replies to queries are sent to the sender address as a single bundle
+ * with the latest values, using the output paths of the sensors. Replies
+ * to /get_config use the paths of the configuration endpoints above, so
+ * they can be sent back unchanged. Replies to /get_latency have one
+ * /latency message per sensor and stage with the arguments: sensor index
+ * (-1 for all sensors), stage name, number of samples, then p50, p99,
+ * p99.9 and max latency in microseconds. Replies to /get_metrics have one
+ * /metric message per metric with its name, labels and value.
+ *
+ * Optionally, an OSCFastReceiver can be started on a separate port
+ * for high rate output updates.
  */
 #ifndef SENSEI_OSC_USER_FRONTEND_H_H
 #define SENSEI_OSC_USER_FRONTEND_H_H
 
+#include <memory>
+
 #include "user_frontend.h"
+#include "osc_fast_receiver.h"
 #include "lo/lo.h"
 
 namespace sensei {
@@ -38,7 +81,8 @@ class OSCUserFrontend : public UserFrontend
 {
 public:
     OSCUserFrontend(SynchronizedQueue<std::unique_ptr<BaseMessage>> *queue, const int max_n_input_pins,
-                        const int max_n_digital_out_pins);
+                        const int max_n_digital_out_pins,
+                        const ThreadSchedulingConfig& thread_scheduling = ThreadSchedulingConfig());
 
     ~OSCUserFrontend()
     {
@@ -47,6 +91,26 @@ public:
 
     CommandErrorCode apply_command(const Command *cmd) override;
 
+    /**
+     * @brief Set output values, values received inside a bundle are collected
+     *        and queued together when the bundle ends.
+     *        Only to be called from the server thread.
+     */
+    void add_output_values(const OutputUpdate* values, int count);
+
+    void begin_bundle();
+
+    void end_bundle();
+
+    /**
+     * @brief Apply the configured scheduling to the server thread.
+     *        Only to be called from the server thread when it starts.
+     */
+    void apply_server_thread_scheduling()
+    {
+        apply_current_thread_scheduling(_thread_scheduling, "osc server");
+    }
+
 private:
     void _start_server();
 
@@ -54,6 +118,11 @@ private:
 
     lo_server_thread _osc_server;
     int _server_port;
+
+    std::unique_ptr<OSCFastReceiver> _fast_receiver;
+
+    int _bundle_depth;
+    std::vector<OutputUpdate> _bundle_values;
 };
 
 } // namespace user_frontend
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Shared memory input for output values written by co-located processes
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "shm_input_receiver.h"
+#include "logging.h"
+
+using namespace sensei;
+using namespace sensei::user_frontend;
+
+SENSEI_GET_LOGGER_WITH_MODULE_NAME("shm_input_receiver");
+
+ShmInputReceiver::ShmInputReceiver(SynchronizedQueue<std::unique_ptr<BaseMessage>>* queue,
+                                   const ThreadSchedulingConfig& thread_scheduling) :
+        _queue(queue),
+        _table(nullptr),
+        _running(false),
+        _thread_scheduling(thread_scheduling)
+{
+    _output_values.reserve(SHM_MAX_OUTPUTS);
+}
+
+ShmInputReceiver::~ShmInputReceiver()
+{
+    stop();
+}
+
+bool ShmInputReceiver::start(const std::string& name, int n_outputs)
+{
+    stop();
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0660);
+    if (fd < 0)
+    {
+        SENSEI_LOG_ERROR("Failed to create shared memory {}: {}", name, strerror(errno));
+        return false;
+    }
+    void* mem = MAP_FAILED;
+    if (ftruncate(fd, sizeof(ShmOutputTable)) == 0)
+    {
+        mem = mmap(nullptr, sizeof(ShmOutputTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        SENSEI_LOG_ERROR("Failed to map shared memory {}: {}", name, strerror(errno));
+        shm_unlink(name.c_str());
+        return false;
+    }
+    _name = name;
+    _table = static_cast<ShmOutputTable*>(mem);
+    std::memset(mem, 0, sizeof(ShmOutputTable));
+    _table->version = SHM_OUTPUT_TABLE_VERSION;
+    _table->n_outputs = static_cast<uint32_t>(std::clamp(n_outputs, 0, SHM_MAX_OUTPUTS));
+    // Clients check the magic number before using the table, so it is written last
+    std::atomic_thread_fence(std::memory_order_release);
+    _table->magic = SHM_OUTPUT_TABLE_MAGIC;
+
+    SENSEI_LOG_INFO("Shared memory input {} created for {} outputs", name, _table->n_outputs);
+    _running = true;
+    _poll_thread = std::thread(&ShmInputReceiver::_poll_loop, this);
+    return true;
+}
+
+void ShmInputReceiver::stop()
+{
+    _running = false;
+    if (_poll_thread.joinable())
+    {
+        _poll_thread.join();
+    }
+    if (_table != nullptr)
+    {
+        munmap(_table, sizeof(ShmOutputTable));
+        shm_unlink(_name.c_str());
+        _table = nullptr;
+    }
+}
+
+void ShmInputReceiver::_poll_loop()
+{
+    apply_current_thread_scheduling(_thread_scheduling, "shm input receiver");
+    uint32_t last_doorbell = 0;
+    while (_running)
+    {
+        uint32_t doorbell = _table->doorbell.load(std::memory_order_acquire);
+        if (doorbell != last_doorbell)
+        {
+            last_doorbell = doorbell;
+            _collect_dirty_values();
+        }
+        std::this_thread::sleep_for(SHM_POLL_INTERVAL);
+    }
+}
+
+void ShmInputReceiver::_collect_dirty_values()
+{
+    for (int word = 0; word < SHM_DIRTY_WORDS; ++word)
+    {
+        // A write that happens after the exchange sets the flag again and is picked up on the next poll
+        uint64_t dirty = _table->dirty[word].exchange(0, std::memory_order_acquire);
+        while (dirty != 0)
+        {
+            int bit = __builtin_ctzll(dirty);
+            dirty &= dirty - 1;
+            int index = word * 64 + bit;
+            uint32_t bits = _table->values[index].load(std::memory_order_relaxed);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            _output_values.push_back({index, value});
+        }
+    }
+    if (_output_values.size() == 1)
+    {
+        _queue->push(_factory.make_float_set_value(_output_values[0].index, _output_values[0].value));
+    }
+    else if (_output_values.size() > 1)
+    {
+        _queue->push(_factory.make_float_set_batch_value(_output_values));
+    }
+    _output_values.clear();
+}
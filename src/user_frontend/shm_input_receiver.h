@@ -0,0 +1,89 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Shared memory input for output values written by co-located processes
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Creates a ShmOutputTable (see shm_output_table.h) and polls its doorbell
+ * from a separate thread. When the doorbell has changed, the outputs flagged
+ * in the dirty bitmap are collected and put in the event queue as a single
+ * batch of output values.
+ */
+#ifndef SENSEI_SHM_INPUT_RECEIVER_H
+#define SENSEI_SHM_INPUT_RECEIVER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "synchronized_queue.h"
+#include "message/message_factory.h"
+#include "user_frontend/shm_output_table.h"
+#include "thread_scheduling.h"
+
+namespace sensei {
+namespace user_frontend {
+
+constexpr auto SHM_POLL_INTERVAL = std::chrono::milliseconds(1);
+
+class ShmInputReceiver
+{
+public:
+    ShmInputReceiver(SynchronizedQueue<std::unique_ptr<BaseMessage>>* queue,
+                     const ThreadSchedulingConfig& thread_scheduling = ThreadSchedulingConfig());
+
+    ~ShmInputReceiver();
+
+    /**
+     * @brief Create the shared memory table and start the polling thread
+     *
+     * @param [in] name      Shared memory object name, must start with '/'
+     * @param [in] n_outputs Number of outputs clients are allowed to write
+     *
+     * @return true if the table could be created
+     */
+    bool start(const std::string& name, int n_outputs);
+
+    /**
+     * @brief Stop the polling thread and remove the shared memory table
+     */
+    void stop();
+
+    bool running() const
+    {
+        return _running;
+    }
+
+private:
+    void _poll_loop();
+
+    void _collect_dirty_values();
+
+    SynchronizedQueue<std::unique_ptr<BaseMessage>>* _queue;
+    MessageFactory _factory;
+    std::vector<OutputUpdate> _output_values;
+    std::string _name;
+    ShmOutputTable* _table;
+    std::atomic<bool> _running;
+    std::thread _poll_thread;
+    ThreadSchedulingConfig _thread_scheduling;
+};
+
+} // namespace user_frontend
+} // namespace sensei
+
+#endif //SENSEI_SHM_INPUT_RECEIVER_H
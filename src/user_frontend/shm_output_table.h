@@ -0,0 +1,148 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SENSEI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SENSEI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SENSEI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Shared memory table of output values, written by co-located processes
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Sensei creates the table, clients open it with ShmOutputWriter. Writing a
+ * value is wait-free and does no system calls, so it is safe to call from a
+ * real-time thread: the value is stored in its slot, the output is flagged in
+ * a dirty bitmap and a doorbell counter is incremented. Sensei polls the
+ * doorbell and only forwards the outputs flagged as dirty, several writes to
+ * the same output between two polls are collapsed to the latest one.
+ *
+ * This header has no dependencies on the rest of Sensei so that clients
+ * can include it directly.
+ */
+#ifndef SENSEI_SHM_OUTPUT_TABLE_H
+#define SENSEI_SHM_OUTPUT_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace sensei {
+
+constexpr uint32_t SHM_OUTPUT_TABLE_MAGIC = 0x53454e53; // "SENS"
+constexpr uint32_t SHM_OUTPUT_TABLE_VERSION = 1;
+constexpr int SHM_MAX_OUTPUTS = 256;
+constexpr int SHM_DIRTY_WORDS = SHM_MAX_OUTPUTS / 64;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory table needs lock free atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory table needs lock free atomics");
+
+struct ShmOutputTable
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_outputs;
+    std::atomic<uint32_t> doorbell;
+    std::atomic<uint64_t> dirty[SHM_DIRTY_WORDS];
+    std::atomic<uint32_t> values[SHM_MAX_OUTPUTS]; // float bit patterns
+};
+
+/**
+ * @brief Client side of the output table, all methods except open() and
+ *        close() are wait-free.
+ */
+class ShmOutputWriter
+{
+public:
+    ShmOutputWriter() : _table(nullptr) {}
+
+    ~ShmOutputWriter()
+    {
+        close();
+    }
+
+    /**
+     * @brief Map an output table created by Sensei
+     *
+     * @param [in] name Shared memory object name, i.e. "/sensei_outputs"
+     *
+     * @return true if the table exists and has a compatible layout
+     */
+    bool open(const char* name)
+    {
+        close();
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+        void* mem = mmap(nullptr, sizeof(ShmOutputTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mem == MAP_FAILED)
+        {
+            return false;
+        }
+        _table = static_cast<ShmOutputTable*>(mem);
+        if (_table->magic != SHM_OUTPUT_TABLE_MAGIC || _table->version != SHM_OUTPUT_TABLE_VERSION)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (_table != nullptr)
+        {
+            munmap(_table, sizeof(ShmOutputTable));
+            _table = nullptr;
+        }
+    }
+
+    bool is_open() const
+    {
+        return _table != nullptr;
+    }
+
+    /**
+     * @brief Set the value of a continuous output
+     *
+     * @param [in] index Output index
+     * @param [in] value New value normalised to a [0, 1] range
+     *
+     * @return false if the index is out of range
+     */
+    bool set_output(int index, float value)
+    {
+        if (_table == nullptr || index < 0 || index >= static_cast<int>(_table->n_outputs))
+        {
+            return false;
+        }
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        _table->values[index].store(bits, std::memory_order_relaxed);
+        // Release ordering makes the value visible before the dirty flag
+        _table->dirty[index / 64].fetch_or(uint64_t(1) << (index % 64), std::memory_order_release);
+        _table->doorbell.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    ShmOutputTable* _table;
+};
+
+} // namespace sensei
+
+#endif //SENSEI_SHM_OUTPUT_TABLE_H
@@ -25,9 +25,23 @@
 using namespace sensei;
 using namespace sensei::user_frontend;
 
-CommandErrorCode UserFrontend::apply_command(const Command* /*cmd*/)
+CommandErrorCode UserFrontend::apply_command(const Command* cmd)
 {
     auto status = CommandErrorCode::UNHANDLED_COMMAND_FOR_SENSOR_TYPE;
+    if (cmd->type() == CommandType::SET_SHM_INPUT_NAME)
+    {
+        const auto typed_cmd = static_cast<const SetShmInputNameCommand*>(cmd);
+        const auto& name = typed_cmd->data();
+        status = CommandErrorCode::OK;
+        if (name.empty())
+        {
+            _shm_receiver->stop();
+        }
+        else if (name[0] != '/' || _shm_receiver->start(name, _max_n_input_pins) == false)
+        {
+            status = CommandErrorCode::INVALID_VALUE;
+        }
+    }
     return status;
 }
 
@@ -49,8 +63,86 @@ void UserFrontend::set_continuous_output(int index, float value)
     _queue->push(std::move(msg));
 }
 
+void UserFrontend::set_continuous_outputs(std::vector<OutputUpdate> values)
+{
+    auto msg = _factory.make_float_set_batch_value(std::move(values));
+    _queue->push(std::move(msg));
+}
+
 void UserFrontend::set_range_output(int index, int value)
 {
     auto msg = _factory.make_integer_set_value(index, value);
     _queue->push(std::move(msg));
-}
\ No newline at end of file
+}
+
+void UserFrontend::subscribe(const std::string& pattern, const std::string& host, int port, int lease_s)
+{
+    auto msg = _factory.make_add_osc_subscription_command(0, pattern, host, port, lease_s);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::unsubscribe(const std::string& pattern, const std::string& host, int port)
+{
+    auto msg = _factory.make_remove_osc_subscription_command(0, pattern, host, port);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::query_values(const std::vector<int>& sensors, const std::string& host, int port)
+{
+    auto msg = _factory.make_query_values_command(0, sensors, host, port);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::set_sending_mode(int index, SendingMode mode)
+{
+    auto msg = _factory.make_set_sending_mode_command(index, mode);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::set_delta_ticks(int index, int ticks)
+{
+    auto msg = _factory.make_set_sending_delta_ticks_command(index, ticks);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::set_input_range(int index, float min, float max)
+{
+    auto msg = _factory.make_set_input_range_command(index, min, max);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::set_filter_time_constant(int index, float time_constant)
+{
+    auto msg = _factory.make_set_analog_time_constant_command(index, time_constant);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::set_slider_threshold(int index, int threshold)
+{
+    auto msg = _factory.make_set_slider_threshold_command(index, threshold);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::set_invert(int index, bool inverted)
+{
+    auto msg = _factory.make_set_invert_enabled_command(index, inverted);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::query_config(const std::vector<int>& sensors, const std::string& host, int port)
+{
+    auto msg = _factory.make_query_config_command(0, sensors, host, port);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::query_latency(const std::vector<int>& sensors, const std::string& host, int port)
+{
+    auto msg = _factory.make_query_latency_command(0, sensors, host, port);
+    _queue->push(std::move(msg));
+}
+
+void UserFrontend::query_metrics(const std::string& host, int port)
+{
+    auto msg = _factory.make_query_metrics_command(0, host, port);
+    _queue->push(std::move(msg));
+}
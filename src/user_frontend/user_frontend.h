@@ -19,13 +19,20 @@
  *
  * This module give run-time control from the user over some fast-changing configuration
  * parameters (e.g. sensors enabled/disabled) and access to digital output pins.
+ *
+ * All user frontends can optionally receive output values from co-located
+ * processes through a shared memory table, see ShmInputReceiver.
  */
 #ifndef SENSEI_USER_FRONTEND_H
 #define SENSEI_USER_FRONTEND_H
 
+#include <memory>
+
 #include <message/message_factory.h>
 #include "synchronized_queue.h"
 #include "message/message_factory.h"
+#include "user_frontend/shm_input_receiver.h"
+#include "thread_scheduling.h"
 
 namespace sensei {
 namespace user_frontend {
@@ -35,10 +42,13 @@ class UserFrontend
 public:
     UserFrontend(SynchronizedQueue<std::unique_ptr<BaseMessage>> *queue,
                  const int max_n_input_pins,
-                 const int max_n_digital_out_pins) :
+                 const int max_n_digital_out_pins,
+                 const ThreadSchedulingConfig& thread_scheduling = ThreadSchedulingConfig()) :
+            _thread_scheduling(thread_scheduling),
             _queue(queue),
             _max_n_input_pins(max_n_input_pins),
-            _max_n_out_pins(max_n_digital_out_pins)
+            _max_n_out_pins(max_n_digital_out_pins),
+            _shm_receiver(std::make_unique<ShmInputReceiver>(queue, thread_scheduling))
     {}
 
     virtual ~UserFrontend()
@@ -87,6 +97,17 @@ public:
      */
     void set_continuous_output(int index, float value);
 
+    /**
+     * @brief Set the values of several continuous outputs at once,
+     *        the values are queued as a single batch.
+     *
+     * This should be preferably called by derived classes in their
+     * runtime thread.
+     *
+     * @param [in] values        Output indexes and values normalised to a [0, 1] range
+     */
+    void set_continuous_outputs(std::vector<OutputUpdate> values);
+
     /**
      * @brief Set the value of a range output.
      *
@@ -98,11 +119,93 @@ public:
      */
     void set_range_output(int index, int value);
 
+    /**
+     * @brief Subscribe a client to the sensors matching an OSC pattern.
+     *        Subscribing again with the same parameters renews the lease.
+     *
+     * @param [in] pattern       OSC pattern matched against sensor paths and names
+     * @param [in] host          Host where values are sent
+     * @param [in] port          Port where values are sent
+     * @param [in] lease_s       Subscription duration in seconds, 0 for default
+     */
+    void subscribe(const std::string& pattern, const std::string& host, int port, int lease_s);
+
+    /**
+     * @brief Remove a client subscription.
+     *
+     * @param [in] pattern       Pattern of the subscription, empty to remove all
+     *                           subscriptions of the client
+     * @param [in] host          Host of the client
+     * @param [in] port          Port of the client
+     */
+    void unsubscribe(const std::string& pattern, const std::string& host, int port);
+
+    /**
+     * @brief Request the latest values of a set of sensors.
+     *
+     * @param [in] sensors       Sensor indexes, empty for a snapshot of all sensors
+     * @param [in] host          Host where the reply is sent
+     * @param [in] port          Port where the reply is sent
+     */
+    void query_values(const std::vector<int>& sensors, const std::string& host, int port);
+
+    /**
+     * @brief Runtime configuration of a single sensor. The commands follow
+     *        the same path as those from the configuration backend, so only
+     *        the affected controller is reconfigured on the board.
+     *
+     * @param [in] index         Sensor index
+     * @param [in] ...           New value of the parameter
+     */
+    void set_sending_mode(int index, SendingMode mode);
+
+    void set_delta_ticks(int index, int ticks);
+
+    void set_input_range(int index, float min, float max);
+
+    void set_filter_time_constant(int index, float time_constant);
+
+    void set_slider_threshold(int index, int threshold);
+
+    void set_invert(int index, bool inverted);
+
+    /**
+     * @brief Request the current configuration of a set of sensors.
+     *
+     * @param [in] sensors       Sensor indexes, empty for all sensors
+     * @param [in] host          Host where the reply is sent
+     * @param [in] port          Port where the reply is sent
+     */
+    void query_config(const std::vector<int>& sensors, const std::string& host, int port);
+
+    /**
+     * @brief Request the latency summaries of a set of sensors.
+     *
+     * @param [in] sensors       Sensor indexes, empty for all sensors together
+     * @param [in] host          Host where the reply is sent
+     * @param [in] port          Port where the reply is sent
+     */
+    void query_latency(const std::vector<int>& sensors, const std::string& host, int port);
+
+    /**
+     * @brief Request the current value of all runtime metrics.
+     *
+     * @param [in] host          Host where the reply is sent
+     * @param [in] port          Port where the reply is sent
+     */
+    void query_metrics(const std::string& host, int port);
+
+protected:
+    // Scheduling of all the threads started by the user frontend
+    ThreadSchedulingConfig _thread_scheduling;
+
 private:
     SynchronizedQueue<std::unique_ptr<BaseMessage>>* _queue;
     int _max_n_input_pins;
     int _max_n_out_pins;
 
+    std::unique_ptr<ShmInputReceiver> _shm_receiver;
+
     MessageFactory _factory;
 };
 
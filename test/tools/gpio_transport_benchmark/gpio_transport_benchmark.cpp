@@ -0,0 +1,106 @@
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cstdlib>
+
+#include "hardware_backend/gpio_hw_socket.h"
+#include "hardware_backend/gpio_hw_shm.h"
+
+/* Round trip benchmark of the transports between Sensei and a gpio client.
+ *
+ * Takes the place of Sensei and sends packets one at a time to the client,
+ * waiting for the ack of each before sending the next. This is done first
+ * over the sockets and then over the shared memory rings.
+ *
+ * Start raspa_mockup with a burst size of 0 first, so that it only acks:
+ * raspa_mockup 0 &
+ * gpio_transport_benchmark [number of packets]
+ */
+
+using namespace sensei::hw_backend;
+
+constexpr char GPIO_CLIENT_SOCKET[] = "/tmp/raspa";
+constexpr auto RECV_TIMEOUT = std::chrono::milliseconds(100);
+constexpr auto ACK_TIMEOUT = std::chrono::seconds(1);
+constexpr int  DEFAULT_PACKETS = 10000;
+
+using Clock = std::chrono::steady_clock;
+
+bool wait_for_ack(BaseHwBackend& backend, uint32_t seq_no)
+{
+    std::array<gpio::GpioPacket, GPIO_SOCKET_BATCH_SIZE> packets;
+    auto deadline = Clock::now() + ACK_TIMEOUT;
+    while (Clock::now() < deadline)
+    {
+        int count = backend.receive_gpio_packets(packets.data(), packets.size());
+        for (int i = 0; i < count; ++i)
+        {
+            if (packets[i].command == gpio::GPIO_ACK && packets[i].payload.gpio_ack_data.returned_seq_no == seq_no)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void run_benchmark(const char* name, BaseHwBackend& backend, int n_packets)
+{
+    std::vector<double> round_trips;
+    round_trips.reserve(n_packets);
+    for (int i = 1; i <= n_packets; ++i)
+    {
+        gpio::GpioPacket packet = {};
+        packet.command = gpio::GPIO_CMD_SET_VALUE;
+        packet.sequence_no = i;
+        auto start = Clock::now();
+        if (!backend.send_gpio_packet(packet) || !wait_for_ack(backend, i))
+        {
+            std::cout << name << ": no ack for packet " << i << ", is raspa_mockup running?" << std::endl;
+            return;
+        }
+        round_trips.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    std::sort(round_trips.begin(), round_trips.end());
+    double mean = std::accumulate(round_trips.begin(), round_trips.end(), 0.0) / round_trips.size();
+    std::cout << std::fixed << std::setprecision(1) << name
+              << "mean " << mean << " us, median " << round_trips[round_trips.size() / 2]
+              << " us, 99th percentile " << round_trips[round_trips.size() * 99 / 100]
+              << " us, max " << round_trips.back() << " us" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int n_packets = argc > 1 ? std::atoi(argv[1]) : DEFAULT_PACKETS;
+    if (n_packets <= 0)
+    {
+        std::cout << "Usage: " << argv[0] << " [number of packets]" << std::endl;
+        return 1;
+    }
+    std::cout << "Round trip of " << n_packets << " packets" << std::endl;
+    {
+        GpioHwSocket backend(GPIO_CLIENT_SOCKET, RECV_TIMEOUT);
+        if (!backend.init())
+        {
+            std::cout << "Failed to open sockets" << std::endl;
+            return 1;
+        }
+        run_benchmark("Socket:        ", backend, n_packets);
+    }
+    {
+        GpioHwShm backend(GPIO_CLIENT_SOCKET, RECV_TIMEOUT);
+        if (!backend.init() || !backend.shm_active())
+        {
+            std::cout << "Gpio client did not accept shared memory" << std::endl;
+            return 1;
+        }
+        run_benchmark("Shared memory: ", backend, n_packets);
+    }
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+#include "hardware_frontend/hw_frontend.h"
+#include "mapping/mapping_processor.h"
+#include "output_backend/output_backend.h"
+#include "message/message_factory.h"
+#include "utils.h"
+
+/* Latency benchmark of the value path from the hw frontend read thread to
+ * the output backend.
+ *
+ * A fake hw backend emits one analog value packet per period. The time from
+ * emitting the packet until the mapped value reaches the output backend is
+ * recorded, first with values going through the event queue and the event
+ * loop thread, then with values mapped inline on the read thread.
+ *
+ * inline_mapping_benchmark [number of values] [period in us]
+ */
+
+using namespace sensei;
+
+constexpr int  DEFAULT_VALUES = 10000;
+constexpr int  DEFAULT_PERIOD_US = 500;
+constexpr int  N_SENSORS = 8;
+constexpr int  HISTOGRAM_BUCKETS = 12;
+constexpr auto EVENT_LOOP_WAIT = std::chrono::milliseconds(100);
+
+using Clock = std::chrono::steady_clock;
+
+/* Power of 2 buckets of microseconds, the last one collects everything above */
+class PowerOf2Histogram
+{
+public:
+    void add(Clock::duration latency)
+    {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        int bucket = 0;
+        while (bucket < HISTOGRAM_BUCKETS - 1 && us >= (1 << bucket))
+        {
+            bucket++;
+        }
+        _buckets[bucket]++;
+        _samples++;
+        _max = std::max(_max, latency);
+        _sum += latency;
+    }
+
+    void print(const char* name) const
+    {
+        std::cout << name << ": " << _samples << " values, mean " << std::fixed << std::setprecision(1)
+                  << (_samples > 0 ? std::chrono::duration<double, std::micro>(_sum).count() / _samples : 0.0)
+                  << " us, max " << std::chrono::duration<double, std::micro>(_max).count() << " us" << std::endl;
+        for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        {
+            if (i < HISTOGRAM_BUCKETS - 1)
+            {
+                std::cout << "  < " << std::setw(5) << (1 << i) << " us ";
+            }
+            else
+            {
+                std::cout << "  >=" << std::setw(5) << (1 << (i - 1)) << " us ";
+            }
+            int width = _samples > 0 ? static_cast<int>(50 * _buckets[i] / _samples) : 0;
+            std::cout << std::setw(8) << _buckets[i] << " " << std::string(width, '#') << std::endl;
+        }
+    }
+
+private:
+    std::array<int64_t, HISTOGRAM_BUCKETS> _buckets{};
+    int64_t _samples{0};
+    Clock::duration _max{0};
+    Clock::duration _sum{0};
+};
+
+/* Emits one value packet per period, alternating between the ends of the range */
+class ValueSourceBackend : public hw_backend::BaseHwBackend
+{
+public:
+    ValueSourceBackend(int n_values, std::chrono::microseconds period) :
+            BaseHwBackend(std::chrono::milliseconds(10)),
+            _n_values(n_values),
+            _period(period)
+    {}
+
+    bool init() override
+    {
+        _next_emit = Clock::now() + _period;
+        return true;
+    }
+
+    void deinit() override {}
+
+    bool send_gpio_packet(const gpio::GpioPacket& /*tx_gpio_packet*/) override
+    {
+        return true;
+    }
+
+    bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) override
+    {
+        if (_emitted >= _n_values)
+        {
+            std::this_thread::sleep_for(_recv_packet_timeout);
+            return false;
+        }
+        std::this_thread::sleep_until(_next_emit);
+        _next_emit += _period;
+        rx_gpio_packet = {};
+        rx_gpio_packet.command = gpio::GPIO_CMD_GET_VALUE;
+        rx_gpio_packet.payload.gpio_value_data.controller_id = _emitted % N_SENSORS;
+        rx_gpio_packet.payload.gpio_value_data.controller_val = hw_frontend::to_gpio_protocol_byteord((_emitted / N_SENSORS) % 2 ? 4000 : 0);
+        _emitted++;
+        emit_time.store(Clock::now());
+        return true;
+    }
+
+    bool done() const
+    {
+        return _emitted >= _n_values;
+    }
+
+    std::atomic<Clock::time_point> emit_time;
+
+private:
+    int _n_values;
+    std::chrono::microseconds _period;
+    std::atomic<int> _emitted{0};
+    Clock::time_point _next_emit;
+};
+
+/* Records the time from emission until a mapped value arrives */
+class LatencyBackend : public output_backend::OutputBackend
+{
+public:
+    LatencyBackend(ValueSourceBackend* source) : OutputBackend(N_SENSORS),
+                                                 _source(source)
+    {}
+
+    void send(const OutputValue* /*transformed_value*/, const Value* /*raw_input_value*/) override
+    {
+        histogram.add(Clock::now() - _source->emit_time.load());
+    }
+
+    PowerOf2Histogram histogram;
+
+private:
+    ValueSourceBackend* _source;
+};
+
+/* Maps values the same way the event handler does, under the same kind of lock */
+class BenchmarkHandler : public hw_frontend::InlineValueHandler
+{
+public:
+    BenchmarkHandler(mapping::MappingProcessor* processor, LatencyBackend* backend) : _processor(processor),
+                                                                                      _backend(backend)
+    {}
+
+    void handle_inline_value(Value* value) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        _processor->process(value, _backend);
+    }
+
+    std::mutex mutex;
+
+private:
+    mapping::MappingProcessor* _processor;
+    LatencyBackend* _backend;
+};
+
+void run_benchmark(const char* name, bool inline_mapping, int n_values, std::chrono::microseconds period)
+{
+    SynchronizedQueue<std::unique_ptr<Command>> to_frontend_queue;
+    SynchronizedQueue<std::unique_ptr<BaseMessage>> event_queue;
+    ValueSourceBackend source(n_values, period);
+    LatencyBackend output(&source);
+    mapping::MappingProcessor processor(N_SENSORS);
+    BenchmarkHandler handler(&processor, &output);
+    MessageFactory factory;
+
+    for (int i = 0; i < N_SENSORS; ++i)
+    {
+        processor.apply_command(static_cast<Command*>(factory.make_set_sensor_type_command(i, SensorType::ANALOG_INPUT).get()));
+        processor.apply_command(static_cast<Command*>(factory.make_set_sending_mode_command(i, SendingMode::ON_VALUE_CHANGED).get()));
+        processor.apply_command(static_cast<Command*>(factory.make_set_enabled_command(i, true).get()));
+    }
+
+    source.init();
+    hw_frontend::HwFrontend frontend(&to_frontend_queue, &event_queue, &source, 1,
+                                     std::chrono::milliseconds(5), std::chrono::milliseconds(100));
+    if (inline_mapping)
+    {
+        frontend.set_inline_value_handler(&handler);
+    }
+    frontend.run();
+
+    /* Event loop, does what EventHandler::handle_events() does for values */
+    while (!source.done() || !event_queue.empty())
+    {
+        event_queue.wait_for_data(EVENT_LOOP_WAIT);
+        while (!event_queue.empty())
+        {
+            auto event = event_queue.pop();
+            std::lock_guard<std::mutex> lock(handler.mutex);
+            if (event->base_type() == MessageType::VALUE)
+            {
+                processor.process(static_cast<Value*>(event.get()), &output);
+            }
+        }
+    }
+    frontend.stop();
+    output.histogram.print(name);
+}
+
+int main(int argc, char* argv[])
+{
+    int n_values = argc > 1 ? std::atoi(argv[1]) : DEFAULT_VALUES;
+    int period_us = argc > 2 ? std::atoi(argv[2]) : DEFAULT_PERIOD_US;
+    if (n_values <= 0 || period_us <= 0)
+    {
+        std::cout << "Usage: " << argv[0] << " [number of values] [period in us]" << std::endl;
+        return 1;
+    }
+    run_benchmark("Event queue", false, n_values, std::chrono::microseconds(period_us));
+    run_benchmark("Inline     ", true, n_values, std::chrono::microseconds(period_us));
+    return 0;
+}
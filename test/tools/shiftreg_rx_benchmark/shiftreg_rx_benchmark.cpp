@@ -0,0 +1,186 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fifo/circularfifo_memory_relaxed_aquire_release.h"
+#include "gpio_protocol/gpio_protocol.h"
+#include "shiftreg_gpio/rx_notifier.h"
+
+/* Latency benchmark of the receive path of the shiftregister gpio backend.
+ *
+ * A producer thread stands in for the rt task, it ticks at 1 kHz and pushes
+ * a packet to a lock free fifo every few ticks. The receiving end runs once
+ * with the old 5 ms sleep polling and once blocking on the RxNotifier, with
+ * a pipe in place of the XDDP socket. For each the latency from push to pop
+ * and the number of receiver wake ups are printed.
+ *
+ * build cmd:
+ * make shiftreg_rx_benchmark
+ * usage: shiftreg_rx_benchmark [number of packets]
+ */
+
+using namespace memory_relaxed_aquire_release;
+using namespace sensei::hw_backend::shiftregister_gpio;
+
+constexpr int  GPIO_PACKET_Q_SIZE = 150;
+constexpr auto TICK_PERIOD = std::chrono::microseconds(1000);
+/* Not a multiple of the polling period, so that packets arrive at varying times */
+constexpr int  TICKS_PER_PACKET = 3;
+constexpr auto RECV_LOOP_SLEEP_PERIOD = std::chrono::milliseconds(5);
+constexpr auto RECV_TIMEOUT = std::chrono::milliseconds(100);
+constexpr int  DEFAULT_PACKETS = 2000;
+
+using Clock = std::chrono::steady_clock;
+
+enum class ReceiveMode
+{
+    SLEEP_POLLING,
+    NOTIFICATION
+};
+
+class RxBenchmark
+{
+public:
+    RxBenchmark(ReceiveMode mode, int packets) : _mode(mode),
+                                                 _packets(packets),
+                                                 _send_times(packets)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            std::cout << "Failed to create pipe" << std::endl;
+            std::exit(1);
+        }
+        _notifier_read_fd = fds[0];
+        _notifier_write_fd = fds[1];
+        fcntl(_notifier_read_fd, F_SETFL, O_NONBLOCK);
+        fcntl(_notifier_write_fd, F_SETFL, O_NONBLOCK);
+    }
+
+    ~RxBenchmark()
+    {
+        close(_notifier_read_fd);
+        close(_notifier_write_fd);
+    }
+
+    void run()
+    {
+        std::vector<double> latencies;
+        latencies.reserve(_packets);
+        auto start_time = Clock::now();
+        std::thread producer(&RxBenchmark::producer_task, this);
+
+        gpio::GpioPacket packet;
+        while (static_cast<int>(latencies.size()) < _packets)
+        {
+            if (receive(packet))
+            {
+                auto latency = Clock::now() - _send_times[packet.sequence_no];
+                latencies.push_back(std::chrono::duration<double, std::micro>(latency).count());
+            }
+        }
+        producer.join();
+        double run_time = std::chrono::duration<double>(Clock::now() - start_time).count();
+
+        std::sort(latencies.begin(), latencies.end());
+        double mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+        std::cout << std::fixed << std::setprecision(1)
+                  << (_mode == ReceiveMode::SLEEP_POLLING ? "Sleep polling: " : "Notification:  ")
+                  << "mean " << mean << " us, median " << latencies[latencies.size() / 2]
+                  << " us, 99th percentile " << latencies[latencies.size() * 99 / 100]
+                  << " us, max " << latencies.back() << " us, "
+                  << _wakeups / run_time << " wake ups/s" << std::endl;
+    }
+
+private:
+    /* Does what the rt task does in _handle_tx_packets() */
+    void producer_task()
+    {
+        auto next_tick = Clock::now();
+        for (int i = 0; i < _packets; )
+        {
+            next_tick += TICK_PERIOD;
+            std::this_thread::sleep_until(next_tick);
+            if (++_ticks % TICKS_PER_PACKET != 0)
+            {
+                continue;
+            }
+            gpio::GpioPacket packet{};
+            packet.sequence_no = i;
+            _send_times[i] = Clock::now();
+            if (!_fifo.push(packet))
+            {
+                continue;
+            }
+            ++i;
+            if (_mode == ReceiveMode::NOTIFICATION && _rx_notifier.notification_needed())
+            {
+                char notification = 0;
+                if (write(_notifier_write_fd, &notification, sizeof(notification)) != sizeof(notification))
+                {
+                    _rx_notifier.notification_failed();
+                }
+            }
+        }
+    }
+
+    /* Same as ShiftregGpio::receive_gpio_packet(), before and after */
+    bool receive(gpio::GpioPacket& packet)
+    {
+        if (_fifo.pop(packet))
+        {
+            return true;
+        }
+        if (_mode == ReceiveMode::SLEEP_POLLING)
+        {
+            for (int i = 0; i < RECV_TIMEOUT / RECV_LOOP_SLEEP_PERIOD; ++i)
+            {
+                std::this_thread::sleep_for(RECV_LOOP_SLEEP_PERIOD);
+                _wakeups++;
+                if (_fifo.pop(packet))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        _rx_notifier.wait(_notifier_read_fd, RECV_TIMEOUT);
+        _wakeups++;
+        return _fifo.pop(packet);
+    }
+
+    ReceiveMode _mode;
+    int _packets;
+    int _ticks{0};
+    uint64_t _wakeups{0};
+    std::vector<Clock::time_point> _send_times;
+    CircularFifo<gpio::GpioPacket, GPIO_PACKET_Q_SIZE> _fifo;
+    RxNotifier _rx_notifier;
+    int _notifier_read_fd;
+    int _notifier_write_fd;
+};
+
+int main(int argc, char* argv[])
+{
+    int packets = argc > 1 ? std::atoi(argv[1]) : DEFAULT_PACKETS;
+    if (packets <= 0)
+    {
+        std::cout << "Usage: " << argv[0] << " [number of packets]" << std::endl;
+        return 1;
+    }
+    std::cout << "Receiving " << packets << " packets, one every " << TICKS_PER_PACKET << " ticks of "
+              << TICK_PERIOD.count() << " us" << std::endl;
+
+    RxBenchmark(ReceiveMode::SLEEP_POLLING, packets).run();
+    RxBenchmark(ReceiveMode::NOTIFICATION, packets).run();
+    return 0;
+}
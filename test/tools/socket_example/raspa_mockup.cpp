@@ -1,6 +1,13 @@
 #include <iostream>
 #include <cstring>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <cstdlib>
 #include <cassert>
 #include <cerrno>
 #include <unistd.h>
@@ -8,9 +15,12 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/mman.h>
+#include <poll.h>
 #include <arpa/inet.h>
 
 #include "gpio_protocol/gpio_protocol.h"
+#include "hardware_backend/gpio_shm_ring.h"
 
 constexpr char SENSEI_SOCKET[] = "/tmp/sensei";
 constexpr char RASPA_SOCKET[] = "/tmp/raspa";
@@ -19,14 +29,30 @@ constexpr auto PING_INTERVAL = std::chrono::milliseconds(250);
 
 constexpr int  SILENT_THRESHOLD = 5;
 
+/* In burst mode, values are sent in bursts at this interval with one sendmmsg call */
+constexpr auto BURST_INTERVAL = std::chrono::milliseconds(10);
+constexpr int  MAX_BATCH_SIZE = 32;
+constexpr auto STATS_INTERVAL = std::chrono::seconds(1);
+
 using namespace gpio;
+using namespace sensei::hw_backend;
 
 /* Dummy task that can act as a stand in for raspalib
  * It claims a socket, prints what it receives on it
  * and sends some data to sensei if available 
  * 
+ * Run with a burst size > 1 to send bursts of values on consecutive
+ * controllers instead, for benchmarking. Packets are then received and
+ * sent in batches with recvmmsg/sendmmsg and only statistics are printed.
+ * With a burst size of 0 it only acks packets, for round trip benchmarks.
+ *
+ * If Sensei offers shared memory rings (see gpio_shm_ring.h), packets are
+ * exchanged through them instead of the sockets until Sensei sends a packet
+ * on the socket again.
+ *
  * build cmd: 
  * g++ raspa_mockup.cpp -g -o mockup -lpthread
+ * usage: mockup [burst size]
  */
 
 inline uint32_t to_gpio_protocol_byteord(uint32_t word)
@@ -52,7 +78,7 @@ void print_packet(const GpioPacket& packet)
 class RaspaMockup
 {
 public:
-    RaspaMockup()
+    RaspaMockup(int burst_size) : _burst_size(burst_size)
     {
         _in_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
         _out_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
@@ -78,6 +104,7 @@ public:
     ~RaspaMockup()
     {
         stop();
+        release_shm();
         unlink(RASPA_SOCKET);
     }
 
@@ -128,22 +155,22 @@ private:
 
     void read_loop()
     {
-        GpioPacket buffer;
+        std::array<GpioPacket, MAX_BATCH_SIZE> buffers;
         while (_running)
         {
-            memset(&buffer, 0, sizeof(buffer));
-            auto bytes = recv(_in_socket, &buffer, sizeof(buffer), 0);
-            if (bytes >= (int)sizeof(buffer))
+            /* Take everything from the ring before waiting for its doorbell */
+            if (_shm != nullptr)
             {
-                std::cout << "Received command: " ; print_packet(buffer);
-                if (!_connected)
+                int count;
+                while ((count = gpio_shm_pop(_shm.load()->to_client, buffers.data(), MAX_BATCH_SIZE)) > 0)
                 {
-                    connect_to_sensei();
+                    handle_incoming_packets(buffers.data(), count);
                 }
-                handle_incoming_packet(buffer);
-                _silent_count = 0;
             }
-            else //if (bytes <= 0)
+
+            pollfd fds[2] = {{_in_socket, POLLIN, 0}, {_to_client_doorbell, POLLIN, 0}};
+            int res = poll(fds, _shm != nullptr ? 2 : 1, SOCKET_TIMEOUT_S * 1000);
+            if (res <= 0)
             {
                 std::cout << "Timeout on read: " << std::endl;
                 if (++_silent_count > SILENT_THRESHOLD)
@@ -151,74 +178,271 @@ private:
                     _silent_count = 0;
                     connect_to_sensei();
                 }
+                continue;
+            }
+            if (_shm != nullptr && fds[1].revents & POLLIN)
+            {
+                uint64_t doorbell;
+                read(_to_client_doorbell, &doorbell, sizeof(doorbell));
+            }
+            if (fds[0].revents & POLLIN)
+            {
+                receive_from_socket(buffers);
             }
         }
     }
 
+    void receive_from_socket(std::array<GpioPacket, MAX_BATCH_SIZE>& buffers)
+    {
+        std::array<mmsghdr, MAX_BATCH_SIZE> messages;
+        std::array<iovec, MAX_BATCH_SIZE> iovecs;
+        std::array<std::array<char, CMSG_SPACE(GPIO_SHM_N_FDS * sizeof(int))>, MAX_BATCH_SIZE> controls;
+        for (int i = 0; i < MAX_BATCH_SIZE; ++i)
+        {
+            iovecs[i] = {&buffers[i], sizeof(GpioPacket)};
+            memset(&messages[i], 0, sizeof(mmsghdr));
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_control = controls[i].data();
+            messages[i].msg_hdr.msg_controllen = controls[i].size();
+        }
+        int count = recvmmsg(_in_socket, messages.data(), MAX_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        if (count <= 0)
+        {
+            return;
+        }
+        if (!_connected)
+        {
+            connect_to_sensei();
+        }
+        int packets = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (messages[i].msg_len == sizeof(GpioShmOffer))
+            {
+                handle_shm_offer(messages[i].msg_hdr, reinterpret_cast<const GpioShmOffer&>(buffers[i]));
+            }
+            else if (messages[i].msg_len >= sizeof(GpioPacket))
+            {
+                buffers[packets++] = buffers[i];
+            }
+        }
+        if (packets > 0 && _shm != nullptr)
+        {
+            std::cout << "Sensei is using the socket, dropping shared memory" << std::endl;
+            release_shm();
+            connect_to_sensei();
+        }
+        handle_incoming_packets(buffers.data(), packets);
+    }
+
+    void handle_shm_offer(const msghdr& message, const GpioShmOffer& offer)
+    {
+        cmsghdr* fd_message = CMSG_FIRSTHDR(&message);
+        if (fd_message == nullptr || fd_message->cmsg_type != SCM_RIGHTS ||
+            fd_message->cmsg_len != CMSG_LEN(GPIO_SHM_N_FDS * sizeof(int)))
+        {
+            return;
+        }
+        int fds[GPIO_SHM_N_FDS];
+        memcpy(fds, CMSG_DATA(fd_message), sizeof(fds));
+
+        void* mem = MAP_FAILED;
+        if (offer.magic == GPIO_SHM_MAGIC && offer.version == GPIO_SHM_VERSION &&
+            offer.segment_size == sizeof(GpioShmSegment))
+        {
+            mem = mmap(nullptr, sizeof(GpioShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fds[GPIO_SHM_SEGMENT_FD], 0);
+        }
+        close(fds[GPIO_SHM_SEGMENT_FD]);
+
+        GpioShmReply reply = {GPIO_SHM_MAGIC, GPIO_SHM_VERSION, mem != MAP_FAILED};
+        release_shm();
+        if (mem != MAP_FAILED)
+        {
+            std::lock_guard<std::mutex> lock(_transport_mutex);
+            _to_client_doorbell = fds[GPIO_SHM_TO_CLIENT_DOORBELL_FD];
+            _from_client_doorbell = fds[GPIO_SHM_FROM_CLIENT_DOORBELL_FD];
+            _shm = static_cast<GpioShmSegment*>(mem);
+            std::cout << "Using shared memory rings" << std::endl;
+        }
+        else
+        {
+            close(fds[GPIO_SHM_TO_CLIENT_DOORBELL_FD]);
+            close(fds[GPIO_SHM_FROM_CLIENT_DOORBELL_FD]);
+        }
+        /* A new offer means Sensei was restarted, and it has a new socket */
+        connect_to_sensei();
+        send(_out_socket, &reply, sizeof(reply), 0);
+    }
+
+    void release_shm()
+    {
+        std::lock_guard<std::mutex> lock(_transport_mutex);
+        if (_shm != nullptr)
+        {
+            munmap(_shm, sizeof(GpioShmSegment));
+            close(_to_client_doorbell);
+            close(_from_client_doorbell);
+            _shm = nullptr;
+        }
+    }
+
     void write_loop()
     {
-        GpioPacket buffer;
+        std::vector<GpioPacket> acks;
+        std::vector<GpioPacket> values;
+        auto next_value_time = std::chrono::steady_clock::now();
+        auto next_stats_time = next_value_time + STATS_INTERVAL;
         while (_running)
         {
-            if (_connected)
             {
-                /* If we have a queued ack, send it  */
-                if (_send_ack)
+                std::unique_lock<std::mutex> lock(_ack_mutex);
+                _ack_notifier.wait_until(lock, next_value_time, [&]() {return !_acks.empty() || !_running;});
+                acks.swap(_acks);
+            }
+            if (!_connected)
+            {
+                acks.clear();
+                next_value_time = std::chrono::steady_clock::now() + PING_INTERVAL;
+                continue;
+            }
+
+            /* If we have queued acks, send them */
+            if (!acks.empty())
+            {
+                int sent = send_packets(acks);
+                if (sent < static_cast<int>(acks.size()))
                 {
-                    auto ret = send(_out_socket, &_ack, sizeof(_ack), 0);
-                    if (ret < sizeof(_ack))
-                    {
-                        std::cout << "Failed to send ack with error: " << ret << std::endl;
-                    }
-                    else
+                    std::cout << "Failed to send acks with error: " << strerror(errno) << std::endl;
+                }
+                else if (!benchmarking())
+                {
+                    for (const auto& ack : acks)
                     {
-                        std::cout << "Sent ack to msg: " << from_gpio_protocol_byteord(_ack.payload.gpio_ack_data.returned_seq_no) << std::endl;
+                        std::cout << "Sent ack to msg: " << from_gpio_protocol_byteord(ack.payload.gpio_ack_data.returned_seq_no) << std::endl;
                     }
-                    _send_ack = false;
                 }
-                else
+                acks.clear();
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_value_time)
+            {
+                /* Send random values, on controller 5 or in bursts on consecutive controllers */
+                auto t = std::chrono::system_clock::now().time_since_epoch();
+                values.clear();
+                for (int i = 0; i < _burst_size; ++i)
                 {
-                    /* Send a random value on controller 5 */
-                    GpioPacket packet;
+                    GpioPacket packet{0};
                     packet.command = GPIO_CMD_GET_VALUE;
-                    packet.payload.gpio_value_data.controller_id = 5;
+                    packet.payload.gpio_value_data.controller_id = benchmarking() ? i : 5;
                     packet.payload.gpio_value_data.controller_val = to_gpio_protocol_byteord(rand() % 128);
+                    packet.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+                    values.push_back(packet);
+                }
+                int sent = send_packets(values);
+                if (sent < static_cast<int>(values.size()))
+                {
+                    std::cout << "Failed to send random values: " << sent << std::endl;
+                }
+                else if (!benchmarking())
+                {
+                    std::cout << "Sent value msg: "  << std::endl;
+                }
+                _sent_count += sent;
+                next_value_time = now + (benchmarking() ? BURST_INTERVAL : PING_INTERVAL + std::chrono::milliseconds(500));
+            }
 
-                    auto t = std::chrono::system_clock::now().time_since_epoch();
-                    packet.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(t).count();  
+            if (benchmarking() && now >= next_stats_time)
+            {
+                std::cout << "Sent " << _sent_count << " values, received " << _received_count << " packets" << std::endl;
+                _sent_count = 0;
+                _received_count = 0;
+                next_stats_time = now + STATS_INTERVAL;
+            }
+        }
+    }
 
-                    auto ret = send(_out_socket, &packet, sizeof(packet), 0);
-                    if (ret < sizeof(_ack))
-                    {
-                        std::cout << "Failed to send random value: " << ret << std::endl;
-                    }
-                    else
-                    {
-                        std::cout << "Sent value msg: "  << std::endl;
-                    }
-                    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                }
+    /* Sends the packets with as few system calls as possible, returns the number sent */
+    int send_packets(std::vector<GpioPacket>& packets)
+    {
+        std::lock_guard<std::mutex> lock(_transport_mutex);
+        if (_shm != nullptr)
+        {
+            bool wake_sensei;
+            int sent = gpio_shm_push(_shm.load()->from_client, packets.data(), packets.size(), wake_sensei);
+            if (wake_sensei)
+            {
+                uint64_t doorbell = 1;
+                write(_from_client_doorbell, &doorbell, sizeof(doorbell));
+            }
+            return sent;
+        }
+        std::array<mmsghdr, MAX_BATCH_SIZE> messages;
+        std::array<iovec, MAX_BATCH_SIZE> iovecs;
+        int sent = 0;
+        while (sent < static_cast<int>(packets.size()))
+        {
+            int count = std::min(static_cast<int>(packets.size()) - sent, MAX_BATCH_SIZE);
+            for (int i = 0; i < count; ++i)
+            {
+                iovecs[i] = {&packets[sent + i], sizeof(GpioPacket)};
+                memset(&messages[i], 0, sizeof(mmsghdr));
+                messages[i].msg_hdr.msg_iov = &iovecs[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+            int ret = sendmmsg(_out_socket, messages.data(), count, 0);
+            if (ret <= 0)
+            {
+                /* Reconnect when the next packet arrives, Sensei may have been restarted */
+                _connected = false;
+                break;
             }
-            std::this_thread::sleep_for(PING_INTERVAL);
+            sent += ret;
         }
+        return sent;
     }
 
-    void handle_incoming_packet(const GpioPacket& packet)
+    void handle_incoming_packets(const GpioPacket* packets, int count)
     {
-        /* Just reply every packet with an ok ack */
-        GpioPacket ack{0};
-        ack.command = GPIO_ACK;
-        ack.payload.gpio_ack_data.returned_seq_no = packet.sequence_no;
-        /* Signal ok to send it */
-        _ack = ack;
-        _send_ack = true;
+        std::lock_guard<std::mutex> lock(_ack_mutex);
+        for (int i = 0; i < count; ++i)
+        {
+            if (!benchmarking())
+            {
+                std::cout << "Received command: " ; print_packet(packets[i]);
+            }
+            /* Just reply every packet with an ok ack */
+            GpioPacket ack{0};
+            ack.command = GPIO_ACK;
+            ack.payload.gpio_ack_data.returned_seq_no = packets[i].sequence_no;
+            _acks.push_back(ack);
+        }
+        _received_count += count;
+        _silent_count = 0;
+        /* Signal ok to send them */
+        _ack_notifier.notify_one();
     }
 
+    bool benchmarking() const
+    {
+        return _burst_size != 1;
+    }
 
-    bool            _running{false};
+    std::atomic<bool> _running{false};
     bool            _connected{false};
-    bool            _send_ack{false};
-    GpioPacket  _ack;
+    int             _burst_size;
+
+    std::mutex      _ack_mutex;
+    std::condition_variable _ack_notifier;
+    std::vector<GpioPacket> _acks;
+    std::atomic<int> _sent_count{0};
+    std::atomic<int> _received_count{0};
+
+    std::mutex      _transport_mutex;
+    std::atomic<GpioShmSegment*> _shm{nullptr};
+    int             _to_client_doorbell{-1};
+    int             _from_client_doorbell{-1};
 
     std::thread     _read_thread;
     std::thread     _write_thread;
@@ -236,10 +460,16 @@ static void signal_handler(int sig_number)
     running = false;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    int burst_size = argc > 1 ? std::atoi(argv[1]) : 1;
+    if (burst_size < 0)
+    {
+        std::cout << "Usage: " << argv[0] << " [burst size]" << std::endl;
+        return 1;
+    }
     signal(SIGINT, signal_handler);
-    RaspaMockup instance;
+    RaspaMockup instance(burst_size);
     instance.run();
     while(running)
     {
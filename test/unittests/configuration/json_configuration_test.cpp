@@ -48,7 +48,7 @@ protected:
 TEST_F(JsonConfigurationTest, test_invalid_file)
 {
     JsonConfiguration test_module(&_queue, "/non/existing/file.json");
-    HwFrontendConfig hw_config;
+    HwConfig hw_config;
     EXPECT_EQ(ConfigStatus::IO_ERROR, test_module.read(hw_config));
 }
 
@@ -58,12 +58,14 @@ TEST_F(JsonConfigurationTest, test_invalid_file)
 TEST_F(JsonConfigurationTest, test_read_configuration)
 {
     EXPECT_TRUE(_queue.empty());
-    HwFrontendConfig hw_frontend;
-    ConfigStatus status = _module_under_test.read(hw_frontend);
+    HwConfig hw_config;
+    ConfigStatus status = _module_under_test.read(hw_config);
     EXPECT_EQ(ConfigStatus::OK, status);
     EXPECT_FALSE(_queue.empty());
 
-    EXPECT_EQ(HwFrontendType::RASPA_GPIO, hw_frontend.type);
+    ASSERT_EQ(1u, hw_config.frontends.size());
+    EXPECT_EQ(HwFrontendType::RASPA_GPIO, hw_config.frontends[0].type);
+    EXPECT_EQ(0, hw_config.frontends[0].first_sensor);
 
     /* Now verify the commands one by one */
     /* First we should receive the backend related commands */
@@ -271,3 +273,176 @@ TEST_F(JsonConfigurationTest, test_read_configuration)
     m = std::move(_queue.pop());
     EXPECT_COMMAND(m, CommandType::ENABLE_SENDING_PACKETS, EnableSendingPacketsCommand, 0, (int)true);
 }
+
+TEST_F(JsonConfigurationTest, test_threads_config)
+{
+    Json::Value threads;
+    threads["hw_frontend_read"]["policy"] = "fifo";
+    threads["hw_frontend_read"]["priority"] = 75;
+    threads["hw_frontend_read"]["cpus"].append(2);
+    threads["hw_frontend_read"]["cpus"].append(3);
+    threads["logger"]["cpus"].append(0);
+
+    ThreadsConfig config;
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_threads_config(threads, config));
+    EXPECT_EQ(SchedulingPolicy::FIFO, config.hw_frontend_read.policy);
+    EXPECT_EQ(75, config.hw_frontend_read.priority);
+    EXPECT_EQ(std::vector<int>({2, 3}), config.hw_frontend_read.cpus);
+    EXPECT_EQ(SchedulingPolicy::INHERIT, config.logger.policy);
+    EXPECT_EQ(std::vector<int>({0}), config.logger.cpus);
+    EXPECT_FALSE(config.event_loop.is_set());
+
+    threads["event_loop"]["policy"] = "deadline";
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_threads_config(threads, config));
+}
+
+TEST_F(JsonConfigurationTest, test_metrics_config)
+{
+    Json::Value metrics;
+    std::string socket_path;
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_metrics_config(metrics, socket_path));
+    EXPECT_TRUE(socket_path.empty());
+
+    metrics["socket"] = "/tmp/sensei_metrics";
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_metrics_config(metrics, socket_path));
+    EXPECT_EQ("/tmp/sensei_metrics", socket_path);
+
+    metrics["socket"] = "";
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_metrics_config(metrics, socket_path));
+}
+
+TEST_F(JsonConfigurationTest, test_multiple_hw_frontends)
+{
+    Json::Value frontends;
+    frontends[0]["type"] = "elk_pi";
+    frontends[0]["n_sensors"] = 32;
+    frontends[1]["type"] = "raspa_gpio";
+    frontends[1]["port"] = "/tmp/raspa_1";
+    frontends[1]["sensei_port"] = "/tmp/sensei_1";
+    frontends[1]["first_sensor"] = 32;
+    frontends[1]["n_sensors"] = 16;
+    frontends[2]["type"] = "raspa_gpio";
+    frontends[2]["port"] = "/tmp/raspa_2";
+    frontends[2]["sensei_port"] = "/tmp/sensei_2";
+    frontends[2]["first_sensor"] = 48;
+    frontends[2]["shm_transport"] = true;
+
+    std::vector<HwFrontendConfig> configs;
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_hw_frontends(frontends, configs));
+    ASSERT_EQ(3u, configs.size());
+    EXPECT_EQ(HwFrontendType::ELK_PI_GPIO, configs[0].type);
+    EXPECT_EQ(32, configs[0].n_sensors);
+    EXPECT_EQ("/tmp/raspa_1", configs[1].port);
+    EXPECT_EQ("/tmp/sensei_1", configs[1].sensei_port);
+    EXPECT_EQ(32, configs[1].first_sensor);
+    EXPECT_EQ(48, configs[2].first_sensor);
+    EXPECT_EQ(0, configs[2].n_sensors);
+    EXPECT_FALSE(configs[1].shm_transport);
+    EXPECT_TRUE(configs[2].shm_transport);
+
+    /* Sensor ranges must not overlap */
+    frontends[2]["first_sensor"] = 40;
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_frontends(frontends, configs));
+
+    /* Nor may two boards share a gpio client */
+    frontends[2]["first_sensor"] = 48;
+    frontends[2]["port"] = "/tmp/raspa_1";
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_frontends(frontends, configs));
+
+    /* Or receive on the same socket, including the default one */
+    frontends[2]["port"] = "/tmp/raspa_2";
+    frontends[2]["sensei_port"] = "/tmp/sensei_1";
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_frontends(frontends, configs));
+    frontends[1].removeMember("sensei_port");
+    frontends[2].removeMember("sensei_port");
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_frontends(frontends, configs));
+}
+
+TEST_F(JsonConfigurationTest, test_simulated_elk_pi_config)
+{
+    Json::Value frontends;
+    frontends[0]["type"] = "elk_pi";
+    frontends[0]["n_sensors"] = 32;
+    frontends[1]["type"] = "elk_pi_simulation";
+    frontends[1]["first_sensor"] = 32;
+
+    /* A simulated board does not share the driver with a real one */
+    std::vector<HwFrontendConfig> configs;
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_hw_frontends(frontends, configs));
+    ASSERT_EQ(2u, configs.size());
+    EXPECT_EQ(HwFrontendType::ELK_PI_GPIO, configs[0].type);
+    EXPECT_EQ(HwFrontendType::ELK_PI_SIMULATION, configs[1].type);
+}
+
+TEST_F(JsonConfigurationTest, test_rt_fifo_overflow_config)
+{
+    Json::Value frontend;
+    frontend["type"] = "elk_pi";
+    HwFrontendConfig config;
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_hw_config(frontend, config));
+    EXPECT_EQ(hw_backend::shiftregister_gpio::RtFifoOverflowPolicy::DROP, config.rt_fifo_overflow);
+
+    frontend["rt_fifo_overflow"] = "defer";
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_hw_config(frontend, config));
+    EXPECT_EQ(hw_backend::shiftregister_gpio::RtFifoOverflowPolicy::DEFER, config.rt_fifo_overflow);
+
+    frontend["rt_fifo_overflow"] = "block";
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_config(frontend, config));
+}
+
+TEST_F(JsonConfigurationTest, test_record_and_replay_config)
+{
+    Json::Value frontend;
+    frontend["type"] = "replay";
+    HwFrontendConfig config;
+    /* A capture to play back is required */
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_config(frontend, config));
+
+    config = HwFrontendConfig();
+    frontend["replay_file"] = "/tmp/session.cap";
+    frontend["replay_speed"] = 0;
+    frontend["record_file"] = "/tmp/replayed.cap";
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_hw_config(frontend, config));
+    EXPECT_EQ(HwFrontendType::REPLAY, config.type);
+    EXPECT_EQ("/tmp/session.cap", config.replay_file);
+    EXPECT_FLOAT_EQ(0.0f, config.replay_speed);
+    EXPECT_EQ("/tmp/replayed.cap", config.record_file);
+
+    frontend["replay_speed"] = -1;
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_config(frontend, config));
+}
+
+TEST_F(JsonConfigurationTest, test_synthetic_config)
+{
+    Json::Value frontend;
+    frontend["type"] = "synthetic";
+    HwFrontendConfig config;
+    /* Something to generate is required */
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_config(frontend, config));
+
+    frontend["synthetic_signals"][0]["waveform"] = "random_walk";
+    frontend["synthetic_signals"][0]["n_controllers"] = 16;
+    frontend["synthetic_signals"][0]["rate_hz"] = 4000;
+    frontend["synthetic_signals"][1]["waveform"] = "button_burst";
+    frontend["synthetic_signals"][1]["first_controller"] = 16;
+    frontend["synthetic_signals"][1]["max"] = 1;
+    frontend["synthetic_signals"][1]["burst_length"] = 3;
+    config = HwFrontendConfig();
+    ASSERT_EQ(ConfigStatus::OK, _module_under_test.handle_hw_config(frontend, config));
+    EXPECT_EQ(HwFrontendType::SYNTHETIC, config.type);
+    ASSERT_EQ(2u, config.synthetic_signals.size());
+    EXPECT_EQ(hw_backend::Waveform::RANDOM_WALK, config.synthetic_signals[0].waveform);
+    EXPECT_EQ(16, config.synthetic_signals[0].n_controllers);
+    EXPECT_FLOAT_EQ(4000, config.synthetic_signals[0].rate_hz);
+    EXPECT_EQ(hw_backend::Waveform::BUTTON_BURST, config.synthetic_signals[1].waveform);
+    EXPECT_EQ(16, config.synthetic_signals[1].first_controller);
+    EXPECT_EQ(1u, config.synthetic_signals[1].max_value);
+    EXPECT_EQ(3, config.synthetic_signals[1].burst_length);
+
+    frontend["synthetic_signals"][1]["waveform"] = "square";
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_config(frontend, config));
+    frontend["synthetic_signals"][1]["waveform"] = "noise";
+    frontend["synthetic_signals"][1]["first_controller"] = 255;
+    frontend["synthetic_signals"][1]["n_controllers"] = 2;
+    EXPECT_EQ(ConfigStatus::PARAMETER_ERROR, _module_under_test.handle_hw_config(frontend, config));
+}
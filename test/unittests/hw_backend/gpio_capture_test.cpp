@@ -0,0 +1,160 @@
+#include <deque>
+#include <thread>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#define private public
+
+#include "hardware_backend/recording_hw_backend.cpp"
+#include "hardware_backend/replay_hw_backend.cpp"
+
+using namespace sensei;
+using namespace sensei::hw_backend;
+
+constexpr auto TEST_TIMEOUT = std::chrono::milliseconds(10);
+
+/* Backend returning the packets it is given, one at a time */
+class FakeHwBackend : public BaseHwBackend
+{
+public:
+    FakeHwBackend() : BaseHwBackend(TEST_TIMEOUT) {}
+
+    bool init() override {return true;}
+
+    void deinit() override {}
+
+    bool send_gpio_packet(const gpio::GpioPacket& tx_gpio_packet) override
+    {
+        sent.push_back(tx_gpio_packet);
+        return true;
+    }
+
+    bool receive_gpio_packet(gpio::GpioPacket& rx_gpio_packet) override
+    {
+        if (to_receive.empty())
+        {
+            return false;
+        }
+        rx_gpio_packet = to_receive.front();
+        to_receive.pop_front();
+        return true;
+    }
+
+    std::vector<gpio::GpioPacket> sent;
+    std::deque<gpio::GpioPacket> to_receive;
+};
+
+gpio::GpioPacket make_value_packet(uint8_t controller_id, uint32_t value)
+{
+    gpio::GpioPacket packet = {};
+    packet.command = gpio::GPIO_CMD_GET_VALUE;
+    packet.payload.gpio_value_data.controller_id = controller_id;
+    packet.payload.gpio_value_data.controller_val = value;
+    return packet;
+}
+
+class TestGpioCapture : public ::testing::Test
+{
+protected:
+    void SetUp()
+    {
+        _file_name = "/tmp/sensei_test_capture_" + std::to_string(getpid()) + ".bin";
+    }
+
+    void TearDown()
+    {
+        std::remove(_file_name.c_str());
+    }
+
+    /* Records a board answering a request for board info, then sending 2 values 50 ms apart */
+    void record_session()
+    {
+        auto backend = std::make_unique<FakeHwBackend>();
+        auto fake_backend = backend.get();
+        RecordingHwBackend recorder(std::move(backend), _file_name, TEST_TIMEOUT);
+        ASSERT_TRUE(recorder.init());
+
+        gpio::GpioPacket request = {};
+        request.command = gpio::GPIO_CMD_SYSTEM_CONTROL;
+        request.sub_command = gpio::GPIO_SUB_CMD_GET_BOARD_INFO;
+        request.sequence_no = 1;
+        ASSERT_EQ(1, recorder.send_gpio_packets(&request, 1));
+        ASSERT_EQ(1u, fake_backend->sent.size());
+
+        gpio::GpioPacket reply = request;
+        reply.payload.gpio_board_info_data.num_analog_input_pins = 8;
+        gpio::GpioPacket ack = {};
+        ack.command = gpio::GPIO_ACK;
+        ack.payload.gpio_ack_data.returned_seq_no = 1;
+        fake_backend->to_receive = {reply, ack, make_value_packet(3, 100)};
+        gpio::GpioPacket packet;
+        for (int i = 0; i < 3; ++i)
+        {
+            ASSERT_EQ(1, recorder.receive_gpio_packets(&packet, 1));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        fake_backend->to_receive = {make_value_packet(4, 200)};
+        ASSERT_TRUE(recorder.receive_gpio_packet(packet));
+        EXPECT_FALSE(recorder.receive_gpio_packet(packet));
+        EXPECT_EQ(5u, recorder.recorded_packets());
+        recorder.deinit();
+    }
+
+    std::string _file_name;
+};
+
+TEST_F(TestGpioCapture, test_replay_as_fast_as_possible)
+{
+    record_session();
+    ReplayHwBackend replay(_file_name, 0, TEST_TIMEOUT);
+    ASSERT_TRUE(replay.init());
+
+    /* Only the values are played back, acks and replies are made for what is sent */
+    std::array<gpio::GpioPacket, 8> packets;
+    ASSERT_EQ(2, replay.receive_gpio_packets(packets.data(), packets.size()));
+    EXPECT_EQ(3, packets[0].payload.gpio_value_data.controller_id);
+    EXPECT_EQ(200u, packets[1].payload.gpio_value_data.controller_val);
+    EXPECT_TRUE(replay.finished());
+    EXPECT_EQ(2u, replay.replayed_packets());
+
+    gpio::GpioPacket request = {};
+    request.command = gpio::GPIO_CMD_SYSTEM_CONTROL;
+    request.sub_command = gpio::GPIO_SUB_CMD_GET_BOARD_INFO;
+    request.sequence_no = 7;
+    ASSERT_TRUE(replay.send_gpio_packet(request));
+    ASSERT_EQ(2, replay.receive_gpio_packets(packets.data(), packets.size()));
+    EXPECT_EQ(8, packets[0].payload.gpio_board_info_data.num_analog_input_pins);
+    EXPECT_EQ(gpio::GPIO_ACK, packets[1].command);
+    EXPECT_EQ(7u, packets[1].payload.gpio_ack_data.returned_seq_no);
+    EXPECT_EQ(0, replay.receive_gpio_packets(packets.data(), packets.size()));
+}
+
+TEST_F(TestGpioCapture, test_replay_at_recorded_speed)
+{
+    record_session();
+    ReplayHwBackend replay(_file_name, 1.0f, TEST_TIMEOUT);
+    ASSERT_TRUE(replay.init());
+
+    /* The second value was recorded 50 ms after the first */
+    std::array<gpio::GpioPacket, 8> packets;
+    ASSERT_EQ(1, replay.receive_gpio_packets(packets.data(), packets.size()));
+    EXPECT_EQ(0, replay.receive_gpio_packets(packets.data(), packets.size()));
+    EXPECT_FALSE(replay.finished());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(1, replay.receive_gpio_packets(packets.data(), packets.size()));
+    EXPECT_EQ(4, packets[0].payload.gpio_value_data.controller_id);
+    EXPECT_TRUE(replay.finished());
+}
+
+TEST_F(TestGpioCapture, test_invalid_capture)
+{
+    ReplayHwBackend missing(_file_name, 1.0f, TEST_TIMEOUT);
+    EXPECT_FALSE(missing.init());
+
+    FILE* file = std::fopen(_file_name.c_str(), "wb");
+    ASSERT_NE(nullptr, file);
+    std::fputs("not a capture", file);
+    std::fclose(file);
+    ReplayHwBackend invalid(_file_name, 1.0f, TEST_TIMEOUT);
+    EXPECT_FALSE(invalid.init());
+}
@@ -0,0 +1,110 @@
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+#include "gtest/gtest.h"
+#define private public
+
+#include "hardware_backend/gpio_hw_socket.cpp"
+#include "hardware_backend/gpio_hw_shm.cpp"
+
+using namespace sensei;
+using namespace sensei::hw_backend;
+
+gpio::GpioPacket make_packet(uint32_t seq_no)
+{
+    gpio::GpioPacket packet = {};
+    packet.command = gpio::GPIO_CMD_SET_VALUE;
+    packet.sequence_no = seq_no;
+    return packet;
+}
+
+TEST(TestGpioShmRing, test_push_pop)
+{
+    auto ring = std::make_unique<GpioShmRing>();
+    ring->head = 0;
+    ring->tail = 0;
+    std::array<gpio::GpioPacket, 4> packets;
+    bool wake;
+
+    EXPECT_EQ(0, gpio_shm_pop(*ring, packets.data(), packets.size()));
+    /* Only the first push to an empty ring rings the doorbell */
+    auto packet = make_packet(1);
+    EXPECT_EQ(1, gpio_shm_push(*ring, &packet, 1, wake));
+    EXPECT_TRUE(wake);
+    packet = make_packet(2);
+    EXPECT_EQ(1, gpio_shm_push(*ring, &packet, 1, wake));
+    EXPECT_FALSE(wake);
+
+    ASSERT_EQ(2, gpio_shm_pop(*ring, packets.data(), packets.size()));
+    EXPECT_EQ(1u, packets[0].sequence_no);
+    EXPECT_EQ(2u, packets[1].sequence_no);
+    packet = make_packet(3);
+    EXPECT_EQ(1, gpio_shm_push(*ring, &packet, 1, wake));
+    EXPECT_TRUE(wake);
+    ASSERT_EQ(1, gpio_shm_pop(*ring, packets.data(), packets.size()));
+
+    /* Fill the ring, also across the wrap around of the indexes */
+    ring->head = std::numeric_limits<uint32_t>::max() - 10;
+    ring->tail = std::numeric_limits<uint32_t>::max() - 10;
+    std::vector<gpio::GpioPacket> many(GPIO_SHM_RING_SIZE + 10);
+    for (unsigned int i = 0; i < many.size(); ++i)
+    {
+        many[i] = make_packet(i);
+    }
+    EXPECT_EQ(static_cast<int>(GPIO_SHM_RING_SIZE), gpio_shm_push(*ring, many.data(), many.size(), wake));
+    EXPECT_EQ(0, gpio_shm_push(*ring, many.data(), 1, wake));
+    for (uint32_t i = 0; i < GPIO_SHM_RING_SIZE; i += packets.size())
+    {
+        ASSERT_EQ(static_cast<int>(packets.size()), gpio_shm_pop(*ring, packets.data(), packets.size()));
+        EXPECT_EQ(i, packets[0].sequence_no);
+        EXPECT_EQ(i + 3, packets[3].sequence_no);
+    }
+    EXPECT_EQ(0, gpio_shm_pop(*ring, packets.data(), packets.size()));
+}
+
+class TestGpioHwShm : public ::testing::Test
+{
+protected:
+    TestGpioHwShm() : _module_under_test("/tmp/raspa_test", std::chrono::milliseconds(10)) {}
+
+    void SetUp()
+    {
+        /* Set up the transport as if negotiated */
+        void* mem = mmap(nullptr, sizeof(GpioShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        ASSERT_NE(MAP_FAILED, mem);
+        _segment = static_cast<GpioShmSegment*>(mem);
+        _module_under_test._segment = _segment;
+        _module_under_test._to_client_doorbell = eventfd(0, EFD_NONBLOCK);
+        _module_under_test._from_client_doorbell = eventfd(0, EFD_NONBLOCK);
+    }
+
+    void TearDown()
+    {
+        _module_under_test._release_shm_transport();
+    }
+
+    GpioHwShm _module_under_test;
+    GpioShmSegment* _segment;
+};
+
+TEST_F(TestGpioHwShm, test_send_and_receive)
+{
+    ASSERT_TRUE(_module_under_test.shm_active());
+    std::array<gpio::GpioPacket, 3> packets = {make_packet(1), make_packet(2), make_packet(3)};
+    EXPECT_EQ(3, _module_under_test.send_gpio_packets(packets.data(), packets.size()));
+    uint64_t doorbell = 0;
+    EXPECT_EQ(static_cast<ssize_t>(sizeof(doorbell)), read(_module_under_test._to_client_doorbell, &doorbell, sizeof(doorbell)));
+    EXPECT_EQ(1u, doorbell);
+
+    /* Act as the client and send them back */
+    std::array<gpio::GpioPacket, 4> received;
+    ASSERT_EQ(3, gpio_shm_pop(_segment->to_client, received.data(), received.size()));
+    bool wake;
+    EXPECT_EQ(3, gpio_shm_push(_segment->from_client, received.data(), 3, wake));
+
+    EXPECT_EQ(3, _module_under_test.receive_gpio_packets(received.data(), received.size()));
+    EXPECT_EQ(2u, received[1].sequence_no);
+
+    /* Times out when there is nothing to receive */
+    EXPECT_FALSE(_module_under_test.receive_gpio_packet(received[0]));
+}
@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#define private public
+
+#include "shiftreg_gpio/rt_fifo_monitor.h"
+
+using namespace sensei;
+using namespace sensei::hw_backend::shiftregister_gpio;
+
+TEST(TestRtFifoMonitor, test_high_water_marks)
+{
+    RtFifoMonitor module_under_test;
+    for (int i = 0; i < 3; ++i)
+    {
+        module_under_test.tx_packet_pushed();
+        module_under_test.rx_packet_pushed();
+    }
+    module_under_test.tx_packet_popped();
+    module_under_test.tx_packet_popped();
+    module_under_test.rx_packet_popped();
+    module_under_test.tx_packet_pushed();
+    module_under_test.rx_packet_pushed();
+
+    auto stats = module_under_test.statistics();
+    EXPECT_EQ(3, stats.tx_fifo_high_water);
+    EXPECT_EQ(3, stats.rx_fifo_high_water);
+
+    module_under_test.rx_packet_pushed();
+    module_under_test.rx_packet_pushed();
+    stats = module_under_test.statistics();
+    EXPECT_EQ(3, stats.tx_fifo_high_water);
+    EXPECT_EQ(5, stats.rx_fifo_high_water);
+}
+
+TEST(TestRtFifoMonitor, test_drop_counters)
+{
+    RtFifoMonitor module_under_test;
+    module_under_test.tx_packet_dropped();
+    module_under_test.tx_packet_dropped();
+    module_under_test.tx_packet_deferred();
+    module_under_test.rx_budget_exhausted();
+    module_under_test.log_msg_dropped();
+    module_under_test.log_budget_exhausted();
+    module_under_test.log_budget_exhausted();
+
+    auto stats = module_under_test.statistics();
+    EXPECT_EQ(2u, stats.tx_packets_dropped);
+    EXPECT_EQ(1u, stats.tx_packets_deferred);
+    EXPECT_EQ(1u, stats.rx_budget_exhausted);
+    EXPECT_EQ(1u, stats.log_msgs_dropped);
+    EXPECT_EQ(2u, stats.log_budget_exhausted);
+}
@@ -0,0 +1,126 @@
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "shiftreg_gpio/shiftreg_gpio_sim.h"
+#include "hardware_frontend/hw_frontend.h"
+#include "message/message_factory.h"
+
+#include "../test_utils.h"
+
+using namespace sensei;
+using namespace sensei::hw_backend::shiftregister_gpio;
+
+constexpr auto TEST_TIMEOUT = std::chrono::milliseconds(10);
+/* Generous, as the simulated board ticks in a regular thread on a possibly loaded machine */
+constexpr auto WAIT_TIMEOUT = std::chrono::seconds(2);
+
+constexpr int BUTTON_ID = 0;
+constexpr int BUTTON_PIN = 3;
+constexpr int LED_ID = 1;
+constexpr int LED_PIN = 5;
+
+/*
+ * Drives the simulated Elk Pi board through the hw frontend, as sensei does,
+ * so that the packets go through the real gpio client of the board.
+ */
+class TestShiftregGpioSim : public ::testing::Test
+{
+protected:
+    TestShiftregGpioSim() :
+            _board(TEST_TIMEOUT),
+            _frontend(&_in_queue, &_out_queue, &_board, 1,
+                      std::chrono::milliseconds(5), std::chrono::milliseconds(100))
+    {
+    }
+
+    void SetUp()
+    {
+        ASSERT_TRUE(_board.init());
+        _frontend.run();
+        push(_factory.make_enable_sending_packets_command(0, false));
+        push(_factory.make_set_sensor_hw_type_command(BUTTON_ID, SensorHwType::DIGITAL_INPUT_PIN));
+        push(_factory.make_set_hw_pins_command(BUTTON_ID, {BUTTON_PIN}));
+        push(_factory.make_set_sending_mode_command(BUTTON_ID, SendingMode::ON_VALUE_CHANGED));
+        push(_factory.make_set_enabled_command(BUTTON_ID, true));
+        push(_factory.make_set_sensor_hw_type_command(LED_ID, SensorHwType::DIGITAL_OUTPUT_PIN));
+        push(_factory.make_set_hw_pins_command(LED_ID, {LED_PIN}));
+        push(_factory.make_set_enabled_command(LED_ID, true));
+        push(_factory.make_enable_sending_packets_command(0, true));
+    }
+
+    void TearDown()
+    {
+        _frontend.stop();
+        _board.deinit();
+    }
+
+    void push(std::unique_ptr<BaseMessage> message)
+    {
+        _in_queue.push(CMD_UPTR(std::move(message)));
+    }
+
+    /* Waits for a value of the given sensor, skipping the ones of other sensors and other values */
+    bool wait_for_value(int sensor_id, int expected)
+    {
+        auto end = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            _out_queue.wait_for_data(TEST_TIMEOUT);
+            while (!_out_queue.empty())
+            {
+                auto message = _out_queue.pop();
+                if (message->base_type() != MessageType::VALUE || message->index() != sensor_id)
+                {
+                    continue;
+                }
+                auto value = static_cast<AnalogValue*>(message.get());
+                if (value->value() == expected)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool wait_for_output(int pin, bool expected)
+    {
+        auto end = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            if (_board.digital_output(pin) == expected)
+            {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    SynchronizedQueue<std::unique_ptr<Command>> _in_queue;
+    SynchronizedQueue<std::unique_ptr<BaseMessage>> _out_queue;
+    ShiftregGpioSim _board;
+    hw_frontend::HwFrontend _frontend;
+    MessageFactory _factory;
+};
+
+TEST_F(TestShiftregGpioSim, test_digital_input)
+{
+    _board.set_digital_input(BUTTON_PIN, true);
+    ASSERT_TRUE(wait_for_value(BUTTON_ID, 1));
+    _board.set_digital_input(BUTTON_PIN, false);
+    ASSERT_TRUE(wait_for_value(BUTTON_ID, 0));
+    EXPECT_GT(_board.ticks(), 0u);
+}
+
+TEST_F(TestShiftregGpioSim, test_digital_output)
+{
+    EXPECT_FALSE(_board.digital_output(LED_PIN));
+    push(_factory.make_set_digital_output_command(LED_ID, true));
+    ASSERT_TRUE(wait_for_output(LED_PIN, true));
+    push(_factory.make_set_digital_output_command(LED_ID, false));
+    ASSERT_TRUE(wait_for_output(LED_PIN, false));
+    /* Other outputs are left alone */
+    EXPECT_FALSE(_board.digital_output(LED_PIN + 1));
+}
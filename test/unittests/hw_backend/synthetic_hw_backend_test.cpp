@@ -0,0 +1,98 @@
+#include <thread>
+
+#include "gtest/gtest.h"
+#define private public
+
+#include "hardware_backend/synthetic_hw_backend.cpp"
+
+using namespace sensei;
+using namespace sensei::hw_backend;
+
+constexpr auto TEST_TIMEOUT = std::chrono::milliseconds(10);
+
+uint32_t packet_value(const gpio::GpioPacket& packet)
+{
+    return hw_frontend::from_gpio_protocol_byteord(packet.payload.gpio_value_data.controller_val);
+}
+
+TEST(TestSyntheticHwBackend, test_generated_values)
+{
+    SyntheticSignalConfig ramp;
+    ramp.first_controller = 2;
+    ramp.n_controllers = 2;
+    ramp.rate_hz = 1000;
+    ramp.period = std::chrono::milliseconds(4);
+    ramp.max_value = 400;
+    SyntheticHwBackend module_under_test({ramp}, TEST_TIMEOUT);
+    ASSERT_TRUE(module_under_test.init());
+
+    /* The first tick is due right away, one value per controller */
+    std::array<gpio::GpioPacket, 16> packets;
+    ASSERT_EQ(2, module_under_test.receive_gpio_packets(packets.data(), packets.size()));
+    EXPECT_EQ(gpio::GPIO_CMD_GET_VALUE, packets[0].command);
+    EXPECT_EQ(2, packets[0].payload.gpio_value_data.controller_id);
+    EXPECT_EQ(3, packets[1].payload.gpio_value_data.controller_id);
+    /* Controllers are spread out in phase */
+    EXPECT_EQ(0u, packet_value(packets[0]));
+    EXPECT_EQ(200u, packet_value(packets[1]));
+
+    /* The next ones follow at the rate of the signal */
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    ASSERT_GE(module_under_test.receive_gpio_packets(packets.data(), packets.size()), 2);
+    EXPECT_EQ(100u, packet_value(packets[0]));
+    EXPECT_EQ(300u, packet_value(packets[1]));
+}
+
+TEST(TestSyntheticHwBackend, test_button_burst)
+{
+    SyntheticSignalConfig burst;
+    burst.waveform = Waveform::BUTTON_BURST;
+    burst.rate_hz = 1000;
+    burst.period = std::chrono::milliseconds(100);
+    burst.min_value = 0;
+    burst.max_value = 1;
+    burst.burst_length = 2;
+    SyntheticHwBackend module_under_test({burst}, TEST_TIMEOUT);
+    ASSERT_TRUE(module_under_test.init());
+
+    /* Two presses, then nothing until the next period */
+    std::array<gpio::GpioPacket, 16> packets;
+    std::vector<uint32_t> values;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        int count = module_under_test.receive_gpio_packets(packets.data(), packets.size());
+        for (int i = 0; i < count; ++i)
+        {
+            values.push_back(packet_value(packets[i]));
+        }
+    }
+    EXPECT_EQ(std::vector<uint32_t>({1, 0, 1, 0}), values);
+}
+
+TEST(TestSyntheticHwBackend, test_auto_ack)
+{
+    SyntheticSignalConfig noise;
+    noise.waveform = Waveform::NOISE;
+    noise.n_controllers = 24;
+    noise.rate_hz = 0.001f;
+    SyntheticHwBackend module_under_test({noise}, TEST_TIMEOUT);
+    ASSERT_TRUE(module_under_test.init());
+    std::array<gpio::GpioPacket, 32> packets;
+    ASSERT_EQ(24, module_under_test.receive_gpio_packets(packets.data(), packets.size()));
+    for (int i = 0; i < 24; ++i)
+    {
+        EXPECT_LE(packet_value(packets[i]), noise.max_value);
+    }
+
+    gpio::GpioPacket request = {};
+    request.command = gpio::GPIO_CMD_SYSTEM_CONTROL;
+    request.sub_command = gpio::GPIO_SUB_CMD_GET_BOARD_INFO;
+    request.sequence_no = 5;
+    ASSERT_TRUE(module_under_test.send_gpio_packet(request));
+    ASSERT_EQ(2, module_under_test.receive_gpio_packets(packets.data(), packets.size()));
+    EXPECT_EQ(24, packets[0].payload.gpio_board_info_data.num_analog_input_pins);
+    EXPECT_EQ(gpio::GPIO_ACK, packets[1].command);
+    EXPECT_EQ(5u, packets[1].payload.gpio_ack_data.returned_seq_no);
+    EXPECT_EQ(24u, module_under_test.generated_packets());
+}
@@ -39,6 +39,21 @@ TEST_F(TestGpioCommandCreator, test_initialize_common_data)
     ASSERT_EQ(next_seq_no, seq_no + 1);
 }
 
+TEST_F(TestGpioCommandCreator, test_sequence_number_wrap)
+{
+    _module_under_test._sequence_count = std::numeric_limits<uint32_t>::max();
+    GpioPacket packet = _module_under_test._prepare_packet();
+    uint32_t seq_no = from_gpio_protocol_byteord(packet.sequence_no);
+    EXPECT_EQ(std::numeric_limits<uint32_t>::max(), seq_no);
+    /* 0 is skipped */
+    packet = _module_under_test._prepare_packet();
+    uint32_t next_seq_no = from_gpio_protocol_byteord(packet.sequence_no);
+    EXPECT_EQ(1u, next_seq_no);
+    EXPECT_TRUE(sequence_before(seq_no, next_seq_no));
+    EXPECT_FALSE(sequence_before(next_seq_no, seq_no));
+    EXPECT_FALSE(sequence_before(seq_no, seq_no));
+}
+
 TEST_F(TestGpioCommandCreator, test_command_creation)
 {
     GpioPacket packet = _module_under_test.make_reset_system_command();
@@ -0,0 +1,539 @@
+#include <map>
+
+#include "gtest/gtest.h"
+#define private public
+
+#include "hardware_frontend/hw_frontend.cpp"
+#include "message/message_factory.h"
+
+#include "../test_utils.h"
+
+using namespace sensei;
+using namespace hw_frontend;
+
+class TestHwFrontend : public ::testing::Test
+{
+protected:
+    TestHwFrontend() :
+            _backend(std::chrono::milliseconds(10)),
+            _module_under_test(&_in_queue, &_out_queue, &_backend, 1,
+                               std::chrono::milliseconds(5), std::chrono::milliseconds(100))
+    {
+    }
+
+    void process(std::unique_ptr<BaseMessage> message)
+    {
+        _module_under_test._process_sensei_command(static_cast<Command*>(message.get()));
+    }
+
+    uint32_t queued_value(int position)
+    {
+        return from_gpio_protocol_byteord(_module_under_test._send_lanes[HwFrontend::OUTPUT_LANE][position].packet.payload.gpio_value_data.controller_val);
+    }
+
+    /* Does what the write loop does for one packet, returns the packet sent */
+    std::optional<gpio::GpioPacket> send_next()
+    {
+        gpio::GpioPacket packet;
+        if (_module_under_test._prepare_send_batch(&packet, 1) == 0)
+        {
+            return std::nullopt;
+        }
+        _module_under_test._finish_send_batch(1);
+        return packet;
+    }
+
+    void ack(const gpio::GpioPacket& packet)
+    {
+        gpio::GpioPacket ack_packet = {};
+        ack_packet.command = gpio::GPIO_ACK;
+        ack_packet.payload.gpio_ack_data.returned_seq_no = packet.sequence_no;
+        ack_packet.payload.gpio_ack_data.gpio_return_status = gpio::GPIO_OK;
+        _module_under_test._handle_ack(ack_packet);
+    }
+
+    SynchronizedQueue<std::unique_ptr<Command>> _in_queue;
+    SynchronizedQueue<std::unique_ptr<BaseMessage>> _out_queue;
+    hw_backend::NoOpHwBackend _backend;
+    HwFrontend _module_under_test;
+    MessageFactory _factory;
+};
+
+TEST_F(TestHwFrontend, test_coalesce_set_values)
+{
+    auto& send_list = _module_under_test._send_lanes[HwFrontend::OUTPUT_LANE];
+    size_t initial_size = send_list.size();
+
+    process(_factory.make_set_range_output_command(3, 10));
+    process(_factory.make_set_range_output_command(4, 20));
+    process(_factory.make_set_range_output_command(3, 11));
+    process(_factory.make_set_range_output_command(3, 12));
+    ASSERT_EQ(initial_size + 2, send_list.size());
+    EXPECT_EQ(12u, queued_value(initial_size));
+    EXPECT_EQ(20u, queued_value(initial_size + 1));
+
+    /* A configuration packet is never overtaken by a later value */
+    process(_factory.make_set_enabled_command(3, false));
+    process(_factory.make_set_range_output_command(3, 13));
+    ASSERT_EQ(initial_size + 3, send_list.size());
+    EXPECT_EQ(12u, queued_value(initial_size));
+    EXPECT_EQ(13u, queued_value(initial_size + 2));
+
+    /* Once sent, a value is not overwritten anymore */
+    while (send_list.size() > 1)
+    {
+        _module_under_test._pop_send_lane(HwFrontend::OUTPUT_LANE);
+    }
+    process(_factory.make_set_range_output_command(3, 14));
+    ASSERT_EQ(1u, send_list.size());
+    EXPECT_EQ(14u, queued_value(0));
+    _module_under_test._pop_send_lane(HwFrontend::OUTPUT_LANE);
+    process(_factory.make_set_range_output_command(3, 15));
+    process(_factory.make_set_range_output_command(4, 21));
+    process(_factory.make_set_range_output_command(4, 22));
+    ASSERT_EQ(2u, send_list.size());
+    EXPECT_EQ(15u, queued_value(0));
+    EXPECT_EQ(22u, queued_value(1));
+}
+
+TEST_F(TestHwFrontend, test_send_lane_priority)
+{
+    /* The system setup packets queued on creation */
+    for (int i = 0; i < 3; ++i)
+    {
+        auto packet = send_next();
+        ASSERT_TRUE(packet.has_value());
+        EXPECT_EQ(gpio::GPIO_CMD_SYSTEM_CONTROL, packet->command);
+        EXPECT_FALSE(send_next().has_value());
+        ack(packet.value());
+    }
+    ASSERT_FALSE(send_next().has_value());
+
+    process(_factory.make_set_enabled_command(4, true));
+    process(_factory.make_set_enabled_command(3, true));
+    process(_factory.make_set_enabled_command(3, false));
+    process(_factory.make_set_range_output_command(4, 20));
+    process(_factory.make_set_range_output_command(5, 30));
+
+    /* The value to controller 4 has to wait for its configuration and blocks the output lane */
+    auto packet = send_next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(gpio::GPIO_CMD_CONFIG_CONTROLLER, packet->command);
+    EXPECT_EQ(4, packet_controller_id(packet.value()));
+    EXPECT_FALSE(send_next().has_value());
+    ack(packet.value());
+
+    /* Then the values go before the remaining configuration */
+    packet = send_next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(gpio::GPIO_CMD_SET_VALUE, packet->command);
+    EXPECT_EQ(4, packet_controller_id(packet.value()));
+    ack(packet.value());
+    packet = send_next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(gpio::GPIO_CMD_SET_VALUE, packet->command);
+    EXPECT_EQ(5, packet_controller_id(packet.value()));
+    ack(packet.value());
+
+    /* A value queued during the configuration overtakes it */
+    packet = send_next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(3, packet_controller_id(packet.value()));
+    process(_factory.make_set_range_output_command(5, 31));
+    ack(packet.value());
+    packet = send_next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(gpio::GPIO_CMD_SET_VALUE, packet->command);
+    ack(packet.value());
+    packet = send_next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(gpio::GPIO_CMD_CONFIG_CONTROLLER, packet->command);
+    ack(packet.value());
+    EXPECT_FALSE(send_next().has_value());
+    EXPECT_EQ(3u, _module_under_test.output_latency_statistics().samples);
+    EXPECT_TRUE(_module_under_test._unfinished_config.empty());
+}
+
+TEST_F(TestHwFrontend, test_sequence_number_wrap)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        auto packet = send_next();
+        ASSERT_TRUE(packet.has_value());
+        ack(packet.value());
+    }
+    /* The configuration gets the last sequence number before wrapping around, the value the first after */
+    _module_under_test._packet_factory._sequence_count = std::numeric_limits<uint32_t>::max();
+    process(_factory.make_set_enabled_command(4, true));
+    process(_factory.make_set_range_output_command(4, 20));
+
+    /* The value still waits for the configuration of its controller */
+    auto packet = send_next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(gpio::GPIO_CMD_CONFIG_CONTROLLER, packet->command);
+    EXPECT_EQ(std::numeric_limits<uint32_t>::max(), from_gpio_protocol_byteord(packet->sequence_no));
+    EXPECT_FALSE(send_next().has_value());
+    ack(packet.value());
+
+    packet = send_next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(gpio::GPIO_CMD_SET_VALUE, packet->command);
+    EXPECT_EQ(1u, from_gpio_protocol_byteord(packet->sequence_no));
+    ack(packet.value());
+    EXPECT_FALSE(send_next().has_value());
+    EXPECT_EQ(0, _module_under_test._message_tracker.in_flight());
+}
+
+TEST_F(TestHwFrontend, test_send_batch)
+{
+    HwFrontend frontend(&_in_queue, &_out_queue, &_backend, 8,
+                        std::chrono::milliseconds(5), std::chrono::milliseconds(100));
+    std::array<gpio::GpioPacket, 8> packets;
+    ASSERT_EQ(3, frontend._prepare_send_batch(packets.data(), packets.size()));
+    frontend._finish_send_batch(3);
+    EXPECT_EQ(3, frontend._message_tracker.in_flight());
+    for (int i = 0; i < 3; ++i)
+    {
+        frontend._message_tracker.ack(from_gpio_protocol_byteord(packets[i].sequence_no));
+        frontend._take_in_flight_packet(from_gpio_protocol_byteord(packets[i].sequence_no));
+    }
+
+    /* Packets that could not be sent are put back in the same order */
+    for (int i = 0; i < 4; ++i)
+    {
+        frontend._process_sensei_command(static_cast<Command*>(_factory.make_set_enabled_command(i, true).get()));
+    }
+    ASSERT_EQ(4, frontend._prepare_send_batch(packets.data(), packets.size()));
+    EXPECT_EQ(4, frontend._message_tracker.in_flight());
+    frontend._finish_send_batch(1);
+    EXPECT_EQ(1, frontend._message_tracker.in_flight());
+    EXPECT_EQ(1u, frontend._in_flight_packets.size());
+    auto& config_lane = frontend._send_lanes[HwFrontend::CONFIG_LANE];
+    ASSERT_EQ(3u, config_lane.size());
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(packets[i + 1].sequence_no, config_lane[i].packet.sequence_no);
+    }
+    ASSERT_EQ(3, frontend._prepare_send_batch(packets.data(), packets.size()));
+    frontend._finish_send_batch(3);
+    EXPECT_EQ(4, frontend._message_tracker.in_flight());
+}
+
+TEST_F(TestHwFrontend, test_handle_all_timeouts)
+{
+    HwFrontend frontend(&_in_queue, &_out_queue, &_backend, 8,
+                        std::chrono::milliseconds(5), std::chrono::milliseconds(100));
+    std::array<gpio::GpioPacket, 8> packets;
+    ASSERT_EQ(3, frontend._prepare_send_batch(packets.data(), packets.size()));
+    frontend._finish_send_batch(3);
+    EXPECT_LT(std::chrono::milliseconds(0), frontend._time_to_next_timeout(std::chrono::milliseconds(20)));
+
+    /* All the packets that timed out together are resent, in the order they were sent */
+    for (auto& entry : frontend._message_tracker._entries)
+    {
+        entry.deadline = std::chrono::steady_clock::now() - std::chrono::milliseconds(1);
+    }
+    EXPECT_EQ(std::chrono::milliseconds(0), frontend._time_to_next_timeout(std::chrono::milliseconds(20)));
+    frontend._handle_timeouts();
+    EXPECT_TRUE(frontend._in_flight_packets.empty());
+    auto& control_lane = frontend._send_lanes[HwFrontend::CONTROL_LANE];
+    ASSERT_EQ(3u, control_lane.size());
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(packets[i].sequence_no, control_lane[i].packet.sequence_no);
+    }
+    EXPECT_EQ(std::chrono::milliseconds(20), frontend._time_to_next_timeout(std::chrono::milliseconds(20)));
+}
+
+TEST_F(TestHwFrontend, test_output_values_not_acked)
+{
+    for (auto packet = send_next(); packet.has_value(); packet = send_next())
+    {
+        ack(packet.value());
+    }
+
+    /* Output values are sent while the window is full with unacked configuration */
+    process(_factory.make_set_enabled_command(3, true));
+    auto config = send_next();
+    ASSERT_TRUE(config.has_value());
+    EXPECT_EQ(gpio::GPIO_CMD_CONFIG_CONTROLLER, config->command);
+    process(_factory.make_set_range_output_command(4, 20));
+    process(_factory.make_set_range_output_command(5, 30));
+    auto value_4 = send_next();
+    ASSERT_TRUE(value_4.has_value());
+    EXPECT_EQ(4, packet_controller_id(value_4.value()));
+    auto value_5 = send_next();
+    ASSERT_TRUE(value_5.has_value());
+    EXPECT_FALSE(send_next().has_value());
+    EXPECT_EQ(1, _module_under_test._message_tracker.in_flight());
+    EXPECT_EQ(2u, _module_under_test._unacked_output_values.size());
+
+    /* The ack of a later value means the value to controller 4 was lost, it is sent again as it's still the latest */
+    ack(value_5.value());
+    EXPECT_EQ(1u, _module_under_test.output_latency_statistics().samples);
+    EXPECT_EQ(1u, _module_under_test.send_queue_statistics().lost_output_values);
+    EXPECT_TRUE(_module_under_test._unacked_output_values.empty());
+    auto& output_lane = _module_under_test._send_lanes[HwFrontend::OUTPUT_LANE];
+    ASSERT_EQ(1u, output_lane.size());
+    EXPECT_EQ(4, packet_controller_id(output_lane[0].packet));
+    EXPECT_EQ(20u, queued_value(0));
+
+    /* Unless a newer value was sent already */
+    value_4 = send_next();
+    ASSERT_TRUE(value_4.has_value());
+    process(_factory.make_set_range_output_command(4, 21));
+    auto newer_value_4 = send_next();
+    ASSERT_TRUE(newer_value_4.has_value());
+    ack(newer_value_4.value());
+    EXPECT_EQ(2u, _module_under_test.send_queue_statistics().lost_output_values);
+    EXPECT_TRUE(output_lane.empty());
+
+    ack(config.value());
+    EXPECT_EQ(0, _module_under_test._message_tracker.in_flight());
+    EXPECT_TRUE(_module_under_test._in_flight_packets.empty());
+}
+
+TEST_F(TestHwFrontend, test_value_sensor_range)
+{
+    _module_under_test.set_sensor_range(32, 16);
+    gpio::GpioPacket packet = {};
+    packet.command = gpio::GPIO_CMD_GET_VALUE;
+    packet.payload.gpio_value_data.controller_id = 15;
+    _module_under_test._handle_gpio_packet(packet);
+    ASSERT_FALSE(_out_queue.empty());
+    EXPECT_EQ(47, _out_queue.pop()->index());
+
+    /* Controllers past the range of the board don't become values of other sensors */
+    packet.payload.gpio_value_data.controller_id = 16;
+    _module_under_test._handle_gpio_packet(packet);
+    EXPECT_TRUE(_out_queue.empty());
+}
+
+TEST_F(TestHwFrontend, test_last_output_value_lost)
+{
+    for (auto packet = send_next(); packet.has_value(); packet = send_next())
+    {
+        ack(packet.value());
+    }
+    process(_factory.make_set_range_output_command(4, 20));
+    auto value = send_next();
+    ASSERT_TRUE(value.has_value());
+    ASSERT_EQ(1u, _module_under_test._unacked_output_values.size());
+
+    /* No later ack reveals that the last value was lost, it is sent again once its ack is late */
+    _module_under_test._handle_timeouts();
+    EXPECT_EQ(1u, _module_under_test._unacked_output_values.size());
+    _module_under_test._unacked_output_values.front().deadline = std::chrono::steady_clock::now();
+    EXPECT_EQ(std::chrono::milliseconds(0), _module_under_test._time_to_next_timeout(std::chrono::milliseconds(20)));
+    _module_under_test._handle_timeouts();
+    EXPECT_TRUE(_module_under_test._unacked_output_values.empty());
+    EXPECT_EQ(1u, _module_under_test.send_queue_statistics().lost_output_values);
+    auto& output_lane = _module_under_test._send_lanes[HwFrontend::OUTPUT_LANE];
+    ASSERT_EQ(1u, output_lane.size());
+    EXPECT_EQ(20u, queued_value(0));
+
+    /* Unless a newer value was queued in the meantime */
+    value = send_next();
+    ASSERT_TRUE(value.has_value());
+    _module_under_test._unacked_output_values.front().deadline = std::chrono::steady_clock::now();
+    process(_factory.make_set_range_output_command(4, 21));
+    _module_under_test._handle_timeouts();
+    EXPECT_EQ(2u, _module_under_test.send_queue_statistics().lost_output_values);
+    ASSERT_EQ(1u, output_lane.size());
+    EXPECT_EQ(21u, queued_value(0));
+}
+
+class RecordingValueHandler : public InlineValueHandler
+{
+public:
+    void handle_inline_value(Value* value) override
+    {
+        ASSERT_EQ(ValueType::ANALOG, value->type());
+        values.push_back(static_cast<AnalogValue*>(value)->value());
+    }
+    std::vector<int> values;
+};
+
+TEST_F(TestHwFrontend, test_inline_value_handler)
+{
+    gpio::GpioPacket packet = {};
+    packet.command = gpio::GPIO_CMD_GET_VALUE;
+    packet.payload.gpio_value_data.controller_id = 2;
+    packet.payload.gpio_value_data.controller_val = to_gpio_protocol_byteord(static_cast<uint32_t>(345));
+
+    _module_under_test._handle_gpio_packet(packet);
+    EXPECT_FALSE(_out_queue.empty());
+    _out_queue.pop();
+
+    RecordingValueHandler handler;
+    _module_under_test.set_inline_value_handler(&handler);
+    _module_under_test._handle_gpio_packet(packet);
+    EXPECT_TRUE(_out_queue.empty());
+    ASSERT_EQ(1u, handler.values.size());
+    EXPECT_EQ(345, handler.values[0]);
+}
+
+TEST_F(TestHwFrontend, test_sensor_range)
+{
+    _module_under_test.set_sensor_range(32, 16);
+
+    /* Commands for global sensor ids go to the controller ids of the board */
+    auto& send_list = _module_under_test._send_lanes[HwFrontend::OUTPUT_LANE];
+    size_t initial_size = send_list.size();
+    process(_factory.make_set_range_output_command(35, 10));
+    ASSERT_EQ(initial_size + 1, send_list.size());
+    EXPECT_EQ(3u, send_list[initial_size].packet.payload.gpio_value_data.controller_id);
+
+    /* And values from the board come with global sensor ids */
+    gpio::GpioPacket packet = {};
+    packet.command = gpio::GPIO_CMD_GET_VALUE;
+    packet.payload.gpio_value_data.controller_id = 5;
+    _module_under_test._handle_gpio_packet(packet);
+    ASSERT_FALSE(_out_queue.empty());
+    auto value = _out_queue.pop();
+    EXPECT_EQ(37, static_cast<Value*>(value.get())->index());
+
+    /* Values from controllers outside of the range are dropped */
+    packet.payload.gpio_value_data.controller_id = 16;
+    _module_under_test._handle_gpio_packet(packet);
+    EXPECT_TRUE(_out_queue.empty());
+}
+
+TEST_F(TestHwFrontend, test_send_lane_overflow)
+{
+    SendQueueLimits limits;
+    limits.output = {2, OverflowPolicy::COALESCE};
+    limits.config = {2, OverflowPolicy::DROP_NEWEST};
+    _module_under_test.set_send_queue_limits(limits);
+    auto& output_lane = _module_under_test._send_lanes[HwFrontend::OUTPUT_LANE];
+    auto& config_lane = _module_under_test._send_lanes[HwFrontend::CONFIG_LANE];
+
+    /* Values for the same controller are merged, the oldest is dropped when it's full anyway */
+    process(_factory.make_set_range_output_command(1, 10));
+    process(_factory.make_set_range_output_command(1, 11));
+    process(_factory.make_set_range_output_command(2, 20));
+    process(_factory.make_set_range_output_command(3, 30));
+    ASSERT_EQ(2u, output_lane.size());
+    EXPECT_EQ(20u, queued_value(0));
+    EXPECT_EQ(30u, queued_value(1));
+    process(_factory.make_set_range_output_command(2, 21));
+    EXPECT_EQ(21u, queued_value(0));
+
+    /* Configuration beyond the capacity is not queued */
+    process(_factory.make_set_enabled_command(1, true));
+    process(_factory.make_set_enabled_command(2, true));
+    process(_factory.make_set_enabled_command(3, true));
+    EXPECT_EQ(2u, config_lane.size());
+
+    auto stats = _module_under_test.send_queue_statistics();
+    EXPECT_EQ(2u, stats.coalesced);
+    EXPECT_EQ(1u, stats.dropped_oldest);
+    EXPECT_EQ(1u, stats.dropped_newest);
+
+    /* A dropped configuration packet no longer holds back the values for its controller */
+    limits.config = {1, OverflowPolicy::DROP_OLDEST};
+    _module_under_test.set_send_queue_limits(limits);
+    process(_factory.make_set_enabled_command(4, true));
+    EXPECT_EQ(0u, _module_under_test._unfinished_config.count(1));
+    EXPECT_EQ(1u, _module_under_test._unfinished_config.count(4));
+}
+
+TEST_F(TestHwFrontend, test_send_lane_backpressure)
+{
+    /* Reliable lanes are sized from the number of sensors by default and never drop packets */
+    _module_under_test.set_sensor_range(0, 4);
+    EXPECT_EQ(4 * PACKETS_PER_SENSOR, _module_under_test._lane_capacity(HwFrontend::CONFIG_LANE));
+    SendQueueLimits limits;
+    limits.config.capacity = 2;
+    _module_under_test.set_send_queue_limits(limits);
+    auto& config_lane = _module_under_test._send_lanes[HwFrontend::CONFIG_LANE];
+
+    process(_factory.make_set_enabled_command(1, true));
+    EXPECT_FALSE(_module_under_test._send_lanes_blocked());
+    process(_factory.make_set_enabled_command(2, true));
+    EXPECT_TRUE(_module_under_test._send_lanes_blocked());
+    process(_factory.make_set_enabled_command(3, true));
+    EXPECT_EQ(3u, config_lane.size());
+    auto stats = _module_under_test.send_queue_statistics();
+    EXPECT_EQ(0u, stats.dropped_oldest + stats.dropped_newest);
+
+    /* Taking commands resumes once packets are sent */
+    for (auto packet = send_next(); packet.has_value(); packet = send_next())
+    {
+        ack(packet.value());
+    }
+    EXPECT_TRUE(config_lane.empty());
+    EXPECT_FALSE(_module_under_test._send_lanes_blocked());
+}
+
+TEST_F(TestHwFrontend, test_backend_disconnect)
+{
+    EXPECT_TRUE(_module_under_test.send_queue_statistics().backend_connected);
+
+    /* A partial send is retried right away */
+    _module_under_test._backend_send_failed(1);
+    auto stats = _module_under_test.send_queue_statistics();
+    EXPECT_TRUE(stats.backend_connected);
+    EXPECT_EQ(1u, stats.failed_sends);
+
+    /* Nothing sent means the backend is down, only probes are sent until it's back */
+    _module_under_test._backend_send_failed(0);
+    _module_under_test._backend_send_failed(0);
+    stats = _module_under_test.send_queue_statistics();
+    EXPECT_FALSE(stats.backend_connected);
+    EXPECT_EQ(3u, stats.failed_sends);
+    EXPECT_EQ(1u, stats.disconnects);
+    EXPECT_GT(_module_under_test._next_send_attempt, std::chrono::steady_clock::now());
+}
+
+TEST_F(TestHwFrontend, test_resync_after_restart)
+{
+    process(_factory.make_set_range_output_command(3, 10));
+    process(_factory.make_set_range_output_command(4, 20));
+    process(_factory.make_set_range_output_command(3, 12));
+    for (auto packet = send_next(); packet.has_value(); packet = send_next())
+    {
+        ack(packet.value());
+    }
+
+    gpio::GpioPacket board_info = {};
+    board_info.command = gpio::GPIO_CMD_SYSTEM_CONTROL;
+    board_info.sub_command = gpio::GPIO_SUB_CMD_GET_BOARD_INFO;
+    board_info.payload.gpio_board_info_data.num_digital_input_pins = 8;
+    _module_under_test._handle_gpio_packet(board_info);
+    _module_under_test._handle_gpio_packet(board_info);
+    EXPECT_TRUE(_out_queue.empty());
+
+    /* A different board info means the board restarted, its configuration is requested */
+    board_info.payload.gpio_board_info_data.num_digital_input_pins = 16;
+    _module_under_test._handle_gpio_packet(board_info);
+    ASSERT_FALSE(_out_queue.empty());
+    auto msg = _out_queue.pop();
+    ASSERT_EQ(MessageType::ERROR, msg->base_type());
+    EXPECT_EQ(ErrorType::HW_BACKEND_RESTARTED, static_cast<Error*>(msg.get())->type());
+    EXPECT_EQ(1u, _module_under_test.resync_statistics().resyncs);
+
+    /* Once the configuration is through, the latest output values are sent again */
+    process(_factory.make_enable_sending_packets_command(0, false));
+    process(_factory.make_set_enabled_command(3, true));
+    process(_factory.make_enable_sending_packets_command(0, true));
+    auto& send_list = _module_under_test._send_lanes[HwFrontend::OUTPUT_LANE];
+    ASSERT_EQ(2u, send_list.size());
+    std::map<int, uint32_t> values;
+    for (size_t i = 0; i < send_list.size(); ++i)
+    {
+        values[send_list[i].packet.payload.gpio_value_data.controller_id] = queued_value(i);
+    }
+    EXPECT_EQ(12u, values[3]);
+    EXPECT_EQ(20u, values[4]);
+
+    /* Recovered when everything is acked */
+    for (auto packet = send_next(); packet.has_value(); packet = send_next())
+    {
+        EXPECT_EQ(HwFrontend::ResyncState::SENDING, _module_under_test._resync_state);
+        ack(packet.value());
+    }
+    EXPECT_EQ(HwFrontend::ResyncState::IDLE, _module_under_test._resync_state);
+    auto stats = _module_under_test.resync_statistics();
+    EXPECT_EQ(stats.max_time_to_recover, stats.last_time_to_recover);
+}
@@ -35,7 +35,8 @@ TEST_F (TestMessageTracker, test_initial_conditions)
 {
     EXPECT_EQ(std::chrono::milliseconds(MAX_TIMEOUT), _module_under_test._timeout);
     EXPECT_EQ(MAX_RESENDS, _module_under_test._max_retries);
-    EXPECT_EQ(nullptr, _module_under_test._message_in_transit);
+    EXPECT_EQ(1u, _module_under_test._entries.size());
+    EXPECT_EQ(0, _module_under_test.in_flight());
 }
 
 /*
@@ -54,7 +55,8 @@ TEST_F (TestMessageTracker, test_simple_tracking)
 
     /* Test that an ack will correctly remove this msg */
     EXPECT_TRUE(_module_under_test.ack(1234));
-    EXPECT_EQ(std::unique_ptr<Command>(nullptr), _module_under_test.get_cached_message());
+    EXPECT_EQ(std::unique_ptr<Command>(nullptr), _module_under_test.get_cached_message(1234));
+    EXPECT_EQ(timeout::NO_MESSAGE, _module_under_test.timed_out());
 }
 
 /*
@@ -66,14 +68,104 @@ TEST_F (TestMessageTracker, test_timeout)
     _module_under_test.store(std::move(message), 1234);
 
     /* Rewind the stored timestamp */
-    _module_under_test._send_time -= std::chrono::milliseconds(1200);
+    _module_under_test._entry(1234).deadline -= std::chrono::milliseconds(1200);
     EXPECT_EQ(timeout::TIMED_OUT, _module_under_test.timed_out());
+    /* Only reported once */
+    EXPECT_EQ(timeout::WAITING, _module_under_test.timed_out());
 
     /* Get the message and pretend to send it again */
-    auto m2 = _module_under_test.get_cached_message();
+    auto m2 = _module_under_test.get_cached_message(1234);
     _module_under_test.store(std::move(m2), 1234);
-    _module_under_test._send_time -= std::chrono::milliseconds(1200);
+    _module_under_test._entry(1234).deadline -= std::chrono::milliseconds(1200);
 
     EXPECT_EQ(timeout::TIMED_OUT_PERMANENTLY, _module_under_test.timed_out());
-    EXPECT_NE(std::unique_ptr<Command>(nullptr), _module_under_test.get_cached_message());
-}
\ No newline at end of file
+    EXPECT_NE(std::unique_ptr<Command>(nullptr), _module_under_test.get_cached_message(1234));
+}
+
+/*
+ * Test tracking several messages in flight
+ */
+TEST(TestMessageTrackerWindow, test_window)
+{
+    MessageTracker module_under_test(std::chrono::milliseconds(MAX_TIMEOUT), MAX_RESENDS, 4);
+    for (uint64_t id = 1; id <= 4; ++id)
+    {
+        EXPECT_TRUE(module_under_test.can_store(id));
+        EXPECT_TRUE(module_under_test.store(nullptr, id));
+    }
+    EXPECT_EQ(4, module_under_test.in_flight());
+
+    /* The slot of 5 is still taken by 1, retries of packets in flight are allowed */
+    EXPECT_FALSE(module_under_test.can_store(5));
+    EXPECT_FALSE(module_under_test.store(nullptr, 5));
+    EXPECT_TRUE(module_under_test.can_store(2));
+
+    /* Acks can arrive out of order */
+    EXPECT_TRUE(module_under_test.ack(3));
+    EXPECT_FALSE(module_under_test.can_store(5));
+    EXPECT_TRUE(module_under_test.ack(1));
+    EXPECT_TRUE(module_under_test.store(nullptr, 5));
+    EXPECT_EQ(3, module_under_test.in_flight());
+
+    /* Each entry has its own deadline */
+    module_under_test._entry(4).deadline -= std::chrono::milliseconds(1200);
+    EXPECT_EQ(module_under_test._entry(4).deadline, module_under_test.next_deadline());
+    uint64_t id = 0;
+    EXPECT_EQ(timeout::TIMED_OUT, module_under_test.timed_out(id));
+    EXPECT_EQ(4u, id);
+    EXPECT_EQ(timeout::WAITING, module_under_test.timed_out(id));
+    EXPECT_EQ(std::min(module_under_test._entry(2).deadline, module_under_test._entry(5).deadline),
+              module_under_test.next_deadline());
+
+    module_under_test.remove(4);
+    EXPECT_EQ(2, module_under_test.in_flight());
+    EXPECT_TRUE(module_under_test.ack(2));
+    EXPECT_TRUE(module_under_test.ack(5));
+    EXPECT_EQ(timeout::NO_MESSAGE, module_under_test.timed_out());
+    EXPECT_EQ(std::chrono::steady_clock::time_point::max(), module_under_test.next_deadline());
+}
+
+/*
+ * Test the adaptive timeout
+ */
+TEST(TestMessageTrackerRtt, test_adaptive_timeout)
+{
+    MessageTracker module_under_test(std::chrono::milliseconds(MAX_TIMEOUT), 3, 1,
+                                     std::chrono::milliseconds(10), std::chrono::milliseconds(2000));
+    auto rtt = module_under_test.rtt_statistics();
+    EXPECT_EQ(0u, rtt.samples);
+    EXPECT_EQ(std::chrono::milliseconds(MAX_TIMEOUT), rtt.timeout);
+
+    /* Pretend the message was sent 4 ms ago */
+    module_under_test.store(nullptr, 1);
+    module_under_test._entry(1).send_time -= std::chrono::milliseconds(4);
+    EXPECT_TRUE(module_under_test.ack(1));
+    rtt = module_under_test.rtt_statistics();
+    EXPECT_EQ(1u, rtt.samples);
+    EXPECT_GE(rtt.smoothed_rtt, std::chrono::milliseconds(4));
+    /* srtt + 4 * srtt/2 is ~12 ms, way below the initial timeout */
+    EXPECT_GE(rtt.timeout, std::chrono::milliseconds(10));
+    EXPECT_LT(rtt.timeout, std::chrono::milliseconds(20));
+
+    /* Fast acks bring it down to the lower bound */
+    for (uint64_t id = 2; id < 50; ++id)
+    {
+        module_under_test.store(nullptr, id);
+        EXPECT_TRUE(module_under_test.ack(id));
+    }
+    rtt = module_under_test.rtt_statistics();
+    EXPECT_EQ(std::chrono::milliseconds(10), rtt.timeout);
+    EXPECT_LT(rtt.min_rtt, rtt.max_rtt);
+
+    /* Retried messages are not sampled, and are backed off */
+    module_under_test.store(nullptr, 50);
+    module_under_test.store(nullptr, 50);
+    auto& entry = module_under_test._entry(50);
+    EXPECT_EQ(std::chrono::milliseconds(20), std::chrono::duration_cast<std::chrono::milliseconds>(entry.deadline - entry.send_time));
+    module_under_test._entry(50).send_time -= std::chrono::milliseconds(500);
+    EXPECT_TRUE(module_under_test.ack(50));
+    rtt = module_under_test.rtt_statistics();
+    EXPECT_EQ(49u, rtt.samples);
+    EXPECT_EQ(1u, rtt.retries);
+    EXPECT_EQ(std::chrono::milliseconds(10), rtt.timeout);
+}
@@ -0,0 +1,130 @@
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "latency_monitor.cpp"
+
+using namespace sensei;
+using namespace std::chrono_literals;
+
+TEST(TestLatencyHistogram, test_buckets)
+{
+    // Exact below 16 us
+    for (uint32_t us = 0; us < 16; ++us)
+    {
+        EXPECT_EQ(static_cast<int>(us), LatencyHistogram::bucket(us));
+        EXPECT_EQ(us, LatencyHistogram::bucket_upper_bound(LatencyHistogram::bucket(us)));
+    }
+    // Every latency is at most its bucket's upper bound, at most 12.5% below it
+    // and above the upper bound of the previous bucket
+    for (uint32_t us = 16; us < (1u << 27); us = us * 9 / 8 + 1)
+    {
+        int bucket = LatencyHistogram::bucket(us);
+        ASSERT_LT(bucket, LatencyHistogram::N_BUCKETS);
+        uint32_t upper_bound = LatencyHistogram::bucket_upper_bound(bucket);
+        EXPECT_GE(upper_bound, us);
+        EXPECT_LE(upper_bound - us, upper_bound / 8);
+        EXPECT_LT(LatencyHistogram::bucket_upper_bound(bucket - 1), us);
+    }
+    EXPECT_EQ(LatencyHistogram::N_BUCKETS - 1, LatencyHistogram::bucket((1u << 27) - 1));
+    EXPECT_EQ(LatencyHistogram::N_BUCKETS - 1, LatencyHistogram::bucket(std::numeric_limits<uint32_t>::max()));
+}
+
+TEST(TestLatencyHistogram, test_percentiles)
+{
+    LatencyHistogram histogram;
+    for (uint32_t us = 1; us <= 1000; ++us)
+    {
+        histogram.record(us);
+    }
+    LatencyHistogram::Counts counts{};
+    uint32_t max_us = 0;
+    histogram.add_to(counts, max_us);
+    EXPECT_EQ(1000u, max_us);
+
+    uint32_t p50 = LatencyHistogram::percentile(counts, 1000, 500);
+    EXPECT_GE(p50, 500u);
+    EXPECT_LE(p50, 500u * 9 / 8);
+    uint32_t p99 = LatencyHistogram::percentile(counts, 1000, 990);
+    EXPECT_GE(p99, 990u);
+    EXPECT_LE(p99, 990u * 9 / 8);
+    EXPECT_EQ(0u, LatencyHistogram::percentile(counts, 0, 500));
+
+    histogram.clear();
+    counts = {};
+    max_us = 0;
+    histogram.add_to(counts, max_us);
+    EXPECT_EQ(0u, max_us);
+    for (auto count : counts)
+    {
+        EXPECT_EQ(0u, count);
+    }
+}
+
+TEST(TestLatencyMonitor, test_stages)
+{
+    LatencyMonitor monitor(4, 10s);
+    auto received = std::chrono::steady_clock::now();
+    monitor.record(2, received, received + 100us, received + 150us, received + 160us);
+
+    auto total = monitor.summary(LatencyStage::TOTAL);
+    EXPECT_EQ(1u, total.samples);
+    EXPECT_EQ(160us, total.p50);
+    EXPECT_EQ(160us, total.p999);
+    EXPECT_EQ(160us, total.max);
+    EXPECT_EQ(100us, monitor.summary(LatencyStage::QUEUE, 2).max);
+    EXPECT_EQ(50us, monitor.summary(LatencyStage::MAPPING, 2).max);
+    EXPECT_EQ(10us, monitor.summary(LatencyStage::OUTPUT, 2).max);
+    EXPECT_EQ(0u, monitor.summary(LatencyStage::TOTAL, 1).samples);
+
+    // Time points that were never set don't add to the latency
+    monitor.record(1, {}, {}, received, received + 20us);
+    EXPECT_EQ(20us, monitor.summary(LatencyStage::TOTAL, 1).max);
+    EXPECT_EQ(0us, monitor.summary(LatencyStage::QUEUE, 1).max);
+
+    // Out of range sensors are ignored
+    monitor.record(4, received, received, received, received);
+    EXPECT_EQ(2u, monitor.summary(LatencyStage::TOTAL).samples);
+    EXPECT_EQ(0u, monitor.summary(LatencyStage::TOTAL, 4).samples);
+}
+
+TEST(TestLatencyMonitor, test_windows)
+{
+    LatencyMonitor monitor(1, 100ms);
+    auto start = std::chrono::steady_clock::now();
+    monitor.record(0, start, start, start, start + 1000us);
+    EXPECT_FALSE(monitor.rotate_if_due(start));
+
+    // The previous window is still summarized
+    ASSERT_TRUE(monitor.rotate_if_due(start + 200ms));
+    monitor.record(0, start, start, start, start + 10us);
+    auto summary = monitor.summary(LatencyStage::TOTAL, 0);
+    EXPECT_EQ(2u, summary.samples);
+    EXPECT_EQ(1000us, summary.max);
+
+    // But not the one before
+    EXPECT_FALSE(monitor.rotate_if_due(start + 250ms));
+    ASSERT_TRUE(monitor.rotate_if_due(start + 300ms));
+    summary = monitor.summary(LatencyStage::TOTAL, 0);
+    EXPECT_EQ(1u, summary.samples);
+    EXPECT_EQ(10us, summary.max);
+}
+
+TEST(TestLatencyMonitor, test_concurrent_record)
+{
+    LatencyMonitor monitor(2, 10s);
+    auto start = std::chrono::steady_clock::now();
+    auto record = [&](int sensor)
+    {
+        for (int i = 0; i < 10000; ++i)
+        {
+            monitor.record(sensor, start, start, start, start + std::chrono::microseconds(i));
+        }
+    };
+    std::thread thread(record, 0);
+    record(1);
+    thread.join();
+    EXPECT_EQ(20000u, monitor.summary(LatencyStage::TOTAL).samples);
+    EXPECT_EQ(10000u, monitor.summary(LatencyStage::TOTAL, 0).samples);
+    EXPECT_EQ(9999us, monitor.summary(LatencyStage::TOTAL).max);
+}
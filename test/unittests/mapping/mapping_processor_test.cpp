@@ -101,5 +101,72 @@ TEST_F(TestMappingProcessor, undefined_mappers_return_empty_process)
     backend._last_output_value = fake_reference_value;
     _processor.process(input_val, &backend);
     ASSERT_FLOAT_EQ(fake_reference_value, backend._last_output_value);
+
+    // Nor are values of sensors past the last one
+    input_msg = factory.make_digital_value(_max_n_sensors, true);
+    _processor.process(static_cast<Value*>(input_msg.get()), &backend);
+    ASSERT_FLOAT_EQ(fake_reference_value, backend._last_output_value);
+}
+
+
+TEST_F(TestMappingProcessor, test_cached_values)
+{
+    MessageFactory factory;
+    OutputBackendMockup backend;
+    _processor.apply_command(CMD_PTR(factory.make_set_enabled_command(0, true)));
+
+    CommandContainer values;
+    _processor.put_cached_values_into({}, std::back_inserter(values));
+    ASSERT_TRUE(values.empty());
+
+    auto input_msg = factory.make_digital_value(0, true);
+    _processor.process(static_cast<Value*>(input_msg.get()), &backend);
+
+    // Snapshot of all sensors only has the one which produced a value
+    _processor.put_cached_values_into({}, std::back_inserter(values));
+    ASSERT_EQ(1u, values.size());
+    auto value = static_cast<OutputValue*>(values[0].get());
+    ASSERT_EQ(0, value->index());
+    ASSERT_FLOAT_EQ(1.0f, value->value());
+
+    // Uninitialized and invalid sensors are skipped
+    values.clear();
+    _processor.put_cached_values_into({0, 1, 2, _max_n_sensors}, std::back_inserter(values));
+    ASSERT_EQ(1u, values.size());
 }
 
+TEST_F(TestMappingProcessor, test_process_set_batch)
+{
+    MessageFactory factory;
+    _processor.apply_command(CMD_PTR(factory.make_set_enabled_command(0, true)));
+
+    auto batch = factory.make_float_set_batch_value({{0, 1.0f}, {5, 0.5f}, {0, 0.0f}});
+    std::vector<std::unique_ptr<Command>> commands;
+    _processor.process_set(static_cast<Value*>(batch.get()), commands);
+
+    // The uninitialized sensor is skipped, the others give one command each
+    ASSERT_EQ(2u, commands.size());
+    ASSERT_EQ(CommandType::SET_DIGITAL_OUTPUT_VALUE, commands[0]->type());
+    ASSERT_TRUE(static_cast<SetDigitalOutputValueCommand*>(commands[0].get())->data());
+    ASSERT_FALSE(static_cast<SetDigitalOutputValueCommand*>(commands[1].get())->data());
+}
+
+TEST_F(TestMappingProcessor, test_sensor_config_commands)
+{
+    CommandContainer all_cmds;
+    _processor.put_config_commands_into(std::back_inserter(all_cmds));
+
+    // Only the requested sensor's commands, invalid sensors are skipped
+    CommandContainer cmds;
+    _processor.put_config_commands_into({1, _max_n_sensors}, std::back_inserter(cmds));
+    ASSERT_FALSE(cmds.empty());
+    ASSERT_LT(cmds.size(), all_cmds.size());
+    for (const auto& cmd : cmds)
+    {
+        ASSERT_EQ(1, cmd->index());
+    }
+
+    cmds.clear();
+    _processor.put_config_commands_into(std::vector<int>(), std::back_inserter(cmds));
+    ASSERT_EQ(all_cmds.size(), cmds.size());
+}
@@ -438,6 +438,27 @@ TEST_F(TestAnalogSensorMapper, test_same_value_not_sent_twice)
     ASSERT_EQ(first_message_time, _backend._last_timestamp);
 }
 
+TEST_F(TestAnalogSensorMapper, test_on_request_value_cached_not_sent)
+{
+    MessageFactory factory;
+    auto ret = _mapper.apply_command(CMD_PTR(factory.make_set_sending_mode_command(_sensor_idx, SendingMode::ON_REQUEST)));
+    ASSERT_EQ(CommandErrorCode::OK, ret);
+
+    float value;
+    uint32_t timestamp;
+    ASSERT_FALSE(_mapper.cached_value(value, timestamp));
+
+    float fake_reference_value = -123456.789f;
+    _backend._last_output_value = fake_reference_value;
+    auto input_msg = factory.make_analog_value(_sensor_idx, _input_scale_low, 1234);
+    _mapper.process(static_cast<Value*>(input_msg.get()), &_backend);
+    ASSERT_FLOAT_EQ(fake_reference_value, _backend._last_output_value);
+
+    ASSERT_TRUE(_mapper.cached_value(value, timestamp));
+    ASSERT_FLOAT_EQ(1.0f, value);
+    ASSERT_EQ(1234u, timestamp);
+}
+
 TEST_F(TestAnalogSensorMapper, test_raw_input_send)
 {
     MessageFactory factory;
@@ -334,4 +334,9 @@ TEST(MessagesTest, test_error_creation)
     tmp_msg = factory.make_too_many_timeouts_error(0);
     auto timeouts_msg = static_cast<TooManyTimeoutsError*>(tmp_msg.get());
     ASSERT_EQ(ErrorType::TOO_MANY_TIMEOUTS, timeouts_msg->type() );
+
+    tmp_msg = factory.make_hw_backend_restarted_error(16);
+    auto restarted_msg = static_cast<HwBackendRestartedError*>(tmp_msg.get());
+    ASSERT_EQ(ErrorType::HW_BACKEND_RESTARTED, restarted_msg->type() );
+    ASSERT_EQ(16, restarted_msg->index());
 }
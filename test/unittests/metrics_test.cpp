@@ -0,0 +1,122 @@
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "gtest/gtest.h"
+
+#include "metrics.cpp"
+
+using namespace sensei;
+using namespace sensei::metrics;
+
+TEST(TestMetrics, test_counters_and_gauges)
+{
+    MetricsRegistry registry;
+    auto counter = registry.counter("test_total", "Test counter");
+    auto gauge = registry.gauge("test_depth", "Test gauge", label("board", 1));
+    counter->increment();
+    counter->increment(4);
+    EXPECT_EQ(5u, counter->value());
+
+    gauge->set(10);
+    gauge->update_max(5);
+    EXPECT_EQ(10, gauge->value());
+    gauge->update_max(12);
+    EXPECT_EQ(12, gauge->value());
+    gauge->set(-1);
+    EXPECT_EQ(-1, gauge->value());
+
+    // Registering again gives the same metric, other labels a new one
+    EXPECT_EQ(counter, registry.counter("test_total", "Test counter"));
+    EXPECT_EQ(gauge, registry.gauge("test_depth", "Test gauge", label("board", 1)));
+    EXPECT_NE(gauge, registry.gauge("test_depth", "Test gauge", label("board", 2)));
+}
+
+TEST(TestMetrics, test_concurrent_increments)
+{
+    MetricsRegistry registry;
+    auto counter = registry.counter("test_total", "");
+    auto gauge = registry.gauge("test_max", "");
+    auto increment = [&](int offset)
+    {
+        for (int i = 0; i < 10000; ++i)
+        {
+            counter->increment();
+            gauge->update_max(i * 2 + offset);
+        }
+    };
+    std::thread thread(increment, 0);
+    increment(1);
+    thread.join();
+    EXPECT_EQ(20000u, counter->value());
+    EXPECT_EQ(19999, gauge->value());
+}
+
+TEST(TestMetrics, test_collect)
+{
+    MetricsRegistry registry;
+    registry.gauge("b_depth", "", label("board", 0))->set(3);
+    registry.counter("a_total", "")->increment(2);
+    registry.gauge("b_depth", "", label("board", 16))->set(4);
+
+    auto samples = registry.collect();
+    ASSERT_EQ(3u, samples.size());
+    EXPECT_EQ("a_total", samples[0].name);
+    EXPECT_EQ(MetricType::COUNTER, samples[0].type);
+    EXPECT_EQ(2, samples[0].value);
+    EXPECT_EQ("b_depth", samples[1].name);
+    EXPECT_EQ("board=\"0\"", samples[1].labels);
+    EXPECT_EQ(MetricType::GAUGE, samples[1].type);
+    EXPECT_EQ(3, samples[1].value);
+    EXPECT_EQ("board=\"16\"", samples[2].labels);
+}
+
+TEST(TestMetrics, test_prometheus_text)
+{
+    MetricsRegistry registry;
+    registry.counter("sensei_acks_total", "Packets acked")->increment(7);
+    registry.gauge("sensei_queue_depth", "Queued packets", label("board", 0))->set(2);
+    registry.gauge("sensei_queue_depth", "Queued packets", label("board", 32))->set(1);
+
+    EXPECT_EQ("# HELP sensei_acks_total Packets acked\n"
+              "# TYPE sensei_acks_total counter\n"
+              "sensei_acks_total 7\n"
+              "# HELP sensei_queue_depth Queued packets\n"
+              "# TYPE sensei_queue_depth gauge\n"
+              "sensei_queue_depth{board=\"0\"} 2\n"
+              "sensei_queue_depth{board=\"32\"} 1\n", registry.prometheus_text());
+}
+
+TEST(TestMetrics, test_prometheus_exporter)
+{
+    const std::string socket_path = "/tmp/sensei_metrics_test";
+    MetricsRegistry registry;
+    registry.counter("sensei_acks_total", "Packets acked")->increment(3);
+    PrometheusExporter exporter(registry, socket_path);
+    ASSERT_TRUE(exporter.start());
+
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(client, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path.c_str());
+    ASSERT_EQ(0, connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+    std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    ASSERT_EQ(static_cast<ssize_t>(request.size()), send(client, request.data(), request.size(), 0));
+
+    std::string response;
+    char buffer[256];
+    ssize_t bytes;
+    while ((bytes = recv(client, buffer, sizeof(buffer), 0)) > 0)
+    {
+        response.append(buffer, bytes);
+    }
+    close(client);
+    EXPECT_EQ(0u, response.find("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(std::string::npos, response.find("\r\n\r\n# HELP sensei_acks_total"));
+    EXPECT_NE(std::string::npos, response.find("sensei_acks_total 3\n"));
+
+    exporter.stop();
+    EXPECT_NE(0, access(socket_path.c_str(), F_OK));
+}
@@ -59,6 +59,8 @@ protected:
 
         config_cmds.push_back(std::move(CMD_UPTR(factory.make_set_sensor_type_command(1, SensorType::ANALOG_INPUT))));
         config_cmds.push_back(std::move(CMD_UPTR(factory.make_set_sensor_name_command(1, "bob"))));
+        config_cmds.push_back(std::move(CMD_UPTR(factory.make_set_enabled_command(0, true))));
+        config_cmds.push_back(std::move(CMD_UPTR(factory.make_set_enabled_command(1, true))));
 
         for (auto const& cmd : config_cmds)
         {
@@ -227,3 +229,139 @@ TEST_F(TestOscBackend, test_send_raw_input)
     lo_server_recv(_osc_server);
     ASSERT_EQ(176, _last_raw_bob_received);
 }
+
+TEST_F(TestOscBackend, test_send_after_unsubscribe)
+{
+    MessageFactory factory;
+    CommandContainer mute_cmds;
+    auto cmd = CMD_UPTR(factory.make_set_osc_subscription_mode_command(0, true));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    cmd = CMD_UPTR(factory.make_add_osc_subscription_command(0, "alice", _host, _port, 10));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_EQ(1u, _backend._sensor_subscribers[0].size());
+
+    // Values sent before the subscriptions are updated don't go to the removed subscriber
+    cmd = CMD_UPTR(factory.make_remove_osc_subscription_command(0, "alice", _host, _port));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    EXPECT_TRUE(_backend._sensor_subscribers[0].empty());
+    auto value_msg = factory.make_output_value(0, 0.5f);
+    _backend.send(static_cast<OutputValue*>(value_msg.get()), nullptr);
+    EXPECT_EQ(0, lo_server_recv_noblock(_osc_server, 10));
+    EXPECT_EQ(0.0f, _last_alice_received);
+}
+
+TEST_F(TestOscBackend, test_subscriptions)
+{
+    MessageFactory factory;
+    CommandContainer mute_cmds;
+
+    // Without subscription mode no sensor is ever muted
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_TRUE(mute_cmds.empty());
+
+    auto cmd = CMD_UPTR(factory.make_set_osc_subscription_mode_command(0, true));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_EQ(2u, mute_cmds.size());
+    auto mute_cmd = extract_cmd_from<SetEnabledCommand>(mute_cmds);
+    ASSERT_EQ(1, mute_cmd->index());
+    ASSERT_FALSE(mute_cmd->data());
+    mute_cmd = extract_cmd_from<SetEnabledCommand>(mute_cmds);
+    ASSERT_EQ(0, mute_cmd->index());
+    ASSERT_FALSE(mute_cmd->data());
+
+    // Subscribing to alice unmutes it and only it
+    cmd = CMD_UPTR(factory.make_add_osc_subscription_command(0, "/test_sensors/*/alice", _host, _port, 10));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_EQ(1u, mute_cmds.size());
+    mute_cmd = extract_cmd_from<SetEnabledCommand>(mute_cmds);
+    ASSERT_EQ(0, mute_cmd->index());
+    ASSERT_TRUE(mute_cmd->data());
+
+    auto value_msg = factory.make_output_value(0, 0.75f);
+    _backend.send(static_cast<OutputValue*>(value_msg.get()), nullptr);
+    lo_server_recv(_osc_server);
+    ASSERT_EQ(0.75f, _last_alice_received);
+
+    // Renewing the lease doesn't create a new subscriber
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    ASSERT_EQ(1u, _backend._subscribers.size());
+
+    // An expired lease mutes the sensor again
+    _backend._subscribers[0].expiry = std::chrono::steady_clock::now();
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_TRUE(_backend._subscribers.empty());
+    ASSERT_EQ(1u, mute_cmds.size());
+    mute_cmd = extract_cmd_from<SetEnabledCommand>(mute_cmds);
+    ASSERT_EQ(0, mute_cmd->index());
+    ASSERT_FALSE(mute_cmd->data());
+
+    // Subscribe by sensor name and remove all subscriptions of the client
+    cmd = CMD_UPTR(factory.make_add_osc_subscription_command(0, "bob", _host, _port, 0));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_EQ(1u, mute_cmds.size());
+    mute_cmds.clear();
+    cmd = CMD_UPTR(factory.make_remove_osc_subscription_command(0, "", _host, _port));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_EQ(1u, mute_cmds.size());
+    mute_cmd = extract_cmd_from<SetEnabledCommand>(mute_cmds);
+    ASSERT_EQ(1, mute_cmd->index());
+    ASSERT_FALSE(mute_cmd->data());
+
+    // Sensors of a board that was configured again are muted again
+    mute_cmds.clear();
+    _backend.sensors_reconfigured(1, 2);
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_EQ(1u, mute_cmds.size());
+    mute_cmd = extract_cmd_from<SetEnabledCommand>(mute_cmds);
+    ASSERT_EQ(1, mute_cmd->index());
+    ASSERT_FALSE(mute_cmd->data());
+
+    cmd = CMD_UPTR(factory.make_add_osc_subscription_command(0, "bob", _host, 100, 0));
+    ASSERT_EQ(CommandErrorCode::INVALID_PORT_NUMBER, _backend.apply_command(cmd.get()));
+}
+
+TEST_F(TestOscBackend, test_subscriptions_enabled_state)
+{
+    MessageFactory factory;
+    CommandContainer mute_cmds;
+    auto cmd = CMD_UPTR(factory.make_set_osc_subscription_mode_command(0, true));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_EQ(2u, mute_cmds.size());
+    mute_cmds.clear();
+
+    // Enabling a muted sensor mutes it again at the next update
+    cmd = CMD_UPTR(factory.make_set_enabled_command(0, true));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_EQ(1u, mute_cmds.size());
+    auto mute_cmd = extract_cmd_from<SetEnabledCommand>(mute_cmds);
+    ASSERT_EQ(0, mute_cmd->index());
+    ASSERT_FALSE(mute_cmd->data());
+
+    // A disabled sensor is neither unmuted by a subscription nor muted by its removal
+    cmd = CMD_UPTR(factory.make_set_enabled_command(0, false));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    cmd = CMD_UPTR(factory.make_add_osc_subscription_command(0, "alice", _host, _port, 10));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_TRUE(mute_cmds.empty());
+    cmd = CMD_UPTR(factory.make_remove_osc_subscription_command(0, "alice", _host, _port));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_TRUE(mute_cmds.empty());
+
+    // Enabling it while it has a subscriber needs no mute
+    cmd = CMD_UPTR(factory.make_add_osc_subscription_command(0, "alice", _host, _port, 10));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    cmd = CMD_UPTR(factory.make_set_enabled_command(0, true));
+    ASSERT_EQ(CommandErrorCode::OK, _backend.apply_command(cmd.get()));
+    _backend.update_subscriptions(std::back_inserter(mute_cmds));
+    ASSERT_TRUE(mute_cmds.empty());
+}
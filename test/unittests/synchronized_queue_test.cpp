@@ -61,3 +61,55 @@ TEST(SynchronizedQueueTest, ordertest)
     push_thread.join();
 }
 
+
+TEST(SynchronizedQueueTest, depth_metrics)
+{
+    SynchronizedQueue<TestContainer> module_under_test;
+    sensei::metrics::MetricsRegistry registry;
+    auto depth = registry.gauge("depth", "");
+    auto high_water = registry.gauge("high_water", "");
+    module_under_test.push(TestContainer());
+    module_under_test.set_depth_metrics(depth, high_water);
+    EXPECT_EQ(1, depth->value());
+
+    std::vector<TestContainer> batch(3);
+    module_under_test.push_all(batch);
+    EXPECT_EQ(4, depth->value());
+    module_under_test.pop();
+    module_under_test.pop();
+    EXPECT_EQ(2, depth->value());
+    EXPECT_EQ(4, high_water->value());
+}
+
+TEST(SynchronizedQueueTest, partial_depth_metrics)
+{
+    SynchronizedQueue<TestContainer> module_under_test;
+    sensei::metrics::MetricsRegistry registry;
+    auto depth = registry.gauge("depth", "");
+    auto high_water = registry.gauge("high_water", "");
+    module_under_test.set_depth_metrics(depth, nullptr);
+    module_under_test.push(TestContainer());
+    EXPECT_EQ(1, depth->value());
+
+    module_under_test.set_depth_metrics(nullptr, high_water);
+    module_under_test.push(TestContainer());
+    module_under_test.pop();
+    EXPECT_EQ(1, depth->value());
+    EXPECT_EQ(2, high_water->value());
+}
+
+TEST(SynchronizedQueueTest, max_size)
+{
+    SynchronizedQueue<TestContainer> module_under_test;
+    std::vector<TestContainer> batch(3);
+    module_under_test.push_all(batch);
+    module_under_test.pop();
+    module_under_test.pop();
+    EXPECT_EQ(3u, module_under_test.max_size());
+
+    module_under_test.reset_max_size();
+    EXPECT_EQ(1u, module_under_test.max_size());
+    module_under_test.push(TestContainer());
+    module_under_test.pop();
+    EXPECT_EQ(2u, module_under_test.max_size());
+}
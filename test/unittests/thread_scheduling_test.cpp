@@ -0,0 +1,83 @@
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <sched.h>
+
+#include "gtest/gtest.h"
+
+#include "thread_scheduling.cpp"
+
+using namespace sensei;
+
+TEST(TestThreadScheduling, test_default_config)
+{
+    ThreadSchedulingConfig config;
+    EXPECT_FALSE(config.is_set());
+    EXPECT_TRUE(apply_current_thread_scheduling(config, "test"));
+}
+
+TEST(TestThreadScheduling, test_affinity)
+{
+    cpu_set_t initial_cpus;
+    ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &initial_cpus));
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &initial_cpus))
+    {
+        cpu++;
+    }
+
+    std::thread thread([&]()
+    {
+        ThreadSchedulingConfig config;
+        config.policy = SchedulingPolicy::OTHER;
+        config.cpus = {cpu};
+        EXPECT_TRUE(config.is_set());
+        EXPECT_TRUE(apply_current_thread_scheduling(config, "test"));
+
+        cpu_set_t cpus;
+        ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus));
+        EXPECT_EQ(1, CPU_COUNT(&cpus));
+        EXPECT_TRUE(CPU_ISSET(cpu, &cpus));
+
+        /* Failures are reported */
+        config.cpus = {CPU_SETSIZE};
+        EXPECT_FALSE(apply_thread_scheduling(pthread_self(), config, "test"));
+    });
+    thread.join();
+}
+
+TEST(TestThreadScheduling, test_measure_latency)
+{
+    auto stats = measure_scheduling_latency(5, std::chrono::microseconds(100));
+    EXPECT_EQ(5, stats.samples);
+    EXPECT_LE(stats.mean, stats.max);
+}
+
+TEST(TestThreadScheduling, test_thread_cpu_times)
+{
+    std::atomic<bool> registered{false};
+    std::atomic<bool> done{false};
+    std::thread thread([&]()
+    {
+        apply_current_thread_scheduling(ThreadSchedulingConfig(), "cpu test");
+        registered = true;
+        while (!done)
+        {
+            std::this_thread::yield();
+        }
+    });
+    while (!registered)
+    {
+        std::this_thread::yield();
+    }
+    auto times = thread_cpu_times();
+    auto entry = std::find_if(times.begin(), times.end(), [](const auto& t) {return t.name == "cpu test";});
+    ASSERT_NE(times.end(), entry);
+    EXPECT_GT(entry->cpu_time.count(), 0);
+    done = true;
+    thread.join();
+
+    /* Threads that have exited are left out */
+    times = thread_cpu_times();
+    EXPECT_TRUE(std::none_of(times.begin(), times.end(), [](const auto& t) {return t.name == "cpu test";}));
+}
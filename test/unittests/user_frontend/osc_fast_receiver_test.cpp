@@ -0,0 +1,227 @@
+#include <vector>
+#include <cstring>
+#include <arpa/inet.h>
+
+#include "gtest/gtest.h"
+
+#include "user_frontend/osc_parser.cpp"
+#include "user_frontend/osc_fast_receiver.cpp"
+
+#include "../test_utils.h"
+
+using namespace sensei;
+using namespace sensei::user_frontend;
+
+// Minimal OSC encoder for building test packets
+class OscPacketBuilder
+{
+public:
+    OscPacketBuilder(const std::string& address, const std::string& types)
+    {
+        _add_string(address);
+        _add_string("," + types);
+    }
+
+    OscPacketBuilder& add(int32_t value)
+    {
+        uint32_t raw = htonl(static_cast<uint32_t>(value));
+        _data.insert(_data.end(), reinterpret_cast<char*>(&raw), reinterpret_cast<char*>(&raw) + 4);
+        return *this;
+    }
+
+    OscPacketBuilder& add(float value)
+    {
+        int32_t raw;
+        std::memcpy(&raw, &value, sizeof(raw));
+        return add(raw);
+    }
+
+    OscPacketBuilder& add(const std::vector<float>& blob)
+    {
+        add(static_cast<int32_t>(blob.size() * 4));
+        for (auto value : blob)
+        {
+            add(value);
+        }
+        return *this;
+    }
+
+    const std::vector<char>& data() const
+    {
+        return _data;
+    }
+
+    // Wrap a number of messages in a bundle
+    static OscPacketBuilder bundle(const std::vector<OscPacketBuilder>& messages)
+    {
+        OscPacketBuilder bundle;
+        bundle._add_string("#bundle");
+        bundle.add(0).add(1);
+        for (const auto& message : messages)
+        {
+            bundle.add(static_cast<int32_t>(message.data().size()));
+            bundle._data.insert(bundle._data.end(), message.data().begin(), message.data().end());
+        }
+        return bundle;
+    }
+
+private:
+    OscPacketBuilder() = default;
+
+    void _add_string(const std::string& str)
+    {
+        _data.insert(_data.end(), str.begin(), str.end());
+        _data.resize((_data.size() / 4 + 1) * 4, '\0');
+    }
+
+    std::vector<char> _data;
+};
+
+TEST(TestOscParser, test_lookup_address)
+{
+    ASSERT_EQ(osc_parser::OscAddress::SET_ENABLED, osc_parser::lookup_address("/set_enabled", 12));
+    ASSERT_EQ(osc_parser::OscAddress::SET_OUTPUT, osc_parser::lookup_address("/set_output", 11));
+    ASSERT_EQ(osc_parser::OscAddress::SET_RANGE_OUTPUT, osc_parser::lookup_address("/set_range_output", 17));
+    ASSERT_EQ(osc_parser::OscAddress::UNKNOWN, osc_parser::lookup_address("/set_outpu", 10));
+    ASSERT_EQ(osc_parser::OscAddress::UNKNOWN, osc_parser::lookup_address("/get_output", 11));
+}
+
+TEST(TestOscParser, test_parse_message)
+{
+    osc_parser::OscMessageView message;
+    auto packet = OscPacketBuilder("/set_output", "if").add(5).add(0.25f);
+    ASSERT_TRUE(osc_parser::parse_message(packet.data().data(), packet.data().size(), message));
+    ASSERT_EQ(osc_parser::OscAddress::SET_OUTPUT, message.address);
+    ASSERT_EQ(2, message.argc);
+    ASSERT_EQ('i', message.types[0]);
+    ASSERT_EQ(5, message.argv[0].i);
+    ASSERT_EQ('f', message.types[1]);
+    ASSERT_FLOAT_EQ(0.25f, message.argv[1].f);
+}
+
+TEST(TestOscParser, test_malformed_messages)
+{
+    osc_parser::OscMessageView message;
+    // Truncated arguments
+    auto packet = OscPacketBuilder("/set_output", "if").add(5);
+    ASSERT_FALSE(osc_parser::parse_message(packet.data().data(), packet.data().size(), message));
+    // Unsupported argument type
+    packet = OscPacketBuilder("/set_output", "is").add(5).add(0);
+    ASSERT_FALSE(osc_parser::parse_message(packet.data().data(), packet.data().size(), message));
+    // Unknown address
+    packet = OscPacketBuilder("/set_something", "if").add(5).add(0.5f);
+    ASSERT_FALSE(osc_parser::parse_message(packet.data().data(), packet.data().size(), message));
+    // Missing type tags
+    const char no_tags[] = "/set_output\0";
+    ASSERT_FALSE(osc_parser::parse_message(no_tags, sizeof(no_tags) - 1, message));
+}
+
+TEST(TestOscParser, test_parse_bundle)
+{
+    osc_parser::OscMessageView message;
+    auto packet = OscPacketBuilder::bundle({OscPacketBuilder("/set_output", "if").add(1).add(0.5f),
+                                            OscPacketBuilder::bundle({OscPacketBuilder("/set_enabled", "ii").add(2).add(1)}),
+                                            OscPacketBuilder("/set_outputs", "ib").add(3).add(std::vector<float>{0.25f, 0.75f})});
+    std::vector<osc_parser::OscAddress> addresses;
+    int blob_size = 0;
+    auto callback = [&](const osc_parser::OscMessageView& m)
+    {
+        addresses.push_back(m.address);
+        if (m.address == osc_parser::OscAddress::SET_OUTPUTS)
+        {
+            blob_size = m.argv[1].b.size;
+        }
+    };
+    osc_parser::parse_packet(packet.data().data(), packet.data().size(), message, callback);
+    ASSERT_EQ(3u, addresses.size());
+    ASSERT_EQ(osc_parser::OscAddress::SET_OUTPUT, addresses[0]);
+    ASSERT_EQ(osc_parser::OscAddress::SET_ENABLED, addresses[1]);
+    ASSERT_EQ(osc_parser::OscAddress::SET_OUTPUTS, addresses[2]);
+    ASSERT_EQ(8, blob_size);
+}
+
+class TestOSCFastReceiver : public ::testing::Test
+{
+protected:
+    void SetUp()
+    {
+        ASSERT_TRUE(_module_under_test.start(_port));
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        std::memset(&_address, 0, sizeof(_address));
+        _address.sin_family = AF_INET;
+        _address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        _address.sin_port = htons(_port);
+    }
+
+    void TearDown()
+    {
+        close(_socket);
+        _module_under_test.stop();
+    }
+
+    void send_packet(const OscPacketBuilder& packet)
+    {
+        sendto(_socket, packet.data().data(), packet.data().size(), 0,
+               reinterpret_cast<sockaddr*>(&_address), sizeof(_address));
+    }
+
+    std::unique_ptr<BaseMessage> wait_for_message()
+    {
+        for (int i = 0; i < 50 && _event_queue.empty(); ++i)
+        {
+            _event_queue.wait_for_data(std::chrono::milliseconds(10));
+        }
+        return _event_queue.empty() ? nullptr : _event_queue.pop();
+    }
+
+    SynchronizedQueue<std::unique_ptr<BaseMessage>> _event_queue;
+    OSCFastReceiver _module_under_test{&_event_queue};
+    int _port{25010};
+    int _socket;
+    sockaddr_in _address;
+};
+
+TEST_F(TestOSCFastReceiver, test_set_output)
+{
+    send_packet(OscPacketBuilder("/set_output", "if").add(5).add(0.5f));
+    auto event = wait_for_message();
+    ASSERT_NE(nullptr, event);
+    ASSERT_EQ(MessageType::VALUE, event->base_type());
+    auto val = static_unique_ptr_cast<FloatSetValue, BaseMessage>(std::move(event));
+    ASSERT_EQ(ValueType::FLOAT_SET, val->type());
+    ASSERT_EQ(5, val->index());
+    ASSERT_FLOAT_EQ(0.5f, val->value());
+}
+
+TEST_F(TestOSCFastReceiver, test_set_enabled)
+{
+    send_packet(OscPacketBuilder("/set_unknown", "ii").add(3).add(1));
+    send_packet(OscPacketBuilder("/set_enabled", "ii").add(3).add(1));
+    auto event = wait_for_message();
+    ASSERT_NE(nullptr, event);
+    ASSERT_EQ(MessageType::COMMAND, event->base_type());
+    auto cmd = static_unique_ptr_cast<SetEnabledCommand, BaseMessage>(std::move(event));
+    ASSERT_EQ(3, cmd->index());
+    ASSERT_TRUE(cmd->data());
+    ASSERT_TRUE(_event_queue.empty());
+}
+
+TEST_F(TestOSCFastReceiver, test_set_outputs_batch)
+{
+    send_packet(OscPacketBuilder::bundle({OscPacketBuilder("/set_output", "if").add(1).add(0.5f),
+                                          OscPacketBuilder("/set_outputs", "ifif").add(2).add(0.1f).add(4).add(0.2f),
+                                          OscPacketBuilder("/set_outputs", "ib").add(6).add(std::vector<float>{0.3f, 0.4f})}));
+    auto event = wait_for_message();
+    ASSERT_NE(nullptr, event);
+    ASSERT_EQ(MessageType::VALUE, event->base_type());
+    auto val = static_unique_ptr_cast<FloatSetBatchValue, BaseMessage>(std::move(event));
+    ASSERT_EQ(ValueType::FLOAT_SET_BATCH, val->type());
+    const auto& values = val->values();
+    ASSERT_EQ(5u, values.size());
+    ASSERT_EQ(1, values[0].index);
+    ASSERT_EQ(4, values[2].index);
+    ASSERT_FLOAT_EQ(0.2f, values[2].value);
+    ASSERT_EQ(7, values[4].index);
+    ASSERT_FLOAT_EQ(0.4f, values[4].value);
+    ASSERT_TRUE(_event_queue.empty());
+}
@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+
+#define private public
+#include "user_frontend/shm_input_receiver.cpp"
+#undef private
+
+#include "../test_utils.h"
+
+using namespace sensei;
+using namespace sensei::user_frontend;
+
+constexpr char TEST_SHM_NAME[] = "/sensei_unit_test_outputs";
+
+class TestShmInputReceiver : public ::testing::Test
+{
+protected:
+    void SetUp()
+    {
+        ASSERT_TRUE(_module_under_test.start(TEST_SHM_NAME, 64));
+        ASSERT_TRUE(_writer.open(TEST_SHM_NAME));
+    }
+
+    void TearDown()
+    {
+        _writer.close();
+        _module_under_test.stop();
+    }
+
+    std::unique_ptr<BaseMessage> wait_for_message()
+    {
+        for (int i = 0; i < 50 && _event_queue.empty(); ++i)
+        {
+            _event_queue.wait_for_data(std::chrono::milliseconds(10));
+        }
+        return _event_queue.empty() ? nullptr : _event_queue.pop();
+    }
+
+    SynchronizedQueue<std::unique_ptr<BaseMessage>> _event_queue;
+    ShmInputReceiver _module_under_test{&_event_queue};
+    ShmOutputWriter _writer;
+};
+
+TEST_F(TestShmInputReceiver, test_writer_open)
+{
+    ShmOutputWriter writer;
+    ASSERT_FALSE(writer.open("/sensei_unit_test_not_existing"));
+    ASSERT_FALSE(writer.set_output(0, 0.5f));
+    ASSERT_TRUE(_writer.is_open());
+    ASSERT_FALSE(_writer.set_output(64, 0.5f));
+    ASSERT_FALSE(_writer.set_output(-1, 0.5f));
+}
+
+TEST_F(TestShmInputReceiver, test_single_value)
+{
+    ASSERT_TRUE(_writer.set_output(5, 0.25f));
+    auto event = wait_for_message();
+    ASSERT_NE(nullptr, event);
+    auto val = static_unique_ptr_cast<FloatSetValue, BaseMessage>(std::move(event));
+    ASSERT_EQ(ValueType::FLOAT_SET, val->type());
+    ASSERT_EQ(5, val->index());
+    ASSERT_FLOAT_EQ(0.25f, val->value());
+}
+
+TEST_F(TestShmInputReceiver, test_collapsed_values)
+{
+    // Stop polling so that all writes are seen in the same poll
+    _module_under_test._running = false;
+    _module_under_test._poll_thread.join();
+    _writer.set_output(3, 0.1f);
+    _writer.set_output(63, 0.2f);
+    _writer.set_output(3, 0.3f);
+    _module_under_test._collect_dirty_values();
+
+    ASSERT_FALSE(_event_queue.empty());
+    auto val = static_unique_ptr_cast<FloatSetBatchValue, BaseMessage>(_event_queue.pop());
+    ASSERT_EQ(ValueType::FLOAT_SET_BATCH, val->type());
+    ASSERT_EQ(2u, val->values().size());
+    ASSERT_EQ(3, val->values()[0].index);
+    ASSERT_FLOAT_EQ(0.3f, val->values()[0].value);
+    ASSERT_EQ(63, val->values()[1].index);
+    ASSERT_TRUE(_event_queue.empty());
+}